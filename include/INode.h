@@ -43,6 +43,7 @@ struct OutsForAmount {
 struct TransactionShortInfo {
   Crypto::Hash txId;
   TransactionPrefix txPrefix;
+  std::vector<uint32_t> globalIndexes; // empty if the node did not send them
 };
 
 struct BlockShortEntry {
@@ -50,6 +51,7 @@ struct BlockShortEntry {
   bool hasBlock;
   CryptoNote::Block block;
   std::vector<TransactionShortInfo> txsShortInfo;
+  std::vector<uint32_t> baseTransactionGlobalIndexes; // empty if the node did not send them
 };
 
 class INode {
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <limits>
+#include <map>
 #include <vector>
 #include "crypto/hash.h"
 #include "ITransaction.h"
@@ -92,6 +93,11 @@ public:
   virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const = 0;
   virtual void getUnconfirmedTransactions(std::vector<Crypto::Hash>& transactions) const = 0;
   virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const = 0;
+  // unlocked key outputs, the same outputs as getOutputs(IncludeKeyUnlocked) ordered by amount
+  virtual size_t spendableOutputsCount() const = 0;
+  virtual void getSpendableAmounts(std::map<uint64_t, size_t>& outputsCounts) const = 0;
+  virtual bool getSpendableOutput(size_t index, TransactionOutputInformation& output) const = 0;
+  virtual void getSpendableOutputs(uint64_t amount, std::vector<TransactionOutputInformation>& outputs) const = 0;
 };
 
 }
@@ -0,0 +1,263 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "Metrics.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace Common {
+
+namespace {
+
+const double SUMMARY_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+size_t getHighestBit(uint64_t value) {
+  size_t bit = 0;
+  for (size_t step = 32; step > 0; step /= 2) {
+    if ((value >> (bit + step)) != 0) {
+      bit += step;
+    }
+  }
+
+  return bit;
+}
+
+std::string joinLabels(const std::string& labels, const std::string& label) {
+  if (labels.empty()) {
+    return "{" + label + "}";
+  }
+
+  return "{" + labels + "," + label + "}";
+}
+
+std::string formatLabels(const std::string& labels) {
+  return labels.empty() ? labels : "{" + labels + "}";
+}
+
+}
+
+MetricCounter::MetricCounter() : m_value(0) {
+}
+
+void MetricCounter::add(uint64_t value) {
+  m_value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t MetricCounter::get() const {
+  return m_value.load(std::memory_order_relaxed);
+}
+
+MetricGauge::MetricGauge() : m_value(0) {
+}
+
+void MetricGauge::add(int64_t value) {
+  m_value.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t MetricGauge::get() const {
+  return m_value.load(std::memory_order_relaxed);
+}
+
+void MetricGauge::set(int64_t value) {
+  m_value.store(value, std::memory_order_relaxed);
+}
+
+MetricHistogram::MetricHistogram() : m_count(0), m_sum(0) {
+  for (std::atomic<uint64_t>& bucket : m_buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t MetricHistogram::getCount() const {
+  return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t MetricHistogram::getQuantile(double quantile) const {
+  // the buckets are counted again, a value recorded meanwhile may be in the buckets and not in m_count yet
+  uint64_t counts[BUCKET_COUNT];
+  uint64_t count = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+    count += counts[i];
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * count));
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return getBucketMaxValue(i);
+    }
+  }
+
+  return getBucketMaxValue(BUCKET_COUNT - 1);
+}
+
+uint64_t MetricHistogram::getSum() const {
+  return m_sum.load(std::memory_order_relaxed);
+}
+
+void MetricHistogram::record(uint64_t value) {
+  m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void MetricHistogram::recordDuration(std::chrono::steady_clock::duration duration) {
+  auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  record(microseconds > 0 ? static_cast<uint64_t>(microseconds) : 0);
+}
+
+// Values of [2^n, 2^(n+1)) for n >= SUB_BUCKET_BITS are split in SUB_BUCKET_COUNT buckets by the SUB_BUCKET_BITS bits
+// below the highest one.
+size_t MetricHistogram::getBucketIndex(uint64_t value) {
+  if (value < SUB_BUCKET_COUNT) {
+    return static_cast<size_t>(value);
+  }
+
+  size_t shift = getHighestBit(value) - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKET_COUNT + static_cast<size_t>((value >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+uint64_t MetricHistogram::getBucketMaxValue(size_t index) {
+  if (index < SUB_BUCKET_COUNT) {
+    return index;
+  }
+
+  size_t shift = index / SUB_BUCKET_COUNT - 1;
+  uint64_t subBucket = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+  // wraps around to UINT64_MAX for the last bucket
+  return ((subBucket + 1) << shift) - 1;
+}
+
+MetricTimer::MetricTimer(MetricHistogram& histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {
+}
+
+MetricTimer::~MetricTimer() {
+  m_histogram.recordDuration(std::chrono::steady_clock::now() - m_start);
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+std::string MetricsRegistry::label(const std::string& name, const std::string& value) {
+  std::string result = name + "=\"";
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      result += '\\';
+      result += c;
+    } else if (c == '\n') {
+      result += "\\n";
+    } else {
+      result += c;
+    }
+  }
+
+  return result + "\"";
+}
+
+MetricsRegistry::MetricsRegistry() {
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::unique_ptr<MetricCounter>& metric = getFamily(name, help, MetricType::COUNTER).counters[labels];
+  if (!metric) {
+    metric.reset(new MetricCounter());
+  }
+
+  return *metric;
+}
+
+std::string MetricsRegistry::format() const {
+  std::ostringstream stream;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (const auto& familyEntry : m_families) {
+    const std::string& name = familyEntry.first;
+    const MetricFamily& family = familyEntry.second;
+    stream << "# HELP " << name << " " << family.help << "\n";
+    switch (family.type) {
+    case MetricType::COUNTER:
+      stream << "# TYPE " << name << " counter\n";
+      for (const auto& metric : family.counters) {
+        stream << name << formatLabels(metric.first) << " " << metric.second->get() << "\n";
+      }
+
+      break;
+
+    case MetricType::GAUGE:
+      stream << "# TYPE " << name << " gauge\n";
+      for (const auto& metric : family.gauges) {
+        stream << name << formatLabels(metric.first) << " " << metric.second->get() << "\n";
+      }
+
+      break;
+
+    case MetricType::HISTOGRAM:
+      stream << "# TYPE " << name << " summary\n";
+      for (const auto& metric : family.histograms) {
+        for (double quantile : SUMMARY_QUANTILES) {
+          std::ostringstream quantileValue;
+          quantileValue << quantile;
+          stream << name << joinLabels(metric.first, label("quantile", quantileValue.str())) << " " << metric.second->getQuantile(quantile) << "\n";
+        }
+
+        stream << name << "_sum" << formatLabels(metric.first) << " " << metric.second->getSum() << "\n";
+        stream << name << "_count" << formatLabels(metric.first) << " " << metric.second->getCount() << "\n";
+      }
+
+      break;
+    }
+  }
+
+  return stream.str();
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::unique_ptr<MetricGauge>& metric = getFamily(name, help, MetricType::GAUGE).gauges[labels];
+  if (!metric) {
+    metric.reset(new MetricGauge());
+  }
+
+  return *metric;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::unique_ptr<MetricHistogram>& metric = getFamily(name, help, MetricType::HISTOGRAM).histograms[labels];
+  if (!metric) {
+    metric.reset(new MetricHistogram());
+  }
+
+  return *metric;
+}
+
+MetricsRegistry::MetricFamily& MetricsRegistry::getFamily(const std::string& name, const std::string& help, MetricType type) {
+  auto result = m_families.emplace(name, MetricFamily());
+  MetricFamily& family = result.first->second;
+  if (result.second) {
+    family.type = type;
+    family.help = help;
+  } else if (family.type != type) {
+    throw std::invalid_argument("Metric " + name + " is registered as another kind of metric");
+  }
+
+  return family;
+}
+
+}
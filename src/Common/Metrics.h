@@ -0,0 +1,131 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Common {
+
+// Metrics are updated with relaxed atomic operations only, from any thread.
+// The registry is locked when a metric is looked up or the metrics are formatted, so code that updates a metric often
+// keeps the reference returned by the registry.
+
+class MetricCounter {
+public:
+  MetricCounter();
+  MetricCounter(const MetricCounter&) = delete;
+  MetricCounter& operator=(const MetricCounter&) = delete;
+
+  void add(uint64_t value = 1);
+  uint64_t get() const;
+
+private:
+  std::atomic<uint64_t> m_value;
+};
+
+class MetricGauge {
+public:
+  MetricGauge();
+  MetricGauge(const MetricGauge&) = delete;
+  MetricGauge& operator=(const MetricGauge&) = delete;
+
+  void add(int64_t value);
+  int64_t get() const;
+  void set(int64_t value);
+
+private:
+  std::atomic<int64_t> m_value;
+};
+
+// Counts values in buckets whose width is 1/8 of their lower bound, so a quantile is off by at most 12.5%, like an HDR
+// histogram with 3 significant bits. Values below 8 have a bucket each.
+class MetricHistogram {
+public:
+  MetricHistogram();
+  MetricHistogram(const MetricHistogram&) = delete;
+  MetricHistogram& operator=(const MetricHistogram&) = delete;
+
+  uint64_t getCount() const;
+  // Returns the highest value of the bucket that holds the given quantile, 0 if nothing is recorded.
+  uint64_t getQuantile(double quantile) const;
+  uint64_t getSum() const;
+  void record(uint64_t value);
+  void recordDuration(std::chrono::steady_clock::duration duration); // in microseconds
+
+private:
+  static const size_t SUB_BUCKET_BITS = 3;
+  static const size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+  static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  static size_t getBucketIndex(uint64_t value);
+  static uint64_t getBucketMaxValue(size_t index);
+
+  std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_sum;
+};
+
+// Records the time from its construction to its destruction in a histogram.
+class MetricTimer {
+public:
+  explicit MetricTimer(MetricHistogram& histogram);
+  MetricTimer(const MetricTimer&) = delete;
+  ~MetricTimer();
+  MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+  MetricHistogram& m_histogram;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// Metrics of the process by name and labels, formatted in the Prometheus text format.
+// Metrics are never removed, the same name and labels always give the same metric.
+// labels are formatted already, as made by label(), for example: command="2001",peer="1"
+class MetricsRegistry {
+public:
+  static MetricsRegistry& instance();
+  static std::string label(const std::string& name, const std::string& value);
+
+  MetricsRegistry();
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // The help text given first for a name is kept. A name is used for one kind of metric only, std::invalid_argument
+  // is thrown otherwise.
+  MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = std::string());
+  // Counters and gauges are written as they are, histograms as summaries with the 0.5, 0.9, 0.99 and 0.999 quantiles.
+  std::string format() const;
+  MetricGauge& gauge(const std::string& name, const std::string& help, const std::string& labels = std::string());
+  MetricHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = std::string());
+
+private:
+  enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+  };
+
+  struct MetricFamily {
+    MetricType type;
+    std::string help;
+    std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+    std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+    std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+  };
+
+  MetricFamily& getFamily(const std::string& name, const std::string& help, MetricType type);
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, MetricFamily> m_families;
+};
+
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "RecursiveSharedMutex.h"
+
+#include <cassert>
+
+namespace Common {
+
+RecursiveSharedMutex::RecursiveSharedMutex() : m_ownerDepth(0), m_waitingWriters(0) {
+}
+
+void RecursiveSharedMutex::lock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::thread::id self = std::this_thread::get_id();
+  if (m_owner == self) {
+    ++m_ownerDepth;
+    return;
+  }
+
+  assert(m_readerDepths.count(self) == 0);
+  ++m_waitingWriters;
+  m_released.wait(lock, [this] { return m_owner == std::thread::id() && m_readerDepths.empty(); });
+  --m_waitingWriters;
+  m_owner = self;
+  m_ownerDepth = 1;
+}
+
+void RecursiveSharedMutex::unlock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  assert(m_owner == std::this_thread::get_id() && m_ownerDepth != 0);
+  if (--m_ownerDepth == 0) {
+    m_owner = std::thread::id();
+    m_released.notify_all();
+  }
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::thread::id self = std::this_thread::get_id();
+
+  // the exclusive owner already excludes everybody else
+  if (m_owner == self) {
+    ++m_ownerDepth;
+    return;
+  }
+
+  // a reader that is already inside is not stopped by a waiting writer, that writer waits for it anyway
+  auto reader = m_readerDepths.find(self);
+  if (reader != m_readerDepths.end()) {
+    ++reader->second;
+    return;
+  }
+
+  m_released.wait(lock, [this] { return m_owner == std::thread::id() && m_waitingWriters == 0; });
+  m_readerDepths[self] = 1;
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::thread::id self = std::this_thread::get_id();
+  if (m_owner == self) {
+    assert(m_ownerDepth != 0);
+    if (--m_ownerDepth == 0) {
+      m_owner = std::thread::id();
+      m_released.notify_all();
+    }
+
+    return;
+  }
+
+  auto reader = m_readerDepths.find(self);
+  assert(reader != m_readerDepths.end() && reader->second != 0);
+  if (--reader->second == 0) {
+    m_readerDepths.erase(reader);
+    if (m_readerDepths.empty()) {
+      m_released.notify_all();
+    }
+  }
+}
+
+}
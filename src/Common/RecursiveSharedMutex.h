@@ -0,0 +1,58 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace Common {
+
+// Shared/exclusive mutex that can be entered again by a thread that is already inside it.
+// A thread holding exclusive ownership may take it again or take shared ownership, a thread holding
+// shared ownership may take shared ownership again but must not ask for exclusive ownership.
+// Writers are preferred: a thread that does not hold the mutex yet waits for the waiting writers before
+// it takes shared ownership, so a steady stream of readers can not keep a writer out. A thread must
+// therefore not wait for a lock or a thread that needs this mutex while it is waiting for shared ownership.
+class RecursiveSharedMutex {
+public:
+  RecursiveSharedMutex();
+  RecursiveSharedMutex(const RecursiveSharedMutex&) = delete;
+  RecursiveSharedMutex& operator=(const RecursiveSharedMutex&) = delete;
+
+  void lock();
+  void unlock();
+  void lock_shared();
+  void unlock_shared();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_released;
+  std::thread::id m_owner;
+  size_t m_ownerDepth;
+  size_t m_waitingWriters;
+  std::unordered_map<std::thread::id, size_t> m_readerDepths;
+};
+
+template<class Mutex> class SharedLockGuard {
+public:
+  explicit SharedLockGuard(Mutex& mutex) : m_mutex(mutex) {
+    m_mutex.lock_shared();
+  }
+
+  ~SharedLockGuard() {
+    m_mutex.unlock_shared();
+  }
+
+  SharedLockGuard(const SharedLockGuard&) = delete;
+  SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+private:
+  Mutex& m_mutex;
+};
+
+}
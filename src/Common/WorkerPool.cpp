@@ -0,0 +1,108 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "WorkerPool.h"
+
+namespace Common {
+
+WorkerPool::WorkerPool(size_t threadCount) : m_stopped(false), m_loopId(0), m_busyThreads(0), m_job(nullptr), m_count(0), m_nextIndex(0), m_failed(false) {
+  for (size_t i = 1; i < threadCount; ++i) {
+    m_threads.emplace_back(&WorkerPool::workerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+
+  m_loopStarted.notify_all();
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+size_t WorkerPool::getThreadCount() const {
+  return m_threads.size() + 1;
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& job) {
+  if (count == 0) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> loopLock(m_loopMutex);
+  m_job = &job;
+  m_count = count;
+  m_nextIndex = 0;
+  m_failed = false;
+  m_exception = nullptr;
+
+  // a single job is not worth waking anybody up
+  if (count > 1 && !m_threads.empty()) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      ++m_loopId;
+      m_busyThreads = m_threads.size();
+    }
+
+    m_loopStarted.notify_all();
+    runJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_loopFinished.wait(lock, [this] { return m_busyThreads == 0; });
+  } else {
+    runJobs();
+  }
+
+  m_job = nullptr;
+  if (m_exception) {
+    std::rethrow_exception(m_exception);
+  }
+}
+
+void WorkerPool::workerLoop() {
+  uint64_t lastLoopId = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_loopStarted.wait(lock, [&] { return m_stopped || m_loopId != lastLoopId; });
+      if (m_stopped) {
+        return;
+      }
+
+      lastLoopId = m_loopId;
+    }
+
+    runJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (--m_busyThreads == 0) {
+      m_loopFinished.notify_one();
+    }
+  }
+}
+
+void WorkerPool::runJobs() {
+  while (!m_failed) {
+    size_t index = m_nextIndex++;
+    if (index >= m_count) {
+      break;
+    }
+
+    try {
+      (*m_job)(index);
+    } catch (...) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (!m_exception) {
+        m_exception = std::current_exception();
+      }
+
+      m_failed = true;
+    }
+  }
+}
+
+}
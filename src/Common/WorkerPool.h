@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+// Fixed set of threads that run parallel loops.
+// The calling thread takes part in every loop, so a pool with threadCount 1 has no worker threads
+// and runs everything on the caller.
+class WorkerPool {
+public:
+  explicit WorkerPool(size_t threadCount);
+  WorkerPool(const WorkerPool&) = delete;
+  ~WorkerPool();
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  size_t getThreadCount() const;
+
+  // Calls job(i) for every i in [0, count) and returns when all calls are done.
+  // The first exception thrown by a job is rethrown here after the remaining jobs are skipped.
+  // Loops started from several threads run one after another.
+  void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+private:
+  void workerLoop();
+  void runJobs();
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_loopMutex;
+  std::mutex m_mutex;
+  std::condition_variable m_loopStarted;
+  std::condition_variable m_loopFinished;
+  bool m_stopped;
+  uint64_t m_loopId;
+  size_t m_busyThreads;
+
+  const std::function<void(size_t)>* m_job;
+  size_t m_count;
+  std::atomic<size_t> m_nextIndex;
+  std::atomic<bool> m_failed;
+  std::exception_ptr m_exception;
+};
+
+}
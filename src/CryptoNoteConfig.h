@@ -65,9 +65,11 @@ const size_t   FUSION_TX_MIN_IN_OUT_COUNT_RATIO              = 4;
 const char     CRYPTONOTE_BLOCKS_FILENAME[]                  = "blocks.dat";
 const char     CRYPTONOTE_BLOCKINDEXES_FILENAME[]            = "blockindexes.dat";
 const char     CRYPTONOTE_BLOCKSCACHE_FILENAME[]             = "blockscache.dat";
+const char     CRYPTONOTE_BLOCKSSUMMARY_FILENAME[]           = "blockssummary.dat";
 const char     CRYPTONOTE_POOLDATA_FILENAME[]                = "poolstate.bin";
 const char     P2P_NET_DATA_FILENAME[]                       = "p2pstate.bin";
 const char     CRYPTONOTE_BLOCKCHAIN_INDEXES_FILENAME[]      = "blockchainindexes.dat";
+const char     CRYPTONOTE_OUTPUTKEYS_FILENAME[]              = "outputkeys.dat";
 const char     MINER_CONFIG_FILE_NAME[]                      = "miner_conf.json";
 
 // HARD_FORK_HEIGHT_1 was originally set to height 230,500 but was later removed from the code because
@@ -92,7 +94,9 @@ const char     GENESIS_COINBASE_TX_HEX[]                     = "013c01ff0001a7d7
 const uint8_t  CURRENT_TRANSACTION_VERSION                   = 1;
 const size_t   BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT        = 10000;  //by default, blocks ids count in synchronizing
 const size_t   BLOCKS_SYNCHRONIZING_DEFAULT_COUNT            = 20;    //by default, blocks count in blocks downloading
+const size_t   BLOCKS_SYNCHRONIZING_MAX_DOWNLOADED_COUNT     = 1000;  //blocks downloaded ahead of the blockchain before connections stop requesting more
 const size_t   CORE_RPC_COMMAND_GET_BLOCKS_FAST_MAX_COUNT    = 1000;
+const size_t   BLOCK_ENTRY_CACHE_MAX_SIZE                    = 32 * 1024 * 1024; // 32 MB of block and transaction blobs kept ready for wallet synchronization requests
 const int      P2P_DEFAULT_PORT                              = 12275;
 const int      RPC_DEFAULT_PORT                              = 12276;
 const int      WALLETD_DEFAULT_PORT                          = 12277;
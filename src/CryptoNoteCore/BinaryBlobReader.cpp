@@ -0,0 +1,182 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BinaryBlobReader.h"
+
+#include <vector>
+
+#include "CryptoTypes.h"
+
+namespace CryptoNote {
+
+namespace {
+
+// Variant tags written by CryptoNoteSerialization.cpp
+const uint8_t BASE_INPUT_TAG = 0xff;
+const uint8_t KEY_INPUT_TAG = 0x2;
+const uint8_t MULTISIGNATURE_INPUT_TAG = 0x3;
+const uint8_t KEY_OUTPUT_TAG = 0x2;
+const uint8_t MULTISIGNATURE_OUTPUT_TAG = 0x3;
+
+// prev_id, nonce, timestamp and merkle_root
+const size_t BLOCK_HEADER_SIZE = sizeof(Crypto::Hash) + sizeof(uint64_t) + sizeof(uint64_t) + sizeof(Crypto::Hash);
+
+}
+
+BinaryBlobReader::BinaryBlobReader(Common::StringView blob) : m_blob(blob), m_position(0) {
+}
+
+size_t BinaryBlobReader::getPosition() const {
+  return m_position;
+}
+
+bool BinaryBlobReader::endOfBlob() const {
+  return m_position == m_blob.getSize();
+}
+
+Common::StringView BinaryBlobReader::range(size_t begin, size_t end) const {
+  return m_blob.range(begin, end);
+}
+
+bool BinaryBlobReader::readVarint(uint64_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 64; shift += 7) {
+    uint8_t piece;
+    if (!readByte(piece)) {
+      return false;
+    }
+
+    value |= static_cast<uint64_t>(piece & 0x7f) << shift;
+    if ((piece & 0x80) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool BinaryBlobReader::skip(size_t size) {
+  if (size > m_blob.getSize() - m_position) {
+    return false;
+  }
+
+  m_position += size;
+  return true;
+}
+
+bool BinaryBlobReader::skipVarint() {
+  uint64_t value;
+  return readVarint(value);
+}
+
+bool BinaryBlobReader::skipTransaction() {
+  uint64_t inputCount;
+  if (!skipVarint() || !skipVarint() || !readVarint(inputCount) || inputCount > m_blob.getSize() - m_position) {
+    return false;
+  }
+
+  // number of signatures each input carries after the transaction prefix
+  std::vector<uint64_t> signatureCounts;
+  signatureCounts.reserve(static_cast<size_t>(inputCount));
+  for (uint64_t i = 0; i < inputCount; ++i) {
+    uint8_t tag;
+    if (!readByte(tag)) {
+      return false;
+    }
+
+    uint64_t signatureCount = 0;
+    if (tag == BASE_INPUT_TAG) {
+      if (!skipVarint()) {
+        return false;
+      }
+    } else if (tag == KEY_INPUT_TAG) {
+      if (!skipVarint() || !readVarint(signatureCount) || signatureCount > m_blob.getSize() - m_position) {
+        return false;
+      }
+
+      for (uint64_t j = 0; j < signatureCount; ++j) {
+        if (!skipVarint()) {
+          return false;
+        }
+      }
+
+      if (!skip(sizeof(Crypto::KeyImage))) {
+        return false;
+      }
+    } else if (tag == MULTISIGNATURE_INPUT_TAG) {
+      if (!skipVarint() || !readVarint(signatureCount) || !skipVarint()) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+
+    signatureCounts.push_back(signatureCount);
+  }
+
+  uint64_t outputCount;
+  if (!readVarint(outputCount)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < outputCount; ++i) {
+    uint8_t tag;
+    if (!skipVarint() || !readByte(tag)) {
+      return false;
+    }
+
+    if (tag == KEY_OUTPUT_TAG) {
+      if (!skip(sizeof(Crypto::PublicKey))) {
+        return false;
+      }
+    } else if (tag == MULTISIGNATURE_OUTPUT_TAG) {
+      uint64_t keyCount;
+      if (!readVarint(keyCount) || keyCount > (m_blob.getSize() - m_position) / sizeof(Crypto::PublicKey) ||
+        !skip(static_cast<size_t>(keyCount) * sizeof(Crypto::PublicKey)) || !skipVarint()) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+
+  uint64_t extraSize;
+  if (!readVarint(extraSize) || extraSize > m_blob.getSize() - m_position || !skip(static_cast<size_t>(extraSize))) {
+    return false;
+  }
+
+  for (uint64_t signatureCount : signatureCounts) {
+    if (signatureCount > (m_blob.getSize() - m_position) / sizeof(Crypto::Signature) ||
+      !skip(static_cast<size_t>(signatureCount) * sizeof(Crypto::Signature))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool BinaryBlobReader::skipBlock() {
+  uint64_t transactionCount;
+  if (!skip(BLOCK_HEADER_SIZE) || !skipTransaction() || !readVarint(transactionCount)) {
+    return false;
+  }
+
+  if (transactionCount > (m_blob.getSize() - m_position) / sizeof(Crypto::Hash)) {
+    return false;
+  }
+
+  return skip(static_cast<size_t>(transactionCount) * sizeof(Crypto::Hash));
+}
+
+bool BinaryBlobReader::readByte(uint8_t& value) {
+  if (m_position == m_blob.getSize()) {
+    return false;
+  }
+
+  value = static_cast<uint8_t>(m_blob.getData()[m_position++]);
+  return true;
+}
+
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Common/StringView.h"
+
+namespace CryptoNote {
+
+// Walks binary-serialized blocks and transactions in place, without building Block or Transaction objects.
+// Every method returns false if the blob is truncated or malformed; the position is undefined afterwards.
+class BinaryBlobReader {
+public:
+  explicit BinaryBlobReader(Common::StringView blob);
+
+  size_t getPosition() const;
+  bool endOfBlob() const;
+  Common::StringView range(size_t begin, size_t end) const;
+
+  bool readVarint(uint64_t& value);
+  bool skip(size_t size);
+  bool skipVarint();
+  bool skipTransaction();
+  bool skipBlock();
+
+private:
+  bool readByte(uint8_t& value);
+
+  Common::StringView m_blob;
+  size_t m_position;
+};
+
+}
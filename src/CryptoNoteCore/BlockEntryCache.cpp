@@ -0,0 +1,94 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BlockEntryCache.h"
+
+#include <iterator>
+
+namespace CryptoNote {
+
+namespace {
+
+size_t getEntrySize(const block_complete_entry& entry) {
+  size_t size = entry.block.size();
+  for (const std::string& transaction : entry.txs) {
+    size += transaction.size();
+  }
+
+  return size;
+}
+
+}
+
+BlockEntryCache::BlockEntryCache(size_t maxSize) : m_maxSize(maxSize), m_size(0), m_hits(0), m_misses(0) {
+}
+
+std::shared_ptr<const block_complete_entry> BlockEntryCache::get(uint32_t height) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_heights.find(height);
+  if (it == m_heights.end()) {
+    ++m_misses;
+    return nullptr;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  ++m_hits;
+  return it->second->blobs;
+}
+
+void BlockEntryCache::insert(uint32_t height, std::shared_ptr<const block_complete_entry> entry) {
+  size_t entrySize = getEntrySize(*entry);
+  if (entrySize > m_maxSize) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_heights.find(height);
+  if (it != m_heights.end()) {
+    erase(it->second);
+  }
+
+  while (m_size + entrySize > m_maxSize) {
+    erase(std::prev(m_entries.end()));
+  }
+
+  m_entries.push_front(Entry{ height, std::move(entry), entrySize });
+  m_heights[height] = m_entries.begin();
+  m_size += entrySize;
+}
+
+void BlockEntryCache::truncate(uint32_t height) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    auto next = std::next(it);
+    if (it->height >= height) {
+      erase(it);
+    }
+
+    it = next;
+  }
+}
+
+void BlockEntryCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_heights.clear();
+  m_size = 0;
+}
+
+size_t BlockEntryCache::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void BlockEntryCache::erase(std::list<Entry>::iterator it) {
+  m_size -= it->size;
+  m_heights.erase(it->height);
+  m_entries.erase(it);
+}
+
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+
+namespace CryptoNote
+{
+  // Bounded least recently used cache of ready to send block blobs and transaction blobs by height.
+  // Heights only change content when blocks are popped, so truncate() must be called from popBlock.
+  // The entries are shared with the callers of get() and are never changed, an evicted entry lives on in their hands.
+  // All methods are thread safe.
+  class BlockEntryCache {
+
+  public:
+
+    explicit BlockEntryCache(size_t maxSize); // maxSize is the total size of the cached blobs in bytes
+
+    std::shared_ptr<const block_complete_entry> get(uint32_t height); // nullptr if height is not cached
+    void insert(uint32_t height, std::shared_ptr<const block_complete_entry> entry);
+    void truncate(uint32_t height); // removes the entries of height and above
+    void clear();
+
+    size_t size() const;
+    uint64_t getHits() const { return m_hits; }
+    uint64_t getMisses() const { return m_misses; }
+
+  private:
+
+    struct Entry {
+      uint32_t height;
+      std::shared_ptr<const block_complete_entry> blobs;
+      size_t size;
+    };
+
+    void erase(std::list<Entry>::iterator it);
+
+    const size_t m_maxSize;
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> m_heights;
+    size_t m_size;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+
+  };
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BlockSummaryIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "Serialization/ISerializer.h"
+
+namespace CryptoNote {
+
+namespace {
+
+// columns are stored as raw little endian arrays to keep loading fast
+template<typename T>
+void serializeColumn(std::vector<T>& column, Common::StringView name, ISerializer& s) {
+  size_t size = column.size() * sizeof(T);
+
+  if (!s.beginArray(size, name)) {
+    column.clear();
+    return;
+  }
+
+  if (s.type() == ISerializer::INPUT) {
+    if (size % sizeof(T) != 0) {
+      throw std::runtime_error("Invalid column size");
+    }
+
+    column.resize(size / sizeof(T));
+  }
+
+  if (size) {
+    s.binary(column.data(), size, "");
+  }
+
+  s.endArray();
+}
+
+}
+
+void BlockSummaryIndex::push(uint64_t timestamp, difficulty_type cumulativeDifficulty, uint64_t blockCumulativeSize, uint64_t alreadyGeneratedCoins) {
+  m_timestamps.push_back(timestamp);
+  m_cumulativeDifficulties.push_back(cumulativeDifficulty);
+  m_blockCumulativeSizes.push_back(blockCumulativeSize);
+  m_alreadyGeneratedCoins.push_back(alreadyGeneratedCoins);
+}
+
+void BlockSummaryIndex::pop() {
+  assert(!m_timestamps.empty());
+
+  m_timestamps.pop_back();
+  m_cumulativeDifficulties.pop_back();
+  m_blockCumulativeSizes.pop_back();
+  m_alreadyGeneratedCoins.pop_back();
+}
+
+void BlockSummaryIndex::clear() {
+  m_timestamps.clear();
+  m_cumulativeDifficulties.clear();
+  m_blockCumulativeSizes.clear();
+  m_alreadyGeneratedCoins.clear();
+}
+
+uint64_t BlockSummaryIndex::getTimestamp(uint32_t height) const {
+  assert(height < m_timestamps.size());
+  return m_timestamps[height];
+}
+
+difficulty_type BlockSummaryIndex::getCumulativeDifficulty(uint32_t height) const {
+  assert(height < m_cumulativeDifficulties.size());
+  return m_cumulativeDifficulties[height];
+}
+
+uint64_t BlockSummaryIndex::getBlockCumulativeSize(uint32_t height) const {
+  assert(height < m_blockCumulativeSizes.size());
+  return m_blockCumulativeSizes[height];
+}
+
+uint64_t BlockSummaryIndex::getAlreadyGeneratedCoins(uint32_t height) const {
+  assert(height < m_alreadyGeneratedCoins.size());
+  return m_alreadyGeneratedCoins[height];
+}
+
+void BlockSummaryIndex::getTimestamps(uint32_t startHeight, uint32_t endHeight, std::vector<uint64_t>& timestamps) const {
+  assert(startHeight <= endHeight && endHeight <= m_timestamps.size());
+  timestamps.insert(timestamps.end(), m_timestamps.begin() + startHeight, m_timestamps.begin() + endHeight);
+}
+
+void BlockSummaryIndex::getCumulativeDifficulties(uint32_t startHeight, uint32_t endHeight, std::vector<difficulty_type>& cumulativeDifficulties) const {
+  assert(startHeight <= endHeight && endHeight <= m_cumulativeDifficulties.size());
+  cumulativeDifficulties.insert(cumulativeDifficulties.end(), m_cumulativeDifficulties.begin() + startHeight, m_cumulativeDifficulties.begin() + endHeight);
+}
+
+void BlockSummaryIndex::getBlockCumulativeSizes(uint32_t startHeight, uint32_t endHeight, std::vector<size_t>& blockCumulativeSizes) const {
+  assert(startHeight <= endHeight && endHeight <= m_blockCumulativeSizes.size());
+  blockCumulativeSizes.insert(blockCumulativeSizes.end(), m_blockCumulativeSizes.begin() + startHeight, m_blockCumulativeSizes.begin() + endHeight);
+}
+
+uint32_t BlockSummaryIndex::findFirstTimestampNotLess(uint32_t startHeight, uint64_t timestamp) const {
+  assert(startHeight <= m_timestamps.size());
+  auto bound = std::lower_bound(m_timestamps.begin() + startHeight, m_timestamps.end(), timestamp);
+  return static_cast<uint32_t>(std::distance(m_timestamps.begin(), bound));
+}
+
+void BlockSummaryIndex::serialize(ISerializer& s) {
+  serializeColumn(m_timestamps, "timestamps", s);
+  serializeColumn(m_cumulativeDifficulties, "cumulative_difficulties", s);
+  serializeColumn(m_blockCumulativeSizes, "block_cumulative_sizes", s);
+  serializeColumn(m_alreadyGeneratedCoins, "already_generated_coins", s);
+
+  if (s.type() == ISerializer::INPUT) {
+    size_t size = m_timestamps.size();
+    if (m_cumulativeDifficulties.size() != size || m_blockCumulativeSizes.size() != size || m_alreadyGeneratedCoins.size() != size) {
+      throw std::runtime_error("Block summary columns have different sizes");
+    }
+  }
+}
+
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CryptoNoteCore/Difficulty.h"
+
+namespace CryptoNote
+{
+  class ISerializer;
+
+  // Per-height columns of the BlockEntry header fields used by the difficulty, block size median and timestamp checks.
+  // Block hashes are kept by BlockIndex, this index only holds the numeric fields.
+  class BlockSummaryIndex {
+
+  public:
+
+    void push(uint64_t timestamp, difficulty_type cumulativeDifficulty, uint64_t blockCumulativeSize, uint64_t alreadyGeneratedCoins);
+    void pop();
+    void clear();
+
+    uint32_t size() const {
+      return static_cast<uint32_t>(m_timestamps.size());
+    }
+
+    bool empty() const {
+      return m_timestamps.empty();
+    }
+
+    uint64_t getTimestamp(uint32_t height) const;
+    difficulty_type getCumulativeDifficulty(uint32_t height) const;
+    uint64_t getBlockCumulativeSize(uint32_t height) const;
+    uint64_t getAlreadyGeneratedCoins(uint32_t height) const;
+
+    // append the values of heights [startHeight, endHeight) to the output vector
+    void getTimestamps(uint32_t startHeight, uint32_t endHeight, std::vector<uint64_t>& timestamps) const;
+    void getCumulativeDifficulties(uint32_t startHeight, uint32_t endHeight, std::vector<difficulty_type>& cumulativeDifficulties) const;
+    void getBlockCumulativeSizes(uint32_t startHeight, uint32_t endHeight, std::vector<size_t>& blockCumulativeSizes) const;
+
+    // returns the first height at or after startHeight whose timestamp is not less than the given timestamp
+    uint32_t findFirstTimestampNotLess(uint32_t startHeight, uint64_t timestamp) const;
+
+    void serialize(ISerializer& s);
+
+  private:
+
+    std::vector<uint64_t> m_timestamps;
+    std::vector<difficulty_type> m_cumulativeDifficulties;
+    std::vector<uint64_t> m_blockCumulativeSizes;
+    std::vector<uint64_t> m_alreadyGeneratedCoins;
+
+  };
+}
@@ -16,6 +16,7 @@
 #include "Common/StdOutputStream.h"
 #include "Rpc/CoreRpcCommands.h"
 #include "Serialization/BinarySerializationTools.h"
+#include "BinaryBlobReader.h"
 #include "CryptoNoteTools.h"
 
 using namespace Logging;
@@ -23,6 +24,10 @@ using namespace Common;
 
 namespace {
 
+Common::MetricHistogram& blockValidationMetric(const std::string& stage) {
+  return MetricsRegistry::instance().histogram("cash2_block_validation_duration_microseconds", "Time spent validating the blocks added to the main chain, by stage", MetricsRegistry::label("stage", stage));
+}
+
 std::string appendPath(const std::string& path, const std::string& fileName) {
   std::string result = path;
   if (!result.empty()) {
@@ -33,6 +38,52 @@ std::string appendPath(const std::string& path, const std::string& fileName) {
   return result;
 }
 
+// Splits a serialized Blockchain::BlockEntry into the block blob and the transaction blobs (coinbase first).
+// The layout must follow Blockchain::BlockEntry::serialize and Blockchain::TransactionEntry::serialize.
+bool splitRawBlockEntry(Common::StringView entry, Common::StringView& block, std::vector<Common::StringView>& transactions) {
+  CryptoNote::BinaryBlobReader reader(entry);
+  if (!reader.skipBlock()) {
+    return false;
+  }
+
+  block = reader.range(0, reader.getPosition());
+
+  // block_index, block_cumulative_size, cumulative_difficulty, already_generated_coins
+  for (int i = 0; i < 4; ++i) {
+    if (!reader.skipVarint()) {
+      return false;
+    }
+  }
+
+  uint64_t transactionCount;
+  if (!reader.readVarint(transactionCount)) {
+    return false;
+  }
+
+  transactions.clear();
+  for (uint64_t i = 0; i < transactionCount; ++i) {
+    size_t transactionBegin = reader.getPosition();
+    if (!reader.skipTransaction()) {
+      return false;
+    }
+
+    transactions.push_back(reader.range(transactionBegin, reader.getPosition()));
+
+    uint64_t indexCount;
+    if (!reader.readVarint(indexCount)) {
+      return false;
+    }
+
+    for (uint64_t j = 0; j < indexCount; ++j) {
+      if (!reader.skipVarint()) {
+        return false;
+      }
+    }
+  }
+
+  return reader.endOfBlob();
+}
+
 }
 
 namespace std {
@@ -47,10 +98,12 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 
 #define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 1
 #define CURRENT_BLOCKCHAININDEXES_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKSUMMARY_STORAGE_ARCHIVE_VER 1
 
 namespace CryptoNote {
 class BlockCacheSerializer;
 class BlockchainIndexesSerializer;
+class BlockSummarySerializer;
 }
 
 namespace CryptoNote {
@@ -302,6 +355,54 @@ private:
   Crypto::Hash m_lastBlockHash;
 };
 
+class BlockSummarySerializer {
+
+public:
+  BlockSummarySerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
+    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockSummarySerializer") {
+  }
+
+  void serialize(ISerializer& s) {
+    uint8_t version = CURRENT_BLOCKSUMMARY_STORAGE_ARCHIVE_VER;
+    s(version, "version");
+
+    // ignore old versions, do rebuild
+    if (version != CURRENT_BLOCKSUMMARY_STORAGE_ARCHIVE_VER)
+      return;
+
+    std::string operation;
+    if (s.type() == ISerializer::INPUT) {
+      operation = "- loading ";
+      Crypto::Hash blockHash;
+      s(blockHash, "last_block");
+
+      if (blockHash != m_lastBlockHash) {
+        return;
+      }
+
+    } else {
+      operation = "- saving ";
+      s(m_lastBlockHash, "last_block");
+    }
+
+    logger(INFO) << operation << "block summary...";
+    s(m_bs.m_blockSummaryIndex, "block_summary");
+
+    m_loaded = true;
+  }
+
+  bool loaded() const {
+    return m_loaded;
+  }
+
+private:
+
+  LoggerRef logger;
+  bool m_loaded;
+  Blockchain& m_bs;
+  Crypto::Hash m_lastBlockHash;
+};
+
 
 Blockchain::Blockchain(const Currency& currency, tx_memory_pool& tx_pool, ILogger& logger) :
 logger(logger, "Blockchain"),
@@ -309,7 +410,15 @@ m_currency(currency),
 m_tx_pool(tx_pool),
 m_current_block_cumul_sz_limit(0),
 m_is_in_checkpoint_zone(false),
-m_checkpoints(logger) {
+m_checkpoints(logger),
+m_blockEntryCache(BLOCK_ENTRY_CACHE_MAX_SIZE),
+m_difficultyCalculator(currency, m_blockSummaryIndex),
+m_validationPool(new WorkerPool(1)),
+m_difficultyMetric(blockValidationMetric("difficulty")),
+m_proofOfWorkMetric(blockValidationMetric("proof_of_work")),
+m_transactionInputsMetric(blockValidationMetric("transaction_inputs")),
+m_ringSignaturesMetric(blockValidationMetric("ring_signatures")),
+m_blockValidationMetric(blockValidationMetric("total")) {
 
   m_outputs.set_deleted_key(0);
   Crypto::KeyImage nullImage = boost::value_initialized<decltype(nullImage)>();
@@ -401,22 +510,22 @@ bool Blockchain::checkTransactionExtraSize(size_t txExtraSize)
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return  m_spent_keys.find(key_im) != m_spent_keys.end();
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return static_cast<uint32_t>(m_blocks.size());
 }
 
 bool Blockchain::init(const std::string& config_folder, bool load_existing) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
   if (!config_folder.empty() && !Tools::create_directories_if_necessary(config_folder)) {
     logger(ERROR, BRIGHT_RED) << "Failed to create data directory: " << m_config_folder;
     return false;
@@ -428,6 +537,11 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     return false;
   }
 
+  if (!m_outputKeyStore.open(appendPath(config_folder, m_currency.outputKeysFileName()))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open output keys file: " << m_currency.outputKeysFileName();
+    return false;
+  }
+
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
     BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
@@ -439,10 +553,17 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     }
 
     loadBlockchainIndexes();
+    loadBlockSummaryIndex();
+    loadOutputKeyStore();
   } else {
     m_blocks.clear();
+    m_blockSummaryIndex.clear();
+    m_outputKeyStore.clear();
+    m_blockEntryCache.clear();
   }
 
+  m_difficultyCalculator.update();
+
   if (m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
@@ -465,8 +586,9 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   // removed hard fork 1 if clause here
 
-  uint64_t timestamp_diff = time(NULL) - m_blocks.back().bl.timestamp;
-  if (!m_blocks.back().bl.timestamp) {
+  uint64_t lastBlockTimestamp = m_blockSummaryIndex.getTimestamp(m_blockSummaryIndex.size() - 1);
+  uint64_t timestamp_diff = time(NULL) - lastBlockTimestamp;
+  if (!lastBlockTimestamp) {
     timestamp_diff = time(NULL) - 1341378000;
   }
 
@@ -487,6 +609,8 @@ void Blockchain::rebuildCache() {
   for (uint32_t b = 0; b < m_blocks.size(); ++b) {
     if (b % 1000 == 0) {
       logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+      // locked exclusively and no earlier block is in use, keeps the decoded blocks within the cache size
+      m_blocks.reclaim();
     }
     const BlockEntry& block = m_blocks[b];
     Crypto::Hash blockHash = get_block_hash(block.bl);
@@ -525,7 +649,7 @@ void Blockchain::rebuildCache() {
 }
 
 bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
 
   logger(INFO, BRIGHT_WHITE) << "Saving blockchain...";
   BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
@@ -540,19 +664,24 @@ bool Blockchain::storeCache() {
 bool Blockchain::deinit() {
   storeCache();
   storeBlockchainIndexes();
+  storeBlockSummaryIndex();
   assert(m_messageQueueList.empty());
   return true;
 }
 
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
   m_blocks.clear();
   m_blockIndex.clear();
+  m_blockSummaryIndex.clear();
+  m_blockEntryCache.clear();
+  m_difficultyCalculator.clear();
   m_transactionMap.clear();
 
   m_spent_keys.clear();
   m_alternative_chains.clear();
   m_outputs.clear();
+  m_outputKeyStore.clear();
 
   m_paymentIdIndex.clear();
   m_timestampIndex.clear();
@@ -566,24 +695,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -620,13 +749,25 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
+uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
+  SharedBlocksLock lk(*this);
+  assert(height < m_blockSummaryIndex.size());
+  return m_blockSummaryIndex.getTimestamp(height);
+}
+
+void Blockchain::getBlockTimestamps(uint32_t startHeight, uint32_t endHeight, std::vector<uint64_t>& timestamps) {
+  SharedBlocksLock lk(*this);
+  assert(startHeight <= endHeight && endHeight <= m_blockSummaryIndex.size());
+  m_blockSummaryIndex.getTimestamps(startHeight, endHeight, timestamps);
+}
+
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   uint32_t height = 0;
 
@@ -647,26 +788,68 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  SharedBlocksLock lock(*this);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
-difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> cummulative_difficulties;
-  size_t offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_currency.difficultyBlocksCount()));
-  if (offset == 0) {
-    ++offset;
+// Copies the stored block blob and non-coinbase transaction blobs without deserializing them.
+bool Blockchain::getRawBlock(uint32_t height, std::string& block, std::vector<std::string>& transactions) {
+  SharedBlocksLock lk(*this);
+  if (height >= m_blocks.size()) {
+    return false;
+  }
+
+  Common::StringView blockBlob;
+  std::vector<Common::StringView> transactionBlobs;
+  if (!splitRawBlockEntry(m_blocks.getRaw(height), blockBlob, transactionBlobs) || transactionBlobs.empty()) {
+    logger(ERROR, BRIGHT_RED) << "Failed to parse stored block at height " << height;
+    return false;
+  }
+
+  block.assign(blockBlob.getData(), blockBlob.getSize());
+  transactions.clear();
+  transactions.reserve(transactionBlobs.size() - 1);
+  for (size_t i = 1; i < transactionBlobs.size(); ++i) {
+    transactions.emplace_back(transactionBlobs[i].getData(), transactionBlobs[i].getSize());
+  }
+
+  return true;
+}
+
+std::shared_ptr<const block_complete_entry> Blockchain::getBlockEntry(uint32_t height) {
+  SharedBlocksLock lk(*this);
+  std::shared_ptr<const block_complete_entry> cachedEntry = m_blockEntryCache.get(height);
+  if (cachedEntry) {
+    return cachedEntry;
   }
 
-  for (; offset < m_blocks.size(); offset++) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    cummulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
+  std::shared_ptr<block_complete_entry> entry = std::make_shared<block_complete_entry>();
+  if (!getRawBlock(height, entry->block, entry->txs)) {
+    return nullptr;
   }
 
+  m_blockEntryCache.insert(height, entry);
+  return entry;
+}
+
+difficulty_type Blockchain::getDifficultyForNextBlock() {
+  SharedBlocksLock lk(*this);
+
   if (m_blocks.size() < parameters::HARD_FORK_HEIGHT_2)
   {
+    std::vector<uint64_t> timestamps;
+    std::vector<difficulty_type> cummulative_difficulties;
+    size_t offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_currency.difficultyBlocksCount()));
+    if (offset == 0) {
+      ++offset;
+    }
+
+    // the genesis block is pushed on an empty chain
+    offset = std::min(offset, static_cast<size_t>(m_blocks.size()));
+
+    m_blockSummaryIndex.getTimestamps(static_cast<uint32_t>(offset), m_blockSummaryIndex.size(), timestamps);
+    m_blockSummaryIndex.getCumulativeDifficulties(static_cast<uint32_t>(offset), m_blockSummaryIndex.size(), cummulative_difficulties);
+
     return m_currency.nextDifficulty1(timestamps, cummulative_difficulties);
   }
   else if (m_blocks.size() < parameters::HARD_FORK_HEIGHT_2 + 4000)
@@ -677,7 +860,8 @@ difficulty_type Blockchain::getDifficultyForNextBlock() {
   }
   else
   {
-    return m_currency.nextDifficulty2(timestamps, cummulative_difficulties);
+    // same result as nextDifficulty2 on the last difficultyBlocksCount() blocks, without copying and sorting the window
+    return m_difficultyCalculator.getNextDifficulty();
   }
 }
 
@@ -687,19 +871,19 @@ uint64_t Blockchain::getMinimalFee(uint32_t height)
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (m_blocks.empty()) {
     return 0;
   } else {
-    return m_blocks.back().already_generated_coins;
+    return m_blockSummaryIndex.getAlreadyGeneratedCoins(m_blockSummaryIndex.size() - 1);
   }
 }
 
 bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain, size_t rollback_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
   // remove failed subchain
   for (size_t i = m_blocks.size() - 1; i >= rollback_height; i--) {
-    popBlock(get_block_hash(m_blocks.back().bl));
+    popBlock(m_blockIndex.getTailId());
   }
 
   // return back original chain
@@ -719,7 +903,7 @@ bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain,
 }
 
 bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
 
   if (!(alt_chain.size())) {
     logger(ERROR, BRIGHT_RED) << "switch_to_alternative_blockchain: empty chain passed";
@@ -800,7 +984,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   std::vector<uint64_t> timestamps;
   std::vector<difficulty_type> cummulative_difficulties;
   if (alt_chain.size() < m_currency.difficultyBlocksCount()) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    SharedBlocksLock lk(*this);
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.block_index : bei.block_index;
     size_t main_chain_count = m_currency.difficultyBlocksCount() - std::min(m_currency.difficultyBlocksCount(), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -808,9 +992,9 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 
     if (!main_chain_start_offset)
       ++main_chain_start_offset; //skip genesis block
-    for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      cummulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+    if (main_chain_start_offset < main_chain_stop_offset) {
+      m_blockSummaryIndex.getTimestamps(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset), timestamps);
+      m_blockSummaryIndex.getCumulativeDifficulties(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset), cummulative_difficulties);
     }
 
     if (!((alt_chain.size() + timestamps.size()) <= m_currency.difficultyBlocksCount())) {
@@ -937,7 +1121,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -945,15 +1129,13 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
     return false;
   }
   size_t start_offset = (from_height + 1) - std::min((from_height + 1), count);
-  for (size_t i = start_offset; i != from_height + 1; i++) {
-    sz.push_back(m_blocks[i].block_cumulative_size);
-  }
+  m_blockSummaryIndex.getBlockCumulativeSizes(static_cast<uint32_t>(start_offset), static_cast<uint32_t>(from_height + 1), sz);
 
   return true;
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (!m_blocks.size()) {
     return true;
   }
@@ -969,12 +1151,12 @@ bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vect
   if (timestamps.size() >= m_currency.timestampCheckWindow())
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   size_t need_elements = m_currency.timestampCheckWindow() - timestamps.size();
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
   do {
-    timestamps.push_back(m_blocks[start_top_height].bl.timestamp);
+    timestamps.push_back(m_blockSummaryIndex.getTimestamp(static_cast<uint32_t>(start_top_height)));
     if (start_top_height == 0)
       break;
     --start_top_height;
@@ -983,7 +1165,7 @@ bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vect
 }
 
 bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
 
   auto block_height = get_block_height(b);
   if (block_height == 0) {
@@ -1033,8 +1215,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     if (alt_chain.size()) {
       //make sure that it has right connection to main chain
       if (!(m_blocks.size() > alt_chain.front()->second.block_index)) { logger(ERROR, BRIGHT_RED) << "main blockchain wrong height"; return false; }
-      Crypto::Hash h = NULL_HASH;
-      get_block_hash(m_blocks[alt_chain.front()->second.block_index - 1].bl, h);
+      Crypto::Hash h = m_blockIndex.getBlockId(alt_chain.front()->second.block_index - 1);
       if (!(h == alt_chain.front()->second.bl.previousBlockHash)) { logger(ERROR, BRIGHT_RED) << "alternative chain have wrong connection to main chain"; return false; }
       complete_timestamps_vector(alt_chain.front()->second.block_index - 1, timestamps);
     } else {
@@ -1114,7 +1295,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       return false;
     }
 
-    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blocks[mainPrevHeight].cumulative_difficulty;
+    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blockSummaryIndex.getCumulativeDifficulty(mainPrevHeight);
     
     if (bei.block_index == parameters::HARD_FORK_HEIGHT_2)
     {
@@ -1153,11 +1334,11 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       }
       return r;
     }
-    else if (m_blocks.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
+    else if (m_blockSummaryIndex.getCumulativeDifficulty(m_blockSummaryIndex.size() - 1) < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
     {
       //do reorganize!
       logger(INFO, BRIGHT_GREEN) <<
-        "###### REORGANIZE on height: " << alt_chain.front()->second.block_index << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blocks.back().cumulative_difficulty
+        "###### REORGANIZE on height: " << alt_chain.front()->second.block_index << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blockSummaryIndex.getCumulativeDifficulty(m_blockSummaryIndex.size() - 1)
         << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cum_difficulty " << bei.cumulative_difficulty;
       bool r = switch_to_alternative_blockchain(alt_chain, false);
       if (r) {
@@ -1189,7 +1370,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (start_offset >= m_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
@@ -1203,7 +1384,7 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
@@ -1216,23 +1397,22 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
-  std::list<Block> blocks;
-  getBlocks(arg.blocks, blocks, rsp.missed_ids);
-
-  for (const auto& bl : blocks) {
-    std::list<Crypto::Hash> missed_tx_id;
-    std::list<Transaction> txs;
-    getTransactions(bl.transactionHashes, txs, rsp.missed_ids);
-    if (!(!missed_tx_id.size())) { logger(ERROR, BRIGHT_RED) << "Internal error: have missed missed_tx_id.size()=" << missed_tx_id.size() << ENDL << "for block id = " << get_block_hash(bl); return false; } //WTF???
+
+  //pack blocks and their transactions straight from the stored blobs
+  for (const auto& blockId : arg.blocks) {
+    uint32_t height = 0;
+    if (!m_blockIndex.getBlockHeight(blockId, height)) {
+      rsp.missed_ids.push_back(blockId);
+      continue;
+    }
+
     rsp.blocks.push_back(block_complete_entry());
     block_complete_entry& e = rsp.blocks.back();
-    //pack block
-    e.block = asString(toBinaryArray(bl));
-    //pack transactions
-    for (Transaction& tx : txs) {
-      e.txs.push_back(asString(toBinaryArray(tx)));
+    if (!getRawBlock(height, e.block, e.txs)) {
+      logger(ERROR, BRIGHT_RED) << "Internal error: failed to load block " << blockId << " at height " << height;
+      return false;
     }
   }
 
@@ -1248,7 +1428,7 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1257,31 +1437,26 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
-    logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
-  }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
+bool Blockchain::add_out_to_get_random_outs(CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
+  SharedBlocksLock lk(*this);
+  const OutputKeyEntry& output = m_outputKeyStore.get(amount, static_cast<uint32_t>(i));
 
   //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlockTime))
+  if (!is_tx_spendtime_unlocked(output.unlockTime))
     return false;
 
   CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
   oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
+  oen.out_key = output.key;
   return true;
 }
 
 size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (amount_outs.empty()) {
     return 0;
   }
@@ -1301,7 +1476,7 @@ size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<Transac
 }
 
 bool Blockchain::getRandomOutsByAmount(const CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   for (uint64_t amount : req.amounts) {
     CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
@@ -1318,11 +1493,12 @@ bool Blockchain::getRandomOutsByAmount(const CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS
     //lets find upper bound of not fresh outs
     size_t up_index_limit = find_end_of_allowed_index(amount_outs);
     if (!(up_index_limit <= amount_outs.size())) { logger(ERROR, BRIGHT_RED) << "internal error: find_end_of_allowed_index returned wrong index=" << up_index_limit << ", with amount_outs.size = " << amount_outs.size(); return false; }
+    if (amount_outs.size() != m_outputKeyStore.getOutputCount(amount)) { logger(ERROR, BRIGHT_RED) << "internal error: output key store has " << m_outputKeyStore.getOutputCount(amount) << " outputs for amount " << amount << ", expected " << amount_outs.size(); return false; }
 
     if (up_index_limit > 0) {
       ShuffleGenerator<size_t, Crypto::random_engine<size_t>> generator(up_index_limit);
       for (uint64_t j = 0; j < up_index_limit && result_outs.outs.size() < req.outs_count; ++j) {
-        add_out_to_get_random_outs(amount_outs, result_outs, amount, generator());
+        add_out_to_get_random_outs(result_outs, amount, generator());
       }
     }
   }
@@ -1333,7 +1509,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1341,29 +1517,29 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
-    return m_blocks[i].cumulative_difficulty;
+    return m_blockSummaryIndex.getCumulativeDifficulty(0);
 
-  return m_blocks[i].cumulative_difficulty - m_blocks[i - 1].cumulative_difficulty;
+  return m_blockSummaryIndex.getCumulativeDifficulty(static_cast<uint32_t>(i)) - m_blockSummaryIndex.getCumulativeDifficulty(static_cast<uint32_t>(i - 1));
 }
 
 bool Blockchain::getBlockCumulativeDifficulty(uint32_t blockIndex, uint64_t& cumulativeDifficulty) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (blockIndex >= m_blocks.size())
   {
     logger(ERROR, BRIGHT_RED) << "Wrong block index = " << blockIndex << " at Blockchain::getBlockCumulativeDifficulty()";
     return false;
   }
 
-  cumulativeDifficulty = m_blocks[blockIndex].cumulative_difficulty;
+  cumulativeDifficulty = m_blockSummaryIndex.getCumulativeDifficulty(blockIndex);
   return true;
 }
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_CYAN) <<
       "Start index too large : " << start_index << ", blockchain height : " << m_blocks.size() - 1;
@@ -1372,10 +1548,12 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
   size_t printCount = 0;
   Crypto::Hash proofOfWorkHash = NULL_HASH;
+  // m_cn_context is only used by writers
+  Crypto::cn_context context;
 
   for (size_t i = start_index; i != m_blocks.size() && i != end_index && printCount < 100; i++) {
 
-    get_block_longhash(m_cn_context, m_blocks[i].bl, proofOfWorkHash);
+    get_block_longhash(context, m_blocks[i].bl, proofOfWorkHash);
 
     ss <<
       std::setw(35) << std::left << "Height"                          << std::setw(50) << std::left << i + 1 << ENDL <<
@@ -1396,7 +1574,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1410,7 +1588,7 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   for (const outputs_container::value_type& v : m_outputs) {
     const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
     if (!vals.empty()) {
@@ -1436,7 +1614,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1444,7 +1622,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1455,12 +1633,12 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_transactionMap.size();
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexes failed to find transaction with id = " << tx_id;
@@ -1478,7 +1656,7 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1501,7 +1679,7 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   if (tail)
     tail->id = getTailId(tail->blockIndex);
@@ -1509,7 +1687,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
   bool res = checkTransactionInputs(tx, &max_used_block_height);
   if (!res) return false;
   if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  max_used_block_id = m_blockIndex.getBlockId(max_used_block_height);
   return true;
 }
 
@@ -1525,12 +1703,13 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
   return false;
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
   Crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
+  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height, deferredChecks);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+// With deferredChecks the ring signatures are not checked, the data needed to check them later is appended instead.
+bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
@@ -1549,12 +1728,17 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      RingSignatureCheck check;
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height, deferredChecks != NULL ? &check : NULL)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
       }
 
+      if (deferredChecks != NULL && !check.outputKeys.empty()) {
+        deferredChecks->push_back(std::move(check));
+      }
+
       ++inputIndex;
     } else if (txin.type() == typeid(MultisignatureInput)) {
       if (!validateInput(::boost::get<MultisignatureInput>(txin), transactionHash, tx_prefix_hash, tx.signatures[inputIndex])) {
@@ -1591,8 +1775,8 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height, RingSignatureCheck* deferredCheck) {
+  SharedBlocksLock lk(*this);
 
   struct outputs_visitor {
     std::vector<const Crypto::PublicKey *>& m_results_collector;
@@ -1601,21 +1785,15 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
     }
 
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
+    bool handle_output(const OutputKeyEntry& output) {
       //check tx unlock time
-      if (!m_bch.is_tx_spendtime_unlocked(tx.unlockTime)) {
-        logger(INFO, BRIGHT_WHITE) <<
-          "One of outputs for one of inputs have wrong tx.unlockTime = " << tx.unlockTime;
-        return false;
-      }
-
-      if (out.target.type() != typeid(KeyOutput)) {
+      if (!m_bch.is_tx_spendtime_unlocked(output.unlockTime)) {
         logger(INFO, BRIGHT_WHITE) <<
-          "Output have wrong type id, which=" << out.target.which();
+          "One of outputs for one of inputs have wrong tx.unlockTime = " << output.unlockTime;
         return false;
       }
 
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
+      m_results_collector.push_back(&output.key);
       return true;
     }
   };
@@ -1641,9 +1819,50 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
+  if (deferredCheck != NULL) {
+    deferredCheck->transactionPrefixHash = tx_prefix_hash;
+    deferredCheck->keyImage = txin.keyImage;
+    deferredCheck->outputKeys.reserve(output_keys.size());
+    for (const Crypto::PublicKey* key : output_keys) {
+      deferredCheck->outputKeys.push_back(*key);
+    }
+
+    deferredCheck->signatures = sig.data();
+    return true;
+  }
+
   return Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
 }
 
+bool Blockchain::checkRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedTransaction) {
+  std::atomic<bool> failed(false);
+  std::atomic<size_t> failedCheck(checks.size());
+  m_validationPool->parallelFor(checks.size(), [&](size_t i) {
+    if (failed) {
+      return;
+    }
+
+    const RingSignatureCheck& check = checks[i];
+    std::vector<const Crypto::PublicKey*> outputKeys;
+    outputKeys.reserve(check.outputKeys.size());
+    for (const Crypto::PublicKey& key : check.outputKeys) {
+      outputKeys.push_back(&key);
+    }
+
+    if (!Crypto::check_ring_signature(check.transactionPrefixHash, check.keyImage, outputKeys, check.signatures)) {
+      failedCheck = i;
+      failed = true;
+    }
+  });
+
+  if (failed) {
+    failedTransaction = checks[failedCheck].transaction;
+    return false;
+  }
+
+  return true;
+}
+
 uint64_t Blockchain::get_adjusted_time() {
   //TODO: add collecting median time
   return time(NULL);
@@ -1658,9 +1877,7 @@ bool Blockchain::check_block_timestamp_main(const Block& b) {
 
   std::vector<uint64_t> timestamps;
   size_t offset = m_blocks.size() <= m_currency.timestampCheckWindow() ? 0 : m_blocks.size() - m_currency.timestampCheckWindow();
-  for (; offset != m_blocks.size(); ++offset) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-  }
+  m_blockSummaryIndex.getTimestamps(static_cast<uint32_t>(offset), m_blockSummaryIndex.size(), timestamps);
 
   return check_block_timestamp(std::move(timestamps), b);
 }
@@ -1737,7 +1954,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
 
   { //to avoid deadlock lets lock tx_pool for whole add/reorganize process
     std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
-    std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+    ExclusiveBlocksLock bcLock(*this);
 
     if (haveBlock(id)) {
       logger(TRACE) << "block with id = " << id << " already exists";
@@ -1765,6 +1982,80 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
   return add_result;
 }
 
+bool Blockchain::addNewBlock(const Block& block, const std::vector<Transaction>& transactions, block_verification_context& bvc) {
+  // Precondition: transactions are the transactions of block in the order of block.transactionHashes
+
+  Crypto::Hash id;
+  if (!get_block_hash(block, id)) {
+    logger(ERROR, BRIGHT_RED) <<
+      "Failed to get block hash, possible block has invalid format";
+    bvc.m_verification_failed = true;
+    return false;
+  }
+
+  bool add_result;
+
+  {
+    std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
+    ExclusiveBlocksLock bcLock(*this);
+
+    if (haveBlock(id)) {
+      logger(TRACE) << "block with id = " << id << " already exists";
+      bvc.m_already_exists = true;
+      return false;
+    }
+
+    uint32_t blockchainHeight = getCurrentBlockchainHeight();
+
+    if (!(block.previousBlockHash == getTailId())) {
+      // alternative blocks take their transactions from the pool when the blockchain switches to them
+      for (size_t i = 0; i < transactions.size(); ++i) {
+        const Crypto::Hash& transactionHash = block.transactionHashes[i];
+        if (!haveTransaction(transactionHash) && !m_tx_pool.have_tx(transactionHash)) {
+          tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+          m_tx_pool.add_tx(transactions[i], transactionHash, getObjectBinarySize(transactions[i]), tvc, true, blockchainHeight);
+        }
+      }
+
+      bvc.m_added_to_main_chain = false;
+      add_result = handle_alternative_block(block, id, bvc);
+    } else {
+      for (const Crypto::Hash& transactionHash : block.transactionHashes) {
+        if (haveTransaction(transactionHash)) {
+          logger(INFO, BRIGHT_WHITE) <<
+            "Block " << id << " contains transaction " << transactionHash << " that is already in the blockchain";
+          bvc.m_verification_failed = true;
+          return false;
+        }
+      }
+
+      // copies of the transactions waiting in the pool are removed and put back if the block is rejected
+      std::vector<Transaction> poolTransactions;
+      for (const Crypto::Hash& transactionHash : block.transactionHashes) {
+        Transaction transaction;
+        size_t transactionSize;
+        uint64_t fee;
+        if (m_tx_pool.take_tx(transactionHash, transaction, transactionSize, fee)) {
+          poolTransactions.push_back(std::move(transaction));
+        }
+      }
+
+      add_result = pushBlock(block, transactions, bvc);
+      if (add_result) {
+        sendMessage(BlockchainMessage(NewBlockMessage(id)));
+      } else {
+        saveTransactions(poolTransactions);
+      }
+    }
+  }
+
+  if (add_result && bvc.m_added_to_main_chain) {
+    m_observerManager.notify(&IBlockchainStorageObserver::blockchainUpdated);
+  }
+
+  return add_result;
+}
+
 const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
   return m_blocks[index.block].transactions[index.transaction];
 }
@@ -1785,11 +2076,14 @@ bool Blockchain::pushBlock(const Block& blockData, block_verification_context& b
 }
 
 bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
 
-  Crypto::Hash blockHash = get_block_hash(blockData);
+  // the block hash is made from the merkle root computed from the transactions, it is computed once for both
+  Crypto::Hash merkleRoot = get_tx_tree_hash(blockData);
+  Crypto::Hash blockHash = NULL_HASH;
+  get_block_hash(blockData, merkleRoot, blockHash);
 
   // check block hash
   if (m_blockIndex.hasBlock(blockHash)) {
@@ -1816,7 +2110,6 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   }
 
   // check merkle root
-  Crypto::Hash merkleRoot = get_tx_tree_hash(blockData);
   if (merkleRoot != blockData.merkleRoot) {
     logger(INFO, BRIGHT_WHITE) <<
       "Block " << blockHash << " merkle root supplied " << blockData.merkleRoot << " does not match merkle root calculated " << merkleRoot;
@@ -1827,6 +2120,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   auto targetTimeStart = std::chrono::steady_clock::now();
   difficulty_type currentDifficulty = getDifficultyForNextBlock();
   auto target_calculating_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - targetTimeStart).count();
+  m_difficultyMetric.recordDuration(std::chrono::steady_clock::now() - targetTimeStart);
 
   if (!(currentDifficulty)) {
     logger(ERROR, BRIGHT_RED) << "!!!!!!!!! difficulty overhead !!!!!!!!!";
@@ -1864,6 +2158,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   }
 
   auto longhash_calculating_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - longhashTimeStart).count();
+  m_proofOfWorkMetric.recordDuration(std::chrono::steady_clock::now() - longhashTimeStart);
 
   if (!prevalidate_miner_transaction(blockData, static_cast<uint32_t>(m_blocks.size()))) {
     logger(INFO, BRIGHT_WHITE) <<
@@ -1884,6 +2179,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
+  // key images, double spends and referenced outputs are checked here one transaction after another,
+  // the ring signatures of all inputs are checked together afterwards
+  std::vector<RingSignatureCheck> ringSignatureChecks;
+  auto transactionInputsTimeStart = std::chrono::steady_clock::now();
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
@@ -1893,7 +2192,9 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
     blob_size = toBinaryArray(block.transactions.back().tx).size();
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    size_t firstCheck = ringSignatureChecks.size();
+    // transactions outlives ringSignatureChecks, so the checks can point to its signatures
+    if (!checkTransactionInputs(transactions[i], NULL, &ringSignatureChecks)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verification_failed = true;
@@ -1903,6 +2204,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
 
+    for (size_t j = firstCheck; j < ringSignatureChecks.size(); ++j) {
+      ringSignatureChecks[j].transaction = i;
+    }
+
     ++transactionIndex.transaction;
     pushTransaction(block, tx_id, transactionIndex);
 
@@ -1910,6 +2215,23 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     fee_summary += fee;
   }
 
+  m_transactionInputsMetric.recordDuration(std::chrono::steady_clock::now() - transactionInputsTimeStart);
+
+  auto signaturesTimeStart = std::chrono::steady_clock::now();
+  size_t failedTransaction;
+  if (!checkRingSignatures(ringSignatureChecks, failedTransaction)) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Failed to check ring signature for tx " << blockData.transactionHashes[failedTransaction];
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " has at least one transaction with wrong inputs: " << blockData.transactionHashes[failedTransaction];
+    bvc.m_verification_failed = true;
+    popTransactions(block, coinbaseTransactionHash);
+    return false;
+  }
+
+  auto signatures_checking_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - signaturesTimeStart).count();
+  m_ringSignaturesMetric.recordDuration(std::chrono::steady_clock::now() - signaturesTimeStart);
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verification_failed = true;
     return false;
@@ -1917,7 +2239,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
   int64_t emissionChange = 0;
   uint64_t reward = 0;
-  uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blocks.back().already_generated_coins;
+  uint64_t already_generated_coins = m_blockSummaryIndex.empty() ? 0 : m_blockSummaryIndex.getAlreadyGeneratedCoins(m_blockSummaryIndex.size() - 1);
   uint32_t blockchainHeight = static_cast<uint32_t>(m_blocks.size());
   if (!validate_miner_transaction(blockData, blockchainHeight, cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
     logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
@@ -1940,13 +2262,14 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     }
     else
     {
-      block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
+      block.cumulative_difficulty += m_blockSummaryIndex.getCumulativeDifficulty(m_blockSummaryIndex.size() - 1);
     }
   }
 
   pushBlock(block);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
+  m_blockValidationMetric.recordDuration(std::chrono::steady_clock::now() - blockProcessingStart);
 
   logger(DEBUGGING) <<
     "+++++ BLOCK SUCCESSFULLY ADDED" << ENDL << "id:\t" << blockHash
@@ -1954,25 +2277,44 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     << ENDL << "HEIGHT " << block.block_index << ", difficulty:\t" << currentDifficulty
     << ENDL << "block reward: " << m_currency.formatAmount(reward) << ", fee = " << m_currency.formatAmount(fee_summary)
     << ", coinbase_blob_size: " << coinbase_blob_size << ", cumulative size: " << cumulative_block_size
-    << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms";
+    << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << "/" << signatures_checking_time << ")ms";
 
   bvc.m_added_to_main_chain = true;
 
+  m_tx_pool.on_blockchain_inc(m_blocks.size(), blockHash, blockData.previousBlockHash, transactions);
+
   // removed hard fork 1 if clause here
 
   return true;
 }
 
+void Blockchain::setValidationThreads(size_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  ExclusiveBlocksLock lk(*this);
+  if (threadCount != m_validationPool->getThreadCount()) {
+    m_validationPool.reset(new WorkerPool(threadCount));
+  }
+}
+
 bool Blockchain::pushBlock(BlockEntry& block) {
   Crypto::Hash blockHash = get_block_hash(block.bl);
 
   m_blocks.push_back(block);
   m_blockIndex.push(blockHash);
+  m_blockSummaryIndex.push(block.bl.timestamp, block.cumulative_difficulty, block.block_cumulative_size, block.already_generated_coins);
+  m_difficultyCalculator.update();
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
 
   assert(m_blockIndex.size() == m_blocks.size());
+  assert(m_blockSummaryIndex.size() == m_blocks.size());
+
+  // the blockchain is locked exclusively, so no reader holds a block evicted from the cache
+  m_blocks.reclaim();
 
   return true;
 }
@@ -1998,8 +2340,16 @@ void Blockchain::popBlock(const Crypto::Hash& blockHash) {
 
   m_blocks.pop_back();
   m_blockIndex.pop();
+  m_blockSummaryIndex.pop();
+  m_blockEntryCache.truncate(static_cast<uint32_t>(m_blocks.size()));
+  m_difficultyCalculator.update();
 
   assert(m_blockIndex.size() == m_blocks.size());
+  assert(m_blockSummaryIndex.size() == m_blocks.size());
+
+  m_blocks.reclaim();
+
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), getTailId());
 }
 
 bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex) {
@@ -2049,6 +2399,8 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
       auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
       amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      const TransactionOutput& transactionOutput = transaction.tx.outputs[output];
+      m_outputKeyStore.push({ transactionOutput.amount, boost::get<KeyOutput>(transactionOutput.target).key, transaction.tx.unlockTime, transactionIndex.block });
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
       auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
@@ -2096,6 +2448,8 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
       if (amountOutputs->second.empty()) {
         m_outputs.erase(amountOutputs);
       }
+
+      m_outputKeyStore.pop();
     } else if (output.target.type() == typeid(MultisignatureOutput)) {
       auto amountOutputs = m_multisignatureOutputs.find(output.amount);
       if (amountOutputs == m_multisignatureOutputs.end()) {
@@ -2229,45 +2583,43 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   assert(startOffset < m_blocks.size());
 
-  auto bound = std::lower_bound(m_blocks.begin() + startOffset, m_blocks.end(), timestamp - m_currency.blockFutureTimeLimit(),
-    [](const BlockEntry& b, uint64_t timestamp) { return b.bl.timestamp < timestamp; });
-
-  if (bound == m_blocks.end()) {
+  uint32_t bound = m_blockSummaryIndex.findFirstTimestampNotLess(static_cast<uint32_t>(startOffset), timestamp - m_currency.blockFutureTimeLimit());
+  if (bound == m_blockSummaryIndex.size()) {
     return false;
   }
 
-  height = static_cast<uint32_t>(std::distance(m_blocks.begin(), bound));
+  height = bound;
   return true;
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
   } else {
-    blockHeight = m_blocks[it->second.block].block_index;
+    blockHeight = it->second.block;
     blockId = getBlockIdByHeight(blockHeight);
     return true;
   }
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    generatedCoins = m_blocks[height].already_generated_coins;
+    generatedCoins = m_blockSummaryIndex.getAlreadyGeneratedCoins(height);
     return true;
   }
 
@@ -2283,12 +2635,12 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    size = m_blocks[height].block_cumulative_size;
+    size = m_blockSummaryIndex.getBlockCumulativeSize(height);
     return true;
   }
 
@@ -2304,7 +2656,7 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2321,8 +2673,29 @@ bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMulti
   return true;
 }
 
+bool Blockchain::getKeyOutputReferences(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences) {
+  SharedBlocksLock lk(*this);
+  auto amountIter = m_outputs.find(txInToKey.amount);
+  if (amountIter == m_outputs.end() || txInToKey.outputIndexes.empty()) {
+    logger(DEBUGGING) << "Transaction contains key input with invalid amount.";
+    return false;
+  }
+
+  for (uint32_t outputIndex : relative_output_offsets_to_absolute(txInToKey.outputIndexes)) {
+    if (amountIter->second.size() <= outputIndex) {
+      logger(DEBUGGING) << "Transaction contains key input with invalid outputIndex.";
+      return false;
+    }
+
+    const std::pair<TransactionIndex, uint16_t>& output = amountIter->second[outputIndex];
+    outputReferences.push_back(std::make_pair(getObjectHash(transactionByIndex(output.first).tx), output.second));
+  }
+
+  return true;
+}
+
 bool Blockchain::storeBlockchainIndexes() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
 
   logger(INFO, BRIGHT_WHITE) << "Saving blockchain indexes...";
   BlockchainIndexesSerializer ser(*this, getTailId(), logger.getLogger());
@@ -2336,7 +2709,7 @@ bool Blockchain::storeBlockchainIndexes() {
 }
 
 bool Blockchain::loadBlockchainIndexes() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  ExclusiveBlocksLock lk(*this);
 
   logger(INFO, BRIGHT_WHITE) << "Loading blockchain indexes for BlockchainExplorer...";
   BlockchainIndexesSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
@@ -2354,6 +2727,7 @@ bool Blockchain::loadBlockchainIndexes() {
     for (uint32_t b = 0; b < m_blocks.size(); ++b) {
       if (b % 1000 == 0) {
         logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+        m_blocks.reclaim();
       }
       const BlockEntry& block = m_blocks[b];
       m_timestampIndex.add(block.bl.timestamp, get_block_hash(block.bl));
@@ -2370,23 +2744,107 @@ bool Blockchain::loadBlockchainIndexes() {
   return true;
 }
 
+bool Blockchain::storeBlockSummaryIndex() {
+  ExclusiveBlocksLock lk(*this);
+
+  logger(INFO, BRIGHT_WHITE) << "Saving block summary...";
+  BlockSummarySerializer ser(*this, getTailId(), logger.getLogger());
+
+  if (!storeToBinaryFile(ser, appendPath(m_config_folder, m_currency.blocksSummaryFileName()))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save block summary";
+    return false;
+  }
+
+  return true;
+}
+
+bool Blockchain::loadBlockSummaryIndex() {
+  ExclusiveBlocksLock lk(*this);
+
+  logger(INFO, BRIGHT_WHITE) << "Loading block summary...";
+  BlockSummarySerializer loader(*this, getTailId(), logger.getLogger());
+
+  if (!loadFromBinaryFile(loader, appendPath(m_config_folder, m_currency.blocksSummaryFileName())) ||
+      !loader.loaded() || m_blockSummaryIndex.size() != m_blocks.size()) {
+    logger(WARNING, BRIGHT_YELLOW) << "No actual block summary found, rebuilding...";
+    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+
+    m_blockSummaryIndex.clear();
+
+    for (uint32_t b = 0; b < m_blocks.size(); ++b) {
+      if (b % 1000 == 0) {
+        logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+        m_blocks.reclaim();
+      }
+      const BlockEntry& block = m_blocks[b];
+      m_blockSummaryIndex.push(block.bl.timestamp, block.cumulative_difficulty, block.block_cumulative_size, block.already_generated_coins);
+    }
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+    logger(INFO, BRIGHT_WHITE) << "Rebuilding block summary took: " << duration.count();
+  }
+  return true;
+}
+
+bool Blockchain::loadOutputKeyStore() {
+  ExclusiveBlocksLock lk(*this);
+
+  // the file is written as the chain changes, it is only checked against the outputs of the blockchain cache
+  uint64_t outputCount = 0;
+  bool actual = true;
+  for (const auto& amountOutputs : m_outputs) {
+    outputCount += amountOutputs.second.size();
+    if (m_outputKeyStore.getOutputCount(amountOutputs.first) != amountOutputs.second.size() ||
+        m_outputKeyStore.get(amountOutputs.first, static_cast<uint32_t>(amountOutputs.second.size() - 1)).blockIndex != amountOutputs.second.back().first.block) {
+      actual = false;
+      break;
+    }
+  }
+
+  if (!actual || m_outputKeyStore.size() != outputCount) {
+    logger(WARNING, BRIGHT_YELLOW) << "No actual output keys found, rebuilding...";
+    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+
+    m_outputKeyStore.clear();
+
+    for (uint32_t b = 0; b < m_blocks.size(); ++b) {
+      if (b % 1000 == 0) {
+        logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+        m_blocks.reclaim();
+      }
+      const BlockEntry& block = m_blocks[b];
+      for (const TransactionEntry& transaction : block.transactions) {
+        for (const TransactionOutput& output : transaction.tx.outputs) {
+          if (output.target.type() == typeid(KeyOutput)) {
+            m_outputKeyStore.push({ output.amount, boost::get<KeyOutput>(output.target).key, transaction.tx.unlockTime, b });
+          }
+        }
+      }
+    }
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+    logger(INFO, BRIGHT_WHITE) << "Rebuilding output keys took: " << duration.count();
+  }
+  return true;
+}
+
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_generatedTransactionsIndex.find(height, generatedTransactions);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_orthanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  SharedBlocksLock lk(*this);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
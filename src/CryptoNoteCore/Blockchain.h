@@ -11,14 +11,21 @@
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 
+#include "Common/Metrics.h"
 #include "Common/ObserverManager.h"
+#include "Common/RecursiveSharedMutex.h"
 #include "Common/Util.h"
+#include "Common/WorkerPool.h"
+#include "CryptoNoteCore/BlockEntryCache.h"
 #include "CryptoNoteCore/BlockIndex.h"
+#include "CryptoNoteCore/BlockSummaryIndex.h"
 #include "CryptoNoteCore/Checkpoints.h"
 #include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/DifficultyCalculator.h"
 #include "CryptoNoteCore/IBlockchainStorageObserver.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
-#include "CryptoNoteCore/SwappedVector.h"
+#include "CryptoNoteCore/MappedVector.h"
+#include "CryptoNoteCore/OutputKeyStore.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionPool.h"
 #include "CryptoNoteCore/BlockchainIndexes.h"
@@ -61,13 +68,21 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> getBlockIds(uint32_t startHeight, uint32_t maxCount);
 
     void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
+    // number of threads that check the ring signatures of a new block, 0 means one per core
+    void setValidationThreads(size_t threadCount);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks);
     bool getAlternativeBlocks(std::list<Block>& blocks);
     uint32_t getAlternativeBlocksCount();
     Crypto::Hash getBlockIdByHeight(uint32_t height);
+    uint64_t getBlockTimestamp(uint32_t height);
+    // appends the timestamps of heights [startHeight, endHeight) from the block summary
+    void getBlockTimestamps(uint32_t startHeight, uint32_t endHeight, std::vector<uint64_t>& timestamps);
     bool getBlockByHash(const Crypto::Hash &h, Block &blk);
     bool getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight);
+    bool getRawBlock(uint32_t height, std::string& block, std::vector<std::string>& transactions);
+    std::shared_ptr<const block_complete_entry> getBlockEntry(uint32_t height); // same blobs as getRawBlock(), shared with m_blockEntryCache, nullptr on failure
+    const BlockEntryCache& getBlockEntryCache() const { return m_blockEntryCache; }
 
     template<class archive_t> void serialize(archive_t & ar, const unsigned int version);
 
@@ -81,6 +96,7 @@ namespace CryptoNote {
     uint64_t getMinimalFee(uint32_t height);
     uint64_t getCoinsInCirculation();
     bool addNewBlock(const Block& bl_, block_verification_context& bvc);
+    bool addNewBlock(const Block& block, const std::vector<Transaction>& transactions, block_verification_context& bvc);
     bool resetAndSetGenesisBlock(const Block& b);
     bool haveBlock(const Crypto::Hash& id);
     size_t getTotalTransactions();
@@ -101,6 +117,7 @@ namespace CryptoNote {
     bool getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins);
     bool getBlockSize(const Crypto::Hash& hash, size_t& size);
     bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference);
+    bool getKeyOutputReferences(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences);
     bool getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions);
     bool getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes);
     bool getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps);
@@ -108,6 +125,8 @@ namespace CryptoNote {
     bool isBlockInMainChain(const Crypto::Hash& blockId);
     bool getBlockCumulativeDifficulty(uint32_t blockIndex, uint64_t& cumulativeDifficulty);
 
+    // vis.handle_output(const OutputKeyEntry&) is called for every output of the input, the outputs are read from the
+    // output key store, blocks are not loaded
     template<class visitor_t> bool scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height = NULL);
 
     bool addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue);
@@ -115,7 +134,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      SharedBlocksLock lk(*this);
 
       for (const auto& bl_id : block_ids) {
         uint32_t height = 0;
@@ -133,7 +152,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      SharedBlocksLock bcLock(*this);
 
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
@@ -218,6 +237,15 @@ namespace CryptoNote {
       }
     };
 
+    // ring signature of one input, checked after the serial checks of the whole block
+    struct RingSignatureCheck {
+      size_t transaction;
+      Crypto::Hash transactionPrefixHash;
+      Crypto::KeyImage keyImage;
+      std::vector<Crypto::PublicKey> outputKeys;
+      const Crypto::Signature* signatures;
+    };
+
     typedef google::sparse_hash_set<Crypto::KeyImage> key_images_container;
     typedef std::unordered_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
     typedef google::sparse_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
@@ -225,7 +253,8 @@ namespace CryptoNote {
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    // shared by readers, exclusive only while the main chain or the alternative chains change
+    Common::RecursiveSharedMutex m_blockchain_lock;
     Crypto::cn_context m_cn_context;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
@@ -233,20 +262,47 @@ namespace CryptoNote {
     size_t m_current_block_cumul_sz_limit;
     blocks_ext_by_hash m_alternative_chains; // Crypto::Hash -> block_extended_info
     outputs_container m_outputs;
+    OutputKeyStore m_outputKeyStore; // the keys, unlock times and block indexes of m_outputs
 
     std::string m_config_folder;
     Checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
-    typedef SwappedVector<BlockEntry> Blocks;
+    typedef MappedVector<BlockEntry> Blocks;
+
+    // m_blockchain_lock together with a reader guard of m_blocks, the blocks read under it stay valid until it is
+    // released and the last one released frees the blocks evicted meanwhile
+    template<class Lock> class BlocksLock {
+    public:
+      explicit BlocksLock(Blockchain& blockchain) : m_lock(blockchain.m_blockchain_lock), m_guard(blockchain.m_blocks) {
+      }
+
+    private:
+      Lock m_lock;
+      Blocks::ReadGuard m_guard;
+    };
+
+    typedef BlocksLock<Common::SharedLockGuard<Common::RecursiveSharedMutex>> SharedBlocksLock;
+    typedef BlocksLock<std::lock_guard<Common::RecursiveSharedMutex>> ExclusiveBlocksLock;
     typedef std::unordered_map<Crypto::Hash, uint32_t> BlockMap;
     typedef std::unordered_map<Crypto::Hash, TransactionIndex> TransactionMap;
 
     friend class BlockCacheSerializer;
     friend class BlockchainIndexesSerializer;
+    friend class BlockSummarySerializer;
 
     Blocks m_blocks;
     CryptoNote::BlockIndex m_blockIndex;
+    CryptoNote::BlockSummaryIndex m_blockSummaryIndex;
+    CryptoNote::BlockEntryCache m_blockEntryCache;
+    CryptoNote::DifficultyCalculator m_difficultyCalculator;
+    std::unique_ptr<Common::WorkerPool> m_validationPool;
+    // time spent in the stages of pushBlock()
+    Common::MetricHistogram& m_difficultyMetric;
+    Common::MetricHistogram& m_proofOfWorkMetric;
+    Common::MetricHistogram& m_transactionInputsMetric;
+    Common::MetricHistogram& m_ringSignaturesMetric;
+    Common::MetricHistogram& m_blockValidationMetric;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
 
@@ -268,7 +324,7 @@ namespace CryptoNote {
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
     bool rollback_blockchain_switching(std::list<Block>& original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
+    bool add_out_to_get_random_outs(CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
     size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs);
     bool check_block_timestamp_main(const Block& b);
@@ -279,9 +335,10 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_comulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL, RingSignatureCheck* deferredCheck = NULL);
+    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedTransaction);
     bool have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
     bool pushBlock(const Block& blockData, block_verification_context& bvc);
@@ -295,6 +352,9 @@ namespace CryptoNote {
 
     bool storeBlockchainIndexes();
     bool loadBlockchainIndexes();
+    bool storeBlockSummaryIndex();
+    bool loadBlockSummaryIndex();
+    bool loadOutputKeyStore();
 
     bool loadTransactions(const Block& block, std::vector<Transaction>& transactions);
     void saveTransactions(const std::vector<Transaction>& transactions);
@@ -304,11 +364,12 @@ namespace CryptoNote {
     friend class LockedBlockchainStorage;
   };
 
+  // Keeps the blockchain from changing for the lifetime of the object, other readers are not blocked.
   class LockedBlockchainStorage: boost::noncopyable {
   public:
 
     LockedBlockchainStorage(Blockchain& bc)
-      : m_bc(bc), m_lock(bc.m_blockchain_lock) {}
+      : m_bc(bc), m_lock(bc) {}
 
     Blockchain* operator -> () {
       return &m_bc;
@@ -317,45 +378,32 @@ namespace CryptoNote {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    Blockchain::SharedBlocksLock m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
-    auto it = m_outputs.find(tx_in_to_key.amount);
-    if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
+    SharedBlocksLock lk(*this);
+    uint32_t outputCount = m_outputKeyStore.getOutputCount(tx_in_to_key.amount);
+    if (outputCount == 0 || !tx_in_to_key.outputIndexes.size())
       return false;
 
     std::vector<uint32_t> absolute_offsets = relative_output_offsets_to_absolute(tx_in_to_key.outputIndexes);
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs_vec = it->second;
     size_t count = 0;
-    for (uint64_t i : absolute_offsets) {
-      if(i >= amount_outs_vec.size() ) {
-        logger(Logging::INFO) << "Wrong index in transaction inputs: " << i << ", expected maximum " << amount_outs_vec.size() - 1;
-        return false;
-      }
-
-      //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
-      //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
-
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
-
-      if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
-        logger(Logging::ERROR, Logging::BRIGHT_RED)
-            << "Wrong index in transaction outputs: "
-            << amount_outs_vec[i].second << ", expected less then "
-            << tx.tx.outputs.size();
+    for (uint32_t i : absolute_offsets) {
+      if(i >= outputCount) {
+        logger(Logging::INFO) << "Wrong index in transaction inputs: " << i << ", expected maximum " << outputCount - 1;
         return false;
       }
 
-      if (!vis.handle_output(tx.tx, tx.tx.outputs[amount_outs_vec[i].second], amount_outs_vec[i].second)) {
+      const OutputKeyEntry& output = m_outputKeyStore.get(tx_in_to_key.amount, i);
+      if (!vis.handle_output(output)) {
         logger(Logging::INFO) << "Failed to handle_output for output no = " << count << ", with absolute offset " << i;
         return false;
       }
 
       if(count++ == absolute_offsets.size()-1 && pmax_related_block_height) {
-        if (*pmax_related_block_height < amount_outs_vec[i].first.block) {
-          *pmax_related_block_height = amount_outs_vec[i].first.block;
+        if (*pmax_related_block_height < output.blockIndex) {
+          *pmax_related_block_height = output.blockIndex;
         }
       }
     }
@@ -5,6 +5,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
 #include <sstream>
 #include <unordered_set>
 
@@ -22,6 +23,7 @@
 #include "CryptoNoteTools.h"
 #include "CryptoNoteStatInfo.h"
 #include "Miner.h"
+#include "PreparedBlock.h"
 #include "TransactionExtra.h"
 #include "IBlock.h"
 #include "CryptoNoteCore/CoreConfig.h"
@@ -60,7 +62,11 @@ logger(logger, "core"),
 m_mempool(currency, m_blockchain, m_timeProvider, logger),
 m_blockchain(currency, m_mempool, logger),
 m_miner(new miner(currency, *this, logger)),
-m_starter_message_showed(false) {
+m_starter_message_showed(false),
+m_blockTemplateCacheTip(NULL_HASH),
+m_blockTemplateCachePoolVersion(0),
+m_blockTemplateCacheHitsMetric(Common::MetricsRegistry::instance().counter("cash2_block_template_cache_hits_total", "Block templates given from the block template cache")),
+m_blockTemplateCacheMissesMetric(Common::MetricsRegistry::instance().counter("cash2_block_template_cache_misses_total", "Block templates made from the blockchain and the memory pool")) {
   set_cryptonote_protocol(pprotocol);
   m_blockchain.addObserver(this);
   m_mempool.addObserver(this);
@@ -117,6 +123,11 @@ bool Core::addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) {
   return m_blockchain.addMessageQueue(messageQueue);
 }
 
+bool Core::addPreparedBlock(const PreparedBlock& block, block_verification_context& bvc) {
+  // the transactions of the block were checked by prepareBlock() and go to the blockchain without passing through the mempool
+  return m_blockchain.addNewBlock(block.block, block.transactions, bvc);
+}
+
 std::vector<Crypto::Hash> Core::buildSparseChain() {
   assert(m_blockchain.getCurrentBlockchainHeight() != 0);
   return m_blockchain.buildSparseChain();
@@ -329,6 +340,70 @@ bool Core::have_block(const Crypto::Hash& id) {
   return m_blockchain.haveBlock(id);
 }
 
+bool Core::prepareBlock(const block_complete_entry& entry, PreparedBlock& block) {
+  // Only checks that do not depend on the blockchain state are done here, so several blocks can be prepared at the same time
+
+  if (entry.block.size() > m_currency.maxBlockBlobSize()) {
+    logger(INFO) << "WRONG BLOCK BLOB, too big size " << entry.block.size() << ", rejected";
+    return false;
+  }
+
+  if (!fromBinaryArray(block.block, asBinaryArray(entry.block))) {
+    logger(INFO) << "Failed to parse and validate new block";
+    return false;
+  }
+
+  // used for the block hash and by the merkle root check below
+  Crypto::Hash merkleRoot = get_tx_tree_hash(block.block);
+  if (!get_block_hash(block.block, merkleRoot, block.hash)) {
+    logger(INFO) << "Failed to get block hash, possible block has invalid format";
+    return false;
+  }
+
+  if (entry.txs.size() != block.block.transactionHashes.size()) {
+    logger(INFO) << "Block " << block.hash << " has " << block.block.transactionHashes.size() << " transactions, but " << entry.txs.size() << " were received";
+    return false;
+  }
+
+  uint32_t blockHeight = get_block_height(block.block);
+
+  block.transactions.resize(entry.txs.size());
+  block.transactionSizes.resize(entry.txs.size());
+  for (size_t i = 0; i < entry.txs.size(); ++i) {
+    const std::string& transactionBlob = entry.txs[i];
+    if (transactionBlob.size() > m_currency.maxTxSize()) {
+      logger(INFO) << "WRONG TRANSACTION BLOB, too big size " << transactionBlob.size() << ", rejected";
+      return false;
+    }
+
+    Crypto::Hash transactionHash;
+    Crypto::Hash transactionPrefixHash;
+    if (!parse_tx_from_blob(block.transactions[i], transactionHash, transactionPrefixHash, asBinaryArray(transactionBlob))) {
+      logger(INFO) << "WRONG TRANSACTION BLOB, Failed to parse, rejected";
+      return false;
+    }
+
+    if (transactionHash != block.block.transactionHashes[i]) {
+      logger(INFO) << "Block " << block.hash << " expects transaction " << block.block.transactionHashes[i] << " at index " << i << ", but " << transactionHash << " was received";
+      return false;
+    }
+
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    if (!checkIncomingTransaction(block.transactions[i], transactionHash, transactionBlob.size(), tvc, true, blockHeight)) {
+      return false;
+    }
+
+    block.transactionSizes[i] = transactionBlob.size();
+  }
+
+  if (merkleRoot != block.block.merkleRoot) {
+    logger(INFO) << "Block " << block.hash << " merkle root supplied " << block.block.merkleRoot << " does not match merkle root calculated " << merkleRoot;
+    return false;
+  }
+
+  return true;
+}
+
 bool Core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockFullInfo>& entries) {
   LockedBlockchainStorage lbs(m_blockchain);
 
@@ -358,25 +433,18 @@ bool Core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
-
-  for (auto& b : blocks) {
+  uint32_t endHeight = std::min(startFullOffset + blocksLeft, currentHeight);
+  for (uint32_t height = startFullOffset; height < endHeight; ++height) {
     BlockFullInfo item;
 
-    item.block_id = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+    item.block_id = lbs->getBlockIdByHeight(height);
 
-      // fill data
-      block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
+    if (lbs->getBlockTimestamp(height) >= timestamp) {
+      // the stored blobs are sent as they are, recent heights polled by many wallets come from the block entry cache
+      item.cachedEntry = lbs->getBlockEntry(height);
+      if (!item.cachedEntry) {
+        logger(ERROR, BRIGHT_RED) << "Failed to load block at height " << height;
+        return false;
       }
     }
 
@@ -426,11 +494,20 @@ bool Core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
 
       item.block = asString(toBinaryArray(b));
 
+      // global output indexes are sent along so that wallets do not ask for them transaction by transaction
+      if (!b.baseTransaction.outputs.empty()) {
+        lbs->getTransactionOutputGlobalIndexes(getObjectHash(b.baseTransaction), item.baseTransactionGlobalIndexes);
+      }
+
       for (const auto& tx: txs) {
         TransactionPrefixInfo info;
         info.txPrefix = tx;
         info.txHash = getObjectHash(tx);
 
+        if (!tx.outputs.empty()) {
+          lbs->getTransactionOutputGlobalIndexes(info.txHash, info.globalIndexes);
+        }
+
         item.txPrefixes.push_back(std::move(info));
       }
     }
@@ -446,20 +523,13 @@ bool Core::removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) {
 }
 
 bool Core::scanOutputkeysForIndexes(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences) {
-  struct outputs_visitor
-  {
-    std::list<std::pair<Crypto::Hash, size_t>>& m_resultsCollector;
-    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector):m_resultsCollector(resultsCollector){}
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex)
-    {
-      m_resultsCollector.push_back(std::make_pair(getObjectHash(tx), transactionOutputIndex));
-      return true;
-    }
-  };
-    
-  outputs_visitor vi(outputReferences);
-    
-  return m_blockchain.scanOutputKeysForIndexes(txInToKey, vi);
+  // the output key store has no transaction hashes, the references are read from the blocks
+  return m_blockchain.getKeyOutputReferences(txInToKey, outputReferences);
+}
+
+void Core::getBlockEntryCacheStatistics(uint64_t& hits, uint64_t& misses) {
+  hits = m_blockchain.getBlockEntryCache().getHits();
+  misses = m_blockchain.getBlockEntryCache().getMisses();
 }
 
 uint64_t Core::getNextBlockDifficulty() {
@@ -580,8 +650,19 @@ bool Core::getPoolTransactionsByTimestamp(uint64_t timestampBegin, uint64_t time
 }
 
 bool Core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& blockchainHeight, const BinaryArray& ex_nonce) {
+  if (getCachedBlockTemplate(b, adr, diffic, blockchainHeight, ex_nonce)) {
+    m_blockTemplateCacheHitsMetric.add();
+    return true;
+  }
+
+  m_blockTemplateCacheMissesMetric.add();
+
+  // read before the pool is, so a template is never cached with a pool version newer than its transactions
+  uint64_t poolVersion = m_mempool.getVersion();
+
   size_t median_size;
   uint64_t already_generated_coins;
+  uint64_t median_ts = 0;
 
   {
     LockedBlockchainStorage blockchainLock(m_blockchain);
@@ -605,17 +686,9 @@ bool Core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
     if (blockchainHeight >= m_currency.timestampCheckWindow())
     {
       std::vector<uint64_t> timestamps;
-      for(size_t offset = blockchainHeight - m_currency.timestampCheckWindow(); offset < blockchainHeight; ++offset)
-      {
-        Crypto::Hash blockHash = getBlockIdByHeight(offset);
-        Block block;
-        if (getBlockByHash(blockHash, block))
-        {
-          timestamps.push_back(block.timestamp);
-        }
-      }
-      
-      uint64_t median_ts = Common::medianValue(timestamps);
+      m_blockchain.getBlockTimestamps(static_cast<uint32_t>(blockchainHeight - m_currency.timestampCheckWindow()), blockchainHeight, timestamps);
+
+      median_ts = Common::medianValue(timestamps);
       
       if (b.timestamp < median_ts)
       {
@@ -647,6 +720,8 @@ bool Core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
   // The merkle root is added to the block here because if we are mining in simplewallet the merkle root is not calculated from the coinbase transaction and block transaction hashes like it is in the mining pool
   b.merkleRoot = get_tx_tree_hash(b);
 
+  cacheBlockTemplate(b, adr, diffic, blockchainHeight, ex_nonce, poolVersion, median_ts);
+
   return true;
 
 }
@@ -657,26 +732,7 @@ size_t Core::get_pool_transactions_count() {
 
 bool Core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t blockHeight) {
   
-  if (!check_tx_syntax(tx)) {
-    logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
-    tvc.m_verification_failed = true;
-    return false;
-  }
-
-  if (!check_tx_semantic(tx, keptByBlock, blockHeight)) {
-    logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " semantic, rejected";
-    tvc.m_verification_failed = true;
-    return false;
-  }
-
-  if (!check_tx_mixin(tx)) {
-    logger(INFO) << "Mixin for transaction " << txHash << " is too large, rejected";
-    tvc.m_verification_failed = true;
-    return false;
-  }
-
-  if (!check_tx_fee(tx, blobSize, tvc, keptByBlock, blockHeight)) {
-    tvc.m_verification_failed = true;
+  if (!checkIncomingTransaction(tx, txHash, blobSize, tvc, keptByBlock, blockHeight)) {
     return false;
   }
 
@@ -808,6 +864,7 @@ bool Core::init(const CoreConfig& config, const MinerConfig& minerConfig, bool l
     bool r = m_mempool.init(m_config_folder);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize memory pool"; return false; }
 
+  m_blockchain.setValidationThreads(config.validationThreads);
   r = m_blockchain.init(m_config_folder, load_existing);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage"; return false; }
 
@@ -953,6 +1010,35 @@ bool Core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t
   return m_mempool.add_tx(tx, tx_hash, blob_size, tvc, kept_by_block, blockchainHeight);
 }
 
+bool Core::checkIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t blockHeight) {
+  // Checks that only depend on the transaction itself
+
+  if (!check_tx_syntax(tx)) {
+    logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  if (!check_tx_semantic(tx, keptByBlock, blockHeight)) {
+    logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " semantic, rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  if (!check_tx_mixin(tx)) {
+    logger(INFO) << "Mixin for transaction " << txHash << " is too large, rejected";
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  if (!check_tx_fee(tx, blobSize, tvc, keptByBlock, blockHeight)) {
+    tvc.m_verification_failed = true;
+    return false;
+  }
+
+  return true;
+}
+
 bool Core::check_tx_fee(const Transaction& tx, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t blockHeight) {
   uint64_t inputs_amount = 0;
   if (!get_inputs_money_amount(tx, inputs_amount)) {
@@ -1126,10 +1212,12 @@ bool Core::parse_tx_from_blob(Transaction& tx, Crypto::Hash& tx_hash, Crypto::Ha
 
 
 void Core::blockchainUpdated() {
+  clearBlockTemplateCache();
   m_observerManager.notify(&ICoreObserver::blockchainUpdated);
 }
 
 void Core::poolUpdated() {
+  clearBlockTemplateCache();
   m_observerManager.notify(&ICoreObserver::poolUpdated);
 }
 
@@ -1141,6 +1229,81 @@ void Core::txDeletedFromPool() {
 // Private mining functions
 
 
+void Core::cacheBlockTemplate(const Block& b, const AccountPublicAddress& adr, difficulty_type diffic, uint32_t blockchainHeight, const BinaryArray& ex_nonce, uint64_t poolVersion, uint64_t minimumTimestamp) {
+  const BinaryArray& extra = b.baseTransaction.extra;
+  if (extra.size() < ex_nonce.size() || !std::equal(ex_nonce.begin(), ex_nonce.end(), extra.end() - ex_nonce.size())) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_blockTemplateCacheLock);
+
+  if (b.previousBlockHash != m_blockTemplateCacheTip || poolVersion != m_blockTemplateCachePoolVersion) {
+    m_blockTemplateCache.clear();
+    m_blockTemplateCacheTip = b.previousBlockHash;
+    m_blockTemplateCachePoolVersion = poolVersion;
+  }
+
+  auto it = std::find_if(m_blockTemplateCache.begin(), m_blockTemplateCache.end(), [&](const BlockTemplateCacheEntry& entry) {
+    return entry.address.spendPublicKey == adr.spendPublicKey && entry.address.viewPublicKey == adr.viewPublicKey &&
+      entry.extraNonceSize == ex_nonce.size();
+  });
+
+  if (it != m_blockTemplateCache.end()) {
+    m_blockTemplateCache.erase(it);
+  } else if (m_blockTemplateCache.size() == BLOCK_TEMPLATE_CACHE_SIZE) {
+    m_blockTemplateCache.erase(m_blockTemplateCache.begin());
+  }
+
+  m_blockTemplateCache.push_back({ adr, ex_nonce.size(), b, diffic, blockchainHeight, minimumTimestamp });
+}
+
+void Core::clearBlockTemplateCache() {
+  std::lock_guard<std::mutex> lock(m_blockTemplateCacheLock);
+  m_blockTemplateCache.clear();
+  m_blockTemplateCacheTip = NULL_HASH;
+}
+
+bool Core::getCachedBlockTemplate(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& blockchainHeight, const BinaryArray& ex_nonce) {
+  uint64_t poolVersion = m_mempool.getVersion();
+  Crypto::Hash tailId = get_tail_id();
+  uint64_t minimumTimestamp;
+
+  {
+    std::lock_guard<std::mutex> lock(m_blockTemplateCacheLock);
+
+    if (m_blockTemplateCache.empty() || tailId != m_blockTemplateCacheTip || poolVersion != m_blockTemplateCachePoolVersion) {
+      return false;
+    }
+
+    auto it = std::find_if(m_blockTemplateCache.begin(), m_blockTemplateCache.end(), [&](const BlockTemplateCacheEntry& entry) {
+      return entry.address.spendPublicKey == adr.spendPublicKey && entry.address.viewPublicKey == adr.viewPublicKey &&
+        entry.extraNonceSize == ex_nonce.size();
+    });
+
+    if (it == m_blockTemplateCache.end()) {
+      return false;
+    }
+
+    b = it->block;
+    diffic = it->difficulty;
+    blockchainHeight = it->height;
+    minimumTimestamp = it->minimumTimestamp;
+  }
+
+  // the extra nonce keeps its size, so the coinbase transaction size and the block reward stay the same
+  std::copy(ex_nonce.begin(), ex_nonce.end(), b.baseTransaction.extra.end() - ex_nonce.size());
+
+  b.timestamp = time(NULL);
+  if (b.timestamp < minimumTimestamp) {
+    b.timestamp = minimumTimestamp;
+  }
+
+  // the coinbase transaction hashes are the first of the merkle root chain, so the whole chain is hashed again
+  b.merkleRoot = get_tx_tree_hash(b);
+
+  return true;
+}
+
 bool Core::update_miner_block_template() {
   m_miner->on_block_chain_update();
   return true;
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include "P2p/NodeServerCommon.h"
@@ -19,6 +20,7 @@
 #include "CryptoNoteCore/CoreConfig.h"
 #include "ICore.h"
 #include "ICoreObserver.h"
+#include "Common/Metrics.h"
 #include "Common/ObserverManager.h"
 #include "System/Dispatcher.h"
 #include "CryptoNoteCore/MessageQueue.h"
@@ -35,6 +37,7 @@ public:
   // Public blockchain functions
   virtual size_t addChain(const std::vector<const IBlock*>& chain) override;
   virtual bool addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) override;
+  virtual bool addPreparedBlock(const PreparedBlock& block, block_verification_context& bvc) override;
   std::vector<Crypto::Hash> buildSparseChain() override;
   std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId) override;
   virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash>& remoteBlockIds, size_t maxCount, uint32_t& totalBlockCount, uint32_t& startBlockIndex) override;
@@ -65,10 +68,12 @@ public:
   virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
   bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override;
   bool have_block(const Crypto::Hash& id) override;
+  virtual bool prepareBlock(const block_complete_entry& entry, PreparedBlock& block) override;
   virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp, uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) override;
   virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) override;
   virtual bool removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) override;
   virtual bool scanOutputkeysForIndexes(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences) override;
+  void getBlockEntryCacheStatistics(uint64_t& hits, uint64_t& misses);
   uint64_t getNextBlockDifficulty();
   uint64_t getTotalGeneratedAmount();
   bool get_alternative_blocks(std::list<Block>& blocks);
@@ -134,6 +139,7 @@ private:
   
   // Private mempool functions
   bool add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool kept_by_block);
+  bool checkIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t blockHeight);
   bool check_tx_fee(const Transaction& tx, size_t blobSize, tx_verification_context& tvc, bool kept_by_block, uint32_t blockHeight);
   bool check_tx_inputs_keyimages_diff(const Transaction& tx);
   bool check_tx_inputs_keyimages_domain(const Transaction& tx) const;
@@ -148,6 +154,9 @@ private:
   virtual void txDeletedFromPool() override;
 
   // Private mining functions
+  void cacheBlockTemplate(const Block& b, const AccountPublicAddress& adr, difficulty_type diffic, uint32_t blockchainHeight, const BinaryArray& ex_nonce, uint64_t poolVersion, uint64_t minimumTimestamp);
+  void clearBlockTemplateCache();
+  bool getCachedBlockTemplate(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& blockchainHeight, const BinaryArray& ex_nonce);
   bool update_miner_block_template();
   
   // Other private functions
@@ -167,6 +176,27 @@ private:
   std::atomic<bool> m_starter_message_showed;
   Tools::ObserverManager<ICoreObserver> m_observerManager;
 
+  // The block templates made for the tip and the pool version, by address and extra nonce size. A template is given
+  // again with the extra nonce of the request written over the one it was made with, the extra nonce is the end of the
+  // coinbase transaction extra.
+  struct BlockTemplateCacheEntry {
+    AccountPublicAddress address;
+    size_t extraNonceSize;
+    Block block;
+    difficulty_type difficulty;
+    uint32_t height;
+    uint64_t minimumTimestamp; // the median timestamp of the last blocks
+  };
+
+  static const size_t BLOCK_TEMPLATE_CACHE_SIZE = 16;
+
+  std::mutex m_blockTemplateCacheLock;
+  Crypto::Hash m_blockTemplateCacheTip;
+  uint64_t m_blockTemplateCachePoolVersion;
+  std::vector<BlockTemplateCacheEntry> m_blockTemplateCache;
+  Common::MetricCounter& m_blockTemplateCacheHitsMetric;
+  Common::MetricCounter& m_blockTemplateCacheMissesMetric;
+
 }; // end class Core
 
 } // end namespace CryptoNote
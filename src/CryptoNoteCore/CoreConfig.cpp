@@ -10,6 +10,12 @@
 
 namespace CryptoNote {
 
+namespace {
+
+const command_line::arg_descriptor<uint32_t> arg_validation_threads = { "validation-threads", "Number of threads checking the signatures of new blocks, 0 uses one thread per core", 0 };
+
+}
+
 CoreConfig::CoreConfig() {
   configFolder = Tools::getDefaultDataDirectory();
 }
@@ -19,8 +25,13 @@ void CoreConfig::init(const boost::program_options::variables_map& options) {
     configFolder = command_line::get_arg(options, command_line::arg_data_dir);
     configFolderDefaulted = options[command_line::arg_data_dir.name].defaulted();
   }
+
+  if (options.count(arg_validation_threads.name) != 0) {
+    validationThreads = command_line::get_arg(options, arg_validation_threads);
+  }
 }
 
 void CoreConfig::initOptions(boost::program_options::options_description& desc) {
+  command_line::add_arg(desc, arg_validation_threads);
 }
 } //namespace CryptoNote
@@ -20,6 +20,7 @@ public:
 
   std::string configFolder;
   bool configFolderDefaulted = true;
+  size_t validationThreads = 0;
 };
 
 } //namespace CryptoNote
@@ -457,12 +457,16 @@ bool lookup_acc_outs(const AccountKeys& acc, const Transaction& tx, const Public
 }
 
 bool get_block_hashing_blob(const Block& b, BinaryArray& ba) {
+  return get_block_hashing_blob(b, get_tx_tree_hash(b), ba);
+}
+
+bool get_block_hashing_blob(const Block& b, const Hash& merkleRoot, BinaryArray& ba) {
   BlockHeader blockHeader;
 
   blockHeader.previousBlockHash = b.previousBlockHash;
   blockHeader.nonce = b.nonce;
   blockHeader.timestamp = b.timestamp;
-  blockHeader.merkleRoot = get_tx_tree_hash(b);
+  blockHeader.merkleRoot = merkleRoot;
 
   if (!toBinaryArray(blockHeader, ba)) {
     return false;
@@ -486,6 +490,15 @@ Hash get_block_hash(const Block& b) {
   return p;
 }
 
+bool get_block_hash(const Block& b, const Hash& merkleRoot, Hash& res) {
+  BinaryArray ba;
+  if (!get_block_hashing_blob(b, merkleRoot, ba)) {
+    return false;
+  }
+
+  return getObjectHash(ba, res);
+}
+
 bool get_aux_block_header_hash(const Block& b, Hash& res) {
   BinaryArray blob;
   if (!get_block_hashing_blob(b, blob)) {
@@ -512,6 +525,21 @@ bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
   return true;
 }
 
+bool get_block_longhash_state(const Block& b, nonce_hash_state& state) {
+  BinaryArray bd;
+  if (!get_block_hashing_blob(b, bd)) {
+    return false;
+  }
+
+  // the nonce follows prev_id in the hashing blob, see serializeBlockHeader()
+  size_t nonceOffset = sizeof(b.previousBlockHash);
+  if (nonce_hash_init(&state, bd.data(), bd.size(), nonceOffset) == -1) {
+    return false;
+  }
+
+  return true;
+}
+
 std::vector<uint32_t> relative_output_offsets_to_absolute(const std::vector<uint32_t>& off) {
   std::vector<uint32_t> res = off;
   for (size_t i = 1; i < res.size(); i++)
@@ -540,12 +568,10 @@ Hash get_tx_tree_hash(const std::vector<Hash>& tx_hashes) {
   return h;
 }
 
-Hash get_tx_tree_hash(const Block& b) {
+void get_base_tx_tree_hashes(const Transaction& baseTransaction, std::vector<Hash>& txs_ids) {
   BinaryArray baseTransactionBA;
  
-  toBinaryArray(b.baseTransaction, baseTransactionBA);
-
-  std::vector<Hash> txs_ids;
+  toBinaryArray(baseTransaction, baseTransactionBA);
 
   if (baseTransactionBA.size() > 120)
   {
@@ -593,12 +619,15 @@ Hash get_tx_tree_hash(const Block& b) {
 
     txs_ids.push_back(baseTransactionHash);
   }
+}
 
-  for (auto& th : b.transactionHashes) {
-    txs_ids.push_back(th);
-  }
+Hash get_tx_tree_hash(const Block& b) {
+  std::vector<Hash> txs_ids;
+  get_base_tx_tree_hashes(b.baseTransaction, txs_ids);
 
-  return get_tx_tree_hash(txs_ids);
+  Hash h = get_tx_tree_hash(txs_ids);
+  tree_hash_extend(&h, 1, b.transactionHashes.data(), b.transactionHashes.size());
+  return h;
 }
 
 }
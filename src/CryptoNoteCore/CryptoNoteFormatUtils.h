@@ -58,10 +58,15 @@ bool generate_key_image_helper(const AccountKeys& ack, const Crypto::PublicKey&
 std::string short_hash_str(const Crypto::Hash& h);
 
 bool get_block_hashing_blob(const Block& b, BinaryArray& blob);
+// merkleRoot is get_tx_tree_hash(b), for callers that have computed it already
+bool get_block_hashing_blob(const Block& b, const Crypto::Hash& merkleRoot, BinaryArray& blob);
 bool get_aux_block_header_hash(const Block& b, Crypto::Hash& res);
 bool get_block_hash(const Block& b, Crypto::Hash& res);
 Crypto::Hash get_block_hash(const Block& b);
+bool get_block_hash(const Block& b, const Crypto::Hash& merkleRoot, Crypto::Hash& res);
 bool get_block_longhash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res);
+// builds the hashing blob once, Crypto::nonce_hash() with the state then gives get_block_longhash() of the block with other nonces
+bool get_block_longhash_state(const Block& b, Crypto::nonce_hash_state& state);
 bool get_inputs_money_amount(const Transaction& tx, uint64_t& money);
 uint64_t get_outs_money_amount(const Transaction& tx);
 bool check_inputs_types_supported(const TransactionPrefix& tx);
@@ -112,5 +117,7 @@ void decompose_amount_into_digits(uint64_t amount, uint64_t dust_threshold, cons
 void get_tx_tree_hash(const std::vector<Crypto::Hash>& tx_hashes, Crypto::Hash& h);
 Crypto::Hash get_tx_tree_hash(const std::vector<Crypto::Hash>& tx_hashes);
 Crypto::Hash get_tx_tree_hash(const Block& b);
+// the first hashes of the merkle root chain of a block, see tree_hash(), they are followed by the transaction hashes
+void get_base_tx_tree_hashes(const Transaction& baseTransaction, std::vector<Crypto::Hash>& hashes);
 
 }
@@ -63,9 +63,11 @@ bool Currency::init() {
   if (isTestnet()) {
     m_blocksFileName = "testnet_" + m_blocksFileName;
     m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
+    m_blocksSummaryFileName = "testnet_" + m_blocksSummaryFileName;
     m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
     m_txPoolFileName = "testnet_" + m_txPoolFileName;
     m_blockchainIndexesFileName = "testnet_" + m_blockchainIndexesFileName;
+    m_outputKeysFileName = "testnet_" + m_outputKeysFileName;
   }
 
   return true;
@@ -559,6 +561,17 @@ difficulty_type Currency::nextDifficulty2(std::vector<uint64_t> timestamps, std:
   sort(timestamps.begin(), timestamps.end());
 
   size_t cutBegin, cutEnd;
+  getDifficultyCut2(length, cutBegin, cutEnd);
+  assert(/*cut_begin >= 0 &&*/ cutBegin + 2 <= cutEnd && cutEnd <= length);
+  uint64_t timeSpan = timestamps[cutEnd - 1] - timestamps[cutBegin];
+
+  difficulty_type totalWork = cumulativeDifficulties[cutEnd - 1] - cumulativeDifficulties[cutBegin];
+  assert(totalWork > 0);
+
+  return nextDifficulty2(timeSpan, totalWork);
+}
+
+void Currency::getDifficultyCut2(size_t length, size_t& cutBegin, size_t& cutEnd) const {
   assert(2 * m_difficultyCut <= m_difficultyWindow - 2);
   if (length <= m_difficultyWindow - 2 * m_difficultyCut) {
     cutBegin = 0;
@@ -567,15 +580,13 @@ difficulty_type Currency::nextDifficulty2(std::vector<uint64_t> timestamps, std:
     cutBegin = (length - (m_difficultyWindow - 2 * m_difficultyCut) + 1) / 2;
     cutEnd = cutBegin + (m_difficultyWindow - 2 * m_difficultyCut);
   }
-  assert(/*cut_begin >= 0 &&*/ cutBegin + 2 <= cutEnd && cutEnd <= length);
-  uint64_t timeSpan = timestamps[cutEnd - 1] - timestamps[cutBegin];
+}
+
+difficulty_type Currency::nextDifficulty2(uint64_t timeSpan, difficulty_type totalWork) const {
   if (timeSpan == 0) {
     timeSpan = 1;
   }
 
-  difficulty_type totalWork = cumulativeDifficulties[cutEnd - 1] - cumulativeDifficulties[cutBegin];
-  assert(totalWork > 0);
-
   uint64_t low, high;
   low = mul128(totalWork, m_difficultyTarget, &high);
   if (high != 0 || low + timeSpan - 1 < low) {
@@ -715,9 +726,11 @@ CurrencyBuilder::CurrencyBuilder(Logging::ILogger& log) : m_currency(log) {
 
   blocksFileName(parameters::CRYPTONOTE_BLOCKS_FILENAME);
   blocksCacheFileName(parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME);
+  blocksSummaryFileName(parameters::CRYPTONOTE_BLOCKSSUMMARY_FILENAME);
   blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
   txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
   blockchainIndexesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDEXES_FILENAME);
+  outputKeysFileName(parameters::CRYPTONOTE_OUTPUTKEYS_FILENAME);
 
   testnet(false);
 }
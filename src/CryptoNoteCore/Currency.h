@@ -71,9 +71,11 @@ public:
 
   const std::string& blocksFileName() const { return m_blocksFileName; }
   const std::string& blocksCacheFileName() const { return m_blocksCacheFileName; }
+  const std::string& blocksSummaryFileName() const { return m_blocksSummaryFileName; }
   const std::string& blockIndexesFileName() const { return m_blockIndexesFileName; }
   const std::string& txPoolFileName() const { return m_txPoolFileName; }
   const std::string& blockchainIndexesFileName() const { return m_blockchainIndexesFileName; }
+  const std::string& outputKeysFileName() const { return m_outputKeysFileName; }
 
   bool isTestnet() const { return m_testnet; }
 
@@ -106,6 +108,10 @@ public:
 
   difficulty_type nextDifficulty1(std::vector<uint64_t> timestamps, std::vector<difficulty_type> cumulativeDifficulties) const;
   difficulty_type nextDifficulty2(std::vector<uint64_t> timestamps, std::vector<difficulty_type> cumulativeDifficulties) const;
+  // positions of the sorted window that nextDifficulty2 keeps after cutting the outliers
+  void getDifficultyCut2(size_t length, size_t& cutBegin, size_t& cutEnd) const;
+  // difficulty of nextDifficulty2 from the time span and the work of the cut window
+  difficulty_type nextDifficulty2(uint64_t timeSpan, difficulty_type totalWork) const;
   bool checkProofOfWork1(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
   bool checkProofOfWork2(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
 
@@ -165,9 +171,11 @@ private:
 
   std::string m_blocksFileName;
   std::string m_blocksCacheFileName;
+  std::string m_blocksSummaryFileName;
   std::string m_blockIndexesFileName;
   std::string m_txPoolFileName;
   std::string m_blockchainIndexesFileName;
+  std::string m_outputKeysFileName;
 
   static const std::vector<uint64_t> PRETTY_AMOUNTS;
 
@@ -238,9 +246,11 @@ public:
 
   CurrencyBuilder& blocksFileName(const std::string& val) { m_currency.m_blocksFileName = val; return *this; }
   CurrencyBuilder& blocksCacheFileName(const std::string& val) { m_currency.m_blocksCacheFileName = val; return *this; }
+  CurrencyBuilder& blocksSummaryFileName(const std::string& val) { m_currency.m_blocksSummaryFileName = val; return *this; }
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchainIndexesFileName(const std::string& val) { m_currency.m_blockchainIndexesFileName = val; return *this; }
+  CurrencyBuilder& outputKeysFileName(const std::string& val) { m_currency.m_outputKeysFileName = val; return *this; }
   
   CurrencyBuilder& testnet(bool val) { m_currency.m_testnet = val; return *this; }
 
@@ -0,0 +1,161 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "DifficultyCalculator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+#include "CryptoNoteCore/Currency.h"
+
+namespace CryptoNote {
+
+DifficultyCalculator::DifficultyCalculator(const Currency& currency, const BlockSummaryIndex& blockSummaryIndex) :
+  m_currency(currency),
+  m_blockSummaryIndex(blockSummaryIndex),
+  m_windowBegin(0),
+  m_windowEnd(0) {
+}
+
+void DifficultyCalculator::update() {
+  // same window as Blockchain::getDifficultyForNextBlock, the genesis block is skipped
+  uint32_t height = m_blockSummaryIndex.size();
+  uint32_t blocksCount = static_cast<uint32_t>(m_currency.difficultyBlocksCount());
+  uint32_t windowBegin = height - std::min(height, blocksCount);
+  if (windowBegin == 0) {
+    ++windowBegin;
+  }
+
+  uint32_t windowEnd = std::min(windowBegin + static_cast<uint32_t>(m_currency.difficultyWindow()), height);
+  windowBegin = std::min(windowBegin, windowEnd);
+
+  // start over instead of walking the whole gap when the new window does not overlap the current one
+  if (m_window.empty() || windowBegin >= m_windowEnd || windowEnd <= m_windowBegin) {
+    clear();
+    m_windowBegin = windowBegin;
+    m_windowEnd = windowBegin;
+  }
+
+  // insert first so that erased timestamps always come from the window itself,
+  // the block summary index no longer has the heights that were just popped
+  while (m_windowEnd < windowEnd) {
+    uint64_t timestamp = m_blockSummaryIndex.getTimestamp(m_windowEnd++);
+    m_window.push_back(timestamp);
+    insert(timestamp);
+  }
+
+  while (m_windowBegin > windowBegin) {
+    uint64_t timestamp = m_blockSummaryIndex.getTimestamp(--m_windowBegin);
+    m_window.push_front(timestamp);
+    insert(timestamp);
+  }
+
+  while (m_windowBegin < windowBegin) {
+    uint64_t timestamp = m_window.front();
+    m_window.pop_front();
+    ++m_windowBegin;
+    erase(timestamp);
+  }
+
+  while (m_windowEnd > windowEnd) {
+    uint64_t timestamp = m_window.back();
+    m_window.pop_back();
+    --m_windowEnd;
+    erase(timestamp);
+  }
+
+  rebalance();
+}
+
+void DifficultyCalculator::clear() {
+  m_windowBegin = 0;
+  m_windowEnd = 0;
+  m_window.clear();
+  m_low.clear();
+  m_middle.clear();
+  m_high.clear();
+}
+
+difficulty_type DifficultyCalculator::getNextDifficulty() const {
+  size_t length = m_window.size();
+  if (length < 10) {
+    return 1;
+  }
+
+  size_t cutBegin, cutEnd;
+  m_currency.getDifficultyCut2(length, cutBegin, cutEnd);
+  assert(m_low.size() == cutBegin && m_middle.size() == cutEnd - cutBegin);
+
+  uint64_t timeSpan = *m_middle.rbegin() - *m_middle.begin();
+
+  difficulty_type totalWork = m_blockSummaryIndex.getCumulativeDifficulty(m_windowBegin + static_cast<uint32_t>(cutEnd) - 1) -
+    m_blockSummaryIndex.getCumulativeDifficulty(m_windowBegin + static_cast<uint32_t>(cutBegin));
+  assert(totalWork > 0);
+
+  return m_currency.nextDifficulty2(timeSpan, totalWork);
+}
+
+void DifficultyCalculator::insert(uint64_t timestamp) {
+  if (!m_low.empty() && timestamp < *m_low.rbegin()) {
+    m_low.insert(timestamp);
+  } else if (!m_high.empty() && timestamp > *m_high.begin()) {
+    m_high.insert(timestamp);
+  } else {
+    m_middle.insert(timestamp);
+  }
+}
+
+void DifficultyCalculator::erase(uint64_t timestamp) {
+  // equal timestamps are interchangeable, so any copy can be removed
+  auto it = m_low.find(timestamp);
+  if (it != m_low.end()) {
+    m_low.erase(it);
+    return;
+  }
+
+  it = m_middle.find(timestamp);
+  if (it != m_middle.end()) {
+    m_middle.erase(it);
+    return;
+  }
+
+  it = m_high.find(timestamp);
+  assert(it != m_high.end());
+  m_high.erase(it);
+}
+
+void DifficultyCalculator::rebalance() {
+  size_t cutBegin, cutEnd;
+  m_currency.getDifficultyCut2(m_window.size(), cutBegin, cutEnd);
+
+  while (m_low.size() > cutBegin) {
+    auto it = std::prev(m_low.end());
+    m_middle.insert(m_middle.begin(), *it);
+    m_low.erase(it);
+  }
+
+  while (m_low.size() < cutBegin) {
+    if (m_middle.empty()) {
+      m_middle.insert(*m_high.begin());
+      m_high.erase(m_high.begin());
+    }
+
+    m_low.insert(m_low.end(), *m_middle.begin());
+    m_middle.erase(m_middle.begin());
+  }
+
+  while (m_low.size() + m_middle.size() > cutEnd) {
+    auto it = std::prev(m_middle.end());
+    m_high.insert(m_high.begin(), *it);
+    m_middle.erase(it);
+  }
+
+  while (m_low.size() + m_middle.size() < cutEnd) {
+    m_middle.insert(m_middle.end(), *m_high.begin());
+    m_high.erase(m_high.begin());
+  }
+}
+
+}
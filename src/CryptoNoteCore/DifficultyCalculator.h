@@ -0,0 +1,54 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <set>
+
+#include "CryptoNoteCore/BlockSummaryIndex.h"
+#include "CryptoNoteCore/Difficulty.h"
+
+namespace CryptoNote
+{
+  class Currency;
+
+  // Incremental version of Currency::nextDifficulty2 for the main chain.
+  // The timestamps of the difficulty window are kept in three ordered partitions, the ones cut off at the bottom,
+  // the ones kept and the ones cut off at the top, so moving the window by one block costs O(log n) and the cut
+  // time span is read from the ends of the middle partition instead of sorting the window for every block.
+  class DifficultyCalculator {
+
+  public:
+
+    DifficultyCalculator(const Currency& currency, const BlockSummaryIndex& blockSummaryIndex);
+
+    // moves the window to match the block summary index, must be called after every push and pop
+    void update();
+    void clear();
+
+    // same result as Currency::nextDifficulty2 called with the window used by Blockchain::getDifficultyForNextBlock
+    difficulty_type getNextDifficulty() const;
+
+  private:
+
+    void insert(uint64_t timestamp);
+    void erase(uint64_t timestamp);
+    void rebalance();
+
+    const Currency& m_currency;
+    const BlockSummaryIndex& m_blockSummaryIndex;
+
+    // timestamps of heights [m_windowBegin, m_windowEnd) in chain order
+    uint32_t m_windowBegin;
+    uint32_t m_windowEnd;
+    std::deque<uint64_t> m_window;
+
+    std::multiset<uint64_t> m_low;
+    std::multiset<uint64_t> m_middle;
+    std::multiset<uint64_t> m_high;
+
+  };
+}
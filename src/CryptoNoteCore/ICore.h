@@ -23,6 +23,7 @@ struct CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request;
 struct CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response;
 struct NOTIFY_REQUEST_GET_OBJECTS_request;
 struct NOTIFY_RESPONSE_GET_OBJECTS_request;
+struct block_complete_entry;
 
 class Currency;
 class IBlock;
@@ -32,6 +33,7 @@ struct BlockFullInfo;
 struct BlockShortInfo;
 struct KeyInput;
 struct MultisignatureInput;
+struct PreparedBlock;
 struct Transaction;
 struct TransactionPrefixInfo;
 struct block_verification_context;
@@ -45,6 +47,7 @@ public:
   virtual size_t addChain(const std::vector<const IBlock*>& chain) = 0;
   virtual bool addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) = 0;
   virtual bool addObserver(ICoreObserver* observer) = 0;
+  virtual bool addPreparedBlock(const PreparedBlock& block, block_verification_context& bvc) = 0;
   virtual std::vector<Crypto::Hash> buildSparseChain() = 0;
   virtual std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId) = 0;
   virtual std::error_code executeLocked(const std::function<std::error_code()>& func) = 0;
@@ -89,6 +92,7 @@ public:
   virtual bool on_idle() = 0;
   virtual void on_synchronized() = 0;
   virtual void pause_mining() = 0;
+  virtual bool prepareBlock(const block_complete_entry& entry, PreparedBlock& block) = 0; // thread safe
   virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp, uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) = 0;
   virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp, uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockShortInfo>& entries) = 0;
   virtual bool removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) = 0;
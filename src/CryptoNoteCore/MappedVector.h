@@ -0,0 +1,674 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "Common/MemoryInputStream.h"
+#include "Common/Metrics.h"
+#include "Common/StdOutputStream.h"
+#include "Common/StringView.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+
+// Drop-in replacement for SwappedVector that uses the same items/indexes file pair,
+// but reads items through a read-only memory mapping of the items file.
+// The items file is kept longer than its items and mapped whole, so only a push that outgrows it remaps;
+// close() cuts the spare space off again.
+// Offsets are kept in a flat array and decoded items are kept in a fixed pool of slots
+// with an intrusive LRU list, so a lookup never touches the file stream.
+// getRaw() exposes the serialized bytes of an item without decoding it; the returned view
+// is valid until the next call to push_back, pop_back, clear or close.
+// Reads (operator[], front, back, getRaw) may run concurrently with each other, modifications may not.
+// An item that is evicted from the pool is only retired, so references returned to other readers stay
+// valid until the owner calls reclaim() at a point where no reader can hold such a reference.
+// Readers that use such references inside a ReadGuard need no reclaim() from the owner: when the last guard is
+// released and more items are retired than the pool has slots, the retired items are freed.
+template<class T> class MappedVector {
+public:
+  typedef T value_type;
+
+  class ReadGuard {
+  public:
+    explicit ReadGuard(MappedVector& mappedVector) : m_mappedVector(mappedVector) {
+      m_mappedVector.enterReader();
+    }
+
+    ~ReadGuard() {
+      m_mappedVector.leaveReader();
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+  private:
+    MappedVector& m_mappedVector;
+  };
+
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef const T* pointer;
+    typedef const T& reference;
+    typedef T value_type;
+
+    const_iterator() {
+    }
+
+    const_iterator(MappedVector* mappedVector, size_t index) : m_mappedVector(mappedVector), m_index(index) {
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const const_iterator& other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator<=(const const_iterator& other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator>(const const_iterator& other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator>=(const const_iterator& other) const {
+      return m_index >= other.m_index;
+    }
+
+    const_iterator& operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator i = *this;
+      ++m_index;
+      return i;
+    }
+
+    const_iterator& operator--() {
+      --m_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator i = *this;
+      --m_index;
+      return i;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index + n);
+    }
+
+    friend const_iterator operator+(difference_type n, const const_iterator& i) {
+      return const_iterator(i.m_mappedVector, n + i.m_index);
+    }
+
+    difference_type operator-(const const_iterator& other) const {
+      return m_index - other.m_index;
+    }
+
+    const_iterator operator-(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index - n);
+    }
+
+    const T& operator*() const {
+      return (*m_mappedVector)[m_index];
+    }
+
+    const T* operator->() const {
+      return &(*m_mappedVector)[m_index];
+    }
+
+    const T& operator[](difference_type offset) const {
+      return (*m_mappedVector)[m_index + offset];
+    }
+
+    size_t index() const {
+      return m_index;
+    }
+
+  private:
+    MappedVector* m_mappedVector;
+    size_t m_index;
+  };
+
+  MappedVector();
+  MappedVector(const MappedVector&) = delete;
+  ~MappedVector();
+  MappedVector& operator=(const MappedVector&) = delete;
+
+  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  void close();
+
+  bool empty() const;
+  uint64_t size() const;
+  const_iterator begin();
+  const_iterator end();
+  const T& operator[](uint64_t index);
+  const T& front();
+  const T& back();
+  Common::StringView getRaw(uint64_t index);
+  void reclaim();
+  void clear();
+  void pop_back();
+  void push_back(const T& item);
+
+private:
+  static const uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+  static const uint64_t MIN_SPARE_SIZE = 1024 * 1024;
+
+  struct Slot {
+    std::unique_ptr<T> item;
+    uint64_t index;
+    uint32_t previous;
+    uint32_t next;
+  };
+
+  std::string m_itemsFileName;
+  std::fstream m_itemsFile;
+  std::fstream m_indexesFile;
+  boost::interprocess::file_mapping m_mapping;
+  boost::interprocess::mapped_region m_region;
+  uint64_t m_mappedSize; // the length of the items file while it is mapped
+  std::vector<uint64_t> m_offsets;
+  uint64_t m_itemsFileSize;
+
+  std::mutex m_slotsMutex;
+  std::vector<Slot> m_slots;
+  std::unordered_map<uint64_t, uint32_t> m_slotByIndex;
+  uint32_t m_usedSlots;
+  uint32_t m_head;
+  uint32_t m_tail;
+  size_t m_readers; // the ReadGuards alive
+  // the same for all the mapped vectors of the process
+  Common::MetricCounter& m_cacheHitsMetric;
+  Common::MetricCounter& m_cacheMissesMetric;
+  std::vector<std::unique_ptr<T>> m_retiredItems;
+  std::vector<std::unique_ptr<T>> m_freeItems;
+
+  const char* mappedItem(uint64_t index, size_t& itemSize);
+  void remap(uint64_t capacity);
+  void retireItem(uint32_t slot);
+  void reclaimItems();
+  void enterReader();
+  void leaveReader();
+  void unmap();
+  T* prepare(uint64_t index);
+  void unlinkSlot(uint32_t slot);
+  void linkSlotAtTail(uint32_t slot);
+  void dropSlot(uint64_t index);
+  void resetSlots();
+};
+
+template<class T> MappedVector<T>::MappedVector() : m_mappedSize(0), m_itemsFileSize(0), m_usedSlots(0), m_head(NO_SLOT), m_tail(NO_SLOT), m_readers(0),
+  m_cacheHitsMetric(Common::MetricsRegistry::instance().counter("cash2_mapped_vector_cache_hits_total", "Items of mapped vectors found decoded in the cache")),
+  m_cacheMissesMetric(Common::MetricsRegistry::instance().counter("cash2_mapped_vector_cache_misses_total", "Items of mapped vectors decoded from the mapping")) {
+}
+
+template<class T> MappedVector<T>::~MappedVector() {
+  close();
+}
+
+template<class T> bool MappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
+  if (poolSize == 0 || poolSize >= NO_SLOT) {
+    return false;
+  }
+
+  unmap();
+  m_itemsFileName = itemFileName;
+  m_itemsFile.open(itemFileName, std::ios::in | std::ios::out | std::ios::binary);
+  m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+  if (m_itemsFile && m_indexesFile) {
+    uint64_t count;
+    m_indexesFile.read(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      return false;
+    }
+
+    std::vector<uint32_t> itemSizes(static_cast<size_t>(count));
+    if (count != 0) {
+      m_indexesFile.read(reinterpret_cast<char*>(itemSizes.data()), sizeof(uint32_t) * itemSizes.size());
+      if (!m_indexesFile) {
+        return false;
+      }
+    }
+
+    std::vector<uint64_t> offsets;
+    offsets.reserve(itemSizes.size());
+    uint64_t itemsFileSize = 0;
+    for (uint32_t itemSize : itemSizes) {
+      offsets.push_back(itemsFileSize);
+      itemsFileSize += itemSize;
+    }
+
+    m_itemsFile.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(m_itemsFile.tellg());
+    if (!m_itemsFile || fileSize < itemsFileSize) {
+      return false;
+    }
+
+    m_offsets.swap(offsets);
+    m_itemsFileSize = itemsFileSize;
+    if (fileSize != 0) {
+      remap(fileSize);
+    }
+  } else {
+    m_itemsFile.open(itemFileName, std::ios::out | std::ios::binary);
+    m_itemsFile.close();
+    m_itemsFile.open(itemFileName, std::ios::in | std::ios::out | std::ios::binary);
+    m_indexesFile.open(indexFileName, std::ios::out | std::ios::binary);
+    uint64_t count = 0;
+    m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      return false;
+    }
+
+    m_indexesFile.close();
+    m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+    m_offsets.clear();
+    m_itemsFileSize = 0;
+  }
+
+  m_slots.clear();
+  m_slots.resize(poolSize);
+  m_slotByIndex.clear();
+  m_slotByIndex.reserve(poolSize);
+  resetSlots();
+  m_freeItems.reserve(poolSize);
+  return true;
+}
+
+template<class T> void MappedVector<T>::close() {
+  bool hasSpareSpace = m_mappedSize > m_itemsFileSize;
+  unmap();
+  if (hasSpareSpace) {
+    boost::system::error_code ignore;
+    boost::filesystem::resize_file(m_itemsFileName, m_itemsFileSize, ignore);
+  }
+}
+
+template<class T> bool MappedVector<T>::empty() const {
+  return m_offsets.empty();
+}
+
+template<class T> uint64_t MappedVector<T>::size() const {
+  return m_offsets.size();
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::begin() {
+  return const_iterator(this, 0);
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::end() {
+  return const_iterator(this, m_offsets.size());
+}
+
+template<class T> const T& MappedVector<T>::operator[](uint64_t index) {
+  {
+    std::lock_guard<std::mutex> lock(m_slotsMutex);
+    auto slotIter = m_slotByIndex.find(index);
+    if (slotIter != m_slotByIndex.end()) {
+      uint32_t slot = slotIter->second;
+      if (slot != m_tail) {
+        unlinkSlot(slot);
+        linkSlotAtTail(slot);
+      }
+
+      m_cacheHitsMetric.add();
+      return *m_slots[slot].item;
+    }
+  }
+
+  // decode without holding the pool, two readers missing the same item both decode it and the first one wins
+  size_t itemSize;
+  const char* itemData = mappedItem(index, itemSize);
+
+  T tempItem;
+  Common::MemoryInputStream stream(itemData, itemSize);
+  CryptoNote::BinaryInputStreamSerializer archive(stream);
+  serialize(tempItem, archive);
+
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  auto slotIter = m_slotByIndex.find(index);
+  if (slotIter != m_slotByIndex.end()) {
+    m_cacheHitsMetric.add();
+    return *m_slots[slotIter->second].item;
+  }
+
+  T* item = prepare(index);
+  std::swap(tempItem, *item);
+  m_cacheMissesMetric.add();
+  return *item;
+}
+
+template<class T> const T& MappedVector<T>::front() {
+  return operator[](0);
+}
+
+template<class T> const T& MappedVector<T>::back() {
+  return operator[](m_offsets.size() - 1);
+}
+
+template<class T> Common::StringView MappedVector<T>::getRaw(uint64_t index) {
+  size_t itemSize;
+  const char* itemData = mappedItem(index, itemSize);
+  return Common::StringView(itemData, itemSize);
+}
+
+// Precondition: no reference returned by operator[], front or back before this call is in use.
+template<class T> void MappedVector<T>::reclaim() {
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  reclaimItems();
+}
+
+template<class T> void MappedVector<T>::clear() {
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::clear");
+  }
+
+  m_indexesFile.seekp(0);
+  uint64_t count = 0;
+  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::clear");
+  }
+
+  unmap();
+  m_offsets.clear();
+  m_itemsFileSize = 0;
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  m_slotByIndex.clear();
+  resetSlots();
+}
+
+template<class T> void MappedVector<T>::pop_back() {
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::pop_back");
+  }
+
+  m_indexesFile.seekp(0);
+  uint64_t count = m_offsets.size() - 1;
+  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::pop_back");
+  }
+
+  m_itemsFileSize = m_offsets.back();
+  m_offsets.pop_back();
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  dropSlot(m_offsets.size());
+}
+
+template<class T> void MappedVector<T>::push_back(const T& item) {
+  uint64_t itemsFileSize;
+
+  {
+    if (!m_itemsFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+
+    m_itemsFile.seekp(m_itemsFileSize);
+
+    Common::StdOutputStream stream(m_itemsFile);
+    CryptoNote::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+
+    itemsFileSize = m_itemsFile.tellp();
+    // the mapping reads through the page cache, so the stream buffer must reach the file
+    m_itemsFile.flush();
+    if (!m_itemsFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+  }
+
+  {
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+
+    m_indexesFile.seekp(sizeof(uint64_t) + sizeof(uint32_t) * m_offsets.size());
+    uint32_t itemSize = static_cast<uint32_t>(itemsFileSize - m_itemsFileSize);
+    m_indexesFile.write(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+
+    m_indexesFile.seekp(0);
+    uint64_t count = m_offsets.size() + 1;
+    m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+  }
+
+  m_offsets.push_back(m_itemsFileSize);
+  m_itemsFileSize = itemsFileSize;
+
+  // readers never remap, the mapping has to cover every item before the next read
+  if (m_itemsFileSize > m_mappedSize) {
+    // the file grows by an eighth rather than doubling, it holds the whole blockchain
+    uint64_t spareSize = MIN_SPARE_SIZE;
+    remap(m_itemsFileSize + std::max(m_itemsFileSize / 8, spareSize));
+  }
+
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  T* newItem = prepare(m_offsets.size() - 1);
+  *newItem = item;
+}
+
+template<class T> const char* MappedVector<T>::mappedItem(uint64_t index, size_t& itemSize) {
+  if (index >= m_offsets.size()) {
+    throw std::runtime_error("MappedVector::operator[]");
+  }
+
+  uint64_t itemBegin = m_offsets[index];
+  uint64_t itemEnd = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize;
+  if (itemEnd > m_mappedSize) {
+    throw std::runtime_error("MappedVector::operator[]");
+  }
+
+  itemSize = static_cast<size_t>(itemEnd - itemBegin);
+  return static_cast<const char*>(m_region.get_address()) + itemBegin;
+}
+
+// the items file is extended to capacity bytes if it is shorter
+template<class T> void MappedVector<T>::remap(uint64_t capacity) {
+  unmap();
+  if (capacity < m_itemsFileSize || capacity == 0) {
+    throw std::runtime_error("MappedVector::remap");
+  }
+
+  try {
+    if (boost::filesystem::file_size(m_itemsFileName) < capacity) {
+      boost::filesystem::resize_file(m_itemsFileName, capacity);
+    }
+
+    boost::interprocess::file_mapping mapping(m_itemsFileName.c_str(), boost::interprocess::read_only);
+    boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only, 0, static_cast<size_t>(capacity));
+    m_mapping.swap(mapping);
+    m_region.swap(region);
+  } catch (std::exception& e) {
+    throw std::runtime_error(std::string("MappedVector::remap, ") + e.what());
+  }
+
+  m_mappedSize = capacity;
+}
+
+template<class T> void MappedVector<T>::unmap() {
+  boost::interprocess::mapped_region region;
+  boost::interprocess::file_mapping mapping;
+  m_region.swap(region);
+  m_mapping.swap(mapping);
+  m_mappedSize = 0;
+}
+
+// Precondition: m_slotsMutex is locked.
+template<class T> T* MappedVector<T>::prepare(uint64_t index) {
+  uint32_t slot;
+  if (m_usedSlots < m_slots.size()) {
+    slot = m_usedSlots++;
+  } else {
+    slot = m_head;
+    unlinkSlot(slot);
+    auto slotIter = m_slotByIndex.find(m_slots[slot].index);
+    if (slotIter != m_slotByIndex.end() && slotIter->second == slot) {
+      m_slotByIndex.erase(slotIter);
+    }
+
+    retireItem(slot);
+  }
+
+  Slot& entry = m_slots[slot];
+  if (!entry.item) {
+    if (!m_freeItems.empty()) {
+      entry.item = std::move(m_freeItems.back());
+      m_freeItems.pop_back();
+    } else {
+      entry.item.reset(new T());
+    }
+  }
+
+  entry.index = index;
+  m_slotByIndex[index] = slot;
+  linkSlotAtTail(slot);
+  return entry.item.get();
+}
+
+template<class T> void MappedVector<T>::retireItem(uint32_t slot) {
+  if (m_slots[slot].item) {
+    m_retiredItems.push_back(std::move(m_slots[slot].item));
+  }
+}
+
+// Precondition: m_slotsMutex is locked.
+template<class T> void MappedVector<T>::reclaimItems() {
+  for (std::unique_ptr<T>& item : m_retiredItems) {
+    if (m_freeItems.size() >= m_slots.size()) {
+      break;
+    }
+
+    m_freeItems.push_back(std::move(item));
+  }
+
+  m_retiredItems.clear();
+}
+
+template<class T> void MappedVector<T>::enterReader() {
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  ++m_readers;
+}
+
+template<class T> void MappedVector<T>::leaveReader() {
+  std::lock_guard<std::mutex> lock(m_slotsMutex);
+  --m_readers;
+  if (m_readers == 0 && m_retiredItems.size() > m_slots.size()) {
+    reclaimItems();
+  }
+}
+
+template<class T> void MappedVector<T>::unlinkSlot(uint32_t slot) {
+  Slot& entry = m_slots[slot];
+  if (entry.previous != NO_SLOT) {
+    m_slots[entry.previous].next = entry.next;
+  } else {
+    m_head = entry.next;
+  }
+
+  if (entry.next != NO_SLOT) {
+    m_slots[entry.next].previous = entry.previous;
+  } else {
+    m_tail = entry.previous;
+  }
+
+  entry.previous = NO_SLOT;
+  entry.next = NO_SLOT;
+}
+
+template<class T> void MappedVector<T>::linkSlotAtTail(uint32_t slot) {
+  Slot& entry = m_slots[slot];
+  entry.previous = m_tail;
+  entry.next = NO_SLOT;
+  if (m_tail != NO_SLOT) {
+    m_slots[m_tail].next = slot;
+  } else {
+    m_head = slot;
+  }
+
+  m_tail = slot;
+}
+
+// Moves the slot of a removed item to the head of the LRU list so it is reused first.
+template<class T> void MappedVector<T>::dropSlot(uint64_t index) {
+  auto slotIter = m_slotByIndex.find(index);
+  if (slotIter == m_slotByIndex.end()) {
+    return;
+  }
+
+  uint32_t slot = slotIter->second;
+  m_slotByIndex.erase(slotIter);
+  unlinkSlot(slot);
+
+  retireItem(slot);
+
+  Slot& entry = m_slots[slot];
+  entry.next = m_head;
+  if (m_head != NO_SLOT) {
+    m_slots[m_head].previous = slot;
+  } else {
+    m_tail = slot;
+  }
+
+  m_head = slot;
+}
+
+template<class T> void MappedVector<T>::resetSlots() {
+  for (Slot& slot : m_slots) {
+    slot.item.reset();
+    slot.previous = NO_SLOT;
+    slot.next = NO_SLOT;
+  }
+
+  m_retiredItems.clear();
+  m_freeItems.clear();
+
+  m_usedSlots = 0;
+  m_head = NO_SLOT;
+  m_tail = NO_SLOT;
+}
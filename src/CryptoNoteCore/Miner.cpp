@@ -401,7 +401,7 @@ namespace CryptoNote
     uint64_t nonce = m_starter_nonce + th_local_index;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
-    Crypto::cn_context context;
+    Crypto::nonce_hash_state hashState;
     Block b;
 
     while(!m_stop)
@@ -420,6 +420,13 @@ namespace CryptoNote
 
         local_template_ver = m_template_no;
         nonce = m_starter_nonce + th_local_index;
+
+        // the hashing blob of the template is built once, only the nonce changes below
+        if (local_template_ver && !get_block_longhash_state(b, hashState)) {
+          logger(ERROR) << "Failed to get block long hash";
+          m_stop = true;
+          break;
+        }
       }
 
       if(!local_template_ver)//no any set_block_template call
@@ -429,43 +436,46 @@ namespace CryptoNote
         continue;
       }
 
-      b.nonce = nonce;
-      Crypto::Hash h;
-      if (!m_stop && !get_block_longhash(context, b, h)) {
-        logger(ERROR) << "Failed to get block long hash";
-        m_stop = true;
-      }
+      uint32_t threadsTotal = m_threads_total;
+      Crypto::Hash hashes[Crypto::NONCE_HASH_BATCH];
+      Crypto::nonce_hash(hashState, nonce, threadsTotal, Crypto::NONCE_HASH_BATCH, hashes);
 
       uint32_t blockHeight = boost::get<BaseInput>(b.baseTransaction.inputs[0]).blockIndex;
 
-      bool checkHashSuccess = false;
-
-      if (blockHeight < parameters::HARD_FORK_HEIGHT_2)
+      for (size_t i = 0; i < Crypto::NONCE_HASH_BATCH && !m_stop; ++i)
       {
-        checkHashSuccess = check_hash1(h, local_diff);
-      }
-      else
-      {
-        checkHashSuccess = check_hash2(h, local_diff);
-      }
+        bool checkHashSuccess = false;
 
-      if (!m_stop && checkHashSuccess)
-      {
-        //we lucky!
-        ++m_config.current_extra_message_index;
+        if (blockHeight < parameters::HARD_FORK_HEIGHT_2)
+        {
+          checkHashSuccess = check_hash1(hashes[i], local_diff);
+        }
+        else
+        {
+          checkHashSuccess = check_hash2(hashes[i], local_diff);
+        }
 
-        logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
+        if (checkHashSuccess)
+        {
+          //we lucky!
+          b.nonce = nonce + i * threadsTotal;
+          ++m_config.current_extra_message_index;
+
+          logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
+
+          if(!m_handler.handle_block_found(b)) {
+            --m_config.current_extra_message_index;
+          } else {
+            //success update, lets update config
+            Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
+          }
 
-        if(!m_handler.handle_block_found(b)) {
-          --m_config.current_extra_message_index;
-        } else {
-          //success update, lets update config
-          Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
+          break;
         }
       }
 
-      nonce += m_threads_total;
-      ++m_hashes;
+      nonce += Crypto::NONCE_HASH_BATCH * threadsTotal;
+      m_hashes += Crypto::NONCE_HASH_BATCH;
     }
     logger(INFO) << "Miner thread stopped ["<< th_local_index << "]";
     return true;
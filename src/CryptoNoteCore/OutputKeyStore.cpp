@@ -0,0 +1,167 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "OutputKeyStore.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+namespace CryptoNote {
+
+static_assert(sizeof(OutputKeyEntry) == 52, "OutputKeyEntry is stored as it is");
+
+OutputKeyStore::OutputKeyStore() : m_capacity(0), m_size(0) {
+}
+
+OutputKeyStore::~OutputKeyStore() {
+  try {
+    close();
+  } catch (std::exception&) {
+  }
+}
+
+bool OutputKeyStore::open(const std::string& fileName) {
+  close();
+  m_fileName = fileName;
+
+  uint64_t size = 0;
+  {
+    std::fstream file(fileName, std::ios::in | std::ios::binary);
+    if (!file) {
+      file.open(fileName, std::ios::out | std::ios::binary);
+      if (!file) {
+        return false;
+      }
+    } else {
+      file.seekg(0, std::ios::end);
+      uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+      file.seekg(0);
+      file.read(reinterpret_cast<char*>(&size), sizeof size);
+      if (!file || fileSize < HEADER_SIZE || (fileSize - HEADER_SIZE) / sizeof(OutputKeyEntry) < size) {
+        size = 0;
+      }
+    }
+  }
+
+  try {
+    map(size > INITIAL_CAPACITY ? size : INITIAL_CAPACITY);
+  } catch (std::runtime_error&) {
+    return false;
+  }
+
+  m_size = size;
+  storeSize();
+
+  const OutputKeyEntry* entries = getEntries();
+  for (uint64_t position = 0; position < m_size; ++position) {
+    m_positionsByAmount[entries[position].amount].push_back(static_cast<uint32_t>(position));
+  }
+
+  return true;
+}
+
+void OutputKeyStore::close() {
+  if (m_region.get_address() == nullptr) {
+    return;
+  }
+
+  m_region.flush();
+  unmap();
+  boost::filesystem::resize_file(m_fileName, HEADER_SIZE + m_size * sizeof(OutputKeyEntry));
+  m_capacity = 0;
+  m_size = 0;
+  m_positionsByAmount.clear();
+}
+
+void OutputKeyStore::clear() {
+  m_size = 0;
+  m_positionsByAmount.clear();
+  storeSize();
+}
+
+const OutputKeyEntry& OutputKeyStore::get(uint64_t amount, uint32_t index) const {
+  auto it = m_positionsByAmount.find(amount);
+  if (it == m_positionsByAmount.end() || index >= it->second.size()) {
+    throw std::out_of_range("OutputKeyStore::get");
+  }
+
+  return getEntries()[it->second[index]];
+}
+
+uint32_t OutputKeyStore::getOutputCount(uint64_t amount) const {
+  auto it = m_positionsByAmount.find(amount);
+  return it == m_positionsByAmount.end() ? 0 : static_cast<uint32_t>(it->second.size());
+}
+
+void OutputKeyStore::pop() {
+  if (m_size == 0) {
+    throw std::runtime_error("OutputKeyStore::pop");
+  }
+
+  --m_size;
+  auto it = m_positionsByAmount.find(getEntries()[m_size].amount);
+  it->second.pop_back();
+  if (it->second.empty()) {
+    m_positionsByAmount.erase(it);
+  }
+
+  storeSize();
+}
+
+void OutputKeyStore::push(const OutputKeyEntry& entry) {
+  if (m_region.get_address() == nullptr || m_size == std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("OutputKeyStore::push");
+  }
+
+  // the file grows by doubling, so pushing an entry remaps the file rarely
+  if (m_size == m_capacity) {
+    map(m_capacity * 2);
+  }
+
+  std::memcpy(getEntries() + m_size, &entry, sizeof entry);
+  m_positionsByAmount[entry.amount].push_back(static_cast<uint32_t>(m_size));
+  ++m_size;
+  storeSize();
+}
+
+OutputKeyEntry* OutputKeyStore::getEntries() const {
+  return reinterpret_cast<OutputKeyEntry*>(static_cast<char*>(m_region.get_address()) + HEADER_SIZE);
+}
+
+void OutputKeyStore::map(uint64_t capacity) {
+  unmap();
+
+  try {
+    boost::filesystem::resize_file(m_fileName, HEADER_SIZE + capacity * sizeof(OutputKeyEntry));
+    boost::interprocess::file_mapping mapping(m_fileName.c_str(), boost::interprocess::read_write);
+    boost::interprocess::mapped_region region(mapping, boost::interprocess::read_write, 0, static_cast<size_t>(HEADER_SIZE + capacity * sizeof(OutputKeyEntry)));
+    m_mapping.swap(mapping);
+    m_region.swap(region);
+  } catch (std::exception& e) {
+    throw std::runtime_error(std::string("OutputKeyStore::map, ") + e.what());
+  }
+
+  m_capacity = capacity;
+}
+
+void OutputKeyStore::storeSize() {
+  if (m_region.get_address() == nullptr) {
+    return;
+  }
+
+  std::memcpy(m_region.get_address(), &m_size, sizeof m_size);
+}
+
+void OutputKeyStore::unmap() {
+  boost::interprocess::mapped_region region;
+  boost::interprocess::file_mapping mapping;
+  m_region.swap(region);
+  m_mapping.swap(mapping);
+}
+
+}
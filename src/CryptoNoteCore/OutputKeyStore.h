@@ -0,0 +1,76 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "CryptoTypes.h"
+
+namespace CryptoNote
+{
+#pragma pack(push, 1)
+  struct OutputKeyEntry {
+    uint64_t amount;
+    Crypto::PublicKey key;
+    uint64_t unlockTime; // of the transaction of the output
+    uint32_t blockIndex;
+  };
+#pragma pack(pop)
+
+  // The key outputs of the main chain in the order they were pushed, so the outputs of the last transaction are always
+  // the last entries. The entries are fixed size records of a memory mapped file, the entries of an amount are found by
+  // a per-amount column of record positions that is rebuilt when the file is opened.
+  // Entries returned by get() are valid until the next call to push, pop, clear or close.
+  // Reads may run concurrently with each other, modifications may not.
+  class OutputKeyStore {
+
+  public:
+
+    OutputKeyStore();
+    OutputKeyStore(const OutputKeyStore&) = delete;
+    ~OutputKeyStore();
+    OutputKeyStore& operator=(const OutputKeyStore&) = delete;
+
+    // a missing or damaged file gives an empty store, false is returned if the file cannot be mapped
+    bool open(const std::string& fileName);
+    // truncates the file to its entries
+    void close();
+
+    void clear();
+    // index is the global output index of the output among the outputs of the amount
+    const OutputKeyEntry& get(uint64_t amount, uint32_t index) const;
+    uint32_t getOutputCount(uint64_t amount) const;
+    void pop();
+    void push(const OutputKeyEntry& entry);
+
+    uint64_t size() const {
+      return m_size;
+    }
+
+  private:
+
+    static const uint64_t HEADER_SIZE = sizeof(uint64_t); // the count of entries
+    static const uint64_t INITIAL_CAPACITY = 1 << 16;
+
+    OutputKeyEntry* getEntries() const;
+    void map(uint64_t capacity);
+    void storeSize();
+    void unmap();
+
+    std::string m_fileName;
+    boost::interprocess::file_mapping m_mapping;
+    boost::interprocess::mapped_region m_region;
+    uint64_t m_capacity;
+    uint64_t m_size;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_positionsByAmount;
+
+  };
+}
@@ -0,0 +1,22 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <vector>
+
+#include "CryptoNote.h"
+
+namespace CryptoNote {
+
+// A block received from a peer that was decoded and checked as far as possible without the blockchain, see ICore::prepareBlock()
+// The transactions are in the order of block.transactionHashes
+struct PreparedBlock {
+  Block block;
+  Crypto::Hash hash;
+  std::vector<Transaction> transactions;
+  std::vector<size_t> transactionSizes;
+};
+
+}
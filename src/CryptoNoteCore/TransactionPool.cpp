@@ -98,10 +98,18 @@ namespace CryptoNote {
     m_timeProvider(timeProvider), 
     m_txCheckInterval(60, timeProvider),
     m_fee_index(boost::get<1>(m_transactions)),
-    logger(log, "txpool") {
+    m_checkedTip(NULL_HASH),
+    m_version(0),
+    logger(log, "txpool"),
+    m_addTimeMetric(Common::MetricsRegistry::instance().histogram("cash2_mempool_add_duration_microseconds", "Time spent checking and adding the transactions offered to the memory pool")),
+    m_addedMetric(Common::MetricsRegistry::instance().counter("cash2_mempool_added_transactions_total", "Transactions added to the memory pool")),
+    m_removedMetric(Common::MetricsRegistry::instance().counter("cash2_mempool_removed_transactions_total", "Transactions removed from the memory pool")),
+    m_sizeMetric(Common::MetricsRegistry::instance().gauge("cash2_mempool_transactions", "Transactions in the memory pool")) {
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(const Transaction &tx, /*const Crypto::Hash& tx_prefix_hash,*/ const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t blockchainHeight) {
+    Common::MetricTimer timer(m_addTimeMetric);
+
     if (!check_inputs_types_supported(tx)) {
       tvc.m_verification_failed = true;
       return false;
@@ -200,6 +208,10 @@ namespace CryptoNote {
       }
       m_paymentIdIndex.add(txd.tx);
       m_timestampIndex.add(txd.receiveTime, txd.id);
+      m_uncheckedTransactions.insert(txd.id);
+      ++m_version;
+      m_addedMetric.add();
+      m_sizeMetric.set(static_cast<int64_t>(m_transactions.size()));
 
     }
 
@@ -254,6 +266,11 @@ namespace CryptoNote {
     return m_transactions.size();
   }
   //---------------------------------------------------------------------------------
+  uint64_t tx_memory_pool::getVersion() const {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    return m_version;
+  }
+  //---------------------------------------------------------------------------------
   void tx_memory_pool::get_transactions(std::list<Transaction>& txs) const {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     for (const auto& tx_vt : m_transactions) {
@@ -303,11 +320,59 @@ namespace CryptoNote {
     deleted_tx_ids.assign(known_set.begin(), known_set.end());
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
+  bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id, const Crypto::Hash& previous_block_id, const std::vector<Transaction>& transactions) {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+
+    if (previous_block_id != m_checkedTip) {
+      resetTransactionChecks(top_block_id);
+      return true;
+    }
+
+    m_checkedTip = top_block_id;
+
+    // the block may have the outputs or the height they were waiting for
+    m_uncheckedTransactions.insert(m_unreadyTransactions.begin(), m_unreadyTransactions.end());
+    m_unreadyTransactions.clear();
+
+    bool spendsMultisignatureOutputs = false;
+    for (const Transaction& transaction : transactions) {
+      for (const TransactionInput& input : transaction.inputs) {
+        if (input.type() == typeid(KeyInput)) {
+          auto it = m_spent_key_images.find(boost::get<KeyInput>(input).keyImage);
+          if (it != m_spent_key_images.end()) {
+            for (const Crypto::Hash& id : it->second) {
+              recheckTransaction(id);
+            }
+          }
+        } else if (input.type() == typeid(MultisignatureInput)) {
+          spendsMultisignatureOutputs = true;
+        }
+      }
+    }
+
+    // the pool does not index the multisignature outputs spent by transactions kept by block, they are rare
+    if (spendsMultisignatureOutputs) {
+      std::vector<Crypto::Hash> multisignatureTransactions;
+      for (const TransactionDetails* txd : m_readyTransactions) {
+        for (const TransactionInput& input : txd->tx.inputs) {
+          if (input.type() == typeid(MultisignatureInput)) {
+            multisignatureTransactions.push_back(txd->id);
+            break;
+          }
+        }
+      }
+
+      for (const Crypto::Hash& id : multisignatureTransactions) {
+        recheckTransaction(id);
+      }
+    }
+
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    resetTransactionChecks(top_block_id);
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -354,6 +419,52 @@ namespace CryptoNote {
     return true;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::checkTransactions() {
+    for (const Crypto::Hash& id : m_uncheckedTransactions) {
+      auto it = m_transactions.find(id);
+      if (it == m_transactions.end()) {
+        continue;
+      }
+
+      TransactionCheckInfo checkInfo(*it);
+      bool ready = is_transaction_ready_to_go(it->tx, checkInfo);
+
+      // update item state
+      m_transactions.modify(it, [&checkInfo](TransactionCheckInfo& item) {
+        item = checkInfo;
+      });
+
+      if (ready) {
+        m_readyTransactions.insert(&*it);
+      } else {
+        m_unreadyTransactions.insert(id);
+      }
+    }
+
+    m_uncheckedTransactions.clear();
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::recheckTransaction(const Crypto::Hash& id) {
+    auto it = m_transactions.find(id);
+    if (it == m_transactions.end()) {
+      return;
+    }
+
+    m_readyTransactions.erase(&*it);
+    m_unreadyTransactions.erase(id);
+    m_uncheckedTransactions.insert(id);
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::resetTransactionChecks(const Crypto::Hash& tip) {
+    m_checkedTip = tip;
+    m_readyTransactions.clear();
+    m_unreadyTransactions.clear();
+    m_uncheckedTransactions.clear();
+    for (const auto& txd : m_transactions) {
+      m_uncheckedTransactions.insert(txd.id);
+    }
+  }
+  //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const {
     std::stringstream ss;
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
@@ -432,40 +543,38 @@ namespace CryptoNote {
                                            uint64_t already_generated_coins, size_t& total_size, uint64_t& fee) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
 
+    if (bl.previousBlockHash != m_checkedTip) {
+      resetTransactionChecks(bl.previousBlockHash);
+    }
+
+    checkTransactions();
+
     total_size = 0;
     fee = 0;
 
     BlockTemplate blockTemplate;
 
-    for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend() && it->fee == 0; ++it) {
-      const auto& txd = *it;
+    for (auto it = m_readyTransactions.rbegin(); it != m_readyTransactions.rend() && (*it)->fee == 0; ++it) {
+      const auto& txd = **it;
 
       if (m_currency.fusionTxMaxSize() < total_size + txd.blobSize) {
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-      if (is_transaction_ready_to_go(txd.tx, checkInfo) && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      // the allowed extra size depends on the height only, it is not kept with the check
+      if (m_validator.checkTransactionExtraSize(txd.tx.extra.size()) && blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
       }
     }
 
-    for (auto i = m_fee_index.begin(); i != m_fee_index.end(); ++i) {
-      const auto& txd = *i;
+    for (const TransactionDetails* ready : m_readyTransactions) {
+      const auto& txd = *ready;
 
       if (maxBlockCumulativeSize < total_size + txd.blobSize) {
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-      bool ready = is_transaction_ready_to_go(txd.tx, checkInfo);
-
-      // update item state
-      m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
-        item = checkInfo;
-      });
-
-      if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (m_validator.checkTransactionExtraSize(txd.tx.extra.size()) && blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
         fee += txd.fee;
       }
@@ -491,6 +600,7 @@ namespace CryptoNote {
       m_transactions.clear();
       m_spent_key_images.clear();
       m_spentOutputs.clear();
+      resetTransactionChecks(NULL_HASH);
 
       m_paymentIdIndex.clear();
       m_timestampIndex.clear();
@@ -499,6 +609,8 @@ namespace CryptoNote {
     }
 
     removeExpiredTransactions();
+    ++m_version;
+    m_sizeMetric.set(static_cast<int64_t>(m_transactions.size()));
 
     // Ignore deserialization error
     return true;
@@ -553,6 +665,7 @@ namespace CryptoNote {
     if (s.type() == ISerializer::INPUT) {
       m_transactions.clear();
       readSequence<TransactionDetails>(std::inserter(m_transactions, m_transactions.end()), "transactions", s);
+      resetTransactionChecks(NULL_HASH);
     } else {
       writeSequence<TransactionDetails>(m_transactions.begin(), m_transactions.end(), "transactions", s);
     }
@@ -608,9 +721,16 @@ namespace CryptoNote {
 
   tx_memory_pool::tx_container_t::iterator tx_memory_pool::removeTransaction(tx_memory_pool::tx_container_t::iterator i) {
     removeTransactionInputs(i->id, i->tx, i->keptByBlock);
+    m_readyTransactions.erase(&*i);
+    m_unreadyTransactions.erase(i->id);
+    m_uncheckedTransactions.erase(i->id);
     m_paymentIdIndex.remove(i->tx);
     m_timestampIndex.remove(i->receiveTime, i->id);
-    return m_transactions.erase(i);
+    auto next = m_transactions.erase(i);
+    ++m_version;
+    m_removedMetric.add();
+    m_sizeMetric.set(static_cast<int64_t>(m_transactions.size()));
+    return next;
   }
 
   bool tx_memory_pool::removeTransactionInputs(const Crypto::Hash& tx_id, const Transaction& tx, bool keptByBlock) {
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstring>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -20,6 +21,7 @@
 
 #include "Common/Util.h"
 #include "Common/int-util.h"
+#include "Common/Metrics.h"
 #include "Common/ObserverManager.h"
 #include "crypto/hash.h"
 
@@ -92,7 +94,10 @@ namespace CryptoNote {
     //gets tx and remove it from pool
     bool take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee);
 
-    bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id);
+    // transactions is the block pushed on top of previous_block_id, only the pool transactions spending the inputs it
+    // spends and the transactions that were not ready are checked again
+    bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id, const Crypto::Hash& previous_block_id, const std::vector<Transaction>& transactions);
+    // all transactions are checked again
     bool on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id);
 
     void lock() const;
@@ -100,11 +105,15 @@ namespace CryptoNote {
     std::unique_lock<std::recursive_mutex> obtainGuard() const;
 
     bool fill_block_template1(Block &bl, size_t median_size, size_t maxCumulativeSize, uint64_t already_generated_coins, size_t &total_size, uint64_t &fee);
+    // takes the transactions from the ready set built for bl.previousBlockHash, only the transactions not checked yet for
+    // it are checked
     bool fill_block_template2(Block &bl, size_t maxCumulativeSize, uint64_t already_generated_coins, size_t &total_size, uint64_t &fee);
 
     void get_transactions(std::list<Transaction>& txs) const;
     void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
     size_t get_transactions_count() const;
+    // changes whenever a transaction is added to or removed from the pool
+    uint64_t getVersion() const;
     std::string print_pool(bool short_format) const;
     void on_idle();
 
@@ -167,6 +176,18 @@ namespace CryptoNote {
       }
     };
 
+    struct ReadyTransactionComparator {
+      bool operator()(const TransactionDetails* lhs, const TransactionDetails* rhs) const {
+        TransactionPriorityComparator priority;
+        if (priority(*lhs, *rhs)) {
+          return true;
+        }
+
+        // the same priority, the ready set keeps both
+        return !priority(*rhs, *lhs) && memcmp(&lhs->id, &rhs->id, sizeof(Crypto::Hash)) < 0;
+      }
+    };
+
     typedef hashed_unique<BOOST_MULTI_INDEX_MEMBER(TransactionDetails, Crypto::Hash, id)> main_index_t;
     typedef ordered_non_unique<identity<TransactionDetails>, TransactionPriorityComparator> fee_index_t;
 
@@ -188,6 +209,10 @@ namespace CryptoNote {
     bool removeExpiredTransactions();
     bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
 
+    void checkTransactions();
+    void recheckTransaction(const Crypto::Hash& id);
+    void resetTransactionChecks(const Crypto::Hash& tip);
+
     void buildIndexes();
 
     Tools::ObserverManager<ITxPoolObserver> m_observerManager;
@@ -205,10 +230,23 @@ namespace CryptoNote {
     tx_container_t::nth_index<1>::type& m_fee_index;
     std::unordered_map<Crypto::Hash, uint64_t> m_recentlyDeletedTransactions;
 
+    // Each transaction of the pool is in one of the three sets, the ready and unready transactions were checked by
+    // is_transaction_ready_to_go with m_checkedTip on top of the blockchain
+    Crypto::Hash m_checkedTip;
+    std::set<const TransactionDetails*, ReadyTransactionComparator> m_readyTransactions; // in the order of m_fee_index
+    std::unordered_set<Crypto::Hash> m_unreadyTransactions;
+    std::unordered_set<Crypto::Hash> m_uncheckedTransactions;
+    uint64_t m_version;
+
     Logging::LoggerRef logger;
 
     PaymentIdIndex m_paymentIdIndex;
     TimestampTransactionsIndex m_timestampIndex;
+
+    Common::MetricHistogram& m_addTimeMetric;
+    Common::MetricCounter& m_addedMetric;
+    Common::MetricCounter& m_removedMetric;
+    Common::MetricGauge& m_sizeMetric;
   };
 }
 
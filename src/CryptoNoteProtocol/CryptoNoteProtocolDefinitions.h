@@ -6,6 +6,7 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include "CryptoNoteCore/CryptoNoteBasic.h"
 
 // ISerializer-based serialization
@@ -36,21 +37,31 @@ namespace CryptoNote
   struct BlockFullInfo : public block_complete_entry
   {
     Crypto::Hash block_id;
+    // when set, the blobs are sent from this entry of the block entry cache instead of block and txs
+    std::shared_ptr<const block_complete_entry> cachedEntry;
 
     void serialize(ISerializer& s) {
       KV_MEMBER(block_id);
-      KV_MEMBER(block);
-      KV_MEMBER(txs);
+      if (cachedEntry && s.type() == ISerializer::OUTPUT) {
+        // an output serializer only reads the values
+        s(const_cast<std::string&>(cachedEntry->block), "block");
+        s(const_cast<std::vector<std::string>&>(cachedEntry->txs), "txs");
+      } else {
+        KV_MEMBER(block);
+        KV_MEMBER(txs);
+      }
     }
   };
 
   struct TransactionPrefixInfo {
     Crypto::Hash txHash;
     TransactionPrefix txPrefix;
+    std::vector<uint32_t> globalIndexes; // global output indexes, empty for pool transactions and from older nodes
 
     void serialize(ISerializer& s) {
       KV_MEMBER(txHash);
       KV_MEMBER(txPrefix);
+      KV_MEMBER(globalIndexes);
     }
   };
 
@@ -58,11 +69,13 @@ namespace CryptoNote
     Crypto::Hash blockId;
     std::string block;
     std::vector<TransactionPrefixInfo> txPrefixes;
+    std::vector<uint32_t> baseTransactionGlobalIndexes;
 
     void serialize(ISerializer& s) {
       KV_MEMBER(blockId);
       KV_MEMBER(block);
       KV_MEMBER(txPrefixes);
+      KV_MEMBER(baseTransactionGlobalIndexes);
     }
   };
 
@@ -4,10 +4,14 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+#include <chrono>
 #include <future>
+#include <thread>
 #include <boost/scope_exit.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include "System/Dispatcher.h"
+#include "System/RemoteContext.h"
 #include "CryptoNoteProtocolHandler.h"
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -18,6 +22,20 @@
 
 namespace CryptoNote {
 
+namespace {
+
+const std::pair<int, const char*> COMMAND_NAMES[] = {
+  { NOTIFY_NEW_BLOCK::ID, "new_block" },
+  { NOTIFY_NEW_TRANSACTIONS::ID, "new_transactions" },
+  { NOTIFY_REQUEST_CHAIN::ID, "request_chain" },
+  { NOTIFY_REQUEST_GET_OBJECTS::ID, "request_get_objects" },
+  { NOTIFY_REQUEST_TX_POOL::ID, "request_tx_pool" },
+  { NOTIFY_RESPONSE_CHAIN_ENTRY::ID, "response_chain_entry" },
+  { NOTIFY_RESPONSE_GET_OBJECTS::ID, "response_get_objects" }
+};
+
+}
+
 
 // Public functions
 
@@ -31,12 +49,27 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, S
   m_stop(false),
   m_observedHeight(0),
   m_peerCount(0),
+  m_committingBlocks(false),
+  m_preparePool(std::max<size_t>(std::thread::hardware_concurrency(), 1)),
+  m_requestedBlockCount(0),
+  m_receivedBlockCount(0),
+  m_receivedBlockBytes(0),
+  m_preparedBlockCount(0),
+  m_prepareTime(0),
+  m_committedBlockCount(0),
+  m_commitTime(0),
+  m_waitingBlockCount(0),
   m_logger(log, "protocol")
 {
   if (!m_p2p)
   {
     m_p2p = &m_p2p_stub;
   }
+
+  for (const auto& command : COMMAND_NAMES)
+  {
+    m_commandMetrics[command.first] = &Common::MetricsRegistry::instance().histogram("cash2_p2p_command_duration_microseconds", "Time spent handling the P2P commands received, by command", Common::MetricsRegistry::label("command", command.second));
+  }
 }
 
 bool CryptoNoteProtocolHandler::addObserver(ICryptoNoteProtocolObserver* observer)
@@ -44,6 +77,20 @@ bool CryptoNoteProtocolHandler::addObserver(ICryptoNoteProtocolObserver* observe
   return m_observerManager.add(observer);
 }
 
+CryptoNoteProtocolHandler::BlockDownloadStatistics CryptoNoteProtocolHandler::getBlockDownloadStatistics() const
+{
+  BlockDownloadStatistics statistics;
+  statistics.requestedBlocks = m_requestedBlockCount;
+  statistics.receivedBlocks = m_receivedBlockCount;
+  statistics.receivedBytes = m_receivedBlockBytes;
+  statistics.preparedBlocks = m_preparedBlockCount;
+  statistics.prepareTime = m_prepareTime;
+  statistics.committedBlocks = m_committedBlockCount;
+  statistics.commitTime = m_commitTime;
+  statistics.waitingBlocks = m_waitingBlockCount;
+  return statistics;
+}
+
 uint32_t CryptoNoteProtocolHandler::getObservedHeight() const
 {
   std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -117,6 +164,7 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
 {
   int ret = 0;
   handled = true;
+  auto start = std::chrono::steady_clock::now();
 
   switch (command) {
     HANDLE_NOTIFY(NOTIFY_NEW_BLOCK, &CryptoNoteProtocolHandler::handle_notify_new_block)
@@ -131,6 +179,10 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
     handled = false;
   }
 
+  if (handled) {
+    m_commandMetrics.at(command)->recordDuration(std::chrono::steady_clock::now() - start);
+  }
+
   return ret;
 }
 
@@ -157,6 +209,11 @@ void CryptoNoteProtocolHandler::onConnectionClosed(const CryptoNoteConnectionCon
     m_peerCount--;
     m_observerManager.notify(&ICryptoNoteProtocolObserver::peerCountUpdated, m_peerCount.load());
   }
+
+  // blocks that were requested from this connection can be requested from other connections now
+  releaseRequestedBlocks(context);
+  m_waitingConnections.erase(context.m_connection_id);
+  requestBlocksForWaitingConnections();
 }
 
 void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext& context)
@@ -165,6 +222,15 @@ void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext&
 
 bool CryptoNoteProtocolHandler::on_idle()
 {
+  if (!m_committingBlocks && m_requestedBlocks.empty() && !m_downloadedBlocks.empty()) {
+    // no connection downloads the blocks that these blocks are waiting for
+    m_logger(Logging::DEBUGGING) << "Discarding " << m_downloadedBlocks.size() << " downloaded blocks that do not connect to the blockchain";
+    m_downloadedBlocks.clear();
+    m_downloadedBlockHashes.clear();
+    m_waitingBlockCount = 0;
+    requestBlocksForWaitingConnections();
+  }
+
   return m_core.on_idle();
 }
 
@@ -532,24 +598,35 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, const NO
 
   context.m_remote_blockchain_height = response.current_blockchain_height;
 
-  size_t count = 0;
+  m_receivedBlockCount += response.blocks.size();
   for (const block_complete_entry& blockCompleteEntry : response.blocks) {
-    ++count;
-    Block block;
-    if (!fromBinaryArray(block, Common::asBinaryArray(blockCompleteEntry.block))) {
-      m_logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << Common::toHex(Common::asBinaryArray(blockCompleteEntry.block)) << "\r\n dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
+    m_receivedBlockBytes += blockCompleteEntry.block.size();
+    for (const std::string& transactionBlob : blockCompleteEntry.txs) {
+      m_receivedBlockBytes += transactionBlob.size();
     }
+  }
+
+  // the blocks are decoded and checked on other threads while the dispatcher serves the other connections
+  std::vector<PreparedBlock> blocks;
+  if (!prepareBlocks(response.blocks, blocks)) {
+    m_logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: failed to parse and validate blocks, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
 
-    Crypto::Hash blockHash = get_block_hash(block);
+  if (context.m_state == CryptoNoteConnectionContext::state_shutdown) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const Crypto::Hash& blockHash = blocks[i].hash;
 
     //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    if (count == 2) {
+    if (i == 1) {
       if (m_core.have_block(blockHash)) {
         context.m_state = CryptoNoteConnectionContext::state_idle;
         context.m_needed_objects.clear();
+        releaseRequestedBlocks(context);
         context.m_requested_objects.clear();
         m_logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
         return 1;
@@ -564,11 +641,9 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, const NO
       return 1;
     }
 
-    if (block.transactionHashes.size() != blockCompleteEntry.txs.size()) {
-      m_logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << ", transactionHashes.size()=" << block.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << blockCompleteEntry.txs.size() << ", dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
+    auto requestedBlock = m_requestedBlocks.find(blockHash);
+    if (requestedBlock != m_requestedBlocks.end() && requestedBlock->second == context.m_connection_id) {
+      m_requestedBlocks.erase(requestedBlock);
     }
 
     context.m_requested_objects.erase(it);
@@ -582,15 +657,21 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, const NO
     return 1;
   }
 
-  {
-    m_core.pause_mining();
+  for (PreparedBlock& block : blocks) {
+    if (m_downloadedBlockHashes.count(block.hash) != 0 || m_core.have_block(block.hash)) {
+      continue;
+    }
 
-    BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+    m_downloadedBlockHashes.insert(block.hash);
+    Crypto::Hash previousBlockHash = block.block.previousBlockHash;
+    m_downloadedBlocks.emplace(previousBlockHash, DownloadedBlock{ std::move(block), context.m_connection_id });
+  }
 
-    int result = processObjects(context, response.blocks);
-    if (result != 0) {
-      return result;
-    }
+  m_waitingBlockCount = m_downloadedBlocks.size();
+
+  commitDownloadedBlocks(context);
+  if (context.m_state == CryptoNoteConnectionContext::state_shutdown) {
+    return 1;
   }
 
   uint32_t blockchainHeight = m_core.get_current_blockchain_height();
@@ -604,6 +685,91 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, const NO
   return 1;
 }
 
+void CryptoNoteProtocolHandler::commitDownloadedBlocks(CryptoNoteConnectionContext& context)
+{
+
+  // Adds the downloaded blocks to the blockchain in height order
+  // Only one context commits at a time, blocks downloaded by other connections in the meantime are added by the same loop
+
+  if (m_committingBlocks) {
+    return;
+  }
+
+  m_committingBlocks = true;
+  m_core.pause_mining();
+
+  BOOST_SCOPE_EXIT_ALL(this) {
+    m_core.update_block_template_and_resume_mining();
+    m_committingBlocks = false;
+  };
+
+  while (!m_stop) {
+    uint32_t heightIgnore;
+    Crypto::Hash tailId;
+    m_core.get_blockchain_top(heightIgnore, tailId);
+
+    auto it = m_downloadedBlocks.find(tailId);
+    if (it == m_downloadedBlocks.end()) {
+      // blocks of an alternative chain
+      it = std::find_if(m_downloadedBlocks.begin(), m_downloadedBlocks.end(), [this](const std::pair<const Crypto::Hash, DownloadedBlock>& downloadedBlock) {
+        return m_core.have_block(downloadedBlock.first);
+      });
+
+      if (it == m_downloadedBlocks.end()) {
+        break;
+      }
+    }
+
+    DownloadedBlock downloadedBlock = std::move(it->second);
+    m_downloadedBlocks.erase(it);
+    m_downloadedBlockHashes.erase(downloadedBlock.block.hash);
+    m_waitingBlockCount = m_downloadedBlocks.size();
+
+    auto commitStart = std::chrono::steady_clock::now();
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    m_core.addPreparedBlock(downloadedBlock.block, bvc);
+    m_commitTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - commitStart).count();
+
+    if (bvc.m_verification_failed || bvc.m_marked_as_orphaned) {
+      const boost::uuids::uuid& connectionId = downloadedBlock.connectionId;
+      m_logger(Logging::DEBUGGING) << "Block " << Common::podToHex(downloadedBlock.block.hash) << " from connection " << connectionId <<
+        (bvc.m_verification_failed ? " failed verification" : " was marked as orphaned") << ", dropping connection";
+
+      // the other blocks from the same connection are not trusted either
+      for (auto i = m_downloadedBlocks.begin(); i != m_downloadedBlocks.end();) {
+        if (i->second.connectionId == connectionId) {
+          m_downloadedBlockHashes.erase(i->second.block.hash);
+          i = m_downloadedBlocks.erase(i);
+        } else {
+          ++i;
+        }
+      }
+
+      m_waitingBlockCount = m_downloadedBlocks.size();
+
+      if (connectionId == context.m_connection_id) {
+        context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      } else {
+        m_p2p->for_each_connection([&connectionId](CryptoNoteConnectionContext& otherContext, PeerIdType peerIdIgnore) {
+          if (otherContext.m_connection_id == connectionId) {
+            otherContext.m_state = CryptoNoteConnectionContext::state_shutdown;
+          }
+        });
+      }
+
+      continue;
+    }
+
+    if (!bvc.m_already_exists) {
+      ++m_committedBlockCount;
+    }
+
+    m_dispatcher.yield();
+  }
+
+  requestBlocksForWaitingConnections();
+}
+
 bool CryptoNoteProtocolHandler::on_connection_synchronized()
 {
   bool val_expected = false;
@@ -624,53 +790,33 @@ bool CryptoNoteProtocolHandler::on_connection_synchronized()
   return true;
 }
 
-int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks)
+bool CryptoNoteProtocolHandler::prepareBlocks(const std::vector<block_complete_entry>& entries, std::vector<PreparedBlock>& blocks)
 {
+  blocks.resize(entries.size());
+  if (entries.empty()) {
+    return true;
+  }
 
-  // Sends blocks and transactions to Core for processing
-
-  for (const block_complete_entry& blockCompleteEntry : blocks) {
-    if (m_stop) {
-      break;
-    }
+  std::atomic<bool> failed(false);
+  auto prepareStart = std::chrono::steady_clock::now();
 
-    //process transactions
-    for (const std::string& tx_blob : blockCompleteEntry.txs) {
-      tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
-      m_core.handle_incoming_tx(Common::asBinaryArray(tx_blob), tvc, true);
-      if (tvc.m_verification_failed) {
-        m_logger(Logging::ERROR) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(getBinaryArrayHash(Common::asBinaryArray(tx_blob))) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        return 1;
+  System::RemoteContext<void> prepareContext(m_dispatcher, [this, &entries, &blocks, &failed] {
+    m_preparePool.parallelFor(entries.size(), [this, &entries, &blocks, &failed](size_t i) {
+      if (!failed && !m_core.prepareBlock(entries[i], blocks[i])) {
+        failed = true;
       }
-    }
-
-    // process block
-    block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block_blob(Common::asBinaryArray(blockCompleteEntry.block), bvc, false, false);
+    });
+  });
 
-    if (bvc.m_verification_failed) {
-      m_logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    } else if (bvc.m_marked_as_orphaned) {
-      m_logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    } else if (bvc.m_already_exists) {
-      m_logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = CryptoNoteConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
-    }
+  prepareContext.get();
+  m_prepareTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - prepareStart).count();
 
-    m_dispatcher.yield();
+  if (failed) {
+    return false;
   }
 
-  return 0;
-
+  m_preparedBlockCount += blocks.size();
+  return true;
 }
 
 void CryptoNoteProtocolHandler::recalculateMaxObservedHeight(const boost::uuids::uuid& connectionId)
@@ -687,6 +833,16 @@ void CryptoNoteProtocolHandler::recalculateMaxObservedHeight(const boost::uuids:
   m_observedHeight = std::max(peerHeight, localHeight + 1);
 }
 
+void CryptoNoteProtocolHandler::releaseRequestedBlocks(const CryptoNoteConnectionContext& context)
+{
+  for (const Crypto::Hash& blockHash : context.m_requested_objects) {
+    auto it = m_requestedBlocks.find(blockHash);
+    if (it != m_requestedBlocks.end() && it->second == context.m_connection_id) {
+      m_requestedBlocks.erase(it);
+    }
+  }
+}
+
 void CryptoNoteProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request& notification)
 {
   auto buffer = LevinProtocol::encode(notification);
@@ -699,28 +855,73 @@ void CryptoNoteProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::requ
   m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buffer);
 }
 
+void CryptoNoteProtocolHandler::requestBlocksForWaitingConnections()
+{
+  if (m_waitingConnections.empty()) {
+    return;
+  }
+
+  m_p2p->for_each_connection([this](CryptoNoteConnectionContext& context, PeerIdType peerIdIgnore) {
+    if (m_waitingConnections.erase(context.m_connection_id) != 0 &&
+      context.m_state == CryptoNoteConnectionContext::state_synchronizing && context.m_requested_objects.empty()) {
+      request_needed_objects(context, true);
+    }
+  });
+}
+
 bool CryptoNoteProtocolHandler::request_needed_objects(CryptoNoteConnectionContext& context, bool checkAlreadyHaveBlock)
 {
+  m_waitingConnections.erase(context.m_connection_id);
+
   if (context.m_needed_objects.size())
   {
     //we know objects that we need, request this objects
+    //blocks requested or downloaded by other connections are skipped, they stay in the list in case those connections fail
     NOTIFY_REQUEST_GET_OBJECTS::request request;
-    size_t count = 0;
+    bool nextBlock = true;
     auto it = context.m_needed_objects.begin();
 
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(checkAlreadyHaveBlock && m_core.have_block(*it))) {
-        request.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
+    while (it != context.m_needed_objects.end() && request.blocks.size() < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
+      bool pending = m_requestedBlocks.count(*it) != 0 || m_downloadedBlockHashes.count(*it) != 0;
+      if ((checkAlreadyHaveBlock || pending) && m_core.have_block(*it)) {
+        it = context.m_needed_objects.erase(it);
+        continue;
+      }
+
+      if (!pending && !nextBlock && m_downloadedBlocks.size() >= BLOCKS_SYNCHRONIZING_MAX_DOWNLOADED_COUNT) {
+        // wait until the blockchain catches up, the block the blockchain waits for is always requested
+        break;
       }
+
+      nextBlock = false;
+
+      if (pending) {
+        ++it;
+        continue;
+      }
+
+      request.blocks.push_back(*it);
+      context.m_requested_objects.insert(*it);
+      m_requestedBlocks[*it] = context.m_connection_id;
       it = context.m_needed_objects.erase(it);
     }
 
-    m_logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << request.blocks.size() << ", txs.size()=" << request.txs.size();
-    post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, request, context);
+    if (!request.blocks.empty()) {
+      m_requestedBlockCount += request.blocks.size();
+      m_logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << request.blocks.size() << ", txs.size()=" << request.txs.size();
+      post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, request, context);
+      return true;
+    }
+
+    if (context.m_needed_objects.size()) {
+      // the remaining blocks are downloaded by other connections
+      m_logger(Logging::TRACE) << context << "waiting for blocks downloaded by other connections";
+      m_waitingConnections.insert(context.m_connection_id);
+      return true;
+    }
   }
-  else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) // peer node still has blocks in its blockchain that we don't have in our blockchain, request more blocks from peer node
+
+  if (context.m_last_response_height < context.m_remote_blockchain_height - 1) // peer node still has blocks in its blockchain that we don't have in our blockchain, request more blocks from peer node
   {
     NOTIFY_REQUEST_CHAIN::request request = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
     request.block_ids = m_core.buildSparseChain();
@@ -741,6 +942,12 @@ bool CryptoNoteProtocolHandler::request_needed_objects(CryptoNoteConnectionConte
       return false;
     }
 
+    if (!m_downloadedBlocks.empty()) {
+      // blocks downloaded by other connections are not in the blockchain yet
+      m_waitingConnections.insert(context.m_connection_id);
+      return true;
+    }
+
     requestMissingPoolTransactions(context);
 
     context.m_state = CryptoNoteConnectionContext::state_normal;
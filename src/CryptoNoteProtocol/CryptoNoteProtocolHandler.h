@@ -6,9 +6,15 @@
 #pragma once
 
 #include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/functional/hash.hpp>
+#include "Common/Metrics.h"
 #include "Common/ObserverManager.h"
+#include "Common/WorkerPool.h"
 #include "../CryptoNoteConfig.h"
 #include "CryptoNoteCore/ICore.h"
+#include "CryptoNoteCore/PreparedBlock.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandlerCommon.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolObserver.h"
@@ -26,7 +32,20 @@ class CryptoNoteProtocolHandler : public i_cryptonote_protocol, public ICryptoNo
 {
 public:
   CryptoNoteProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& core, IP2pEndpoint* p2p, Logging::ILogger& log);
+  // block download counters, can be read from any thread
+  struct BlockDownloadStatistics {
+    uint64_t requestedBlocks;
+    uint64_t receivedBlocks;
+    uint64_t receivedBytes;
+    uint64_t preparedBlocks;
+    uint64_t prepareTime; // microseconds spent decoding and checking received blocks
+    uint64_t committedBlocks;
+    uint64_t commitTime; // microseconds spent adding blocks to the blockchain
+    uint64_t waitingBlocks; // blocks waiting for their previous block
+  };
+
   virtual bool addObserver(ICryptoNoteProtocolObserver* observer) override;
+  BlockDownloadStatistics getBlockDownloadStatistics() const;
   virtual uint32_t getObservedHeight() const override;
   virtual size_t getPeerCount() const override;
   void get_all_connections_addresses(std::vector<std::string>& addresses);
@@ -55,11 +74,14 @@ private:
   int handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& request, CryptoNoteConnectionContext& context);
   int handle_response_chain_entry(int command, const NOTIFY_RESPONSE_CHAIN_ENTRY::request& response, CryptoNoteConnectionContext& context);
   int handle_response_get_objects(int command, const NOTIFY_RESPONSE_GET_OBJECTS::request& response, CryptoNoteConnectionContext& context);
+  void commitDownloadedBlocks(CryptoNoteConnectionContext& context);
   bool on_connection_synchronized();
-  int processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks);
+  bool prepareBlocks(const std::vector<block_complete_entry>& entries, std::vector<PreparedBlock>& blocks);
   void recalculateMaxObservedHeight(const boost::uuids::uuid& connectionId);
+  void releaseRequestedBlocks(const CryptoNoteConnectionContext& context);
   virtual void relay_block(NOTIFY_NEW_BLOCK::request& notification) override;
   virtual void relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& notification) override;
+  void requestBlocksForWaitingConnections();
   bool request_needed_objects(CryptoNoteConnectionContext& context, bool checkAlreadyHaveBlock);
   void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext& context);
 
@@ -91,6 +113,31 @@ private:
 
   std::atomic<size_t> m_peerCount;
   Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
+
+  // Blocks are requested from all synchronizing connections at the same time, decoded and checked on m_preparePool
+  // and added to the blockchain in height order by a single committer
+  struct DownloadedBlock {
+    PreparedBlock block;
+    boost::uuids::uuid connectionId;
+  };
+
+  std::unordered_map<Crypto::Hash, boost::uuids::uuid> m_requestedBlocks; // blocks not received yet and the connections they were requested from
+  std::unordered_multimap<Crypto::Hash, DownloadedBlock> m_downloadedBlocks; // blocks waiting to be added by previous block hash
+  std::unordered_set<Crypto::Hash> m_downloadedBlockHashes;
+  std::unordered_set<boost::uuids::uuid, boost::hash<boost::uuids::uuid>> m_waitingConnections; // connections waiting for blocks downloaded by other connections
+  bool m_committingBlocks;
+  Common::WorkerPool m_preparePool;
+
+  std::atomic<uint64_t> m_requestedBlockCount;
+  std::atomic<uint64_t> m_receivedBlockCount;
+  std::atomic<uint64_t> m_receivedBlockBytes;
+  std::atomic<uint64_t> m_preparedBlockCount;
+  std::atomic<uint64_t> m_prepareTime;
+  std::atomic<uint64_t> m_committedBlockCount;
+  std::atomic<uint64_t> m_commitTime;
+  std::atomic<uint64_t> m_waitingBlockCount;
+
+  std::unordered_map<int, Common::MetricHistogram*> m_commandMetrics; // by command ID, built once
 };
 
 } // end namespace CryptoNote
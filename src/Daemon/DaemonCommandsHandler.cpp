@@ -39,6 +39,7 @@ DaemonCommandsHandler::DaemonCommandsHandler(CryptoNote::Core& core, CryptoNote:
   m_consoleHandler.setHandler("print_pl", boost::bind(&DaemonCommandsHandler::print_pl, this, _1), "Print peer list");
   m_consoleHandler.setHandler("print_pool", boost::bind(&DaemonCommandsHandler::print_pool, this, _1), "Print transaction pool (long format)");
   m_consoleHandler.setHandler("print_pool_sh", boost::bind(&DaemonCommandsHandler::print_pool_sh, this, _1), "Print transaction pool (short format)");
+  m_consoleHandler.setHandler("print_sync_stats", boost::bind(&DaemonCommandsHandler::print_sync_stats, this, _1), "Print the number of blocks downloaded from peers and the time spent checking and adding them");
   m_consoleHandler.setHandler("print_total_transactions_count", boost::bind(&DaemonCommandsHandler::print_total_transactions_count, this, _1), "Print the total number of transactions ever created and sent on the network");
   m_consoleHandler.setHandler("print_transaction_fee", boost::bind(&DaemonCommandsHandler::print_transaction_fee, this, _1), "Print the minimum fee needed to send a transaction");
   m_consoleHandler.setHandler("print_tx", boost::bind(&DaemonCommandsHandler::print_tx, this, _1), "Print transaction\n * print_tx <transaction_hash>");
@@ -484,6 +485,20 @@ bool DaemonCommandsHandler::print_pool_sh(const std::vector<std::string>& args)
   return true;
 }
 
+bool DaemonCommandsHandler::print_sync_stats(const std::vector<std::string>& args)
+{
+  CryptoNote::CryptoNoteProtocolHandler::BlockDownloadStatistics statistics = m_nodeServer.get_payload_object().getBlockDownloadStatistics();
+
+  m_logger(Logging::INFO, Logging::BRIGHT_CYAN) << "Requested blocks : " << statistics.requestedBlocks << ENDL <<
+    "Received blocks : " << statistics.receivedBlocks << " (" << statistics.receivedBytes << " bytes)" << ENDL <<
+    "Prepared blocks : " << statistics.preparedBlocks << " in " << statistics.prepareTime / 1000 << " ms, " <<
+      statistics.preparedBlocks * 1000000.0 / std::max<uint64_t>(statistics.prepareTime, 1) << " blocks/s" << ENDL <<
+    "Added blocks : " << statistics.committedBlocks << " in " << statistics.commitTime / 1000 << " ms, " <<
+      statistics.committedBlocks * 1000000.0 / std::max<uint64_t>(statistics.commitTime, 1) << " blocks/s" << ENDL <<
+    "Blocks waiting to be added : " << statistics.waitingBlocks;
+  return true;
+}
+
 bool DaemonCommandsHandler::print_total_transactions_count(const std::vector<std::string>& args)
 {
   uint32_t numCoinbaseTransactions = m_core.get_current_blockchain_height();
@@ -630,6 +630,7 @@ bool DaemonRpcCommands::get_info(const CORE_RPC_COMMAND_GET_INFO::request& reque
   // uint64_t is unsafe in JavaScript environment so we display it as a formatted string instead
   response.circulating_supply = m_core.currency().formatAmount(m_core.getTotalGeneratedAmount());
   response.transaction_fee = m_core.getMinimalFee();
+  m_core.getBlockEntryCacheStatistics(response.block_cache_hits, response.block_cache_misses);
 
   response.status = CORE_RPC_STATUS_OK;
   return true;
@@ -1029,4 +1030,28 @@ bool DaemonRpcCommands::validate_address(const CORE_RPC_COMMAND_VALIDATE_ADDRESS
 	return true;
 }
 
+// Returns the state of the daemon without waiting, DaemonRpcServer calls it again until it differs from the request
+bool DaemonRpcCommands::wait_for_changes(const CORE_RPC_COMMAND_WAIT_FOR_CHANGES::request& request, CORE_RPC_COMMAND_WAIT_FOR_CHANGES::response& response) {
+  response.status = CORE_RPC_STATUS_FAILED;
+
+  m_core.get_blockchain_top(response.tail_block_index, response.tail_block_id);
+
+  Block tailBlock;
+  if (!m_core.getBlockByHash(response.tail_block_id, tailBlock)) {
+    return true;
+  }
+
+  response.tail_block_timestamp = tailBlock.timestamp;
+  response.added_txs.clear();
+  response.deleted_txs_ids.clear();
+  m_core.getPoolChangesLite(response.tail_block_id, request.known_txs_ids, response.added_txs, response.deleted_txs_ids);
+  // never below the tail, like NodeRpcProxy keeps it, or the request would return at once without peers
+  response.last_known_block_index = std::max(std::max(static_cast<uint32_t>(1), m_cryptoNoteProtocolQuery.getObservedHeight()) - 1, response.tail_block_index);
+  response.peer_count = m_cryptoNoteProtocolQuery.getPeerCount();
+  response.transaction_fee = m_core.getMinimalFee();
+
+  response.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 } // end namespace CryptoNote
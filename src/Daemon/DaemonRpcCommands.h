@@ -64,6 +64,7 @@ public:
   bool stop_mining(const CORE_RPC_COMMAND_STOP_MINING::request& request, CORE_RPC_COMMAND_STOP_MINING::response& response); // disabled in restricted rpc mode
   bool submit_block(const CORE_RPC_COMMAND_SUBMIT_BLOCK::request& request, CORE_RPC_COMMAND_SUBMIT_BLOCK::response& response);
   bool validate_address(const CORE_RPC_COMMAND_VALIDATE_ADDRESS::request& request, CORE_RPC_COMMAND_VALIDATE_ADDRESS::response& response);
+  bool wait_for_changes(const CORE_RPC_COMMAND_WAIT_FOR_CHANGES::request& request, CORE_RPC_COMMAND_WAIT_FOR_CHANGES::response& response);
 
 private :
   Logging::LoggerRef m_logger;
@@ -5,13 +5,68 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "Common/ScopeExit.h"
 #include "Rpc/CoreRpcCommands.h"
 #include "Rpc/CoreRpcStatuses.h"
 #include "DaemonRpcServer.h"
 #include "Rpc/JsonRpc.h"
+#include "System/ContextGroup.h"
+#include "System/DispatcherCall.h"
+#include "System/InterruptedException.h"
+#include "System/Timer.h"
+
+#include <algorithm>
+#include <type_traits>
 
 #undef ERROR
 
+using namespace Logging;
+
+namespace {
+
+const uint32_t MAX_WAIT_FOR_CHANGES_TIMEOUT = 60000; // milliseconds
+
+template<typename Request>
+void loadJsonRpcParams(const CryptoNote::JsonRpc::JsonRpcRequest& jsonRequest, Request& request) {
+  if (!jsonRequest.loadParams(request)) {
+    throw CryptoNote::JsonRpc::JsonRpcError(CryptoNote::JsonRpc::errInvalidParams);
+  }
+}
+
+// a request without parameters can be sent without params
+void loadJsonRpcParams(const CryptoNote::JsonRpc::JsonRpcRequest& jsonRequest, CryptoNote::EMPTY_STRUCT& request) {
+}
+
+struct BinaryFormat {
+  template<typename T> static bool load(T& value, const std::string& body) {
+    return CryptoNote::loadFromBinaryKeyValue(value, body);
+  }
+
+  template<typename T> static std::string store(const T& value) {
+    return CryptoNote::storeToBinaryKeyValue(value);
+  }
+};
+
+struct JsonFormat {
+  template<typename T> static bool load(T& value, const std::string& body) {
+    return CryptoNote::loadFromJson(value, body);
+  }
+
+  template<typename T> static std::string store(const T& value) {
+    return CryptoNote::storeToJson(value);
+  }
+};
+
+bool hasChanges(const CryptoNote::CORE_RPC_COMMAND_WAIT_FOR_CHANGES::request& request, const CryptoNote::CORE_RPC_COMMAND_WAIT_FOR_CHANGES::response& response) {
+  return response.tail_block_id != request.tail_block_id ||
+    !response.added_txs.empty() ||
+    !response.deleted_txs_ids.empty() ||
+    response.last_known_block_index != request.last_known_block_index ||
+    response.peer_count != request.peer_count;
+}
+
+}
+
 // Binary
 // get_blocks.bin                  get_blocks()
 // get_o_indexes.bin               get_indexes()
@@ -20,6 +75,7 @@
 // get_random_outs.bin             get_random_outs()
 // query_blocks.bin                query_blocks()
 // query_blocks_lite.bin           query_blocks_lite()
+// wait_for_changes.bin            processWaitForChangesRequest()
 
 // HTTP
 // get_circulating_supply          get_circulating_supply()
@@ -42,6 +98,7 @@
 // get_white_peerlist              get_white_peerlist()
 // get_white_peerlist_size         get_white_peerlist_size()
 // json_rpc                        processJsonRpcRequest()
+// metrics                         processMetricsRequest()
 // send_raw_transaction            send_raw_tx()
 // start_mining                    start_mining()
 // stop_daemon                     stop_daemon()
@@ -67,15 +124,91 @@
 namespace CryptoNote {
 
 
+const std::unordered_map<std::string, DaemonRpcServer::RpcRoute> DaemonRpcServer::s_routes = {
+  // binary
+  { "/get_blocks.bin", route<CORE_RPC_COMMAND_GET_BLOCKS_FAST, RpcFormat::BINARY>(&DaemonRpcCommands::get_blocks, false, true) },
+  { "/get_o_indexes.bin", route<CORE_RPC_COMMAND_GET_TX_GLOBAL_OUTPUTS_INDEXES, RpcFormat::BINARY>(&DaemonRpcCommands::get_indexes, false, true) },
+  { "/get_pool_changes.bin", route<CORE_RPC_COMMAND_GET_POOL_CHANGES, RpcFormat::BINARY>(&DaemonRpcCommands::get_pool_changes, false, true) },
+  { "/get_pool_changes_lite.bin", route<CORE_RPC_COMMAND_GET_POOL_CHANGES_LITE, RpcFormat::BINARY>(&DaemonRpcCommands::get_pool_changes_lite, false, true) },
+  { "/get_random_outs.bin", route<CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS, RpcFormat::BINARY>(&DaemonRpcCommands::get_random_outs, false, true) },
+  { "/query_blocks.bin", route<CORE_RPC_COMMAND_QUERY_BLOCKS, RpcFormat::BINARY>(&DaemonRpcCommands::query_blocks, false, true) },
+  { "/query_blocks_lite.bin", route<CORE_RPC_COMMAND_QUERY_BLOCKS_LITE, RpcFormat::BINARY>(&DaemonRpcCommands::query_blocks_lite, false, true) },
+  { "/wait_for_changes.bin", { RpcFormat::BINARY, false, true, &DaemonRpcServer::processWaitForChangesRequest, nullptr } },
+
+  // HTTP
+  { "/get_circulating_supply", route<CORE_RPC_COMMAND_GET_CIRCULATING_SUPPLY, RpcFormat::JSON>(&DaemonRpcCommands::get_circulating_supply, false, false) },
+  { "/get_connections", route<CORE_RPC_COMMAND_GET_CONNECTIONS, RpcFormat::JSON>(&DaemonRpcCommands::get_connections, false, false) },
+  { "/get_connections_count", route<CORE_RPC_COMMAND_GET_CONNECTIONS_COUNT, RpcFormat::JSON>(&DaemonRpcCommands::get_connections_count, false, false) },
+  { "/get_difficulty", route<CORE_RPC_COMMAND_GET_DIFFICULTY, RpcFormat::JSON>(&DaemonRpcCommands::get_difficulty, false, false) },
+  { "/get_grey_peerlist", route<CORE_RPC_COMMAND_GET_GREY_PEERLIST, RpcFormat::JSON>(&DaemonRpcCommands::get_grey_peerlist, false, false) },
+  { "/get_grey_peerlist_size", route<CORE_RPC_COMMAND_GET_GREY_PEERLIST_SIZE, RpcFormat::JSON>(&DaemonRpcCommands::get_grey_peerlist_size, false, false) },
+  { "/get_height", route<CORE_RPC_COMMAND_GET_HEIGHT, RpcFormat::JSON>(&DaemonRpcCommands::get_height, false, false) },
+  { "/get_incoming_connections", route<CORE_RPC_COMMAND_GET_INCOMING_CONNECTIONS, RpcFormat::JSON>(&DaemonRpcCommands::get_incoming_connections, false, false) },
+  { "/get_incoming_connections_count", route<CORE_RPC_COMMAND_GET_INCOMING_CONNECTIONS_COUNT, RpcFormat::JSON>(&DaemonRpcCommands::get_incoming_connections_count, false, false) },
+  { "/get_info", route<CORE_RPC_COMMAND_GET_INFO, RpcFormat::JSON>(&DaemonRpcCommands::get_info, false, false) },
+  { "/get_mempool_transactions_count", route<CORE_RPC_COMMAND_GET_MEMPOOL_TRANSACTIONS_COUNT, RpcFormat::JSON>(&DaemonRpcCommands::get_mempool_transactions_count, false, false) },
+  { "/get_orphan_blocks_count", route<CORE_RPC_COMMAND_GET_ORPHAN_BLOCKS_COUNT, RpcFormat::JSON>(&DaemonRpcCommands::get_orphan_blocks_count, false, false) },
+  { "/get_outgoing_connections", route<CORE_RPC_COMMAND_GET_OUTGOING_CONNECTIONS, RpcFormat::JSON>(&DaemonRpcCommands::get_outgoing_connections, false, false) },
+  { "/get_outgoing_connections_count", route<CORE_RPC_COMMAND_GET_OUTGOING_CONNECTIONS_COUNT, RpcFormat::JSON>(&DaemonRpcCommands::get_outgoing_connections_count, false, false) },
+  { "/get_total_transactions_count", route<CORE_RPC_COMMAND_GET_TOTAL_TRANSACTIONS_COUNT, RpcFormat::JSON>(&DaemonRpcCommands::get_total_transactions_count, false, true) },
+  { "/get_transaction_fee", route<CORE_RPC_COMMAND_GET_TRANSACTION_FEE, RpcFormat::JSON>(&DaemonRpcCommands::get_transaction_fee, false, true) },
+  { "/get_transactions", route<CORE_RPC_COMMAND_GET_TRANSACTIONS, RpcFormat::JSON>(&DaemonRpcCommands::get_transactions, false, true) },
+  { "/get_white_peerlist", route<CORE_RPC_COMMAND_GET_WHITE_PEERLIST, RpcFormat::JSON>(&DaemonRpcCommands::get_white_peerlist, false, false) },
+  { "/get_white_peerlist_size", route<CORE_RPC_COMMAND_GET_WHITE_PEERLIST_SIZE, RpcFormat::JSON>(&DaemonRpcCommands::get_white_peerlist_size, false, false) },
+  { "/json_rpc", { RpcFormat::JSON_RPC, false, false, &DaemonRpcServer::processJsonRpcRequest, nullptr } },
+  { "/metrics", { RpcFormat::TEXT, false, false, &DaemonRpcServer::processMetricsRequest, nullptr } },
+  { "/send_raw_transaction", route<CORE_RPC_COMMAND_SEND_RAW_TX, RpcFormat::JSON>(&DaemonRpcCommands::send_raw_transaction, false, true) },
+  { "/start_mining", route<CORE_RPC_COMMAND_START_MINING, RpcFormat::JSON>(&DaemonRpcCommands::start_mining, true, true) },
+  { "/stop_daemon", route<CORE_RPC_COMMAND_STOP_DAEMON, RpcFormat::JSON>(&DaemonRpcCommands::stop_daemon, true, false) },
+  { "/stop_mining", route<CORE_RPC_COMMAND_STOP_MINING, RpcFormat::JSON>(&DaemonRpcCommands::stop_mining, true, true) }
+};
+
+const std::unordered_map<std::string, DaemonRpcServer::RpcRoute> DaemonRpcServer::s_jsonRpcRoutes = {
+  { "check_payment", jsonRpcRoute<CORE_RPC_COMMAND_CHECK_PAYMENT>(&DaemonRpcCommands::check_payment, false, false) },
+  { "get_block", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCK>(&DaemonRpcCommands::get_block, false, false) },
+  { "get_block_count", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCK_COUNT>(&DaemonRpcCommands::get_block_count, false, false) },
+  { "get_block_hash", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCK_HASH>(&DaemonRpcCommands::get_block_hash, false, false) },
+  { "get_block_header_by_hash", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCK_HEADER_BY_HASH>(&DaemonRpcCommands::get_block_header_by_hash, false, false) },
+  { "get_block_header_by_height", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCK_HEADER_BY_HEIGHT>(&DaemonRpcCommands::get_block_header_by_height, false, false) },
+  { "get_block_template", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCK_TEMPLATE>(&DaemonRpcCommands::get_block_template, false, false) },
+  { "get_blocks", jsonRpcRoute<CORE_RPC_COMMAND_GET_BLOCKS_JSON>(&DaemonRpcCommands::get_blocks_json, false, false) },
+  { "get_currency_id", jsonRpcRoute<CORE_RPC_COMMAND_GET_CURRENCY_ID>(&DaemonRpcCommands::get_currency_id, false, false) },
+  { "get_last_block_header", jsonRpcRoute<CORE_RPC_COMMAND_GET_LAST_BLOCK_HEADER>(&DaemonRpcCommands::get_last_block_header, false, false) },
+  { "get_mempool", jsonRpcRoute<CORE_RPC_COMMAND_GET_MEMPOOL>(&DaemonRpcCommands::get_mempool, false, false) },
+  { "get_transaction", jsonRpcRoute<CORE_RPC_COMMAND_GET_TRANSACTION>(&DaemonRpcCommands::get_transaction, false, false) },
+  { "submit_block", jsonRpcRoute<CORE_RPC_COMMAND_SUBMIT_BLOCK>(&DaemonRpcCommands::submit_block, false, false) },
+  { "validate_address", jsonRpcRoute<CORE_RPC_COMMAND_VALIDATE_ADDRESS>(&DaemonRpcCommands::validate_address, false, false) }
+};
+
+
 // Public functions
 
 
-DaemonRpcServer::DaemonRpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, Core& core, NodeServer& nodeServer, const ICryptoNoteProtocolQuery& cryptoNoteProtocolQuery, const DaemonRpcServerConfigurationOptions& daemonRpcServerConfigurationOptions) :
+DaemonRpcServer::DaemonRpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, Core& core, NodeServer& nodeServer, ICryptoNoteProtocolQuery& cryptoNoteProtocolQuery, const DaemonRpcServerConfigurationOptions& daemonRpcServerConfigurationOptions) :
   HttpServer(dispatcher, log),
+  m_logger(log, "DaemonRpcServer"),
   m_daemonRpcCommands(log, core, nodeServer, cryptoNoteProtocolQuery),
   m_daemonRpcServerConfigurationOptions(daemonRpcServerConfigurationOptions),
   m_core(core),
-  m_nodeServer(nodeServer) {
+  m_nodeServer(nodeServer),
+  m_cryptoNoteProtocolQuery(cryptoNoteProtocolQuery),
+  m_restricted_rpc(false) {
+  Common::MetricsRegistry& metrics = Common::MetricsRegistry::instance();
+  for (const auto& route : s_routes) {
+    m_requestMetrics[route.first] = &metrics.histogram("cash2_rpc_request_duration_microseconds", "Time spent serving the RPC requests, by url", Common::MetricsRegistry::label("url", route.first));
+  }
+
+  for (const auto& route : s_jsonRpcRoutes) {
+    m_requestMetrics[route.first] = &metrics.histogram("cash2_json_rpc_request_duration_microseconds", "Time spent serving the JSON-RPC requests, by method", Common::MetricsRegistry::label("method", route.first));
+  }
+
+  m_core.addObserver(this);
+  m_cryptoNoteProtocolQuery.addObserver(this);
+}
+
+DaemonRpcServer::~DaemonRpcServer() {
+  m_cryptoNoteProtocolQuery.removeObserver(this);
+  m_core.removeObserver(this);
 }
 
 void DaemonRpcServer::enableCors(const std::string domain) {
@@ -91,692 +224,235 @@ void DaemonRpcServer::setRestrictedRpc(const bool is_restricted) {
 }
 
 void DaemonRpcServer::start() {
-  HttpServer::start(m_daemonRpcServerConfigurationOptions.bindIp, m_daemonRpcServerConfigurationOptions.bindPort);
+  HttpServer::start(m_daemonRpcServerConfigurationOptions.bindIp, m_daemonRpcServerConfigurationOptions.bindPort, m_daemonRpcServerConfigurationOptions.threads);
 }
 
 
 // Pirvate functions
 
 
-bool DaemonRpcServer::isCoreReady() {
-  return m_core.currency().isTestnet() || m_nodeServer.get_payload_object().isSynchronized();
+DaemonRpcServer::ChangeWaiter::ChangeWaiter(System::Dispatcher& dispatcher) :
+  dispatcher(dispatcher),
+  event(dispatcher) {
 }
 
-void DaemonRpcServer::processRequest(const HttpRequest& httpRequest, HttpResponse& httpResponse) {
-  std::string url = httpRequest.getUrl();
-
-  httpResponse.addHeader("Content-Type", "application/json");
-  if (!m_cors_domain.empty()) {
-    httpResponse.addHeader("Access-Control-Allow-Origin", m_cors_domain);
-  }
-
-  if (url == "/get_blocks.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_GET_BLOCKS_FAST::request request;
-    CORE_RPC_COMMAND_GET_BLOCKS_FAST::response response;
-
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.get_blocks(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/query_blocks.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
+template<typename Command>
+DaemonRpcServer::RpcRoute DaemonRpcServer::jsonRpcRoute(bool (DaemonRpcCommands::*command)(const typename Command::request&, typename Command::response&), bool restricted, bool needsSynced) {
+  RpcRoute route = { RpcFormat::JSON_RPC, restricted, needsSynced, nullptr, nullptr };
+  route.jsonRpcHandler = [command, needsSynced](DaemonRpcServer& server, System::Dispatcher& dispatcher, const JsonRpc::JsonRpcRequest& jsonRequest, JsonRpc::JsonRpcResponse& jsonResponse) {
+    typename Command::request request;
+    typename Command::response response;
 
-    CORE_RPC_COMMAND_QUERY_BLOCKS::request request;
-    CORE_RPC_COMMAND_QUERY_BLOCKS::response response;
+    loadJsonRpcParams(jsonRequest, request);
 
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
+    if (!server.invokeCommand(dispatcher, needsSynced, [&] { (server.m_daemonRpcCommands.*command)(request, response); })) {
+      return false;
     }
 
-    m_daemonRpcCommands.query_blocks(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/query_blocks_lite.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_QUERY_BLOCKS_LITE::request request;
-    CORE_RPC_COMMAND_QUERY_BLOCKS_LITE::response response;
-
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
-    }
+    jsonResponse.setResult(response);
+    return true;
+  };
 
-    m_daemonRpcCommands.query_blocks_lite(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/get_o_indexes.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_GET_TX_GLOBAL_OUTPUTS_INDEXES::request request;
-    CORE_RPC_COMMAND_GET_TX_GLOBAL_OUTPUTS_INDEXES::response response;
-
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.get_indexes(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/get_random_outs.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request request;
-    CORE_RPC_COMMAND_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response response;
-
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.get_random_outs(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/get_pool_changes.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_GET_POOL_CHANGES::request request;
-    CORE_RPC_COMMAND_GET_POOL_CHANGES::response response;
-
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
-    }
+  return route;
+}
 
-    m_daemonRpcCommands.get_pool_changes(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/get_pool_changes_lite.bin")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
+template<typename Command, DaemonRpcServer::RpcFormat format>
+DaemonRpcServer::RpcRoute DaemonRpcServer::route(bool (DaemonRpcCommands::*command)(const typename Command::request&, typename Command::response&), bool restricted, bool needsSynced) {
+  typedef typename std::conditional<format == RpcFormat::BINARY, BinaryFormat, JsonFormat>::type Format;
 
-    CORE_RPC_COMMAND_GET_POOL_CHANGES_LITE::request request;
-    CORE_RPC_COMMAND_GET_POOL_CHANGES_LITE::response response;
+  RpcRoute route = { format, restricted, needsSynced, nullptr, nullptr };
+  route.handler = [command, needsSynced](DaemonRpcServer& server, System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse) {
+    typename Command::request request;
+    typename Command::response response;
 
-    if (!loadFromBinaryKeyValue(request, httpRequest.getBody())) {
-      return;
+    if (!Format::load(request, httpRequest.getBody())) {
+      return true;
     }
 
-    m_daemonRpcCommands.get_pool_changes_lite(request, response);
-    httpResponse.setBody(storeToBinaryKeyValue(response));
-  }
-  else if (url == "/get_circulating_supply")
-  {
-    CORE_RPC_COMMAND_GET_CIRCULATING_SUPPLY::request request;
-    CORE_RPC_COMMAND_GET_CIRCULATING_SUPPLY::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+    if (!server.invokeCommand(dispatcher, needsSynced, [&] { (server.m_daemonRpcCommands.*command)(request, response); })) {
+      return false;
     }
 
-    m_daemonRpcCommands.get_circulating_supply(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_connections")
-  {
-    CORE_RPC_COMMAND_GET_CONNECTIONS::request request;
-    CORE_RPC_COMMAND_GET_CONNECTIONS::response response;
+    httpResponse.setBody(Format::store(response));
+    return true;
+  };
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+  return route;
+}
 
-    m_daemonRpcCommands.get_connections(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_connections_count")
-  {
-    CORE_RPC_COMMAND_GET_CONNECTIONS_COUNT::request request;
-    CORE_RPC_COMMAND_GET_CONNECTIONS_COUNT::response response;
+void DaemonRpcServer::blockchainUpdated() {
+  notifyChangeWaiters();
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+// Executes command on the dispatcher of the server, where the core can be used, returns false instead if the core is needed
+// synchronized and is not.
+bool DaemonRpcServer::invokeCommand(System::Dispatcher& dispatcher, bool needsSynced, const std::function<void()>& command) {
+  return System::callInDispatcher<bool>(dispatcher, m_dispatcher, [&] {
+    if (needsSynced && !isCoreReady()) {
+      return false;
     }
 
-    m_daemonRpcCommands.get_connections_count(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_difficulty")
-  {
-    CORE_RPC_COMMAND_GET_DIFFICULTY::request request;
-    CORE_RPC_COMMAND_GET_DIFFICULTY::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+    command();
+    return true;
+  });
+}
 
-    m_daemonRpcCommands.get_difficulty(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_grey_peerlist")
-  {
-    CORE_RPC_COMMAND_GET_GREY_PEERLIST::request request;
-    CORE_RPC_COMMAND_GET_GREY_PEERLIST::response response;
+bool DaemonRpcServer::isCoreReady() {
+  return m_core.currency().isTestnet() || m_nodeServer.get_payload_object().isSynchronized();
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+void DaemonRpcServer::lastKnownBlockHeightUpdated(uint32_t height) {
+  notifyChangeWaiters();
+}
 
-    m_daemonRpcCommands.get_grey_peerlist(request, response);
-    httpResponse.setBody(storeToJson(response));
+// the waiters look at the daemon again on their own dispatchers, they are removed when their requests end
+void DaemonRpcServer::notifyChangeWaiters() {
+  std::unique_lock<std::mutex> lock(m_changeWaitersMutex);
+  for (const std::shared_ptr<ChangeWaiter>& waiter : m_changeWaiters) {
+    std::shared_ptr<ChangeWaiter> waiterCopy = waiter;
+    waiter->dispatcher.remoteSpawn([waiterCopy] { waiterCopy->event.set(); });
   }
-  else if (url == "/get_grey_peerlist_size")
-  {
-    CORE_RPC_COMMAND_GET_GREY_PEERLIST_SIZE::request request;
-    CORE_RPC_COMMAND_GET_GREY_PEERLIST_SIZE::response response;
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+void DaemonRpcServer::peerCountUpdated(size_t count) {
+  notifyChangeWaiters();
+}
 
-    m_daemonRpcCommands.get_grey_peerlist_size(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_height")
-  {
-    CORE_RPC_COMMAND_GET_HEIGHT::request request;
-    CORE_RPC_COMMAND_GET_HEIGHT::response response;
+void DaemonRpcServer::poolUpdated() {
+  notifyChangeWaiters();
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+bool DaemonRpcServer::processJsonRpcRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse) {
+  JsonRpc::JsonRpcRequest jsonRequest;
+  JsonRpc::JsonRpcResponse jsonResponse;
 
-    m_daemonRpcCommands.get_height(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_incoming_connections")
+  try
   {
-    CORE_RPC_COMMAND_GET_INCOMING_CONNECTIONS::request request;
-    CORE_RPC_COMMAND_GET_INCOMING_CONNECTIONS::response response;
+    jsonRequest.parseRequest(httpRequest.getBody());
+    jsonResponse.setId(jsonRequest.getId());
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+    auto it = s_jsonRpcRoutes.find(jsonRequest.getMethod());
+    if (it == s_jsonRpcRoutes.end()) {
+      throw JsonRpc::JsonRpcError(JsonRpc::errMethodNotFound);
     }
 
-    m_daemonRpcCommands.get_incoming_connections(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_incoming_connections_count")
-  {
-    CORE_RPC_COMMAND_GET_INCOMING_CONNECTIONS_COUNT::request request;
-    CORE_RPC_COMMAND_GET_INCOMING_CONNECTIONS_COUNT::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+    const RpcRoute& route = it->second;
+    if (route.restricted && m_restricted_rpc) {
+      throw JsonRpc::JsonRpcError(JsonRpc::errInvalidRequest, CORE_RPC_STATUS_FAILED_RESTRICTED);
     }
 
-    m_daemonRpcCommands.get_incoming_connections_count(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_info")
-  {
-    CORE_RPC_COMMAND_GET_INFO::request request;
-    CORE_RPC_COMMAND_GET_INFO::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+    auto start = std::chrono::steady_clock::now();
+    if (!route.jsonRpcHandler(*this, dispatcher, jsonRequest, jsonResponse)) {
+      throw JsonRpc::JsonRpcError(JsonRpc::errInternalError, "Core is busy");
     }
 
-    m_daemonRpcCommands.get_info(request, response);
-    httpResponse.setBody(storeToJson(response));
+    requestProcessed(jsonRequest.getMethod(), std::chrono::steady_clock::now() - start);
+  } catch (const JsonRpc::JsonRpcError& err) {
+    jsonResponse.setError(err);
+  } catch (const std::exception& e) {
+    jsonResponse.setError(JsonRpc::JsonRpcError(JsonRpc::errInternalError, e.what()));
   }
-  else if (url == "/get_mempool_transactions_count")
-  {
-    CORE_RPC_COMMAND_GET_MEMPOOL_TRANSACTIONS_COUNT::request request;
-    CORE_RPC_COMMAND_GET_MEMPOOL_TRANSACTIONS_COUNT::response response;
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.get_mempool_transactions_count(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_orphan_blocks_count")
-  {
-    CORE_RPC_COMMAND_GET_ORPHAN_BLOCKS_COUNT::request request;
-    CORE_RPC_COMMAND_GET_ORPHAN_BLOCKS_COUNT::response response;
+  httpResponse.setBody(jsonResponse.getBody());
+  return true;
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+bool DaemonRpcServer::processMetricsRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse) {
+  // replaces the JSON content type set by serveRequest()
+  httpResponse.addHeader("Content-Type", "text/plain; version=0.0.4");
+  httpResponse.setBody(Common::MetricsRegistry::instance().format());
+  return true;
+}
 
-    m_daemonRpcCommands.get_orphan_blocks_count(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_outgoing_connections")
-  {
-    CORE_RPC_COMMAND_GET_OUTGOING_CONNECTIONS::request request;
-    CORE_RPC_COMMAND_GET_OUTGOING_CONNECTIONS::response response;
+void DaemonRpcServer::processRequest(const HttpRequest& httpRequest, HttpResponse& httpResponse) {
+  serveRequest(m_dispatcher, httpRequest, httpResponse);
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+// Holds the connection until the daemon differs from the request or the timeout of the request passes. The waiter is
+// registered before the daemon is looked at and its event is cleared before each look, so no change is missed.
+bool DaemonRpcServer::processWaitForChangesRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse) {
+  CORE_RPC_COMMAND_WAIT_FOR_CHANGES::request request;
+  CORE_RPC_COMMAND_WAIT_FOR_CHANGES::response response;
 
-    m_daemonRpcCommands.get_outgoing_connections(request, response);
-    httpResponse.setBody(storeToJson(response));
+  if (!BinaryFormat::load(request, httpRequest.getBody())) {
+    return true;
   }
-  else if (url == "/get_outgoing_connections_count")
-  {
-    CORE_RPC_COMMAND_GET_OUTGOING_CONNECTIONS_COUNT::request request;
-    CORE_RPC_COMMAND_GET_OUTGOING_CONNECTIONS_COUNT::response response;
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.get_outgoing_connections_count(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_total_transactions_count")
+  std::shared_ptr<ChangeWaiter> waiter = std::make_shared<ChangeWaiter>(dispatcher);
   {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_GET_TOTAL_TRANSACTIONS_COUNT::request request;
-    CORE_RPC_COMMAND_GET_TOTAL_TRANSACTIONS_COUNT::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.get_total_transactions_count(request, response);
-    httpResponse.setBody(storeToJson(response));
+    std::unique_lock<std::mutex> lock(m_changeWaitersMutex);
+    m_changeWaiters.insert(waiter);
   }
-  else if (url == "/get_transactions")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
 
-    CORE_RPC_COMMAND_GET_TRANSACTIONS::request request;
-    CORE_RPC_COMMAND_GET_TRANSACTIONS::response response;
+  Tools::ScopeExit removeWaiter([this, &waiter] {
+    std::unique_lock<std::mutex> lock(m_changeWaitersMutex);
+    m_changeWaiters.erase(waiter);
+  });
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+  bool timedOut = false;
+  System::ContextGroup timeoutContextGroup(dispatcher);
+  timeoutContextGroup.spawn([&] {
+    try {
+      System::Timer(dispatcher).sleep(std::chrono::milliseconds(std::min(request.timeout, MAX_WAIT_FOR_CHANGES_TIMEOUT)));
+      timedOut = true;
+      waiter->event.set();
+    } catch (System::InterruptedException&) {
     }
+  });
 
-    m_daemonRpcCommands.get_transactions(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_transaction_fee")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
+  for (;;) {
+    waiter->event.clear();
+    if (!invokeCommand(dispatcher, true, [&] { m_daemonRpcCommands.wait_for_changes(request, response); })) {
+      return false;
     }
 
-    CORE_RPC_COMMAND_GET_TRANSACTION_FEE::request request;
-    CORE_RPC_COMMAND_GET_TRANSACTION_FEE::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
+    if (timedOut || response.status != CORE_RPC_STATUS_OK || hasChanges(request, response)) {
+      break;
     }
 
-    m_daemonRpcCommands.get_transaction_fee(request, response);
-    httpResponse.setBody(storeToJson(response));
+    waiter->event.wait();
   }
-  else if (url == "/get_white_peerlist")
-  {
-    CORE_RPC_COMMAND_GET_WHITE_PEERLIST::request request;
-    CORE_RPC_COMMAND_GET_WHITE_PEERLIST::response response;
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+  httpResponse.setBody(BinaryFormat::store(response));
+  return true;
+}
 
-    m_daemonRpcCommands.get_white_peerlist(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/get_white_peerlist_size")
-  {
-    CORE_RPC_COMMAND_GET_WHITE_PEERLIST_SIZE::request request;
-    CORE_RPC_COMMAND_GET_WHITE_PEERLIST_SIZE::response response;
+// the place to measure the cost of every url and JSON-RPC method, name is a key of s_routes or s_jsonRpcRoutes
+void DaemonRpcServer::requestProcessed(const std::string& name, std::chrono::steady_clock::duration duration) {
+  m_requestMetrics.at(name)->recordDuration(duration);
+  m_logger(TRACE) << name << " processed in " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << " us";
+}
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
+void DaemonRpcServer::serveRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse) {
+  const std::string& url = httpRequest.getUrl();
 
-    m_daemonRpcCommands.get_white_peerlist_size(request, response);
-    httpResponse.setBody(storeToJson(response));
+  httpResponse.addHeader("Content-Type", "application/json");
+  if (!m_cors_domain.empty()) {
+    httpResponse.addHeader("Access-Control-Allow-Origin", m_cors_domain);
   }
-  else if (url == "/json_rpc")
-  {
-    JsonRpc::JsonRpcRequest jsonRequest;
-    JsonRpc::JsonRpcResponse jsonResponse;
-
-    try
-    {
-      jsonRequest.parseRequest(httpRequest.getBody());
-      jsonResponse.setId(jsonRequest.getId());
-
-      if (jsonRequest.getMethod() == "check_payment")
-      {
-        CORE_RPC_COMMAND_CHECK_PAYMENT::request request;
-        CORE_RPC_COMMAND_CHECK_PAYMENT::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.check_payment(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_block")
-      {
-        CORE_RPC_COMMAND_GET_BLOCK::request request;
-        CORE_RPC_COMMAND_GET_BLOCK::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_block(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_block_count")
-      {
-        CORE_RPC_COMMAND_GET_BLOCK_COUNT::request request;
-        CORE_RPC_COMMAND_GET_BLOCK_COUNT::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_block_count(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_block_hash")
-      {
-        CORE_RPC_COMMAND_GET_BLOCK_HASH::request request;
-        CORE_RPC_COMMAND_GET_BLOCK_HASH::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_block_hash(request, response);
-
-        jsonResponse.setResult(response);
-      }      
-      else if (jsonRequest.getMethod() == "get_block_header_by_hash")
-      {
-        CORE_RPC_COMMAND_GET_BLOCK_HEADER_BY_HASH::request request;
-        CORE_RPC_COMMAND_GET_BLOCK_HEADER_BY_HASH::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_block_header_by_hash(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_block_header_by_height")
-      {
-        CORE_RPC_COMMAND_GET_BLOCK_HEADER_BY_HEIGHT::request request;
-        CORE_RPC_COMMAND_GET_BLOCK_HEADER_BY_HEIGHT::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_block_header_by_height(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_block_template")
-      {
-        CORE_RPC_COMMAND_GET_BLOCK_TEMPLATE::request request;
-        CORE_RPC_COMMAND_GET_BLOCK_TEMPLATE::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_block_template(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_blocks")
-      {
-        CORE_RPC_COMMAND_GET_BLOCKS_JSON::request request;
-        CORE_RPC_COMMAND_GET_BLOCKS_JSON::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_blocks_json(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_currency_id")
-      {
-        CORE_RPC_COMMAND_GET_CURRENCY_ID::request request;
-        CORE_RPC_COMMAND_GET_CURRENCY_ID::response response;
-
-        m_daemonRpcCommands.get_currency_id(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_last_block_header")
-      {
-        CORE_RPC_COMMAND_GET_LAST_BLOCK_HEADER::request request;
-        CORE_RPC_COMMAND_GET_LAST_BLOCK_HEADER::response response;
-
-        m_daemonRpcCommands.get_last_block_header(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_mempool")
-      {
-        CORE_RPC_COMMAND_GET_MEMPOOL::request request;
-        CORE_RPC_COMMAND_GET_MEMPOOL::response response;
-
-        m_daemonRpcCommands.get_mempool(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "get_transaction")
-      {
-        CORE_RPC_COMMAND_GET_TRANSACTION::request request;
-        CORE_RPC_COMMAND_GET_TRANSACTION::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.get_transaction(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "submit_block")
-      {
-        CORE_RPC_COMMAND_SUBMIT_BLOCK::request request;
-        CORE_RPC_COMMAND_SUBMIT_BLOCK::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.submit_block(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else if (jsonRequest.getMethod() == "validate_address")
-      {
-        CORE_RPC_COMMAND_VALIDATE_ADDRESS::request request;
-        CORE_RPC_COMMAND_VALIDATE_ADDRESS::response response;
-
-        if (!jsonRequest.loadParams(request)) {
-          throw JsonRpc::JsonRpcError(JsonRpc::errInvalidParams);
-        }
-
-        m_daemonRpcCommands.validate_address(request, response);
-
-        jsonResponse.setResult(response);
-      }
-      else
-      {
-        throw JsonRpc::JsonRpcError(JsonRpc::errMethodNotFound);
-      }
-    } catch (const JsonRpc::JsonRpcError& err) {
-      jsonResponse.setError(err);
-    } catch (const std::exception& e) {
-      jsonResponse.setError(JsonRpc::JsonRpcError(JsonRpc::errInternalError, e.what()));
-    }
 
-    httpResponse.setBody(jsonResponse.getBody());
+  auto it = s_routes.find(url);
+  if (it == s_routes.end()) {
+    httpResponse.setStatus(HttpResponse::STATUS_404);
     return;
   }
-  else if (url == "/send_raw_transaction")
-  {
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    CORE_RPC_COMMAND_SEND_RAW_TX::request request;
-    CORE_RPC_COMMAND_SEND_RAW_TX::response response;
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.send_raw_transaction(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/start_mining")
-  {
-    CORE_RPC_COMMAND_START_MINING::request request;
-    CORE_RPC_COMMAND_START_MINING::response response;
-
-    if (m_restricted_rpc) {
-      response.status = CORE_RPC_STATUS_FAILED_RESTRICTED;
-      httpResponse.setBody(storeToJson(response));
-      return;
-    }
-
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.start_mining(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else if (url == "/stop_mining")
-  {
-    CORE_RPC_COMMAND_STOP_MINING::request request;
-    CORE_RPC_COMMAND_STOP_MINING::response response;
-
-    if (m_restricted_rpc) {
-      response.status = CORE_RPC_STATUS_FAILED_RESTRICTED;
-      httpResponse.setBody(storeToJson(response));
-      return;
-    }
-
-    if (!isCoreReady())
-    {
-      httpResponse.setStatus(HttpResponse::STATUS_500);
-      httpResponse.setBody("Core is busy");
-      return;
-    }
 
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.stop_mining(request, response);
+  const RpcRoute& route = it->second;
+  if (route.restricted && m_restricted_rpc) {
+    STATUS_STRUCT response;
+    response.status = CORE_RPC_STATUS_FAILED_RESTRICTED;
     httpResponse.setBody(storeToJson(response));
+    return;
   }
-  else if (url == "/stop_daemon")
-  {
-    CORE_RPC_COMMAND_STOP_DAEMON::request request;
-    CORE_RPC_COMMAND_STOP_DAEMON::response response;
 
-    if (m_restricted_rpc) {
-      response.status = CORE_RPC_STATUS_FAILED_RESTRICTED;
-      httpResponse.setBody(storeToJson(response));
-      return;
-    }
-
-    if (!loadFromJson(request, httpRequest.getBody())) {
-      return;
-    }
-
-    m_daemonRpcCommands.stop_daemon(request, response);
-    httpResponse.setBody(storeToJson(response));
-  }
-  else
-  {
-    httpResponse.setStatus(HttpResponse::STATUS_404);
+  auto start = std::chrono::steady_clock::now();
+  if (!route.handler(*this, dispatcher, httpRequest, httpResponse)) {
+    httpResponse.setStatus(HttpResponse::STATUS_500);
+    httpResponse.setBody("Core is busy");
     return;
   }
+
+  requestProcessed(url, std::chrono::steady_clock::now() - start);
 }
 
 } // end namespace CryptoNote
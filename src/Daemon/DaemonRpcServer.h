@@ -6,34 +6,96 @@
 
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Common/Metrics.h"
 #include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/ICoreObserver.h"
 #include "P2p/NodeServer.h"
+#include "CryptoNoteProtocol/ICryptoNoteProtocolObserver.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolQuery.h"
+#include "System/Event.h"
 #include "Rpc/HttpServer.h"
+#include "Rpc/JsonRpc.h"
 #include "Logging/LoggerRef.h"
 #include "DaemonRpcCommands.h"
 #include "DaemonRpcServerConfigurationOptions.h"
 
 namespace CryptoNote {
 
-class DaemonRpcServer : public HttpServer {
+class DaemonRpcServer : public HttpServer, private ICoreObserver, private ICryptoNoteProtocolObserver {
 public:
-  DaemonRpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, Core& core, NodeServer& nodeServer, const ICryptoNoteProtocolQuery& cryptoNoteProtocolQuery, const DaemonRpcServerConfigurationOptions& daemonRpcServerConfig);
+  DaemonRpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, Core& core, NodeServer& nodeServer, ICryptoNoteProtocolQuery& cryptoNoteProtocolQuery, const DaemonRpcServerConfigurationOptions& daemonRpcServerConfig);
+  ~DaemonRpcServer();
   void enableCors(const std::string domain);
   std::string getCorsDomain();
   void setRestrictedRpc(const bool is_resctricted);
   void start();
 
 private:
+  enum class RpcFormat {
+    BINARY,
+    JSON,
+    JSON_RPC,
+    TEXT
+  };
+
+  // How the requests to a url or the JSON-RPC requests of a method are served. The handlers load the request and store
+  // the response on the thread of the connection, only the command is executed on the dispatcher of the server.
+  // A handler returns false if the core is not synchronized and the route needs it to be.
+  struct RpcRoute {
+    RpcFormat format;
+    bool restricted; // refused in restricted RPC mode
+    bool needsSynced; // refused until the core is synchronized, except on testnet
+    std::function<bool(DaemonRpcServer& server, System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse)> handler;
+    std::function<bool(DaemonRpcServer& server, System::Dispatcher& dispatcher, const JsonRpc::JsonRpcRequest& jsonRequest, JsonRpc::JsonRpcResponse& jsonResponse)> jsonRpcHandler;
+  };
+
+  // A request to /wait_for_changes.bin, woken on the dispatcher of its connection when the daemon changes
+  struct ChangeWaiter {
+    explicit ChangeWaiter(System::Dispatcher& dispatcher);
+
+    System::Dispatcher& dispatcher;
+    System::Event event;
+  };
+
+  template<typename Command> static RpcRoute jsonRpcRoute(bool (DaemonRpcCommands::*command)(const typename Command::request&, typename Command::response&), bool restricted, bool needsSynced);
+  template<typename Command, RpcFormat format> static RpcRoute route(bool (DaemonRpcCommands::*command)(const typename Command::request&, typename Command::response&), bool restricted, bool needsSynced);
+
+  virtual void blockchainUpdated() override;
+  bool invokeCommand(System::Dispatcher& dispatcher, bool needsSynced, const std::function<void()>& command);
   bool isCoreReady();  
+  virtual void lastKnownBlockHeightUpdated(uint32_t height) override;
+  void notifyChangeWaiters();
+  virtual void peerCountUpdated(size_t count) override;
+  virtual void poolUpdated() override;
+  bool processJsonRpcRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse);
+  bool processMetricsRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse);
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) override;
+  bool processWaitForChangesRequest(System::Dispatcher& dispatcher, const HttpRequest& httpRequest, HttpResponse& httpResponse);
+  void requestProcessed(const std::string& name, std::chrono::steady_clock::duration duration);
+  virtual void serveRequest(System::Dispatcher& dispatcher, const HttpRequest& request, HttpResponse& response) override;
+
+  // built once, the same for all servers
+  static const std::unordered_map<std::string, RpcRoute> s_routes;
+  static const std::unordered_map<std::string, RpcRoute> s_jsonRpcRoutes;
 
+  Logging::LoggerRef m_logger;
   DaemonRpcCommands m_daemonRpcCommands;
   const DaemonRpcServerConfigurationOptions& m_daemonRpcServerConfigurationOptions;
   Core& m_core;
   NodeServer& m_nodeServer;
+  ICryptoNoteProtocolQuery& m_cryptoNoteProtocolQuery;
   bool m_restricted_rpc;
   std::string m_cors_domain;
+  std::unordered_map<std::string, Common::MetricHistogram*> m_requestMetrics; // by url and JSON-RPC method, built once
+  std::mutex m_changeWaitersMutex; // the observers are notified on other threads than the connections
+  std::unordered_set<std::shared_ptr<ChangeWaiter>> m_changeWaiters;
 };
 
 } // end namespace CryptoNote
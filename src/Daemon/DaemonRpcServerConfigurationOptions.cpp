@@ -18,6 +18,7 @@ const command_line::arg_descriptor<std::string> arg_enable_cors     = { "enable-
 const command_line::arg_descriptor<bool>        arg_restricted_rpc  = { "restricted-rpc", "Restrict Daemon RPC commands to view only commands to prevent abuse" };
 const command_line::arg_descriptor<std::string> arg_rpc_bind_ip     = { "rpc-bind-ip", "", DEFAULT_RPC_IP };
 const command_line::arg_descriptor<uint16_t>    arg_rpc_bind_port   = { "rpc-bind-port", "", DEFAULT_RPC_PORT };
+const command_line::arg_descriptor<uint32_t>    arg_rpc_threads     = { "rpc-threads", "Number of threads accepting and serving Daemon RPC connections", 1 };
 
 }
 
@@ -25,7 +26,8 @@ DaemonRpcServerConfigurationOptions::DaemonRpcServerConfigurationOptions() :
   bindIp(DEFAULT_RPC_IP),
   bindPort(DEFAULT_RPC_PORT),
   enableCors(""),
-  restrictedRpc(false) {
+  restrictedRpc(false),
+  threads(1) {
 }
 
 std::string DaemonRpcServerConfigurationOptions::getBindAddress() const {
@@ -37,6 +39,7 @@ void DaemonRpcServerConfigurationOptions::initOptions(boost::program_options::op
   command_line::add_arg(desc, arg_restricted_rpc);
   command_line::add_arg(desc, arg_rpc_bind_ip);
   command_line::add_arg(desc, arg_rpc_bind_port);
+  command_line::add_arg(desc, arg_rpc_threads);
 }
 
 void DaemonRpcServerConfigurationOptions::init(const boost::program_options::variables_map& vm) {
@@ -44,6 +47,7 @@ void DaemonRpcServerConfigurationOptions::init(const boost::program_options::var
   restrictedRpc = command_line::get_arg(vm, arg_restricted_rpc);
   bindIp = command_line::get_arg(vm, arg_rpc_bind_ip);
   bindPort = command_line::get_arg(vm, arg_rpc_bind_port);
+  threads = command_line::get_arg(vm, arg_rpc_threads);
 }
 
 } // end namespace CryptoNote
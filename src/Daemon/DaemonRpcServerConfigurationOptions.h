@@ -23,6 +23,7 @@ public:
   uint16_t bindPort;
   std::string enableCors;
   bool restrictedRpc;
+  uint32_t threads;
 };
 
 }
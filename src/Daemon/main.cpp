@@ -62,6 +62,7 @@ int main(int argc, char* argv[])
     allConfigurationOptionsDescription.
       add(daemonConfigurationOptionsDescription).
       add(daemonRpcServerConfigurationOptionsDescription).
+      add(coreConfigurationOptionsDescription).
       add(nodeServerConfigurationOptionsDescription).
       add(miningConfigurationOptionsDescription);
 
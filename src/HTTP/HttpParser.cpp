@@ -6,11 +6,17 @@
 #include "HttpParser.h"
 
 #include <algorithm>
+#include <cassert>
+#include <cstring>
 
 #include "HttpParserErrorCodes.h"
 
 namespace {
 
+const size_t MAX_HEADERS_SIZE = 64 * 1024;
+const size_t MAX_BODY_SIZE = 100000000; // the largest levin packet
+const size_t MIN_RECEIVE_SIZE = 4096;
+
 void throwIfNotGood(std::istream& stream) {
   if (!stream.good()) {
     if (stream.eof()) {
@@ -25,6 +31,9 @@ void throwIfNotGood(std::istream& stream) {
 
 namespace CryptoNote {
 
+HttpParser::HttpParser() : m_begin(0), m_end(0), m_scanned(0), m_headersEnd(0), m_bodyLength(0) {
+}
+
 HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::string& status) {
   if (status == "200 OK" || status == "200 Ok") return CryptoNote::HttpResponse::STATUS_200;
   else if (status == "404 Not Found") return CryptoNote::HttpResponse::STATUS_404;
@@ -87,12 +96,7 @@ void HttpParser::receiveResponse(std::istream& stream, HttpResponse& response) {
   }
 
   response.addHeader(name, value);
-  auto headers = response.getHeaders();
-  size_t length = 0;
-  auto it = headers.find("content-length");
-  if (it != headers.end()) {
-    length = std::stoul(it->second);
-  }
+  size_t length = getBodyLen(response.getHeaders());
   
   std::string body;
   if (length) {
@@ -103,6 +107,163 @@ void HttpParser::receiveResponse(std::istream& stream, HttpResponse& response) {
 }
 
 
+uint8_t* HttpParser::getReceiveBuffer(size_t& size) {
+  // the buffer grows with the received data, not with the body length a peer declares
+  size_t needed = m_end - m_begin + MIN_RECEIVE_SIZE;
+  if (m_buffer.size() - m_begin < needed) {
+    if (m_begin != 0) {
+      memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+      m_end -= m_begin;
+      m_scanned -= m_begin;
+      if (m_headersEnd != 0) {
+        m_headersEnd -= m_begin;
+      }
+
+      m_begin = 0;
+    }
+
+    if (m_buffer.size() < needed) {
+      m_buffer.resize(std::max(needed, 2 * m_buffer.size()));
+    }
+  }
+
+  size = m_buffer.size() - m_end;
+  return m_buffer.data() + m_end;
+}
+
+void HttpParser::received(size_t size) {
+  assert(size <= m_buffer.size() - m_end);
+  m_end += size;
+}
+
+bool HttpParser::hasReceivedData() const {
+  return m_begin != m_end;
+}
+
+bool HttpParser::parseRequest(HttpRequest& request) {
+  if (!findHeaders() || m_end - m_headersEnd < m_bodyLength) {
+    return false;
+  }
+
+  // method, url and version separated by spaces
+  const char* line = reinterpret_cast<const char*>(m_buffer.data() + m_begin);
+  const char* lineEnd = reinterpret_cast<const char*>(m_buffer.data() + findLineEnd(m_begin));
+  const char* methodEnd = std::find(line, lineEnd, ' ');
+  if (methodEnd == lineEnd) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+  }
+
+  const char* urlEnd = std::find(methodEnd + 1, lineEnd, ' ');
+  request.method.assign(line, methodEnd);
+  request.url.assign(methodEnd + 1, urlEnd);
+  request.headers = std::move(m_headers);
+  request.body.assign(reinterpret_cast<const char*>(m_buffer.data() + m_headersEnd), m_bodyLength);
+  takeMessage();
+  return true;
+}
+
+bool HttpParser::parseResponse(HttpResponse& response) {
+  if (!findHeaders() || m_end - m_headersEnd < m_bodyLength) {
+    return false;
+  }
+
+  // version and status separated by a space
+  const char* line = reinterpret_cast<const char*>(m_buffer.data() + m_begin);
+  const char* lineEnd = reinterpret_cast<const char*>(m_buffer.data() + findLineEnd(m_begin));
+  const char* versionEnd = std::find(line, lineEnd, ' ');
+  if (versionEnd == lineEnd) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+  }
+
+  response.setStatus(parseResponseStatusFromString(std::string(versionEnd + 1, lineEnd)));
+  for (const auto& header : m_headers) {
+    response.addHeader(header.first, header.second);
+  }
+
+  response.setBody(std::string(reinterpret_cast<const char*>(m_buffer.data() + m_headersEnd), m_bodyLength));
+  takeMessage();
+  return true;
+}
+
+// the headers end with an empty line, the search continues where the previous one stopped
+bool HttpParser::findHeaders() {
+  if (m_headersEnd != 0) {
+    return true;
+  }
+
+  size_t position = std::max(m_scanned, m_begin + 3);
+  while (position < m_end) {
+    const uint8_t* found = static_cast<const uint8_t*>(memchr(m_buffer.data() + position, '\n', m_end - position));
+    if (found == nullptr) {
+      break;
+    }
+
+    position = found - m_buffer.data();
+    if (m_buffer[position - 1] == '\r' && m_buffer[position - 2] == '\n' && m_buffer[position - 3] == '\r') {
+      m_headersEnd = position + 1;
+      m_headers.clear();
+      size_t lineBegin = findLineEnd(m_begin) + 2;
+      while (lineBegin < m_headersEnd - 2) {
+        size_t lineEnd = findLineEnd(lineBegin);
+        std::string name;
+        std::string value;
+        parseHeader(lineBegin, lineEnd, name, value);
+        m_headers[name] = value;
+        lineBegin = lineEnd + 2;
+      }
+
+      m_bodyLength = getBodyLen(m_headers);
+      return true;
+    }
+
+    ++position;
+  }
+
+  m_scanned = m_end;
+  if (m_end - m_begin > MAX_HEADERS_SIZE) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::HEADERS_TOO_LARGE));
+  }
+
+  return false;
+}
+
+// once the headers are found, every line of them ends with "\r\n"
+size_t HttpParser::findLineEnd(size_t position) const {
+  for (;;) {
+    const uint8_t* found = static_cast<const uint8_t*>(memchr(m_buffer.data() + position, '\r', m_headersEnd - position));
+    assert(found != nullptr);
+    position = found - m_buffer.data();
+    if (m_buffer[position + 1] == '\n') {
+      return position;
+    }
+
+    ++position;
+  }
+}
+
+void HttpParser::parseHeader(size_t begin, size_t end, std::string& name, std::string& value) const {
+  const char* line = reinterpret_cast<const char*>(m_buffer.data() + begin);
+  const char* lineEnd = reinterpret_cast<const char*>(m_buffer.data() + end);
+  const char* nameEnd = std::find(line, lineEnd, ':');
+  if (nameEnd == lineEnd) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+  }
+
+  if (nameEnd == line) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::EMPTY_HEADER));
+  }
+
+  name.assign(line, nameEnd);
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+  const char* valueBegin = nameEnd + 1;
+  while (valueBegin != lineEnd && (*valueBegin == ' ' || *valueBegin == '\t')) {
+    ++valueBegin;
+  }
+
+  value.assign(valueBegin, lineEnd);
+}
+
 void HttpParser::readWord(std::istream& stream, std::string& word) {
 
   char c;
@@ -192,8 +353,13 @@ bool HttpParser::readHeader(std::istream& stream, std::string& name, std::string
 size_t HttpParser::getBodyLen(const HttpRequest::Headers& headers) {
   auto it = headers.find("content-length");
   if (it != headers.end()) {
-    size_t bytes = std::stoul(it->second);
-    return bytes;
+    // the limit also keeps the end of the body within size_t
+    unsigned long long bytes = std::stoull(it->second);
+    if (bytes > MAX_BODY_SIZE) {
+      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::BODY_TOO_LARGE));
+    }
+
+    return static_cast<size_t>(bytes);
   }
 
   return 0;
@@ -210,4 +376,17 @@ void HttpParser::readBody(std::istream& stream, std::string& body, const size_t
   throwIfNotGood(stream);
 }
 
+void HttpParser::takeMessage() {
+  m_begin = m_headersEnd + m_bodyLength;
+  m_scanned = m_begin;
+  m_headersEnd = 0;
+  m_bodyLength = 0;
+  m_headers.clear();
+  if (m_begin == m_end) {
+    m_begin = 0;
+    m_end = 0;
+    m_scanned = 0;
+  }
+}
+
 }
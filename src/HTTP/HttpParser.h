@@ -6,28 +6,53 @@
 #ifndef HTTPPARSER_H_
 #define HTTPPARSER_H_
 
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 
 namespace CryptoNote {
 
 //Blocking HttpParser
+//
+//Messages can also be parsed from a receive buffer kept by the parser, without reading a stream one character at a time.
+//Received data is written to getReceiveBuffer() and added with received(), parseRequest() and parseResponse() take
+//the first message out of the buffer once all of it is received. Pipelined messages stay in the buffer for the next call.
 class HttpParser {
 public:
-  HttpParser() {};
+  HttpParser();
 
   void receiveRequest(std::istream& stream, HttpRequest& request);
   void receiveResponse(std::istream& stream, HttpResponse& response);
   static HttpResponse::HTTP_STATUS parseResponseStatusFromString(const std::string& status);
+
+  uint8_t* getReceiveBuffer(size_t& size);
+  void received(size_t size);
+  bool hasReceivedData() const;
+  bool parseRequest(HttpRequest& request);
+  bool parseResponse(HttpResponse& response);
+
 private:
+  bool findHeaders();
+  size_t findLineEnd(size_t position) const;
+  void parseHeader(size_t begin, size_t end, std::string& name, std::string& value) const;
   void readWord(std::istream& stream, std::string& word);
   void readHeaders(std::istream& stream, HttpRequest::Headers &headers);
   bool readHeader(std::istream& stream, std::string& name, std::string& value);
   size_t getBodyLen(const HttpRequest::Headers& headers);
   void readBody(std::istream& stream, std::string& body, const size_t bodyLen);
+  void takeMessage();
+
+  std::vector<uint8_t> m_buffer;
+  size_t m_begin;
+  size_t m_end;
+  size_t m_scanned; // the end of the headers is not before it
+  size_t m_headersEnd; // 0 until the end of the headers of the first message is found
+  size_t m_bodyLength;
+  HttpRequest::Headers m_headers;
 };
 
 } //namespace CryptoNote
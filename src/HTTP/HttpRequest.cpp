@@ -5,6 +5,8 @@
 
 #include "HttpRequest.h"
 
+#include <utility>
+
 namespace CryptoNote {
 
   const std::string& HttpRequest::getMethod() const {
@@ -26,8 +28,8 @@ namespace CryptoNote {
   void HttpRequest::addHeader(const std::string& name, const std::string& value) {
     headers[name] = value;
   }
-  void HttpRequest::setBody(const std::string& b) {
-    body = b;
+  void HttpRequest::setBody(std::string b) {
+    body = std::move(b);
     if (!body.empty()) {
       headers["Content-Length"] = std::to_string(body.size());
     }
@@ -40,18 +42,26 @@ namespace CryptoNote {
     url = u;
   }
 
-  std::ostream& HttpRequest::printHttpRequest(std::ostream& os) const {
-    os << "POST " << url << " HTTP/1.1\r\n";
+  std::string HttpRequest::getHeaderString() const {
+    std::string headerString = "POST " + url + " HTTP/1.1\r\n";
     auto host = headers.find("Host");
     if (host == headers.end()) {
-      os << "Host: " << "127.0.0.1" << "\r\n";
+      headerString += "Host: 127.0.0.1\r\n";
     }
 
-    for (auto pair : headers) {
-      os << pair.first << ": " << pair.second << "\r\n";
+    for (const auto& pair : headers) {
+      headerString += pair.first;
+      headerString += ": ";
+      headerString += pair.second;
+      headerString += "\r\n";
     }
-    
-    os << "\r\n";
+
+    headerString += "\r\n";
+    return headerString;
+  }
+
+  std::ostream& HttpRequest::printHttpRequest(std::ostream& os) const {
+    os << getHeaderString();
     if (!body.empty()) {
       os << body;
     }
@@ -18,9 +18,11 @@ namespace CryptoNote {
     const std::string& getUrl() const;
     const Headers& getHeaders() const;
     const std::string& getBody() const;
+    // the request line and the headers followed by an empty line, what is sent before the body
+    std::string getHeaderString() const;
 
     void addHeader(const std::string& name, const std::string& value);
-    void setBody(const std::string& b);
+    void setBody(std::string b);
     void setUrl(const std::string& uri);
 
   private:
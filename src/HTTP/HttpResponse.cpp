@@ -7,6 +7,7 @@
 #include "HttpResponse.h"
 
 #include <stdexcept>
+#include <utility>
 
 namespace {
 
@@ -60,8 +61,8 @@ void HttpResponse::addHeader(const std::string& name, const std::string& value)
   headers[name] = value;
 }
 
-void HttpResponse::setBody(const std::string& b) {
-  body = b;
+void HttpResponse::setBody(std::string b) {
+  body = std::move(b);
   if (!body.empty()) {
     headers["Content-Length"] = std::to_string(body.size());
   } else {
@@ -69,13 +70,24 @@ void HttpResponse::setBody(const std::string& b) {
   }
 }
 
-std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
-  os << "HTTP/1.1 " << getStatusString(status) << "\r\n";
+std::string HttpResponse::getHeaderString() const {
+  std::string headerString = "HTTP/1.1 ";
+  headerString += getStatusString(status);
+  headerString += "\r\n";
 
-  for (auto pair: headers) {
-    os << pair.first << ": " << pair.second << "\r\n";
+  for (const auto& pair : headers) {
+    headerString += pair.first;
+    headerString += ": ";
+    headerString += pair.second;
+    headerString += "\r\n";
   }
-  os << "\r\n";
+
+  headerString += "\r\n";
+  return headerString;
+}
+
+std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
+  os << getHeaderString();
 
   if (!body.empty()) {
     os << body;
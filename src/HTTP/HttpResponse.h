@@ -23,9 +23,11 @@ namespace CryptoNote {
 
     void setStatus(HTTP_STATUS s);
     void addHeader(const std::string& name, const std::string& value);
-    void setBody(const std::string& b);
+    void setBody(std::string b);
 
     const std::map<std::string, std::string>& getHeaders() const { return headers; }
+    // the status line and the headers followed by an empty line, what is sent before the body
+    std::string getHeaderString() const;
     HTTP_STATUS getStatus() const { return status; }
     const std::string& getBody() const { return body; }
 
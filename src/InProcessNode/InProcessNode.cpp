@@ -499,10 +499,13 @@ std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& kno
       }
     }
 
+    bse.baseTransactionGlobalIndexes = entry.baseTransactionGlobalIndexes;
+
     for (const auto& tsi: entry.txPrefixes) {
       TransactionShortInfo tpi;
       tpi.txId = tsi.txHash;
       tpi.txPrefix = tsi.txPrefix;
+      tpi.globalIndexes = tsi.globalIndexes;
 
       bse.txsShortInfo.push_back(std::move(tpi));
     }
@@ -89,43 +89,49 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
 void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint64_t nonceStep) {
   try {
     Block block = blockTemplate;
-    Crypto::cn_context cryptoContext;
+
+    // the hashing blob is built once, only the nonce changes below
+    Crypto::nonce_hash_state hashState;
+    if (!get_block_longhash_state(block, hashState)) {
+      //error occured
+      m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
+      m_state = MiningState::MINING_STOPPED;
+      return;
+    }
+
+    uint32_t blockHeight = boost::get<BaseInput>(block.baseTransaction.inputs[0]).blockIndex;
 
     while (m_state == MiningState::MINING_IN_PROGRESS) {
-      Crypto::Hash hash;
-      if (!get_block_longhash(cryptoContext, block, hash)) {
-        //error occured
-        m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
-        m_state = MiningState::MINING_STOPPED;
-        return;
-      }
+      Crypto::Hash hashes[Crypto::NONCE_HASH_BATCH];
+      Crypto::nonce_hash(hashState, block.nonce, nonceStep, Crypto::NONCE_HASH_BATCH, hashes);
 
-      uint32_t blockHeight = boost::get<BaseInput>(block.baseTransaction.inputs[0]).blockIndex;
+      for (size_t i = 0; i < Crypto::NONCE_HASH_BATCH; ++i) {
+        bool checkHashSuccess = false;
 
-      bool checkHashSuccess = false;
+        if (blockHeight < parameters::HARD_FORK_HEIGHT_2)
+        {
+          checkHashSuccess = check_hash1(hashes[i], difficulty);
+        }
+        else
+        {
+          checkHashSuccess = check_hash2(hashes[i], difficulty);
+        }
 
-      if (blockHeight < parameters::HARD_FORK_HEIGHT_2)
-      {
-        checkHashSuccess = check_hash1(hash, difficulty);
-      }
-      else
-      {
-        checkHashSuccess = check_hash2(hash, difficulty);
-      }
+        if (checkHashSuccess) {
+          m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
 
-      if (checkHashSuccess) {
-        m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+          if (!setStateBlockFound()) {
+            m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+            return;
+          }
 
-        if (!setStateBlockFound()) {
-          m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+          block.nonce += i * nonceStep;
+          m_block = block;
           return;
         }
-
-        m_block = block;
-        return;
       }
 
-      block.nonce += nonceStep;
+      block.nonce += Crypto::NONCE_HASH_BATCH * nonceStep;
     }
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Miner got error: " << e.what();
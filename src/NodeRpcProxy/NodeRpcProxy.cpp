@@ -54,6 +54,7 @@ std::error_code interpretResponseStatus(const std::string& status) {
 NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort) :
   m_rpcTimeout(10000),
   m_pullInterval(5000),
+  m_waitForChangesTimeout(30000),
   m_nodeHost(nodeHost),
   m_nodePort(nodePort),
   m_lastLocalBlockTimestamp(0),
@@ -72,6 +73,7 @@ NodeRpcProxy::~NodeRpcProxy() {
 
 void NodeRpcProxy::resetInternalState() {
   m_stop = false;
+  m_waitForChangesSupported = true;
   m_peerCount.store(0, std::memory_order_relaxed);
   m_nodeHeight.store(0, std::memory_order_relaxed);
   m_networkHeight.store(0, std::memory_order_relaxed);
@@ -111,6 +113,7 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    m_statusContextGroup->interrupt();
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -134,6 +137,10 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     Event httpEvent(dispatcher);
     m_httpEvent = &httpEvent;
     m_httpEvent->set();
+    HttpClient statusHttpClient(dispatcher, m_nodeHost, m_nodePort);
+    m_statusHttpClient = &statusHttpClient;
+    ContextGroup statusContextGroup(dispatcher);
+    m_statusContextGroup = &statusContextGroup;
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -144,16 +151,24 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
-    contextGroup.spawn([this]() {
+    statusContextGroup.spawn([this]() {
       Timer pullTimer(*m_dispatcher);
       while (!m_stop) {
-        updateNodeStatus();
+        if (m_waitForChangesSupported && waitForNodeChanges()) {
+          continue;
+        }
+
+        if (!m_stop) {
+          updateNodeStatus();
+        }
+
         if (!m_stop) {
           pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
         }
       }
     });
 
+    statusContextGroup.wait();
     contextGroup.wait();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
@@ -162,8 +177,10 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
   m_dispatcher = nullptr;
   m_context_group = nullptr;
+  m_statusContextGroup = nullptr;
   m_httpClient = nullptr;
   m_httpEvent = nullptr;
+  m_statusHttpClient = nullptr;
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
@@ -262,6 +279,73 @@ void NodeRpcProxy::updatePoolState(const std::vector<std::unique_ptr<ITransactio
   }
 }
 
+// Waits on the daemon until its blockchain, pool or peers differ from what is known here and applies the changes.
+// Returns false if the daemon could not be asked, the status is pulled once instead.
+bool NodeRpcProxy::waitForNodeChanges() {
+  CryptoNote::CORE_RPC_COMMAND_WAIT_FOR_CHANGES::request req = AUTO_VAL_INIT(req);
+  CryptoNote::CORE_RPC_COMMAND_WAIT_FOR_CHANGES::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.tail_block_id = m_lastKnowHash;
+  req.known_txs_ids = getKnownTxsVector();
+  req.last_known_block_index = m_networkHeight.load(std::memory_order_relaxed);
+  req.peer_count = m_peerCount.load(std::memory_order_relaxed);
+  req.timeout = m_waitForChangesTimeout;
+
+  try {
+    HttpRequest httpReq;
+    HttpResponse httpRes;
+
+    httpReq.setUrl("/wait_for_changes.bin");
+    httpReq.setBody(storeToBinaryKeyValue(req));
+
+    m_statusHttpClient->request(httpReq, httpRes);
+
+    if (httpRes.getStatus() == HttpResponse::STATUS_404) {
+      m_waitForChangesSupported = false;
+      return false;
+    }
+
+    if (httpRes.getStatus() != HttpResponse::STATUS_200 || !loadFromBinaryKeyValue(rsp, httpRes.getBody()) || interpretResponseStatus(rsp.status)) {
+      return false;
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+
+  if (rsp.tail_block_id != m_lastKnowHash) {
+    m_lastKnowHash = rsp.tail_block_id;
+    m_nodeHeight.store(rsp.tail_block_index, std::memory_order_relaxed);
+    m_lastLocalBlockTimestamp.store(rsp.tail_block_timestamp, std::memory_order_relaxed);
+    m_observerManager.notify(&INodeObserver::localBlockchainUpdated, m_nodeHeight.load(std::memory_order_relaxed));
+  }
+
+  auto lastKnownBlockIndex = std::max(rsp.last_known_block_index, m_nodeHeight.load(std::memory_order_relaxed));
+  if (m_networkHeight.load(std::memory_order_relaxed) != lastKnownBlockIndex) {
+    m_networkHeight.store(lastKnownBlockIndex, std::memory_order_relaxed);
+    m_observerManager.notify(&INodeObserver::lastKnownBlockHeightUpdated, m_networkHeight.load(std::memory_order_relaxed));
+  }
+
+  updatePeerCount(rsp.peer_count);
+  m_minimalFee.store(rsp.transaction_fee, std::memory_order_relaxed);
+
+  if (!rsp.added_txs.empty() || !rsp.deleted_txs_ids.empty()) {
+    std::vector<std::unique_ptr<ITransactionReader>> addedTxs;
+    for (const auto& tpi : rsp.added_txs) {
+      addedTxs.push_back(createTransactionPrefix(tpi.txPrefix, tpi.txHash));
+    }
+
+    updatePoolState(addedTxs, rsp.deleted_txs_ids);
+    m_observerManager.notify(&INodeObserver::poolChanged);
+  }
+
+  if (!m_connected) {
+    m_connected = true;
+    m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
+  }
+
+  return true;
+}
+
 std::vector<Crypto::Hash> NodeRpcProxy::getKnownTxsVector() const {
   return std::vector<Crypto::Hash>(m_knownTxs.begin(), m_knownTxs.end());
 }
@@ -554,10 +638,13 @@ std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>&
       bse.hasBlock = true;
     }
 
-    for (const auto& txp: item.txPrefixes) {
+    bse.baseTransactionGlobalIndexes = std::move(item.baseTransactionGlobalIndexes);
+
+    for (auto& txp: item.txPrefixes) {
       TransactionShortInfo tsi;
       tsi.txId = txp.txHash;
       tsi.txPrefix = txp.txPrefix;
+      tsi.globalIndexes = std::move(txp.globalIndexes);
       bse.txsShortInfo.push_back(std::move(tsi));
     }
 
@@ -85,6 +85,7 @@ private:
   bool updatePoolStatus();
   void updatePeerCount(size_t peerCount);
   void updatePoolState(const std::vector<std::unique_ptr<ITransactionReader>>& addedTxs, const std::vector<Crypto::Hash>& deletedTxsIds);
+  bool waitForNodeChanges();
 
   std::error_code doRelayTransaction(const CryptoNote::Transaction& transaction);
   std::error_code doGetRandomOutsByAmounts(std::vector<uint64_t>& amounts, uint64_t outsCount,
@@ -119,6 +120,7 @@ private:
   std::thread m_workerThread;
   System::Dispatcher* m_dispatcher = nullptr;
   System::ContextGroup* m_context_group = nullptr;
+  System::ContextGroup* m_statusContextGroup = nullptr; // interrupted on shutdown, a status request can wait long
   Tools::ObserverManager<CryptoNote::INodeObserver> m_observerManager;
   Tools::ObserverManager<CryptoNote::INodeRpcProxyObserver> m_rpcProxyObserverManager;
 
@@ -127,11 +129,14 @@ private:
   unsigned int m_rpcTimeout;
   HttpClient* m_httpClient = nullptr;
   System::Event* m_httpEvent = nullptr;
+  HttpClient* m_statusHttpClient = nullptr; // a connection of its own, held by /wait_for_changes.bin
 
   uint64_t m_pullInterval;
+  uint32_t m_waitForChangesTimeout;
 
   // Internal state
   bool m_stop = false;
+  bool m_waitForChangesSupported; // false if the daemon has no /wait_for_changes.bin, the status is pulled then
   std::atomic<size_t> m_peerCount;
   std::atomic<uint32_t> m_nodeHeight;
   std::atomic<uint32_t> m_networkHeight;
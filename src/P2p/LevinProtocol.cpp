@@ -4,7 +4,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "LevinProtocol.h"
+#include <cstring>
 #include <System/TcpConnection.h>
+#include <System/TcpStream.h>
 
 using namespace CryptoNote;
 
@@ -30,8 +32,12 @@ struct bucket_head2
 };
 #pragma pack(pop)
 
+static_assert(sizeof(bucket_head2) == LevinProtocol::HEADER_SIZE, "Unexpected Levin header size");
+
 }
 
+const size_t LevinProtocol::HEADER_SIZE;
+
 bool LevinProtocol::Command::needReply() const {
   return !(isNotify || isResponse);
 }
@@ -40,23 +46,24 @@ LevinProtocol::LevinProtocol(System::TcpConnection& connection)
   : m_conn(connection) {}
 
 void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
+  uint8_t header[HEADER_SIZE];
+  makeMessageHeader(command, out.size(), needResponse, header);
+
+  // write header and body in one operation
+  System::TcpConnection::Buffer buffers[] = { { header, HEADER_SIZE }, { out.data(), out.size() } };
+  writeBuffers(buffers, 2);
+}
+
+void LevinProtocol::makeMessageHeader(uint32_t command, size_t size, bool needResponse, uint8_t* header) {
   bucket_head2 head = { 0 };
   head.m_signature = LEVIN_SIGNATURE;
-  head.m_cb = out.size();
+  head.m_cb = size;
   head.m_have_to_return_data = needResponse;
   head.m_command = command;
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  memcpy(header, &head, sizeof(head));
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -92,30 +99,28 @@ bool LevinProtocol::readCommand(Command& cmd) {
 }
 
 void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode) {
+  uint8_t header[HEADER_SIZE];
+  makeReplyHeader(command, out.size(), returnCode, header);
+
+  System::TcpConnection::Buffer buffers[] = { { header, HEADER_SIZE }, { out.data(), out.size() } };
+  writeBuffers(buffers, 2);
+}
+
+void LevinProtocol::makeReplyHeader(uint32_t command, size_t size, int32_t returnCode, uint8_t* header) {
   bucket_head2 head = { 0 };
   head.m_signature = LEVIN_SIGNATURE;
-  head.m_cb = out.size();
+  head.m_cb = size;
   head.m_have_to_return_data = false;
   head.m_command = command;
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  memcpy(header, &head, sizeof(head));
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
-  size_t offset = 0;
-  while (offset < size) {
-    offset += m_conn.write(ptr + offset, size - offset);
-  }
+void LevinProtocol::writeBuffers(const System::TcpConnection::Buffer* buffers, size_t count) {
+  System::writeAll(m_conn, buffers, count);
 }
 
 bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
@@ -8,12 +8,10 @@
 #include "CryptoNote.h"
 #include <Common/MemoryInputStream.h>
 #include <Common/VectorOutputStream.h>
+#include "Serialization/KVBinaryInputBufferSerializer.h"
 #include "Serialization/KVBinaryInputStreamSerializer.h"
 #include "Serialization/KVBinaryOutputStreamSerializer.h"
-
-namespace System {
-class TcpConnection;
-}
+#include "System/TcpConnection.h"
 
 namespace CryptoNote {
 
@@ -33,6 +31,9 @@ const int32_t LEVIN_PROTOCOL_RETCODE_SUCCESS = 1;
 class LevinProtocol {
 public:
 
+  // size of the header written before every message body
+  static const size_t HEADER_SIZE = 33;
+
   LevinProtocol(System::TcpConnection& connection);
 
   template <typename Request, typename Response>
@@ -68,11 +69,17 @@ public:
   void sendMessage(uint32_t command, const BinaryArray& out, bool needResponse);
   void sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
 
+  // fill HEADER_SIZE bytes at header for a body of the given size, the body is written after it by the caller
+  static void makeMessageHeader(uint32_t command, size_t size, bool needResponse, uint8_t* header);
+  static void makeReplyHeader(uint32_t command, size_t size, int32_t returnCode, uint8_t* header);
+
+  // writes all buffers without copying them
+  void writeBuffers(const System::TcpConnection::Buffer* buffers, size_t count);
+
   template <typename T>
   static bool decode(const BinaryArray& buf, T& value) {
     try {
-      Common::MemoryInputStream stream(buf.data(), buf.size());
-      KVBinaryInputStreamSerializer serializer(stream);
+      KVBinaryInputBufferSerializer serializer(buf.data(), buf.size());
       serialize(value, serializer);
     } catch (std::exception&) {
       return false;
@@ -94,7 +101,6 @@ public:
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
-  void writeStrict(const uint8_t* ptr, size_t size);
   System::TcpConnection& m_conn;
 };
 
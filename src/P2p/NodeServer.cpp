@@ -1269,12 +1269,13 @@ std::string NodeServer::print_peerlist_to_string(const std::list<PeerlistEntry>&
 void NodeServer::relay_notify_to_all(int command, const BinaryArray& buffer, const net_connection_id* excludeConnection)
 {
   net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+  std::shared_ptr<const BinaryArray> sharedBuffer = std::make_shared<BinaryArray>(buffer);
 
   forEachConnection([&](P2pConnectionContext& context) {
     if (context.peerId && context.m_connection_id != excludeId &&
         (context.m_state == CryptoNoteConnectionContext::state_normal ||
          context.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-      context.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, buffer));
+      context.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, sharedBuffer));
     }
   });
 }
@@ -1310,7 +1311,7 @@ bool NodeServer::timedSync()
 {
   COMMAND_TIMED_SYNC::request request = boost::value_initialized<COMMAND_TIMED_SYNC::request>();
   m_payload_handler.get_payload_sync_data(request.payload_data);
-  BinaryArray commandBuffer = LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(request);
+  std::shared_ptr<const BinaryArray> commandBuffer = std::make_shared<BinaryArray>(LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(request));
 
   forEachConnection([&](P2pConnectionContext& conn) {
     if (conn.peerId && 
@@ -1507,22 +1508,34 @@ void NodeServer::writeHandler(P2pConnectionContext& context)
         break;
       }
 
-      for (const P2pMessage& message : messages) {
+      // only the headers are built here, the message buffers are written as they are
+      std::vector<uint8_t> headers(messages.size() * LevinProtocol::HEADER_SIZE);
+      std::vector<System::TcpConnection::Buffer> buffers;
+      buffers.reserve(messages.size() * 2);
+
+      for (size_t i = 0; i < messages.size(); ++i) {
+        const P2pMessage& message = messages[i];
+        uint8_t* header = headers.data() + i * LevinProtocol::HEADER_SIZE;
         logger(Logging::DEBUGGING) << context << "message " << message.type << ':' << message.command;
         switch (message.type) {
         case P2pMessage::COMMAND:
-          protocol.sendMessage(message.command, message.buffer, true);
+          LevinProtocol::makeMessageHeader(message.command, message.buffer->size(), true, header);
           break;
         case P2pMessage::NOTIFY:
-          protocol.sendMessage(message.command, message.buffer, false);
+          LevinProtocol::makeMessageHeader(message.command, message.buffer->size(), false, header);
           break;
         case P2pMessage::REPLY:
-          protocol.sendReply(message.command, message.buffer, message.returnCode);
+          LevinProtocol::makeReplyHeader(message.command, message.buffer->size(), message.returnCode, header);
           break;
         default:
           assert(false);
         }
+
+        buffers.push_back({ header, LevinProtocol::HEADER_SIZE });
+        buffers.push_back({ message.buffer->data(), message.buffer->size() });
       }
+
+      protocol.writeBuffers(buffers.data(), buffers.size());
     }
   } catch (System::InterruptedException&) {
     // connection stopped
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <chrono>
+#include <memory>
 #include "CryptoNote.h"
 #include "../CryptoNoteConfig.h"
 #include "ConnectionContext.h"
@@ -28,6 +29,15 @@ struct P2pMessage {
   };
 
   P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
+    type(type), command(command), buffer(std::make_shared<BinaryArray>(buffer)), returnCode(returnCode) {
+  }
+
+  P2pMessage(Type type, uint32_t command, BinaryArray&& buffer, int32_t returnCode = 0) :
+    type(type), command(command), buffer(std::make_shared<BinaryArray>(std::move(buffer))), returnCode(returnCode) {
+  }
+
+  // the buffer is not copied, the same message can be queued on many connections
+  P2pMessage(Type type, uint32_t command, const std::shared_ptr<const BinaryArray>& buffer, int32_t returnCode = 0) :
     type(type), command(command), buffer(buffer), returnCode(returnCode) {
   }
 
@@ -36,12 +46,12 @@ struct P2pMessage {
   }
 
   size_t size() {
-    return buffer.size();
+    return buffer->size();
   }
 
   Type type;
   uint32_t command;
-  const BinaryArray buffer;
+  std::shared_ptr<const BinaryArray> buffer;
   int32_t returnCode;
 };
 
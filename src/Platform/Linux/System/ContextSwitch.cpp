@@ -0,0 +1,201 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ContextSwitch.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+
+// Saved context, from the stack pointer up: mxcsr and x87 control word, padding, r15, r14, r13, r12, rbx, rbp, return address.
+// A new context starts in System_contextEntry with the procedure in r12 and its argument in r13.
+extern "C" void System_switchContext(void** from, void* to);
+extern "C" void System_contextEntry();
+
+__asm__(
+  ".text\n"
+  ".globl System_switchContext\n"
+  ".hidden System_switchContext\n"
+  ".type System_switchContext, @function\n"
+  "System_switchContext:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $16, %rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $16, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size System_switchContext, .-System_switchContext\n"
+  ".globl System_contextEntry\n"
+  ".hidden System_contextEntry\n"
+  ".type System_contextEntry, @function\n"
+  "System_contextEntry:\n"
+  "  .cfi_startproc\n"
+  "  .cfi_undefined rip\n"
+  "  movq %r13, %rdi\n"
+  "  callq *%r12\n"
+  "  ud2\n"
+  "  .cfi_endproc\n"
+  ".size System_contextEntry, .-System_contextEntry\n"
+);
+
+namespace System {
+
+void* makeContext(void* stack, size_t stackSize, void (*procedure)(void*), void* argument) {
+  // the stack pointer is 16 byte aligned after the return to System_contextEntry
+  uintptr_t top = (reinterpret_cast<uintptr_t>(stack) + stackSize) & ~static_cast<uintptr_t>(15);
+  uint64_t* frame = reinterpret_cast<uint64_t*>(top - 88);
+  memset(frame, 0, 88);
+  frame[0] = 0x1f80 | (static_cast<uint64_t>(0x037f) << 32); // default mxcsr and x87 control word
+  frame[4] = reinterpret_cast<uint64_t>(argument);
+  frame[5] = reinterpret_cast<uint64_t>(procedure);
+  frame[8] = reinterpret_cast<uint64_t>(&System_contextEntry);
+  return frame;
+}
+
+void switchContext(void** from, void* to) {
+  System_switchContext(from, to);
+}
+
+}
+
+#elif defined(__aarch64__)
+
+// Saved context, from the stack pointer up: x19 to x28, x29, x30, d8 to d15.
+// A new context starts in System_contextEntry with the procedure in x19 and its argument in x20.
+extern "C" void System_switchContext(void** from, void* to);
+extern "C" void System_contextEntry();
+
+__asm__(
+  ".text\n"
+  ".globl System_switchContext\n"
+  ".hidden System_switchContext\n"
+  ".type System_switchContext, %function\n"
+  "System_switchContext:\n"
+  "  sub sp, sp, #160\n"
+  "  stp x19, x20, [sp, #0]\n"
+  "  stp x21, x22, [sp, #16]\n"
+  "  stp x23, x24, [sp, #32]\n"
+  "  stp x25, x26, [sp, #48]\n"
+  "  stp x27, x28, [sp, #64]\n"
+  "  stp x29, x30, [sp, #80]\n"
+  "  stp d8, d9, [sp, #96]\n"
+  "  stp d10, d11, [sp, #112]\n"
+  "  stp d12, d13, [sp, #128]\n"
+  "  stp d14, d15, [sp, #144]\n"
+  "  mov x2, sp\n"
+  "  str x2, [x0]\n"
+  "  mov sp, x1\n"
+  "  ldp x19, x20, [sp, #0]\n"
+  "  ldp x21, x22, [sp, #16]\n"
+  "  ldp x23, x24, [sp, #32]\n"
+  "  ldp x25, x26, [sp, #48]\n"
+  "  ldp x27, x28, [sp, #64]\n"
+  "  ldp x29, x30, [sp, #80]\n"
+  "  ldp d8, d9, [sp, #96]\n"
+  "  ldp d10, d11, [sp, #112]\n"
+  "  ldp d12, d13, [sp, #128]\n"
+  "  ldp d14, d15, [sp, #144]\n"
+  "  add sp, sp, #160\n"
+  "  ret\n"
+  ".size System_switchContext, .-System_switchContext\n"
+  ".globl System_contextEntry\n"
+  ".hidden System_contextEntry\n"
+  ".type System_contextEntry, %function\n"
+  "System_contextEntry:\n"
+  "  .cfi_startproc\n"
+  "  .cfi_undefined x30\n"
+  "  mov x0, x20\n"
+  "  blr x19\n"
+  "  brk #0\n"
+  "  .cfi_endproc\n"
+  ".size System_contextEntry, .-System_contextEntry\n"
+);
+
+namespace System {
+
+void* makeContext(void* stack, size_t stackSize, void (*procedure)(void*), void* argument) {
+  uintptr_t top = (reinterpret_cast<uintptr_t>(stack) + stackSize) & ~static_cast<uintptr_t>(15);
+  uint64_t* frame = reinterpret_cast<uint64_t*>(top - 160);
+  memset(frame, 0, 160);
+  frame[0] = reinterpret_cast<uint64_t>(procedure);
+  frame[1] = reinterpret_cast<uint64_t>(argument);
+  frame[11] = reinterpret_cast<uint64_t>(&System_contextEntry);
+  return frame;
+}
+
+void switchContext(void** from, void* to) {
+  System_switchContext(from, to);
+}
+
+}
+
+#else
+
+#include <ucontext.h>
+#include "ErrorMessage.h"
+
+namespace System {
+
+namespace {
+
+struct ContextStart {
+  void (*procedure)(void*);
+  void* argument;
+};
+
+// makecontext() passes int arguments only
+void contextStart(unsigned int high, unsigned int low) {
+  ContextStart* start = reinterpret_cast<ContextStart*>(static_cast<uintptr_t>((static_cast<uint64_t>(high) << 32) | low));
+  start->procedure(start->argument);
+}
+
+}
+
+void* makeContext(void* stack, size_t stackSize, void (*procedure)(void*), void* argument) {
+  // the ucontext and the start data are kept at the top of the stack
+  uintptr_t top = reinterpret_cast<uintptr_t>(stack) + stackSize;
+  ucontext_t* context = reinterpret_cast<ucontext_t*>((top - sizeof(ucontext_t)) & ~static_cast<uintptr_t>(15));
+  ContextStart* start = reinterpret_cast<ContextStart*>((reinterpret_cast<uintptr_t>(context) - sizeof(ContextStart)) & ~static_cast<uintptr_t>(15));
+  if (getcontext(context) == -1) {
+    throw std::runtime_error("makeContext, getcontext failed, " + lastErrorMessage());
+  }
+
+  start->procedure = procedure;
+  start->argument = argument;
+  context->uc_stack.ss_sp = stack;
+  context->uc_stack.ss_size = reinterpret_cast<uintptr_t>(start) - reinterpret_cast<uintptr_t>(stack);
+  context->uc_link = nullptr;
+  uint64_t startValue = reinterpret_cast<uintptr_t>(start);
+  makecontext(context, reinterpret_cast<void(*)()>(contextStart), 2, static_cast<unsigned int>(startValue >> 32), static_cast<unsigned int>(startValue));
+  return context;
+}
+
+void switchContext(void** from, void* to) {
+  // the suspended context is saved on its own stack
+  ucontext_t context;
+  *from = &context;
+  if (swapcontext(&context, static_cast<ucontext_t*>(to)) == -1) {
+    throw std::runtime_error("switchContext, swapcontext failed, " + lastErrorMessage());
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,22 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+
+namespace System {
+
+// A suspended context is the stack pointer at which switchContext() saved it.
+// On x86-64 and aarch64 only the registers a function call must preserve are saved, there are no system calls,
+// on other architectures ucontext is used.
+
+// Prepares the stack [stack, stack + stackSize) so that the first switch to the returned context calls procedure(argument),
+// procedure must never return.
+void* makeContext(void* stack, size_t stackSize, void (*procedure)(void*), void* argument);
+
+// Saves the current context in *from and continues with to.
+void switchContext(void** from, void* to);
+
+}
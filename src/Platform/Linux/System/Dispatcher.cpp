@@ -8,22 +8,18 @@
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/timerfd.h>
 #include <fcntl.h>
 #include <string.h>
-#include <ucontext.h>
 #include <unistd.h>
+#include "ContextSwitch.h"
 #include "ErrorMessage.h"
 
 namespace System {
 
 namespace {
 
-struct ContextMakingData {
-  Dispatcher* dispatcher;
-  void* ucontext;
-};
-
 class MutextGuard {
 public:
   MutextGuard(pthread_mutex_t& _mutex) : mutex(_mutex) {
@@ -45,6 +41,15 @@ static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "in
 
 const size_t STACK_SIZE = 64 * 1024;
 
+// events taken from epoll by one call
+const int MAX_EVENTS = 64;
+
+// a stack is mapped with a guard page below it, a stack overflow faults instead of overwriting other memory
+size_t getGuardSize() {
+  static const size_t guardSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return guardSize;
+}
+
 };
 
 Dispatcher::Dispatcher() {
@@ -53,44 +58,40 @@ Dispatcher::Dispatcher() {
   if (epoll == -1) {
     message = "epoll_create1 failed, " + lastErrorMessage();
   } else {
-    mainContext.ucontext = new ucontext_t;
-    if (getcontext(reinterpret_cast<ucontext_t*>(mainContext.ucontext)) == -1) {
-      message = "getcontext failed, " + lastErrorMessage();
+    mainContext.machineContext = nullptr;
+    remoteSpawnEvent = eventfd(0, O_NONBLOCK);
+    if(remoteSpawnEvent == -1) {
+      message = "eventfd failed, " + lastErrorMessage();
     } else {
-      remoteSpawnEvent = eventfd(0, O_NONBLOCK);
-      if(remoteSpawnEvent == -1) {
-        message = "eventfd failed, " + lastErrorMessage();
-      } else {
-        remoteSpawnEventContext.writeContext = nullptr;
-        remoteSpawnEventContext.readContext = nullptr;
+      remoteSpawnEventContext.writeContext = nullptr;
+      remoteSpawnEventContext.readContext = nullptr;
 
-        epoll_event remoteSpawnEventEpollEvent;
-        remoteSpawnEventEpollEvent.events = EPOLLIN;
-        remoteSpawnEventEpollEvent.data.ptr = &remoteSpawnEventContext;
+      epoll_event remoteSpawnEventEpollEvent;
+      remoteSpawnEventEpollEvent.events = EPOLLIN;
+      remoteSpawnEventEpollEvent.data.ptr = &remoteSpawnEventContext;
 
-        if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
-          message = "epoll_ctl failed, " + lastErrorMessage();
-        } else {
-          *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
-
-          mainContext.interrupted = false;
-          mainContext.group = &contextGroup;
-          mainContext.groupPrev = nullptr;
-          mainContext.groupNext = nullptr;
-          contextGroup.firstContext = nullptr;
-          contextGroup.lastContext = nullptr;
-          contextGroup.firstWaiter = nullptr;
-          contextGroup.lastWaiter = nullptr;
-          currentContext = &mainContext;
-          firstResumingContext = nullptr;
-          firstReusableContext = nullptr;
-          runningContextCount = 0;
-          return;
-        }
-
-        auto result = close(remoteSpawnEvent);
-        assert(result == 0);
+      if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
+        message = "epoll_ctl failed, " + lastErrorMessage();
+      } else {
+        *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
+
+        mainContext.interrupted = false;
+        mainContext.group = &contextGroup;
+        mainContext.groupPrev = nullptr;
+        mainContext.groupNext = nullptr;
+        contextGroup.firstContext = nullptr;
+        contextGroup.lastContext = nullptr;
+        contextGroup.firstWaiter = nullptr;
+        contextGroup.lastWaiter = nullptr;
+        currentContext = &mainContext;
+        firstResumingContext = nullptr;
+        firstReusableContext = nullptr;
+        runningContextCount = 0;
+        return;
       }
+
+      auto result = close(remoteSpawnEvent);
+      assert(result == 0);
     }
 
     auto result = close(epoll);
@@ -111,11 +112,9 @@ Dispatcher::~Dispatcher() {
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    void* stackPtr = firstReusableContext->stackPtr;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
+    munmap(stackPtr, getGuardSize() + STACK_SIZE);
   }
 
   while (!timers.empty()) {
@@ -134,11 +133,9 @@ Dispatcher::~Dispatcher() {
 
 void Dispatcher::clear() {
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    void* stackPtr = firstReusableContext->stackPtr;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
+    munmap(stackPtr, getGuardSize() + STACK_SIZE);
   }
 
   while (!timers.empty()) {
@@ -160,51 +157,23 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
-
-        continue;
-      }
-
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
-        continue;
-      }
-
-      assert(context != nullptr);
-      break;
+    // every ready event is taken at once and the contexts waiting for them are queued to resume
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll, events, MAX_EVENTS, -1);
+    if (count > 0) {
+      resumeEventContexts(events, count);
+      continue;
     }
 
-    if (errno != EINTR) {
+    if (count == -1 && errno != EINTR) {
       throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, "  + lastErrorMessage());
     }
   }
 
   if (context != currentContext) {
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
+    NativeContext* oldContext = currentContext;
     currentContext = context;
-    if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
-      throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
-    }
+    switchContext(&oldContext->machineContext, context->machineContext);
   }
 }
 
@@ -262,6 +231,43 @@ void Dispatcher::remoteSpawn(std::function<void()>&& procedure) {
   }
 }
 
+// the contexts are resumed in the order of the events, a context that is resumed cannot be interrupted by its interrupt procedure
+// any more, its operation completed
+void Dispatcher::resumeEventContexts(const epoll_event* events, int count) {
+  for (int i = 0; i < count; ++i) {
+    ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
+    if (((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
+      uint64_t buf;
+      auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+      if (transferred == -1) {
+        throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+      }
+
+      MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+      while (!remoteSpawningProcedures.empty()) {
+        spawn(std::move(remoteSpawningProcedures.front()));
+        remoteSpawningProcedures.pop();
+      }
+
+      continue;
+    }
+
+    OperationContext* operationContext;
+    if ((events[i].events & EPOLLOUT) != 0) {
+      operationContext = contextPair->writeContext;
+    } else if ((events[i].events & EPOLLIN) != 0) {
+      operationContext = contextPair->readContext;
+    } else {
+      continue;
+    }
+
+    assert(operationContext != nullptr && operationContext->context != nullptr);
+    operationContext->context->interruptProcedure = nullptr;
+    operationContext->events = events[i].events;
+    pushContext(operationContext->context);
+  }
+}
+
 void Dispatcher::spawn(std::function<void()>&& procedure) {
   NativeContext* context = &getReusableContext();
   if(contextGroup.firstContext != nullptr) {
@@ -284,51 +290,14 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
 
 void Dispatcher::yield() {
   for(;;){
-    epoll_event events[16];
-    int count = epoll_wait(epoll, events, 16, 0);
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll, events, MAX_EVENTS, 0);
     if (count == 0) {
       break;
     }
 
     if(count > 0) {
-      for(int i = 0; i < count; ++i) {
-        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          if(contextPair->writeContext != nullptr) {
-            if(contextPair->writeContext->context != nullptr) {
-              contextPair->writeContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          if(contextPair->readContext != nullptr) {
-            if(contextPair->readContext->context != nullptr) {
-              contextPair->readContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else {
-          continue;
-        }
-      }
+      resumeEventContexts(events, count);
     } else {
       if (errno != EINTR) {
         throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, " + lastErrorMessage());
@@ -348,25 +317,22 @@ int Dispatcher::getEpoll() const {
 
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
-    ucontext_t* newlyCreatedContext = new ucontext_t;
-    if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
-      throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
+    size_t guardSize = getGuardSize();
+    void* stackPointer = mmap(nullptr, guardSize + STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stackPointer == MAP_FAILED) {
+      throw std::runtime_error("Dispatcher::getReusableContext, mmap failed, " + lastErrorMessage());
     }
 
-    auto stackPointer = new uint8_t[STACK_SIZE];
-    newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
-
-    ContextMakingData makingContextData {this, newlyCreatedContext};
-    makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
-
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
-    if (swapcontext(oldContext, newlyCreatedContext) == -1) {
-      throw std::runtime_error("Dispatcher::getReusableContext, swapcontext failed, " + lastErrorMessage());
+    if (mprotect(stackPointer, guardSize, PROT_NONE) == -1) {
+      std::string message = "Dispatcher::getReusableContext, mprotect failed, " + lastErrorMessage();
+      munmap(stackPointer, guardSize + STACK_SIZE);
+      throw std::runtime_error(message);
     }
 
+    void* newlyCreatedContext = makeContext(static_cast<uint8_t*>(stackPointer) + guardSize, STACK_SIZE, contextProcedureStatic, this);
+    switchContext(&currentContext->machineContext, newlyCreatedContext);
+
     assert(firstReusableContext != nullptr);
-    assert(firstReusableContext->ucontext == newlyCreatedContext);
     firstReusableContext->stackPtr = stackPointer;
   };
 
@@ -404,17 +370,14 @@ void Dispatcher::pushTimer(int timer) {
   timers.push(timer);
 }
 
-void Dispatcher::contextProcedure(void* ucontext) {
+void Dispatcher::contextProcedure() {
   assert(firstReusableContext == nullptr);
   NativeContext context;
-  context.ucontext = ucontext;
+  context.machineContext = nullptr;
   context.interrupted = false;
   context.next = nullptr;
   firstReusableContext = &context;
-  ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
-  if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
-    throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
-  }
+  switchContext(&context.machineContext, currentContext->machineContext);
 
   for (;;) {
     ++runningContextCount;
@@ -464,8 +427,7 @@ void Dispatcher::contextProcedure(void* ucontext) {
 };
 
 void Dispatcher::contextProcedureStatic(void *context) {
-  ContextMakingData* makingContextData = reinterpret_cast<ContextMakingData*>(context);
-  makingContextData->dispatcher->contextProcedure(makingContextData->ucontext);
+  static_cast<Dispatcher*>(context)->contextProcedure();
 }
 
 }
@@ -10,12 +10,14 @@
 #include <queue>
 #include <stack>
 
+struct epoll_event;
+
 namespace System {
 
 struct NativeContextGroup;
 
 struct NativeContext {
-  void* ucontext;
+  void* machineContext; // saved by switchContext()
   void* stackPtr;
   bool interrupted;
   NativeContext* next;
@@ -78,6 +80,7 @@ public:
 #endif
 
 private:
+  void resumeEventContexts(const epoll_event* events, int count);
   void spawn(std::function<void()>&& procedure);
   int epoll;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
@@ -94,7 +97,7 @@ private:
   NativeContext* firstReusableContext;
   size_t runningContextCount;
 
-  void contextProcedure(void* ucontext);
+  void contextProcedure();
   static void contextProcedureStatic(void* context);
 };
 
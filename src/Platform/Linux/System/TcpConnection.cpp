@@ -5,9 +5,12 @@
 
 #include "TcpConnection.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cassert>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <System/ErrorMessage.h>
@@ -16,6 +19,13 @@
 
 namespace System {
 
+namespace {
+
+// buffers passed to a single sendmsg call, the rest are left for the next write
+const size_t MAX_WRITE_BUFFERS = 64;
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -154,7 +164,6 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  std::string message;
   if(size == 0) {
     if(shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -163,7 +172,31 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
+  Buffer buffer = { data, size };
+  return writeBuffers(&buffer, 1);
+}
+
+std::size_t TcpConnection::writeBuffers(const Buffer* buffers, std::size_t count) {
+  assert(dispatcher != nullptr);
+  assert(contextPair.writeContext == nullptr);
+  assert(count > 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec vectors[MAX_WRITE_BUFFERS];
+  msghdr header = {};
+  header.msg_iov = vectors;
+  header.msg_iovlen = std::min(count, MAX_WRITE_BUFFERS);
+  size_t size = 0;
+  for (size_t i = 0; i < header.msg_iovlen; ++i) {
+    vectors[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+    vectors[i].iov_len = buffers[i].size;
+    size += buffers[i].size;
+  }
+
+  std::string message;
+  ssize_t transferred = ::sendmsg(connection, &header, MSG_NOSIGNAL);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "send failed, " + lastErrorMessage();
@@ -226,7 +259,7 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &header, MSG_NOSIGNAL);
         if (transferred == -1) {
           message = "send failed, "  + lastErrorMessage();
         } else {
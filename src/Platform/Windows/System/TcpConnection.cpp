@@ -4,10 +4,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "TcpConnection.h"
+#include <algorithm>
 #include <cassert>
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <winsock2.h>
 #include <ws2ipdef.h>
 #include <System/InterruptedException.h>
@@ -19,6 +23,9 @@ namespace System {
 
 namespace {
 
+// buffers passed to a single WSASend call, the rest are left for the next write
+const size_t MAX_WRITE_BUFFERS = 64;
+
 struct TcpConnectionContext : public OVERLAPPED {
   NativeContext* context;
   bool interrupted;
@@ -148,10 +155,30 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  Buffer buffer = { data, size };
+  return writeBuffers(&buffer, 1);
+}
+
+size_t TcpConnection::writeBuffers(const Buffer* buffers, size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  assert(count > 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  WSABUF bufs[MAX_WRITE_BUFFERS];
+  DWORD bufCount = static_cast<DWORD>(std::min(count, MAX_WRITE_BUFFERS));
+  size_t size = 0;
+  for (DWORD i = 0; i < bufCount; ++i) {
+    bufs[i].len = static_cast<ULONG>(buffers[i].size);
+    bufs[i].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(buffers[i].data));
+    size += buffers[i].size;
+  }
+
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, bufs, bufCount, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
@@ -17,7 +17,9 @@ class TcpConnection;
 class TcpListener {
 public:
   TcpListener();
-  TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port);
+  // with reusePort several listeners, usually of different dispatchers, can listen on the same address and port
+  // and the system spreads incoming connections between them
+  TcpListener(Dispatcher& dispatcher, const Ipv4Address& address, uint16_t port, bool reusePort = false);
   TcpListener(const TcpListener&) = delete;
   TcpListener(TcpListener&& other);
   ~TcpListener();
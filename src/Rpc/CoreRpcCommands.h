@@ -486,6 +486,8 @@ struct CORE_RPC_COMMAND_GET_INFO {
   typedef EMPTY_STRUCT request;
 
   struct response {
+    uint64_t block_cache_hits;
+    uint64_t block_cache_misses;
     std::string circulating_supply;
     uint64_t connections_count;
     uint64_t difficulty;
@@ -502,6 +504,8 @@ struct CORE_RPC_COMMAND_GET_INFO {
     uint64_t white_peerlist_size;
 
     void serialize(ISerializer &s) {
+      KV_MEMBER(block_cache_hits)
+      KV_MEMBER(block_cache_misses)
       KV_MEMBER(circulating_supply)
       KV_MEMBER(connections_count)
       KV_MEMBER(difficulty)
@@ -947,4 +951,48 @@ struct CORE_RPC_COMMAND_VALIDATE_ADDRESS {
 	};
 };
 
+// Waits until the blockchain, the pool, the observed height or the peer count of the daemon differs from the request, or
+// until timeout milliseconds passed, then returns them. The pool changes are relative to known_txs_ids.
+struct CORE_RPC_COMMAND_WAIT_FOR_CHANGES {
+  struct request {
+    Crypto::Hash tail_block_id;
+    std::vector<Crypto::Hash> known_txs_ids;
+    uint32_t last_known_block_index;
+    uint64_t peer_count;
+    uint32_t timeout;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tail_block_id)
+      serializeAsBinary(known_txs_ids, "known_txs_ids", s);
+      KV_MEMBER(last_known_block_index)
+      KV_MEMBER(peer_count)
+      KV_MEMBER(timeout)
+    }
+  };
+
+  struct response {
+    Crypto::Hash tail_block_id;
+    uint32_t tail_block_index;
+    uint64_t tail_block_timestamp;
+    std::vector<TransactionPrefixInfo> added_txs;
+    std::vector<Crypto::Hash> deleted_txs_ids;
+    uint32_t last_known_block_index;
+    uint64_t peer_count;
+    uint64_t transaction_fee;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tail_block_id)
+      KV_MEMBER(tail_block_index)
+      KV_MEMBER(tail_block_timestamp)
+      KV_MEMBER(added_txs)
+      serializeAsBinary(deleted_txs_ids, "deleted_txs_ids", s);
+      KV_MEMBER(last_known_block_index)
+      KV_MEMBER(peer_count)
+      KV_MEMBER(transaction_fee)
+      KV_MEMBER(status)
+    }
+  };
+};
+
 } // end namespace CryptoNote
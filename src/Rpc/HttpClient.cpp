@@ -5,10 +5,10 @@
 
 #include "HttpClient.h"
 
-#include <HTTP/HttpParser.h>
 #include <System/Ipv4Resolver.h>
 #include <System/Ipv4Address.h>
 #include <System/TcpConnector.h>
+#include <System/TcpStream.h>
 
 namespace CryptoNote {
 
@@ -28,11 +28,24 @@ void HttpClient::request(const HttpRequest &req, HttpResponse &res) {
   }
 
   try {
-    std::iostream stream(m_streamBuf.get());
-    HttpParser parser;
-    stream << req;
-    stream.flush();
-    parser.receiveResponse(stream, res);
+    std::string headerString = req.getHeaderString();
+    System::TcpConnection::Buffer buffers[] = {
+      { reinterpret_cast<const uint8_t*>(headerString.data()), headerString.size() },
+      { reinterpret_cast<const uint8_t*>(req.getBody().data()), req.getBody().size() }
+    };
+
+    System::writeAll(m_connection, buffers, 2);
+
+    while (!m_parser.parseResponse(res)) {
+      size_t size;
+      uint8_t* buffer = m_parser.getReceiveBuffer(size);
+      size_t received = m_connection.read(buffer, size);
+      if (received == 0) {
+        throw std::runtime_error("Connection closed by the server");
+      }
+
+      m_parser.received(received);
+    }
   } catch (const std::exception &) {
     disconnect();
     throw;
@@ -43,7 +56,7 @@ void HttpClient::connect() {
   try {
     auto ipAddr = System::Ipv4Resolver(m_dispatcher).resolve(m_address);
     m_connection = System::TcpConnector(m_dispatcher).connect(ipAddr, m_port);
-    m_streamBuf.reset(new System::TcpStreambuf(m_connection));
+    m_parser = HttpParser();
     m_connected = true;
   } catch (const std::exception& e) {
     throw ConnectException(e.what());
@@ -55,7 +68,6 @@ bool HttpClient::isConnected() const {
 }
 
 void HttpClient::disconnect() {
-  m_streamBuf.reset();
   try {
     m_connection.write(nullptr, 0); //Socket shutdown.
   } catch (std::exception&) {
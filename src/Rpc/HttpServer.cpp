@@ -8,37 +8,95 @@
 #include <boost/scope_exit.hpp>
 
 #include <HTTP/HttpParser.h>
+#include <System/DispatcherCall.h>
 #include <System/InterruptedException.h>
-#include <System/TcpStream.h>
 #include <System/Ipv4Address.h>
+#include <System/TcpStream.h>
 
 using namespace Logging;
 
+namespace {
+
+// responses to pipelined requests are sent once this many are ready or their bodies reach this size
+const size_t MAX_PIPELINED_RESPONSES = 64;
+const size_t MAX_PIPELINED_BODY_SIZE = 1024 * 1024;
+
+}
+
 namespace CryptoNote {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer"), m_runningWorkers(0), m_workersStopped(dispatcher) {
 
 }
 
-void HttpServer::start(const std::string& address, uint16_t port) {
-  m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
-  workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+void HttpServer::start(const std::string& address, uint16_t port, size_t threadCount) {
+  if (threadCount <= 1) {
+    m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
+    workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this, std::ref(m_dispatcher), std::ref(m_listener), std::ref(workingContextGroup)));
+    return;
+  }
+
+  // every worker listens on the same port and the system spreads the connections between them
+  m_workersStopped.clear();
+  for (size_t i = 0; i < threadCount; ++i) {
+    std::unique_ptr<Worker> worker(new Worker());
+    std::promise<void> started;
+    std::future<void> startedFuture = started.get_future();
+    ++m_runningWorkers;
+    worker->thread = std::thread(&HttpServer::workerProcedure, this, std::ref(*worker), address, port, std::ref(started));
+    m_workers.push_back(std::move(worker));
+
+    try {
+      startedFuture.get();
+    } catch (std::exception&) {
+      stop();
+      throw;
+    }
+  }
 }
 
 void HttpServer::stop() {
   workingContextGroup.interrupt();
   workingContextGroup.wait();
+
+  if (m_workers.empty()) {
+    return;
+  }
+
+  {
+    // a worker that has already exited has cleared its pointers
+    std::lock_guard<std::mutex> lock(m_workersMutex);
+    for (const std::unique_ptr<Worker>& worker : m_workers) {
+      if (worker->stopEvent != nullptr) {
+        System::Event* stopEvent = worker->stopEvent;
+        worker->dispatcher->remoteSpawn([=] { stopEvent->set(); });
+      }
+    }
+  }
+
+  // the workers can still be waiting for requests processed on this dispatcher
+  m_workersStopped.wait();
+
+  for (const std::unique_ptr<Worker>& worker : m_workers) {
+    worker->thread.join();
+  }
+
+  m_workers.clear();
+}
+
+void HttpServer::serveRequest(System::Dispatcher& dispatcher, const HttpRequest& request, HttpResponse& response) {
+  System::callInDispatcher<void>(dispatcher, m_dispatcher, [&] { processRequest(request, response); });
 }
 
-void HttpServer::acceptLoop() {
+void HttpServer::acceptLoop(System::Dispatcher& dispatcher, System::TcpListener& listener, System::ContextGroup& contextGroup) {
   try {
     System::TcpConnection connection;
     bool accepted = false;
 
     while (!accepted) {
       try {
-        connection = m_listener.accept();
+        connection = listener.accept();
         accepted = true;
       } catch (System::InterruptedException&) {
         throw;
@@ -47,11 +105,16 @@ void HttpServer::acceptLoop() {
       }
     }
 
-    m_connections.insert(&connection);
+    {
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
+      m_connections.insert(&connection);
+    }
+
     BOOST_SCOPE_EXIT_ALL(this, &connection) { 
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
       m_connections.erase(&connection); };
 
-    workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+    contextGroup.spawn(std::bind(&HttpServer::acceptLoop, this, std::ref(dispatcher), std::ref(listener), std::ref(contextGroup)));
 
     //auto addr = connection.getPeerAddressAndPort();
     auto addr = std::pair<System::Ipv4Address, uint16_t>(static_cast<System::Ipv4Address>(0), 0);
@@ -63,28 +126,57 @@ void HttpServer::acceptLoop() {
 
     logger(DEBUGGING) << "Incoming connection from " << addr.first.toDottedDecimal() << ":" << addr.second;
 
-    System::TcpStreambuf streambuf(connection);
-    std::iostream stream(&streambuf);
     HttpParser parser;
+    std::vector<HttpResponse> responses;
+    size_t responsesBodySize = 0;
 
     for (;;) {
+      // responses to pipelined requests are sent together once no more requests are received or the batch is full
       HttpRequest req;
-      HttpResponse resp;
-      resp.addHeader("Access-Control-Allow-Origin", "*");
-      resp.addHeader("content-type", "application/json");
-
-      parser.receiveRequest(stream, req);
-      processRequest(req, resp);
-
-      stream << resp;
-      stream.flush();
+      bool closed = false;
+      while (!parser.parseRequest(req)) {
+        if (!responses.empty()) {
+          writeResponses(connection, responses);
+          responses.clear();
+          responsesBodySize = 0;
+        }
+
+        size_t size;
+        uint8_t* buffer = parser.getReceiveBuffer(size);
+        size_t received = connection.read(buffer, size);
+        if (received == 0) {
+          closed = true;
+          break;
+        }
+
+        parser.received(received);
+      }
 
-      if (stream.peek() == std::iostream::traits_type::eof()) {
+      if (closed) {
         break;
       }
+
+      HttpResponse resp;
+      resp.addHeader("Access-Control-Allow-Origin", "*");
+      resp.addHeader("Content-Type", "application/json");
+
+      serveRequest(dispatcher, req, resp);
+      responsesBodySize += resp.getBody().size();
+      responses.push_back(std::move(resp));
+      if (responses.size() >= MAX_PIPELINED_RESPONSES || responsesBodySize >= MAX_PIPELINED_BODY_SIZE) {
+        writeResponses(connection, responses);
+        responses.clear();
+        responsesBodySize = 0;
+      }
+    }
+
+    size_t connectionsCount;
+    {
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
+      connectionsCount = m_connections.size();
     }
 
-    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connections.size();
+    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << connectionsCount;
 
   } catch (System::InterruptedException&) {
   } catch (std::exception& e) {
@@ -92,4 +184,60 @@ void HttpServer::acceptLoop() {
   }
 }
 
+void HttpServer::workerProcedure(Worker& worker, const std::string& address, uint16_t port, std::promise<void>& started) {
+  bool isStarted = false;
+
+  try {
+    System::Dispatcher dispatcher;
+    System::Event stopEvent(dispatcher);
+    System::ContextGroup contextGroup(dispatcher);
+    System::TcpListener listener(dispatcher, System::Ipv4Address(address), port, true);
+    contextGroup.spawn(std::bind(&HttpServer::acceptLoop, this, std::ref(dispatcher), std::ref(listener), std::ref(contextGroup)));
+
+    {
+      std::lock_guard<std::mutex> lock(m_workersMutex);
+      worker.dispatcher = &dispatcher;
+      worker.stopEvent = &stopEvent;
+    }
+
+    // stop() must not use the dispatcher and the event once they are destroyed
+    BOOST_SCOPE_EXIT_ALL(this, &worker) {
+      std::lock_guard<std::mutex> lock(m_workersMutex);
+      worker.dispatcher = nullptr;
+      worker.stopEvent = nullptr;
+    };
+
+    isStarted = true;
+    started.set_value();
+
+    stopEvent.wait();
+    contextGroup.interrupt();
+    contextGroup.wait();
+  } catch (std::exception&) {
+    if (!isStarted) {
+      started.set_exception(std::current_exception());
+    } else {
+      logger(WARNING) << "HTTP server thread failed";
+    }
+  }
+
+  if (--m_runningWorkers == 0) {
+    System::Event* workersStopped = &m_workersStopped;
+    m_dispatcher.remoteSpawn([=] { workersStopped->set(); });
+  }
+}
+
+void HttpServer::writeResponses(System::TcpConnection& connection, const std::vector<HttpResponse>& responses) {
+  std::vector<std::string> headerStrings;
+  headerStrings.reserve(responses.size());
+  std::vector<System::TcpConnection::Buffer> buffers;
+  for (const HttpResponse& response : responses) {
+    headerStrings.push_back(response.getHeaderString());
+    buffers.push_back({ reinterpret_cast<const uint8_t*>(headerStrings.back().data()), headerStrings.back().size() });
+    buffers.push_back({ reinterpret_cast<const uint8_t*>(response.getBody().data()), response.getBody().size() });
+  }
+
+  System::writeAll(connection, buffers.data(), buffers.size());
+}
+
 }
@@ -5,7 +5,13 @@
 
 #pragma once 
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
@@ -26,24 +32,44 @@ public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
 
-  void start(const std::string& address, uint16_t port);
+  // with threadCount > 1 connections are accepted and served by threadCount threads with a dispatcher each,
+  // processRequest() is always executed on the dispatcher of the server
+  void start(const std::string& address, uint16_t port, size_t threadCount = 1);
   void stop();
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) = 0;
 
+  // Called on dispatcher, the dispatcher of the connection, to execute processRequest() on the dispatcher of the server.
+  // A server can override it to do the part of the work that needs nothing of its dispatcher on the thread of the connection.
+  virtual void serveRequest(System::Dispatcher& dispatcher, const HttpRequest& request, HttpResponse& response);
+
 protected:
 
   System::Dispatcher& m_dispatcher;
 
 private:
 
-  void acceptLoop();
+  // dispatcher and stopEvent are locals of the thread, set while it runs and guarded by m_workersMutex
+  struct Worker {
+    std::thread thread;
+    System::Dispatcher* dispatcher = nullptr;
+    System::Event* stopEvent = nullptr;
+  };
+
+  void acceptLoop(System::Dispatcher& dispatcher, System::TcpListener& listener, System::ContextGroup& contextGroup);
   void connectionHandler(System::TcpConnection&& conn);
+  void workerProcedure(Worker& worker, const std::string& address, uint16_t port, std::promise<void>& started);
+  void writeResponses(System::TcpConnection& connection, const std::vector<HttpResponse>& responses);
 
   System::ContextGroup workingContextGroup;
   Logging::LoggerRef logger;
   System::TcpListener m_listener;
   std::unordered_set<System::TcpConnection*> m_connections;
+  std::mutex m_connectionsMutex;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::mutex m_workersMutex;
+  std::atomic<size_t> m_runningWorkers;
+  System::Event m_workersStopped;
 };
 
 }
@@ -0,0 +1,389 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "KVBinaryInputBufferSerializer.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "KVBinaryCommon.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t MAX_NESTING_DEPTH = 100;
+
+template <typename T>
+T readPod(const char* data) {
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+size_t getPodSize(uint8_t type) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  return sizeof(int64_t);
+  case BIN_KV_SERIALIZE_TYPE_INT32:  return sizeof(int32_t);
+  case BIN_KV_SERIALIZE_TYPE_INT16:  return sizeof(int16_t);
+  case BIN_KV_SERIALIZE_TYPE_INT8:   return sizeof(int8_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT64: return sizeof(uint64_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT32: return sizeof(uint32_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT16: return sizeof(uint16_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  return sizeof(uint8_t);
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return sizeof(double);
+  case BIN_KV_SERIALIZE_TYPE_BOOL:   return sizeof(uint8_t);
+  default:                           return 0;
+  }
+}
+
+}
+
+KVBinaryInputBufferSerializer::KVBinaryInputBufferSerializer(const void* data, size_t size) :
+  m_end(static_cast<const char*>(data) + size) {
+
+  const char* position = static_cast<const char*>(data);
+  require(position, sizeof(KVBinaryStorageBlockHeader));
+  KVBinaryStorageBlockHeader header = readPod<KVBinaryStorageBlockHeader>(position);
+  position += sizeof(KVBinaryStorageBlockHeader);
+
+  if (header.m_signature_a != PORTABLE_STORAGE_SIGNATUREA || header.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
+    throw std::runtime_error("Invalid binary storage signature");
+  }
+
+  if (header.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
+    throw std::runtime_error("Unknown binary storage format version");
+  }
+
+  m_frames.push_back(Frame{ false, 0, 0, 0, nullptr });
+  scanObject(position, 1);
+}
+
+ISerializer::SerializerType KVBinaryInputBufferSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool KVBinaryInputBufferSerializer::beginObject(Common::StringView name) {
+  uint8_t type;
+  const char* data;
+  if (!getValue(name, type, data)) {
+    return false;
+  }
+
+  if (type != BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    throw std::runtime_error("Object expected");
+  }
+
+  m_frames.push_back(Frame{ false, m_entries.size(), 0, 0, nullptr });
+  scanObject(data, m_frames.size());
+  return true;
+}
+
+void KVBinaryInputBufferSerializer::endObject() {
+  assert(m_frames.size() > 1 && !m_frames.back().isArray);
+  m_entries.resize(m_frames.back().entriesBegin);
+  m_frames.pop_back();
+}
+
+bool KVBinaryInputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  if (m_frames.back().isArray) {
+    throw std::runtime_error("Nested arrays are not supported");
+  }
+
+  uint8_t type;
+  const char* data;
+  if (!getValue(name, type, data)) {
+    size = 0;
+    return false;
+  }
+
+  if ((type & BIN_KV_SERIALIZE_FLAG_ARRAY) == 0) {
+    throw std::runtime_error("Array expected");
+  }
+
+  // the items were checked against the end of the buffer when the enclosing object was scanned
+  data = readVarint(data, size);
+  m_frames.push_back(Frame{ true, 0, static_cast<uint8_t>(type & ~BIN_KV_SERIALIZE_FLAG_ARRAY), size, data });
+  return true;
+}
+
+void KVBinaryInputBufferSerializer::endArray() {
+  assert(m_frames.size() > 1 && m_frames.back().isArray);
+  m_frames.pop_back();
+}
+
+bool KVBinaryInputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputBufferSerializer::operator()(double& value, Common::StringView name) {
+  uint8_t type;
+  const char* data;
+  if (!getValue(name, type, data)) {
+    return false;
+  }
+
+  if (type == BIN_KV_SERIALIZE_TYPE_DOUBLE) {
+    value = readPod<double>(data);
+    return true;
+  }
+
+  int64_t integer;
+  if (!getInteger(type, data, integer)) {
+    throw std::runtime_error("Number expected");
+  }
+
+  value = static_cast<double>(integer);
+  return true;
+}
+
+bool KVBinaryInputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  uint8_t type;
+  const char* data;
+  if (!getValue(name, type, data)) {
+    return false;
+  }
+
+  if (type != BIN_KV_SERIALIZE_TYPE_BOOL) {
+    throw std::runtime_error("Boolean expected");
+  }
+
+  value = readPod<uint8_t>(data) != 0;
+  return true;
+}
+
+bool KVBinaryInputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  const char* data;
+  size_t size;
+  if (!getString(name, data, size)) {
+    return false;
+  }
+
+  value.assign(data, size);
+  return true;
+}
+
+bool KVBinaryInputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  const char* data;
+  size_t dataSize;
+  if (!getString(name, data, dataSize)) {
+    return false;
+  }
+
+  if (dataSize != size) {
+    throw std::runtime_error("Binary block size mismatch");
+  }
+
+  memcpy(value, data, size);
+  return true;
+}
+
+bool KVBinaryInputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  return (*this)(value, name);
+}
+
+const char* KVBinaryInputBufferSerializer::scanObject(const char* data, size_t depth) {
+  // lists the entries of the object at data in m_entries and returns the end of the object
+
+  if (depth > MAX_NESTING_DEPTH) {
+    throw std::runtime_error("Binary storage nesting is too deep");
+  }
+
+  size_t count;
+  data = readVarint(data, count);
+
+  while (count--) {
+    require(data, 1);
+    uint8_t nameSize = readPod<uint8_t>(data);
+    require(data + 1, nameSize + 1);
+    Common::StringView name(data + 1, nameSize);
+    uint8_t type = readPod<uint8_t>(data + 1 + nameSize);
+    data += 1 + nameSize + 1;
+
+    m_entries.push_back(Entry{ name, type, data });
+    data = skipValue(type, data, depth + 1);
+  }
+
+  return data;
+}
+
+const char* KVBinaryInputBufferSerializer::skipValue(uint8_t type, const char* data, size_t depth) {
+  if (depth > MAX_NESTING_DEPTH) {
+    throw std::runtime_error("Binary storage nesting is too deep");
+  }
+
+  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
+    uint8_t itemType = type & ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    if (itemType == BIN_KV_SERIALIZE_TYPE_ARRAY) {
+      throw std::runtime_error("Nested arrays are not supported");
+    }
+
+    size_t count;
+    data = readVarint(data, count);
+    while (count--) {
+      data = skipValue(itemType, data, depth + 1);
+    }
+
+    return data;
+  }
+
+  size_t size = getPodSize(type);
+  if (size != 0) {
+    require(data, size);
+    return data + size;
+  }
+
+  if (type == BIN_KV_SERIALIZE_TYPE_STRING) {
+    data = readVarint(data, size);
+    require(data, size);
+    return data + size;
+  }
+
+  if (type == BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    size_t count;
+    data = readVarint(data, count);
+
+    while (count--) {
+      require(data, 1);
+      uint8_t nameSize = readPod<uint8_t>(data);
+      require(data + 1, nameSize + 1);
+      uint8_t entryType = readPod<uint8_t>(data + 1 + nameSize);
+      data = skipValue(entryType, data + 1 + nameSize + 1, depth + 1);
+    }
+
+    return data;
+  }
+
+  throw std::runtime_error("Unknown data type");
+}
+
+const char* KVBinaryInputBufferSerializer::readVarint(const char* data, size_t& value) {
+  require(data, 1);
+  uint8_t b = readPod<uint8_t>(data);
+  size_t bytesLeft = 0;
+
+  switch (b & PORTABLE_RAW_SIZE_MARK_MASK) {
+  case PORTABLE_RAW_SIZE_MARK_BYTE:
+    bytesLeft = 0;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_WORD:
+    bytesLeft = 1;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_DWORD:
+    bytesLeft = 3;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_INT64:
+    bytesLeft = 7;
+    break;
+  }
+
+  require(data, 1 + bytesLeft);
+  value = b;
+
+  for (size_t i = 1; i <= bytesLeft; ++i) {
+    size_t n = readPod<uint8_t>(data + i);
+    value |= n << (i * 8);
+  }
+
+  value >>= 2;
+  return data + 1 + bytesLeft;
+}
+
+void KVBinaryInputBufferSerializer::require(const char* data, size_t size) const {
+  if (data > m_end || size > static_cast<size_t>(m_end - data)) {
+    throw std::runtime_error("Unexpected end of binary storage");
+  }
+}
+
+bool KVBinaryInputBufferSerializer::getValue(Common::StringView name, uint8_t& type, const char*& data) {
+  Frame& frame = m_frames.back();
+
+  if (frame.isArray) {
+    if (frame.itemsLeft == 0) {
+      throw std::runtime_error("Array index is out of range");
+    }
+
+    type = frame.itemType;
+    data = frame.cursor;
+    frame.cursor = skipValue(frame.itemType, frame.cursor, m_frames.size());
+    --frame.itemsLeft;
+    return true;
+  }
+
+  for (size_t i = frame.entriesBegin; i < m_entries.size(); ++i) {
+    if (m_entries[i].name == name) {
+      type = m_entries[i].type;
+      data = m_entries[i].data;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool KVBinaryInputBufferSerializer::getInteger(Common::StringView name, int64_t& value) {
+  uint8_t type;
+  const char* data;
+  if (!getValue(name, type, data)) {
+    return false;
+  }
+
+  if (!getInteger(type, data, value)) {
+    throw std::runtime_error("Integer expected");
+  }
+
+  return true;
+}
+
+bool KVBinaryInputBufferSerializer::getInteger(uint8_t type, const char* data, int64_t& value) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  value = readPod<int64_t>(data); return true;
+  case BIN_KV_SERIALIZE_TYPE_INT32:  value = readPod<int32_t>(data); return true;
+  case BIN_KV_SERIALIZE_TYPE_INT16:  value = readPod<int16_t>(data); return true;
+  case BIN_KV_SERIALIZE_TYPE_INT8:   value = readPod<int8_t>(data); return true;
+  case BIN_KV_SERIALIZE_TYPE_UINT64: value = static_cast<int64_t>(readPod<uint64_t>(data)); return true;
+  case BIN_KV_SERIALIZE_TYPE_UINT32: value = readPod<uint32_t>(data); return true;
+  case BIN_KV_SERIALIZE_TYPE_UINT16: value = readPod<uint16_t>(data); return true;
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  value = readPod<uint8_t>(data); return true;
+  default:                           return false;
+  }
+}
+
+bool KVBinaryInputBufferSerializer::getString(Common::StringView name, const char*& data, size_t& size) {
+  uint8_t type;
+  if (!getValue(name, type, data)) {
+    return false;
+  }
+
+  if (type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("String expected");
+  }
+
+  data = readVarint(data, size);
+  return true;
+}
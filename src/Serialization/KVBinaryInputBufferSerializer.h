@@ -0,0 +1,90 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ISerializer.h"
+
+namespace CryptoNote {
+
+// Reads the key-value binary format in place from a memory buffer, the buffer must outlive the serializer.
+// Accepts the same input as KVBinaryInputStreamSerializer without building a Common::JsonValue tree first,
+// fields are located by scanning the enclosing object when it is entered and are decoded straight into the values asked for.
+class KVBinaryInputBufferSerializer : public ISerializer {
+public:
+  KVBinaryInputBufferSerializer(const void* data, size_t size);
+  virtual ~KVBinaryInputBufferSerializer() {}
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
+  virtual bool binary(void* value, size_t size, Common::StringView name) override;
+  virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  // a named value of an object, data points right after the type byte
+  struct Entry {
+    Common::StringView name;
+    uint8_t type;
+    const char* data;
+  };
+
+  // an object lists its entries in m_entries from entriesBegin, an array reads its items one after another from cursor
+  struct Frame {
+    bool isArray;
+    size_t entriesBegin;
+    uint8_t itemType;
+    size_t itemsLeft;
+    const char* cursor;
+  };
+
+  const char* m_end;
+  std::vector<Entry> m_entries;
+  std::vector<Frame> m_frames;
+
+  const char* scanObject(const char* data, size_t depth);
+  const char* skipValue(uint8_t type, const char* data, size_t depth);
+  const char* readVarint(const char* data, size_t& value);
+  void require(const char* data, size_t size) const;
+
+  bool getValue(Common::StringView name, uint8_t& type, const char*& data);
+  bool getInteger(Common::StringView name, int64_t& value);
+  bool getInteger(uint8_t type, const char* data, int64_t& value);
+  bool getString(Common::StringView name, const char*& data, size_t& size);
+
+  template<typename T>
+  bool getNumber(Common::StringView name, T& value) {
+    int64_t integer;
+    if (!getInteger(name, integer)) {
+      return false;
+    }
+
+    value = static_cast<T>(integer);
+    return true;
+  }
+};
+
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+
+namespace System {
+
+namespace Detail {
+
+template<class T> void setPromiseValue(std::promise<T>& promise, std::function<T()>& procedure) {
+  promise.set_value(procedure());
+}
+
+inline void setPromiseValue(std::promise<void>& promise, std::function<void()>& procedure) {
+  procedure();
+  promise.set_value();
+}
+
+}
+
+// Execute procedure in a new context of owner, a dispatcher that may run in another thread, and run other tasks on dispatcher,
+// the dispatcher of the current context, until it is done. Returns the result of procedure or rethrows its exception.
+// Objects that belong to owner can be used safely from another thread this way.
+template<class T> T callInDispatcher(Dispatcher& dispatcher, Dispatcher& owner, std::function<T()>&& procedure) {
+  if (&dispatcher == &owner) {
+    return procedure();
+  }
+
+  std::promise<T> promise;
+  std::future<T> future = promise.get_future();
+  Event done(dispatcher);
+  owner.remoteSpawn([&] {
+    try {
+      Detail::setPromiseValue(promise, procedure);
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+
+    // done is not destroyed before it is set
+    Event* localDone = &done;
+    dispatcher.remoteSpawn([=] { localDone->set(); });
+  });
+
+  // procedure refers to objects of the current context, it cannot be left running
+  bool interrupted = false;
+  while (!done.get()) {
+    try {
+      done.wait();
+    } catch (InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    dispatcher.interrupt();
+  }
+
+  return future.get();
+}
+
+}
@@ -4,7 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "TcpStream.h"
-#include <System/TcpConnection.h>
+#include <vector>
 
 namespace System {
 
@@ -91,4 +91,29 @@ bool TcpStreambuf::dumpBuffer(bool finalize) {
   return true;
 }
 
+void writeAll(TcpConnection& connection, const TcpConnection::Buffer* buffers, size_t count) {
+  // a write of nothing would shut the connection down
+  std::vector<TcpConnection::Buffer> remaining;
+  for (size_t i = 0; i < count; ++i) {
+    if (buffers[i].size != 0) {
+      remaining.push_back(buffers[i]);
+    }
+  }
+
+  size_t first = 0;
+  while (first < remaining.size()) {
+    size_t written = connection.writeBuffers(&remaining[first], remaining.size() - first);
+    while (written > 0) {
+      if (written >= remaining[first].size) {
+        written -= remaining[first].size;
+        ++first;
+      } else {
+        remaining[first].data += written;
+        remaining[first].size -= written;
+        written = 0;
+      }
+    }
+  }
+}
+
 }
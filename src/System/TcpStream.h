@@ -8,11 +8,10 @@
 #include <array>
 #include <cstdint>
 #include <streambuf>
+#include <System/TcpConnection.h>
 
 namespace System {
 
-class TcpConnection;
-
 class TcpStreambuf : public std::streambuf {
 public:
   explicit TcpStreambuf(TcpConnection& connection);
@@ -31,4 +30,7 @@ private:
   bool dumpBuffer(bool finalize);
 };
 
+// Writes all of the buffers, a partially written buffer is continued by the next write.
+void writeAll(TcpConnection& connection, const TcpConnection::Buffer* buffers, size_t count);
+
 }
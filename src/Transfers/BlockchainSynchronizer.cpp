@@ -400,11 +400,13 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response)
     {
       completeBlock.block = std::move(newBlock.block);
       completeBlock.transactions.push_back(createTransactionPrefix(completeBlock.block->baseTransaction));
+      completeBlock.globalIndexes.push_back(std::move(newBlock.baseTransactionGlobalIndexes));
 
       try
       {
-        for (const TransactionShortInfo& txShortInfo : newBlock.txsShortInfo) {
+        for (TransactionShortInfo& txShortInfo : newBlock.txsShortInfo) {
           completeBlock.transactions.push_back(createTransactionPrefix(txShortInfo.txPrefix, reinterpret_cast<const Crypto::Hash&>(txShortInfo.txId)));
+          completeBlock.globalIndexes.push_back(std::move(txShortInfo.globalIndexes));
         }
       }
       catch (std::exception&)
@@ -26,6 +26,8 @@ struct CompleteBlock {
   boost::optional<CryptoNote::Block> block;
   // first transaction is always coinbase
   std::list<std::shared_ptr<ITransactionReader>> transactions;
+  // global output indexes of the transactions in the same order, empty if the node did not send them
+  std::list<std::vector<uint32_t>> globalIndexes;
 };
 
 }
@@ -5,10 +5,13 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+#include <atomic>
 #include <future>
+#include <memory>
 #include <numeric>
+#include <thread>
 
-#include "Common/BlockingQueue.h"
 #include "Common/StringTools.h"
 #include "CommonTypes.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -21,50 +24,79 @@ namespace {
 
 using namespace CryptoNote;
 
-void checkOutputKey(const Crypto::KeyDerivation& derivation, const Crypto::PublicKey& key, size_t keyIndex, size_t outputIndex, const std::unordered_set<Crypto::PublicKey>& spendKeys, std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs)
-{
-
-  Crypto::PublicKey spendPublicKey;
-  underive_public_key(derivation, keyIndex, key, spendPublicKey);
-
-  if (spendKeys.find(spendPublicKey) != spendKeys.end()) {
-    outputs[spendPublicKey].push_back(static_cast<uint32_t>(outputIndex));
-  }
+// number of transactions whose outputs are checked together, the key derivations of a batch and the keys of its outputs
+// are each compressed with a single field inversion
+const size_t SCAN_BATCH_SIZE = 64;
 
-}
-
-void findMyOutputs(const ITransactionReader& transactionReader, const Crypto::SecretKey& viewSecretKey, const std::unordered_set<Crypto::PublicKey>& spendPublicKeys, std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs)
+// outputs[i] gets the indexes of the outputs of transactions[i] sent to each of spendPublicKeys
+void findMyOutputs(const ITransactionReader* const* transactions, size_t count, const Crypto::SecretKey& viewSecretKey, const std::unordered_set<Crypto::PublicKey>& spendPublicKeys, std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>* outputs)
 {
-  Crypto::PublicKey transactionPublicKey = transactionReader.getTransactionPublicKey();
-  Crypto::KeyDerivation derivation;
+  std::vector<Crypto::PublicKey> transactionPublicKeys;
+  transactionPublicKeys.reserve(count);
 
-  if (!generate_key_derivation(transactionPublicKey, viewSecretKey, derivation)) {
-    return;
+  for (size_t i = 0; i < count; ++i) {
+    transactionPublicKeys.push_back(transactions[i]->getTransactionPublicKey());
   }
 
-  size_t keyIndex = 0;
-  size_t outputCount = transactionReader.getOutputCount();
+  std::vector<Crypto::KeyDerivation> derivations(count);
+  std::unique_ptr<bool[]> derivationsValid(new bool[count]);
+  generate_key_derivations(transactionPublicKeys.data(), count, viewSecretKey, derivations.data(), derivationsValid.get());
 
-  for (size_t i = 0; i < outputCount; ++i) {
-    TransactionTypes::OutputType outputType = transactionReader.getOutputType(i);
+  // every output key of the batch with the derivation and key index it is underived with
+  std::vector<Crypto::KeyDerivation> keyDerivations;
+  std::vector<size_t> keyIndexes;
+  std::vector<Crypto::PublicKey> keys;
+  std::vector<size_t> keyTransactions;
+  std::vector<uint32_t> keyOutputs;
 
-    if (outputType == TransactionTypes::OutputType::Key)
-    {
-      uint64_t amountIgnore;
-      KeyOutput keyOutput;
-      transactionReader.getOutput(i, keyOutput, amountIgnore);
-      checkOutputKey(derivation, keyOutput.key, keyIndex, i, spendPublicKeys, outputs);
-      ++keyIndex;
+  for (size_t t = 0; t < count; ++t) {
+    if (!derivationsValid[t]) {
+      continue;
     }
-    else if (outputType == TransactionTypes::OutputType::Multisignature)
-    {
-      uint64_t amountIgnore;
-      MultisignatureOutput out;
-      transactionReader.getOutput(i, out, amountIgnore);
-      for (const auto& key : out.keys) {
-        checkOutputKey(derivation, key, i, i, spendPublicKeys, outputs);
+
+    const ITransactionReader& transactionReader = *transactions[t];
+    size_t keyIndex = 0;
+    size_t outputCount = transactionReader.getOutputCount();
+
+    for (size_t i = 0; i < outputCount; ++i) {
+      TransactionTypes::OutputType outputType = transactionReader.getOutputType(i);
+
+      if (outputType == TransactionTypes::OutputType::Key)
+      {
+        uint64_t amountIgnore;
+        KeyOutput keyOutput;
+        transactionReader.getOutput(i, keyOutput, amountIgnore);
+        keyDerivations.push_back(derivations[t]);
+        keyIndexes.push_back(keyIndex);
+        keys.push_back(keyOutput.key);
+        keyTransactions.push_back(t);
+        keyOutputs.push_back(static_cast<uint32_t>(i));
         ++keyIndex;
       }
+      else if (outputType == TransactionTypes::OutputType::Multisignature)
+      {
+        uint64_t amountIgnore;
+        MultisignatureOutput out;
+        transactionReader.getOutput(i, out, amountIgnore);
+        for (const auto& key : out.keys) {
+          keyDerivations.push_back(derivations[t]);
+          keyIndexes.push_back(i);
+          keys.push_back(key);
+          keyTransactions.push_back(t);
+          keyOutputs.push_back(static_cast<uint32_t>(i));
+          ++keyIndex;
+        }
+      }
+    }
+  }
+
+  std::vector<Crypto::PublicKey> spendKeys(keys.size());
+  std::unique_ptr<bool[]> spendKeysValid(new bool[keys.size()]);
+  underive_public_keys(keyDerivations.data(), keyIndexes.data(), keys.data(), keys.size(), spendKeys.data(), spendKeysValid.get());
+
+  for (size_t k = 0; k < keys.size(); ++k) {
+    if (spendKeysValid[k] && spendPublicKeys.find(spendKeys[k]) != spendPublicKeys.end()) {
+      outputs[keyTransactions[k]][spendKeys[k]].push_back(keyOutputs[k]);
     }
   }
 }
@@ -92,7 +124,8 @@ namespace CryptoNote {
 TransfersConsumer::TransfersConsumer(const Currency& currency, INode& node, const Crypto::SecretKey& viewSecret) :
   m_node(node),
   m_viewPrivateKey(viewSecret),
-  m_currency(currency) {
+  m_currency(currency),
+  m_workerPool(std::max<size_t>(std::thread::hardware_concurrency(), 2)) {
   updateSyncStart();
 }
 
@@ -174,91 +207,95 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   struct Tx {
     TransactionBlockInfo blockInfo;
     const ITransactionReader* transactionReader;
+    const std::vector<uint32_t>* globalIndexes;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
-
-  std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
+  std::vector<Tx> transactions;
 
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
-
-  BlockingQueue<Tx> inputQueue(workers * 2);
+  for (uint32_t i = 0; i < numBlocks; ++i) {
+    const boost::optional<Block>& block = blocks[i].block;
 
-  std::atomic<bool> stopProcessing(false);
+    if (!block.is_initialized()) {
+      continue;
+    }
 
-  std::future<void> pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < numBlocks && !stopProcessing; ++i) {
-      const boost::optional<Block>& block = blocks[i].block;
+    // filter by syncStartTimestamp
+    if (m_synchronizationStart.timestamp && m_synchronizationStart.timestamp > block->timestamp) {
+      continue;
+    }
 
-      if (!block.is_initialized()) {
-        continue;
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
+
+    static const std::vector<uint32_t> noGlobalIndexes;
+    auto globalIndexesIt = blocks[i].globalIndexes.begin();
+
+    for (const std::shared_ptr<ITransactionReader>& transactionReaderPtr : blocks[i].transactions) {
+      // global output indexes sent along with the block, if there are none they are asked for in preprocessOutputs()
+      const std::vector<uint32_t>* globalIndexes = &noGlobalIndexes;
+      if (globalIndexesIt != blocks[i].globalIndexes.end()) {
+        globalIndexes = &*globalIndexesIt;
+        ++globalIndexesIt;
       }
 
-      // filter by syncStartTimestamp
-      if (m_synchronizationStart.timestamp && m_synchronizationStart.timestamp > block->timestamp) {
+      Crypto::PublicKey transactionPublicKey = transactionReaderPtr->getTransactionPublicKey();
+      if (transactionPublicKey == NULL_PUBLIC_KEY) {
+        ++blockInfo.transactionIndex;
         continue;
       }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
+      Tx item = { blockInfo, transactionReaderPtr.get(), globalIndexes };
+      transactions.push_back(item);
+      ++blockInfo.transactionIndex;
+    }
+  }
 
-      for (const std::shared_ptr<ITransactionReader>& transactionReaderPtr : blocks[i].transactions) {
-        Crypto::PublicKey transactionPublicKey = transactionReaderPtr->getTransactionPublicKey();
-        if (transactionPublicKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
+  // small batches when there are few transactions so that every thread gets some
+  const size_t threadCount = m_workerPool.getThreadCount();
+  const size_t batchSize = std::max<size_t>(1, std::min(SCAN_BATCH_SIZE, (transactions.size() + threadCount - 1) / threadCount));
+  const size_t batchCount = (transactions.size() + batchSize - 1) / batchSize;
+  std::vector<PreprocessInfo> preprocessedTransactions(transactions.size());
+  std::vector<std::error_code> batchErrors(batchCount);
+  std::atomic<bool> stopProcessing(false);
 
-        Tx item = { blockInfo, transactionReaderPtr.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
+  std::error_code processingError;
+  try {
+    m_workerPool.parallelFor(batchCount, [&](size_t batch) {
+      if (stopProcessing) {
+        return;
       }
-    }
 
-    inputQueue.close();
-  });
+      size_t begin = batch * batchSize;
+      size_t end = std::min(begin + batchSize, transactions.size());
 
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
-
-      ec = preprocessOutputs(item.blockInfo, *item.transactionReader, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+      std::vector<const ITransactionReader*> transactionReaders;
+      for (size_t i = begin; i < end; ++i) {
+        transactionReaders.push_back(transactions[i].transactionReader);
       }
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
-    }
-    return ec;
-  };
+      std::vector<std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>> outputs(transactionReaders.size());
+      findMyOutputs(transactionReaders.data(), transactionReaders.size(), m_viewPrivateKey, m_spendPublicKeys, outputs.data());
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
+      for (size_t i = begin; i < end && !stopProcessing; ++i) {
+        const Tx& item = transactions[i];
+        std::error_code ec = preprocessOutputs(item.blockInfo, *item.transactionReader, *item.globalIndexes, outputs[i - begin], preprocessedTransactions[i]);
+        if (ec) {
+          batchErrors[batch] = ec;
+          stopProcessing = true;
+        }
+      }
+    });
+  } catch (const std::system_error& e) {
+    processingError = e.code();
+  } catch (const std::exception&) {
+    processingError = std::make_error_code(std::errc::operation_canceled);
   }
 
-  std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
-      }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
+  for (const std::error_code& ec : batchErrors) {
+    if (!processingError && ec) {
+      processingError = ec;
     }
   }
 
@@ -266,13 +303,9 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
-
-    for (const auto& tx : preprocessedTransactions) {
-      processTransaction(tx.blockInfo, *tx.transactionReader, tx);
+    // already in block height and transaction index order
+    for (size_t i = 0; i < transactions.size(); ++i) {
+      processTransaction(transactions[i].blockInfo, *transactions[i].transactionReader, preprocessedTransactions[i]);
     }
   } else {
     forEachSubscription([&](TransfersSubscription& sub) {
@@ -446,11 +479,17 @@ std::error_code TransfersConsumer::getTransactionOutputsGlobalIndexes(const Cryp
   return future.get();
 }
 
-std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, PreprocessInfo& info) {
+std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, const std::vector<uint32_t>& globalIndexes, PreprocessInfo& info) {
   
   std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>> outputs;
+  const ITransactionReader* transaction = &transactionReader;
 
-  findMyOutputs(transactionReader, m_viewPrivateKey, m_spendPublicKeys, outputs);
+  findMyOutputs(&transaction, 1, m_viewPrivateKey, m_spendPublicKeys, &outputs);
+
+  return preprocessOutputs(blockInfo, transactionReader, globalIndexes, outputs, info);
+}
+
+std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, const std::vector<uint32_t>& globalIndexes, const std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info) {
 
   if (outputs.empty()) {
     return std::error_code();
@@ -459,9 +498,13 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
   std::error_code errorCode;
   auto transactionHash = transactionReader.getTransactionHash();
   if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
-    errorCode = getTransactionOutputsGlobalIndexes(reinterpret_cast<const Crypto::Hash&>(transactionHash), info.globalIndexes);
-    if (errorCode) {
-      return errorCode;
+    if (globalIndexes.size() == transactionReader.getOutputCount()) {
+      info.globalIndexes = globalIndexes;
+    } else {
+      errorCode = getTransactionOutputsGlobalIndexes(reinterpret_cast<const Crypto::Hash&>(transactionHash), info.globalIndexes);
+      if (errorCode) {
+        return errorCode;
+      }
     }
   }
 
@@ -501,7 +544,7 @@ void TransfersConsumer::processOutputs(const TransactionBlockInfo& blockInfo, Tr
 
 std::error_code TransfersConsumer::processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader) {
   PreprocessInfo info;
-  auto ec = preprocessOutputs(blockInfo, transactionReader, info);
+  auto ec = preprocessOutputs(blockInfo, transactionReader, std::vector<uint32_t>(), info);
   if (ec) {
     return ec;
   }
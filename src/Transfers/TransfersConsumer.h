@@ -9,6 +9,7 @@
 
 #include <unordered_set>
 
+#include "Common/WorkerPool.h"
 #include "crypto/crypto.h"
 #include "IBlockchainSynchronizer.h"
 #include "ITransfersSynchronizer.h"
@@ -54,7 +55,8 @@ private:
 
   std::error_code createTransfers(const AccountKeys& account, const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, const std::vector<uint32_t>& outputs, const std::vector<uint32_t>& globalIdxs, std::vector<TransactionOutputInformationIn>& transfers);
   std::error_code getTransactionOutputsGlobalIndexes(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndexes);
-  std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, PreprocessInfo& info);
+  std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, const std::vector<uint32_t>& globalIndexes, PreprocessInfo& info);
+  std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, const std::vector<uint32_t>& globalIndexes, const std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& subscription, const ITransactionReader& transactionReader, const std::vector<TransactionOutputInformationIn>& outputs, const std::vector<uint32_t>& globalIdxs, bool& contains, bool& updated);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader);
   void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& transactionReader, const PreprocessInfo& info);
@@ -70,6 +72,7 @@ private:
   SynchronizationStart m_synchronizationStart;
   std::unordered_set<Crypto::Hash> m_transactionHashesSeen;
   const Crypto::SecretKey m_viewPrivateKey;
+  Common::WorkerPool m_workerPool; // scans the transactions of onNewBlocks()
   
 };
 
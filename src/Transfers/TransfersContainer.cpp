@@ -3,6 +3,10 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -166,7 +170,9 @@ bool SpentOutputDescriptor::operator==(const SpentOutputDescriptor& other) const
 TransfersContainer::TransfersContainer(const Currency& currency, size_t transactionSpendableAge) :
   m_currentHeight(0),
   m_currency(currency),
-  m_transactionSpendableAge(transactionSpendableAge) {
+  m_transactionSpendableAge(transactionSpendableAge),
+  m_timeUnlocked(0) {
+  rebuildBalance();
 }
 
 bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const ITransactionReader& transactionReader, const std::vector<TransactionOutputInformationIn>& transfers)
@@ -190,7 +196,7 @@ bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
   }
 
   if (block.height != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
-    m_currentHeight = block.height;
+    setCurrentHeight(block.height);
   }
 
   return added;
@@ -201,7 +207,7 @@ bool TransfersContainer::advanceHeight(uint32_t height)
   std::lock_guard<std::mutex> lk(m_mutex);
 
   if (m_currentHeight <= height) {
-    m_currentHeight = height;
+    setCurrentHeight(height);
     return true;
   }
 
@@ -211,19 +217,23 @@ bool TransfersContainer::advanceHeight(uint32_t height)
 uint64_t TransfersContainer::balance(uint32_t flags) const
 {
   std::lock_guard<std::mutex> lk(m_mutex);
+
+  releaseTimeLocks();
+
+  const TransactionTypes::OutputType types[BALANCE_TYPES] = { TransactionTypes::OutputType::Key, TransactionTypes::OutputType::Multisignature };
+  const uint32_t states[BALANCE_STATES] = { IncludeStateLocked, IncludeStateSoftLocked, IncludeStateUnlocked };
+
   uint64_t amount = 0;
 
-  for (const auto& t : m_availableTransfers) {
-    if (t.visible && isIncluded(t, flags)) {
-      amount += t.amount;
+  for (size_t type = 0; type < BALANCE_TYPES; ++type) {
+    for (size_t state = 0; state < BALANCE_STATES; ++state) {
+      if (isIncluded(types[type], states[state], flags)) {
+        amount += m_balance[type][state];
+      }
     }
-  }
 
-  if ((flags & IncludeStateLocked) != 0) {
-    for (const auto& t : m_unconfirmedTransfers) {
-      if (t.visible && isIncluded(t.type, IncludeStateLocked, flags)) {
-        amount += t.amount;
-      }
+    if (isIncluded(types[type], IncludeStateLocked, flags)) {
+      amount += m_unconfirmedBalance[type];
     }
   }
 
@@ -283,7 +293,7 @@ std::vector<Crypto::Hash> TransfersContainer::detach(uint32_t height)
   }
 
   // TODO: notification on detach
-  m_currentHeight = height == 0 ? 0 : height - 1;
+  setCurrentHeight(height == 0 ? 0 : height - 1);
 
   return deletedTransactions;
 }
@@ -307,6 +317,58 @@ void TransfersContainer::getOutputs(std::vector<TransactionOutputInformation>& t
   }
 }
 
+void TransfersContainer::getSpendableAmounts(std::map<uint64_t, size_t>& outputsCounts) const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  releaseTimeLocks();
+
+  for (const auto& outputs : m_spendableOutputs) {
+    outputsCounts[outputs.first] += outputs.second.size();
+  }
+}
+
+// index counts the spendable outputs from the smallest amount up, outputs of the same amount are in no particular order
+// the running counts are built again after the spendable outputs change, then an index is found with a binary search
+bool TransfersContainer::getSpendableOutput(size_t index, TransactionOutputInformation& output) const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  releaseTimeLocks();
+
+  if (m_spendableEnds.empty()) {
+    size_t end = 0;
+    m_spendableEnds.reserve(m_spendableOutputs.size());
+    for (const auto& outputs : m_spendableOutputs) {
+      end += outputs.second.size();
+      m_spendableEnds.emplace_back(end, &outputs.second);
+    }
+  }
+
+  auto it = std::upper_bound(m_spendableEnds.begin(), m_spendableEnds.end(), index,
+    [](size_t i, const decltype(m_spendableEnds)::value_type& end) { return i < end.first; });
+  if (it == m_spendableEnds.end()) {
+    return false;
+  }
+
+  size_t begin = it == m_spendableEnds.begin() ? 0 : std::prev(it)->first;
+  output = *(*it->second)[index - begin];
+  return true;
+}
+
+void TransfersContainer::getSpendableOutputs(uint64_t amount, std::vector<TransactionOutputInformation>& outputs) const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  releaseTimeLocks();
+
+  auto it = m_spendableOutputs.find(amount);
+  if (it == m_spendableOutputs.end()) {
+    return;
+  }
+
+  for (const TransactionOutputInformationEx* transfer : it->second) {
+    outputs.push_back(*transfer);
+  }
+}
+
 std::vector<TransactionSpentOutputInformation> TransfersContainer::getSpentOutputs() const
 {
   std::lock_guard<std::mutex> lk(m_mutex);
@@ -482,6 +544,8 @@ void TransfersContainer::load(std::istream& in) // take information from disk an
   m_unconfirmedTransfers = std::move(unconfirmedTransfers);
   m_availableTransfers = std::move(availableTransfers);
   m_spentTransfers = std::move(spentTransfers);
+
+  rebuildBalance();
 }
 
 bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& block, const Crypto::Hash& transactionHash, const std::vector<uint32_t>& globalIndexes)
@@ -533,8 +597,10 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
     (void)result; // Disable unused warning
     bool inserted = result.second;
     assert(inserted);
+    updateBalance(*result.first, true, true);
 
     // remove transfer from m_unconfirmedTransfers
+    updateBalance(*transferIt, false, false);
     transferIt = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(transferIt);
 
     if (transfer.type == TransactionTypes::OutputType::Key) {
@@ -570,6 +636,14 @@ void TransfersContainer::save(std::ostream& os)
   writeSequence<SpentTransactionOutput>(m_spentTransfers.begin(), m_spentTransfers.end(), "spentTransfers", s);
 }
 
+size_t TransfersContainer::spendableOutputsCount() const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  releaseTimeLocks();
+
+  return m_spendablePositions.size();
+}
+
 size_t TransfersContainer::transactionsCount() const
 {
   std::lock_guard<std::mutex> lk(m_mutex);
@@ -660,6 +734,7 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       assert(spendingTransferIt->keyImage == input.keyImage);
       copyToSpent(block, transactionReader, i, *spendingTransferIt);
       // erase from available outputs
+      updateBalance(*spendingTransferIt, true, false);
       outputDescriptorIndex.erase(spendingTransferIt);
       updateTransfersVisibility(input.keyImage);
 
@@ -675,6 +750,7 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       if (availableOutputIt != outputDescriptorIndex.end()) {
         copyToSpent(block, transactionReader, i, *availableOutputIt);
         // erase from available outputs
+        updateBalance(*availableOutputIt, true, false);
         outputDescriptorIndex.erase(availableOutputIt);
 
         inputsAdded = true;
@@ -731,6 +807,7 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
       (void)result; // Disable unused warning
       bool inserted = result.second;
       assert(inserted);
+      updateBalance(*result.first, false, true);
     }
     else
     {
@@ -773,6 +850,7 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
       (void)result; // Disable unused warning
       bool inserted = result.second;
       assert(inserted);
+      updateBalance(*result.first, true, true);
     }
 
     if (info.type == TransactionTypes::OutputType::Key) {
@@ -785,6 +863,86 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
   return outputsAdded;
 }
 
+void TransfersContainer::addUnlockBucket(uint64_t height, size_t type, size_t fromState, size_t toState, uint64_t amount, bool add) const // pre m_mutex is locked.
+{
+  auto it = m_unlockHeights.find(height);
+  if (it == m_unlockHeights.end()) {
+    assert(add);
+    UnlockBucket bucket = {};
+    it = m_unlockHeights.emplace(height, bucket).first;
+  }
+
+  UnlockBucket& bucket = it->second;
+  if (add) {
+    bucket.amounts[type][fromState] -= amount;
+    bucket.amounts[type][toState] += amount;
+    bucket.transfersCount++;
+  } else {
+    bucket.amounts[type][fromState] += amount;
+    bucket.amounts[type][toState] -= amount;
+    bucket.transfersCount--;
+
+    if (bucket.transfersCount == 0) {
+      m_unlockHeights.erase(it);
+    }
+  }
+}
+
+// lockedUntil and softLockedUntil are the first heights at which the transfer is no longer locked and soft locked
+void TransfersContainer::addUnlockSchedule(const TransactionOutputInformationEx* transfer, size_t type, uint64_t lockedUntil, uint64_t softLockedUntil, bool add) const // pre m_mutex is locked.
+{
+  uint64_t amount = transfer->amount;
+
+  size_t state;
+  if (m_currentHeight < lockedUntil) {
+    state = 0;
+  } else if (m_currentHeight < softLockedUntil) {
+    state = 1;
+  } else {
+    state = 2;
+  }
+
+  if (add) {
+    m_balance[type][state] += amount;
+  } else {
+    m_balance[type][state] -= amount;
+  }
+
+  // a height of 0 is never reached by setCurrentHeight()
+  if (lockedUntil > 0) {
+    addUnlockBucket(lockedUntil, type, 0, lockedUntil < softLockedUntil ? 1 : 2, amount, add);
+  }
+
+  if (softLockedUntil > lockedUntil) {
+    addUnlockBucket(softLockedUntil, type, 1, 2, amount, add);
+  }
+
+  if (type != 0) {
+    return;
+  }
+
+  if (state == 2) {
+    updateSpendableOutput(transfer, add);
+  }
+
+  uint64_t spendableFrom = std::max(lockedUntil, softLockedUntil);
+  if (spendableFrom == 0) {
+    return;
+  }
+
+  if (add) {
+    m_spendableHeights.emplace(spendableFrom, transfer);
+  } else {
+    auto range = m_spendableHeights.equal_range(spendableFrom);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == transfer) {
+        m_spendableHeights.erase(it);
+        break;
+      }
+    }
+  }
+}
+
 void TransfersContainer::copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& transactionReader, size_t inputIndex, const TransactionOutputInformationEx& output) // pre m_mutex is locked.
 {
   assert(output.blockHeight != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
@@ -813,6 +971,7 @@ void TransfersContainer::deleteTransactionTransfers(const Crypto::Hash& transact
 
     auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
     assert(result.second);
+    updateBalance(*result.first, true, true);
     it = spendingTransactionIndex.erase(it);
 
     if (result.first->type == TransactionTypes::OutputType::Key) {
@@ -823,6 +982,8 @@ void TransfersContainer::deleteTransactionTransfers(const Crypto::Hash& transact
   // erase transfers from m_unconfirmedTransfers
   auto unconfirmedTransfersRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
   for (auto it = unconfirmedTransfersRange.first; it != unconfirmedTransfersRange.second;) {
+    updateBalance(*it, false, false);
+
     if (it->type == TransactionTypes::OutputType::Key) {
       Crypto::KeyImage keyImage = it->keyImage;
       it = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(it);
@@ -836,6 +997,8 @@ void TransfersContainer::deleteTransactionTransfers(const Crypto::Hash& transact
   auto& transactionTransfersIndex = m_availableTransfers.get<ContainingTransactionIndex>();
   auto transactionTransfersRange = transactionTransfersIndex.equal_range(transactionHash);
   for (auto it = transactionTransfersRange.first; it != transactionTransfersRange.second;) {
+    updateBalance(*it, true, false);
+
     if (it->type == TransactionTypes::OutputType::Key) {
       Crypto::KeyImage keyImage = it->keyImage;
       it = transactionTransfersIndex.erase(it);
@@ -889,6 +1052,179 @@ bool TransfersContainer::isSpendTimeUnlocked(uint64_t unlockTime) const
   return false;
 }
 
+void TransfersContainer::rebuildBalance() // pre m_mutex is locked.
+{
+  memset(m_balance, 0, sizeof(m_balance));
+  memset(m_unconfirmedBalance, 0, sizeof(m_unconfirmedBalance));
+  m_unlockHeights.clear();
+  m_unlockTimes.clear();
+  m_timeUnlocked = 0;
+  m_spendableOutputs.clear();
+  m_spendableHeights.clear();
+  m_spendablePositions.clear();
+  m_spendableEnds.clear();
+
+  for (const auto& transfer : m_availableTransfers) {
+    updateBalance(transfer, true, true);
+  }
+
+  for (const auto& transfer : m_unconfirmedTransfers) {
+    updateBalance(transfer, false, true);
+  }
+}
+
+// time locks expire without a call to advanceHeight(), they are released when the balance is asked for
+// and are not locked again if the clock goes back
+void TransfersContainer::releaseTimeLocks() const // pre m_mutex is locked.
+{
+  uint64_t unlockTime = static_cast<uint64_t>(time(NULL)) + m_currency.lockedTxAllowedDeltaSeconds();
+  if (unlockTime <= m_timeUnlocked) {
+    return;
+  }
+
+  m_timeUnlocked = unlockTime;
+
+  auto end = m_unlockTimes.upper_bound(unlockTime);
+  for (auto it = m_unlockTimes.begin(); it != end; ++it) {
+    const TimeLockedTransfer& transfer = it->second;
+    m_balance[transfer.type][0] -= transfer.transfer->amount;
+    addUnlockSchedule(transfer.transfer, transfer.type, 0, transfer.softLockedUntil, true);
+  }
+
+  m_unlockTimes.erase(m_unlockTimes.begin(), end);
+}
+
+void TransfersContainer::setCurrentHeight(uint32_t height) // pre m_mutex is locked.
+{
+  if (height > m_currentHeight) {
+    auto end = m_unlockHeights.upper_bound(height);
+    for (auto it = m_unlockHeights.upper_bound(m_currentHeight); it != end; ++it) {
+      for (size_t type = 0; type < BALANCE_TYPES; ++type) {
+        for (size_t state = 0; state < BALANCE_STATES; ++state) {
+          m_balance[type][state] += it->second.amounts[type][state];
+        }
+      }
+    }
+
+    auto spendableEnd = m_spendableHeights.upper_bound(height);
+    for (auto it = m_spendableHeights.upper_bound(m_currentHeight); it != spendableEnd; ++it) {
+      updateSpendableOutput(it->second, true);
+    }
+  } else if (height < m_currentHeight) {
+    auto end = m_unlockHeights.upper_bound(m_currentHeight);
+    for (auto it = m_unlockHeights.upper_bound(height); it != end; ++it) {
+      for (size_t type = 0; type < BALANCE_TYPES; ++type) {
+        for (size_t state = 0; state < BALANCE_STATES; ++state) {
+          m_balance[type][state] -= it->second.amounts[type][state];
+        }
+      }
+    }
+
+    auto spendableEnd = m_spendableHeights.upper_bound(m_currentHeight);
+    for (auto it = m_spendableHeights.upper_bound(height); it != spendableEnd; ++it) {
+      updateSpendableOutput(it->second, false);
+    }
+  }
+
+  m_currentHeight = height;
+}
+
+// keeps m_balance, m_unconfirmedBalance and the unlock schedules in step with the visible transfers, same states as isIncluded()
+void TransfersContainer::updateBalance(const TransactionOutputInformationEx& transfer, bool available, bool add) // pre m_mutex is locked.
+{
+  if (!transfer.visible) {
+    return;
+  }
+
+  size_t type;
+  if (transfer.type == TransactionTypes::OutputType::Key) {
+    type = 0;
+  } else if (transfer.type == TransactionTypes::OutputType::Multisignature) {
+    type = 1;
+  } else {
+    return;
+  }
+
+  if (!available || transfer.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    uint64_t& amount = available ? m_balance[type][0] : m_unconfirmedBalance[type];
+    if (add) {
+      amount += transfer.amount;
+    } else {
+      amount -= transfer.amount;
+    }
+
+    return;
+  }
+
+  uint64_t softLockedUntil = static_cast<uint64_t>(transfer.blockHeight) + m_transactionSpendableAge;
+
+  if (transfer.unlockTime < m_currency.maxBlockHeight()) {
+    // interpret as block index
+    uint64_t lockedUntil = transfer.unlockTime > m_currency.lockedTxAllowedDeltaBlocks() ? transfer.unlockTime - m_currency.lockedTxAllowedDeltaBlocks() : 0;
+    addUnlockSchedule(&transfer, type, lockedUntil, softLockedUntil, add);
+  } else if (transfer.unlockTime <= m_timeUnlocked) {
+    // time lock already released
+    addUnlockSchedule(&transfer, type, 0, softLockedUntil, add);
+  } else if (add) {
+    TimeLockedTransfer timeLockedTransfer = { type, &transfer, softLockedUntil };
+    m_unlockTimes.emplace(transfer.unlockTime, timeLockedTransfer);
+    m_balance[type][0] += transfer.amount;
+  } else {
+    auto range = m_unlockTimes.equal_range(transfer.unlockTime);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.transfer == &transfer) {
+        m_unlockTimes.erase(it);
+        break;
+      }
+    }
+
+    m_balance[type][0] -= transfer.amount;
+  }
+}
+
+// the spendable index holds pointers to the transfers in m_availableTransfers, it is updated before a transfer is erased
+// and after it is inserted or replaced
+void TransfersContainer::updateSpendableOutput(const TransactionOutputInformationEx* transfer, bool add) const // pre m_mutex is locked.
+{
+  m_spendableEnds.clear();
+
+  if (add) {
+    std::vector<const TransactionOutputInformationEx*>& outputs = m_spendableOutputs[transfer->amount];
+    m_spendablePositions.emplace(transfer, outputs.size());
+    outputs.push_back(transfer);
+    return;
+  }
+
+  auto positionIt = m_spendablePositions.find(transfer);
+  assert(positionIt != m_spendablePositions.end());
+
+  auto outputsIt = m_spendableOutputs.find(transfer->amount);
+  assert(outputsIt != m_spendableOutputs.end());
+
+  std::vector<const TransactionOutputInformationEx*>& outputs = outputsIt->second;
+  const TransactionOutputInformationEx* last = outputs.back();
+  outputs[positionIt->second] = last;
+  m_spendablePositions[last] = positionIt->second;
+  outputs.pop_back();
+  m_spendablePositions.erase(transfer);
+
+  if (outputs.empty()) {
+    m_spendableOutputs.erase(outputsIt);
+  }
+}
+
+template<typename C, typename T>
+void TransfersContainer::updateVisibilityAndBalance(C& collection, const T& range, bool available, bool visible) // pre m_mutex is locked.
+{
+  for (auto it = range.first; it != range.second; ++it) {
+    auto updated = *it;
+    updated.visible = visible;
+    updateBalance(*it, available, false);
+    collection.replace(it, updated);
+    updateBalance(*it, available, true);
+  }
+}
+
 namespace
 {
   template<typename C, typename T>
@@ -919,12 +1255,12 @@ void TransfersContainer::updateTransfersVisibility(const Crypto::KeyImage& keyIm
   assert(spentCount == 0 || spentCount == 1);
 
   if (spentCount > 0) {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, false);
-    updateVisibility(availableIndex, availableRange, false);
+    updateVisibilityAndBalance(unconfirmedIndex, unconfirmedRange, false, false);
+    updateVisibilityAndBalance(availableIndex, availableRange, true, false);
     updateVisibility(spentIndex, spentRange, true);
   } else if (availableCount > 0) {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, false);
-    updateVisibility(availableIndex, availableRange, false);
+    updateVisibilityAndBalance(unconfirmedIndex, unconfirmedRange, false, false);
+    updateVisibilityAndBalance(availableIndex, availableRange, true, false);
 
     auto iteratorList = createTransferIteratorList(availableRange);
     auto earliestTransferIt = iteratorList.minElement();
@@ -932,9 +1268,11 @@ void TransfersContainer::updateTransfersVisibility(const Crypto::KeyImage& keyIm
 
     auto earliestTransfer = *earliestTransferIt;
     earliestTransfer.visible = true;
+    updateBalance(*earliestTransferIt, true, false);
     availableIndex.replace(earliestTransferIt, earliestTransfer);
+    updateBalance(*earliestTransferIt, true, true);
   } else {
-    updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1);
+    updateVisibilityAndBalance(unconfirmedIndex, unconfirmedRange, false, unconfirmedCount == 1);
   }
 }
 
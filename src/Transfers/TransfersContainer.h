@@ -6,8 +6,10 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
@@ -148,6 +150,9 @@ public:
   bool deleteUnconfirmedTransaction(const Crypto::Hash& transactionHash);
   std::vector<Crypto::Hash> detach(uint32_t height);
   virtual void getOutputs(std::vector<TransactionOutputInformation>& transfers, uint32_t flags) const override;
+  virtual void getSpendableAmounts(std::map<uint64_t, size_t>& outputsCounts) const override;
+  virtual bool getSpendableOutput(size_t index, TransactionOutputInformation& output) const override;
+  virtual void getSpendableOutputs(uint64_t amount, std::vector<TransactionOutputInformation>& outputs) const override;
   virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const override;
   virtual bool getTransactionInformation(const Crypto::Hash& transactionHash, TransactionInformation& info, uint64_t* amountIn = nullptr, uint64_t* amountOut = nullptr) const override;
   virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const override; // only type flags are feasible for this function
@@ -156,6 +161,7 @@ public:
   virtual void load(std::istream& in) override;
   bool markTransactionConfirmed(const TransactionBlockInfo& block, const Crypto::Hash& transactionHash, const std::vector<uint32_t>& globalIndexes);
   virtual void save(std::ostream& os) override;
+  virtual size_t spendableOutputsCount() const override;
   virtual size_t transactionsCount() const override;
   virtual size_t transfersCount() const override;
 
@@ -267,24 +273,57 @@ private:
     >
   > SpentTransfersMultiIndex;
 
+  enum { BALANCE_TYPES = 2, BALANCE_STATES = 3 };
+
+  // amounts moving between states when the current height reaches the key of the bucket,
+  // sums are taken modulo 2^64 so that a bucket can take an amount out of a state
+  struct UnlockBucket {
+    uint64_t amounts[BALANCE_TYPES][BALANCE_STATES];
+    size_t transfersCount;
+  };
+
+  // a transfer locked until a time, it is moved to the height schedule when the time has come
+  struct TimeLockedTransfer {
+    size_t type;
+    const TransactionOutputInformationEx* transfer;
+    uint64_t softLockedUntil;
+  };
+
   void addTransaction(const TransactionBlockInfo& block, const ITransactionReader& transactionReader);
   bool addTransactionInputs(const TransactionBlockInfo& block, const ITransactionReader& transactionReader);
   bool addTransactionOutputs(const TransactionBlockInfo& block, const ITransactionReader& transactionReader, const std::vector<TransactionOutputInformationIn>& transfers);
+  void addUnlockBucket(uint64_t height, size_t type, size_t fromState, size_t toState, uint64_t amount, bool add) const;
+  void addUnlockSchedule(const TransactionOutputInformationEx* transfer, size_t type, uint64_t lockedUntil, uint64_t softLockedUntil, bool add) const;
   void copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& transactionReader, size_t inputIndex, const TransactionOutputInformationEx& output);
   void deleteTransactionTransfers(const Crypto::Hash& transactionHash);
   bool isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const;
   static bool isIncluded(TransactionTypes::OutputType type, uint32_t state, uint32_t flags);
   bool isSpendTimeUnlocked(uint64_t unlockTime) const;
+  void rebuildBalance();
+  void releaseTimeLocks() const;
+  void setCurrentHeight(uint32_t height);
+  void updateBalance(const TransactionOutputInformationEx& transfer, bool available, bool add);
+  void updateSpendableOutput(const TransactionOutputInformationEx* transfer, bool add) const;
   void updateTransfersVisibility(const Crypto::KeyImage& keyImage);
+  template<typename C, typename T> void updateVisibilityAndBalance(C& collection, const T& range, bool available, bool visible);
 
   AvailableTransfersMultiIndex m_availableTransfers;
+  mutable uint64_t m_balance[BALANCE_TYPES][BALANCE_STATES]; // visible available transfers at m_currentHeight
   const CryptoNote::Currency& m_currency;
   uint32_t m_currentHeight; // current height is needed to check if a transfer is unlocked
   mutable std::mutex m_mutex;
   SpentTransfersMultiIndex m_spentTransfers;
   TransactionMultiIndex m_transactions;
+  mutable std::map<uint64_t, std::vector<const TransactionOutputInformationEx*>> m_spendableOutputs; // unlocked visible key transfers by amount
+  mutable std::multimap<uint64_t, const TransactionOutputInformationEx*> m_spendableHeights; // key transfers by the height at which they are no longer locked or soft locked
+  mutable std::unordered_map<const TransactionOutputInformationEx*, size_t> m_spendablePositions; // position of a transfer in its m_spendableOutputs vector
+  mutable std::vector<std::pair<size_t, const std::vector<const TransactionOutputInformationEx*>*>> m_spendableEnds; // running count of m_spendableOutputs up to each amount, cleared when an output is added or removed
   size_t m_transactionSpendableAge;
+  mutable uint64_t m_timeUnlocked; // time locked transfers up to this unlock time are in m_unlockHeights
+  uint64_t m_unconfirmedBalance[BALANCE_TYPES]; // visible unconfirmed transfers, always locked
   UnconfirmedTransfersMultiIndex m_unconfirmedTransfers;
+  mutable std::map<uint64_t, UnlockBucket> m_unlockHeights;
+  mutable std::multimap<uint64_t, TimeLockedTransfer> m_unlockTimes;
 
 };
 
@@ -13,6 +13,7 @@
 #include <random>
 #include <set>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 
 #include "Common/ScopeExit.h"
@@ -416,15 +417,18 @@ IFusionManager::EstimateResult WalletGreen::estimate(uint64_t threshold) const {
   std::array<size_t, std::numeric_limits<uint64_t>::digits10 + 1> bucketSizes;
   bucketSizes.fill(0);
   for (size_t walletIndex = 0; walletIndex < walletOuts.size(); ++walletIndex) {
-    for (auto& out : walletOuts[walletIndex].outs) {
+    std::map<uint64_t, size_t> outputsCounts;
+    walletOuts[walletIndex].wallet->container->getSpendableAmounts(outputsCounts);
+
+    for (const auto& outputsCount : outputsCounts) {
       uint8_t powerOfTen = 0;
-      if (m_currency.isAmountApplicableInFusionTransactionInput(out.amount, threshold, powerOfTen, m_node.getLastKnownBlockHeight())) {
+      if (m_currency.isAmountApplicableInFusionTransactionInput(outputsCount.first, threshold, powerOfTen, m_node.getLastKnownBlockHeight())) {
         assert(powerOfTen < std::numeric_limits<uint64_t>::digits10 + 1);
-        bucketSizes[powerOfTen]++;
+        bucketSizes[powerOfTen] += outputsCount.second;
       }
     }
 
-    result.totalOutputCount += walletOuts[walletIndex].outs.size();
+    result.totalOutputCount += walletOuts[walletIndex].outsCount;
   }
 
   for (auto bucketSize : bucketSizes) {
@@ -1886,17 +1890,21 @@ AccountPublicAddress WalletGreen::parseAddress(const std::string& address) const
 
 // Plan to remove
 std::vector<WalletGreen::OutputToTransfer> WalletGreen::pickRandomFusionInputs(uint64_t threshold, size_t minInputCount, size_t maxInputCount) {
-  std::vector<WalletGreen::OutputToTransfer> allFusionReadyOuts;
+  // only the amounts are looked at to size the buckets, outputs are read for the selected bucket only
+  std::vector<std::tuple<WalletRecord*, uint64_t, uint8_t>> fusionReadyAmounts;
   auto walletOuts = pickWalletsWithMoney();
   std::array<size_t, std::numeric_limits<uint64_t>::digits10 + 1> bucketSizes;
   bucketSizes.fill(0);
   for (size_t walletIndex = 0; walletIndex < walletOuts.size(); ++walletIndex) {
-    for (auto& out : walletOuts[walletIndex].outs) {
+    std::map<uint64_t, size_t> outputsCounts;
+    walletOuts[walletIndex].wallet->container->getSpendableAmounts(outputsCounts);
+
+    for (const auto& outputsCount : outputsCounts) {
       uint8_t powerOfTen = 0;
-      if (m_currency.isAmountApplicableInFusionTransactionInput(out.amount, threshold, powerOfTen, m_node.getLastKnownBlockHeight())) {
-        allFusionReadyOuts.push_back({std::move(out), walletOuts[walletIndex].wallet});
+      if (m_currency.isAmountApplicableInFusionTransactionInput(outputsCount.first, threshold, powerOfTen, m_node.getLastKnownBlockHeight())) {
+        fusionReadyAmounts.emplace_back(walletOuts[walletIndex].wallet, outputsCount.first, powerOfTen);
         assert(powerOfTen < std::numeric_limits<uint64_t>::digits10 + 1);
-        bucketSizes[powerOfTen]++;
+        bucketSizes[powerOfTen] += outputsCount.second;
       }
     }
   }
@@ -1919,21 +1927,25 @@ std::vector<WalletGreen::OutputToTransfer> WalletGreen::pickRandomFusionInputs(u
   size_t selectedBucket = bucketNumbers[bucketNumberIndex];
   assert(selectedBucket < std::numeric_limits<uint64_t>::digits10 + 1);
   assert(bucketSizes[selectedBucket] >= minInputCount);
-  uint64_t lowerBound = 1;
-  for (size_t i = 0; i < selectedBucket; ++i) {
-    lowerBound *= 10;
-  }
-   
-  uint64_t upperBound = selectedBucket == std::numeric_limits<uint64_t>::digits10 ? UINT64_MAX : lowerBound * 10;
   std::vector<WalletGreen::OutputToTransfer> selectedOuts;
   selectedOuts.reserve(bucketSizes[selectedBucket]);
-  for (size_t outIndex = 0; outIndex < allFusionReadyOuts.size(); ++outIndex) {
-    if (allFusionReadyOuts[outIndex].out.amount >= lowerBound && allFusionReadyOuts[outIndex].out.amount < upperBound) {
-      selectedOuts.push_back(std::move(allFusionReadyOuts[outIndex]));
+  for (const auto& fusionReadyAmount : fusionReadyAmounts) {
+    if (std::get<2>(fusionReadyAmount) != selectedBucket) {
+      continue;
+    }
+
+    WalletRecord* wallet = std::get<0>(fusionReadyAmount);
+    std::vector<TransactionOutputInformation> outs;
+    wallet->container->getSpendableOutputs(std::get<1>(fusionReadyAmount), outs);
+    for (auto& out : outs) {
+      selectedOuts.push_back({std::move(out), wallet});
     }
   }
 
-  assert(selectedOuts.size() >= minInputCount);
+  // the outputs may have changed since the amounts were read
+  if (selectedOuts.size() < minInputCount) {
+    return {};
+  }
 
   auto outputsSortingFunction = [](const OutputToTransfer& l, const OutputToTransfer& r) { return l.out.amount < r.out.amount; };
   if (selectedOuts.size() <= maxInputCount) {
@@ -1957,7 +1969,7 @@ WalletGreen::WalletOuts WalletGreen::pickWallet(const std::string& address) {
 
   ITransfersContainer* containerPtr = walletRecord.container;
   WalletOuts walletOuts;
-  containerPtr->getOutputs(walletOuts.outs, ITransfersContainer::IncludeKeyUnlocked);
+  walletOuts.outsCount = containerPtr->spendableOutputsCount();
   walletOuts.wallet = const_cast<WalletRecord *>(&walletRecord);
 
   return walletOuts;
@@ -1969,7 +1981,7 @@ std::vector<WalletGreen::WalletOuts> WalletGreen::pickWallets(const std::vector<
 
   for (const std::string& address: addresses) {
     WalletOuts wallet = pickWallet(address);
-    if (!wallet.outs.empty()) {
+    if (wallet.outsCount > 0) {
       walletOuts.emplace_back(std::move(wallet));
     }
   }
@@ -1987,10 +1999,12 @@ std::vector<WalletGreen::WalletOuts> WalletGreen::pickWalletsWithMoney() const {
       ITransfersContainer* container = walletRecord.container;
 
       WalletOuts walletOuts;
-      container->getOutputs(walletOuts.outs, ITransfersContainer::IncludeKeyUnlocked);
+      walletOuts.outsCount = container->spendableOutputsCount();
       walletOuts.wallet = const_cast<WalletRecord *>(&walletRecord);
 
-      walletOutsVect.push_back(std::move(walletOuts));
+      if (walletOuts.outsCount > 0) {
+        walletOutsVect.push_back(std::move(walletOuts));
+      }
 
     }
   };
@@ -2151,33 +2165,50 @@ uint64_t WalletGreen::selectTransfers(uint64_t neededMoney, bool dust, uint64_t
 
   uint64_t foundMoney = 0;
 
-  std::vector<WalletOuts> walletOuts = wallets;
+  // outputs are picked by their index in the spendable index of each container, the shuffle generators
+  // give every index once without reading the outputs that are not picked
+  typedef ShuffleGenerator<size_t, Crypto::random_engine<size_t>> IndexGenerator;
+  struct WalletIndexes {
+    WalletRecord* wallet;
+    size_t outsLeft;
+    std::unique_ptr<IndexGenerator> generator;
+  };
+
+  std::vector<WalletIndexes> walletIndexes;
+  for (const WalletOuts& walletOuts : wallets) {
+    if (walletOuts.outsCount > 0) {
+      walletIndexes.push_back({ walletOuts.wallet, walletOuts.outsCount, std::unique_ptr<IndexGenerator>(new IndexGenerator(walletOuts.outsCount)) });
+    }
+  }
+
+  std::unordered_set<Crypto::PublicKey> selectedKeys;
   std::default_random_engine randomGenerator(Crypto::rand<std::default_random_engine::result_type>());
 
-  while (foundMoney < neededMoney && !walletOuts.empty()) {
-    std::uniform_int_distribution<size_t> walletsDistribution(0, walletOuts.size() - 1);
+  while (foundMoney < neededMoney && !walletIndexes.empty()) {
+    std::uniform_int_distribution<size_t> walletsDistribution(0, walletIndexes.size() - 1);
 
     size_t walletIndex = walletsDistribution(randomGenerator);
-    std::vector<TransactionOutputInformation>& addressOuts = walletOuts[walletIndex].outs;
+    WalletIndexes& addressIndexes = walletIndexes[walletIndex];
 
-    assert(addressOuts.size() > 0);
-    std::uniform_int_distribution<size_t> outDistribution(0, addressOuts.size() - 1);
-    size_t outIndex = outDistribution(randomGenerator);
+    assert(addressIndexes.outsLeft > 0);
+    size_t outIndex = (*addressIndexes.generator)();
 
-    TransactionOutputInformation out = addressOuts[outIndex];
-    if (out.amount > dustThreshold || dust) {
+    // the container can change while outputs are selected, an index past the end is skipped
+    TransactionOutputInformation out;
+    if (addressIndexes.wallet->container->getSpendableOutput(outIndex, out) && selectedKeys.count(out.outputKey) == 0 && (out.amount > dustThreshold || dust)) {
       if (out.amount <= dustThreshold) {
         dust = false;
       }
 
       foundMoney += out.amount;
 
-      selectedTransfers.push_back( { std::move(out), walletOuts[walletIndex].wallet } );
+      selectedKeys.insert(out.outputKey);
+      selectedTransfers.push_back( { std::move(out), addressIndexes.wallet } );
     }
 
-    addressOuts.erase(addressOuts.begin() + outIndex);
-    if (addressOuts.empty()) {
-      walletOuts.erase(walletOuts.begin() + walletIndex);
+    addressIndexes.outsLeft--;
+    if (addressIndexes.outsLeft == 0) {
+      walletIndexes.erase(walletIndexes.begin() + walletIndex);
     }
   }
 
@@ -2185,14 +2216,12 @@ uint64_t WalletGreen::selectTransfers(uint64_t neededMoney, bool dust, uint64_t
     return foundMoney;
   }
 
-  for (const auto& addressOuts : walletOuts) {
-    auto it = std::find_if(addressOuts.outs.begin(), addressOuts.outs.end(), [dustThreshold] (const TransactionOutputInformation& out) {
-      return out.amount <= dustThreshold;
-    });
-
-    if (it != addressOuts.outs.end()) {
-      foundMoney += it->amount;
-      selectedTransfers.push_back({ *it, addressOuts.wallet });
+  // the spendable index is ordered by amount, the first output is the smallest one
+  for (const WalletIndexes& addressIndexes : walletIndexes) {
+    TransactionOutputInformation out;
+    if (addressIndexes.wallet->container->getSpendableOutput(0, out) && out.amount <= dustThreshold && selectedKeys.count(out.outputKey) == 0) {
+      foundMoney += out.amount;
+      selectedTransfers.push_back({ std::move(out), addressIndexes.wallet });
       break;
     }
   }
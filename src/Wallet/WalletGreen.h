@@ -116,9 +116,10 @@ protected :
     std::vector<uint64_t> amounts;
   };
 
+  // outputs are read from the spendable index of the wallet container when they are selected
   struct WalletOuts {
     WalletRecord* wallet;
-    std::vector<TransactionOutputInformation> outs;
+    size_t outsCount;
   };
 
   typedef std::unordered_map<std::string, AddressAmounts> TransfersMap;
@@ -0,0 +1,208 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blake2b-backend.h"
+
+#if defined(BLAKE2B_X86)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <immintrin.h>
+
+#include "blake2-impl.h"
+#include "blake2b-lanes.h"
+
+// Built with -mavx2, only called when the CPU and the operating system support it. A vector holds four words, either a
+// whole row of the state of one message or the same word of four messages.
+
+// builds for CPUs with AVX-512 have a rotate instruction
+#if defined(__AVX512VL__)
+#define vrotr32(x) _mm256_ror_epi64((x), 32)
+#define vrotr24(x) _mm256_ror_epi64((x), 24)
+#define vrotr16(x) _mm256_ror_epi64((x), 16)
+#define vrotr63(x) _mm256_ror_epi64((x), 63)
+#else
+static inline __m256i vrotr32(__m256i x)
+{
+  return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline __m256i vrotr24(__m256i x)
+{
+  return _mm256_shuffle_epi8(x, _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                                 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+}
+
+static inline __m256i vrotr16(__m256i x)
+{
+  return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                                 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+}
+
+static inline __m256i vrotr63(__m256i x)
+{
+  return _mm256_xor_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x));
+}
+#endif
+
+static inline void g(__m256i *a, __m256i *b, __m256i *c, __m256i *d, __m256i x, __m256i y)
+{
+  *a = _mm256_add_epi64(_mm256_add_epi64(*a, *b), x);
+  *d = vrotr32(_mm256_xor_si256(*d, *a));
+  *c = _mm256_add_epi64(*c, *d);
+  *b = vrotr24(_mm256_xor_si256(*b, *c));
+  *a = _mm256_add_epi64(_mm256_add_epi64(*a, *b), y);
+  *d = vrotr16(_mm256_xor_si256(*d, *a));
+  *c = _mm256_add_epi64(*c, *d);
+  *b = vrotr63(_mm256_xor_si256(*b, *c));
+}
+
+static inline __m256i load(const uint64_t *p)
+{
+  return _mm256_loadu_si256((const __m256i *)p);
+}
+
+static inline void store(uint64_t *p, __m256i x)
+{
+  _mm256_storeu_si256((__m256i *)p, x);
+}
+
+// words a and b of the message held in pairs in m, the indexes are constants so one instruction is left
+static inline __m128i message_words(const __m128i *m, size_t a, size_t b)
+{
+  if (a % 2 == 0) {
+    return b % 2 == 0 ? _mm_unpacklo_epi64(m[a / 2], m[b / 2]) : _mm_blend_epi16(m[a / 2], m[b / 2], 0xf0);
+  }
+
+  return b % 2 == 0 ? _mm_alignr_epi8(m[b / 2], m[a / 2], 8) : _mm_unpackhi_epi64(m[a / 2], m[b / 2]);
+}
+
+static inline __m256i message_words4(const __m128i *m, size_t a, size_t b, size_t c, size_t d)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(message_words(m, a, b)), message_words(m, c, d), 1);
+}
+
+// the diagonal steps rotate rows 2 to 4 so the words of each diagonal are in one column
+#define MSG(r, i, j, k, l) message_words4(m, blake2b_lanes_sigma[r][i], blake2b_lanes_sigma[r][j], blake2b_lanes_sigma[r][k], blake2b_lanes_sigma[r][l])
+
+#define ROUND(r)                                                                  \
+  do {                                                                            \
+    g(&row1, &row2, &row3, &row4, MSG(r, 0, 2, 4, 6), MSG(r, 1, 3, 5, 7));        \
+    row2 = _mm256_permute4x64_epi64(row2, _MM_SHUFFLE(0, 3, 2, 1));               \
+    row3 = _mm256_permute4x64_epi64(row3, _MM_SHUFFLE(1, 0, 3, 2));               \
+    row4 = _mm256_permute4x64_epi64(row4, _MM_SHUFFLE(2, 1, 0, 3));               \
+    g(&row1, &row2, &row3, &row4, MSG(r, 8, 10, 12, 14), MSG(r, 9, 11, 13, 15));  \
+    row2 = _mm256_permute4x64_epi64(row2, _MM_SHUFFLE(2, 1, 0, 3));               \
+    row3 = _mm256_permute4x64_epi64(row3, _MM_SHUFFLE(1, 0, 3, 2));               \
+    row4 = _mm256_permute4x64_epi64(row4, _MM_SHUFFLE(0, 3, 2, 1));               \
+  } while (0)
+
+void blake2b_compress_avx2(blake2b_state *S, const uint8_t *block)
+{
+  __m128i m[8];
+  __m256i row1, row2, row3, row4;
+  size_t i;
+
+  for (i = 0; i < 8; ++i) {
+    m[i] = _mm_loadu_si128((const __m128i *)(block + i * sizeof(__m128i)));
+  }
+
+  row1 = load(&S->h[0]);
+  row2 = load(&S->h[4]);
+  row3 = load(&blake2b_lanes_IV[0]);
+  row4 = _mm256_xor_si256(load(&blake2b_lanes_IV[4]), _mm256_set_epi64x((int64_t)S->f[1], (int64_t)S->f[0], (int64_t)S->t[1], (int64_t)S->t[0]));
+
+  ROUND(0);
+  ROUND(1);
+  ROUND(2);
+  ROUND(3);
+  ROUND(4);
+  ROUND(5);
+  ROUND(6);
+  ROUND(7);
+  ROUND(8);
+  ROUND(9);
+  ROUND(10);
+  ROUND(11);
+
+  store(&S->h[0], _mm256_xor_si256(load(&S->h[0]), _mm256_xor_si256(row1, row3)));
+  store(&S->h[4], _mm256_xor_si256(load(&S->h[4]), _mm256_xor_si256(row2, row4)));
+}
+
+#undef MSG
+#undef ROUND
+
+// vectors is the number of vectors per word, 1 for 4 lanes and 2 for 8 lanes
+#define LANES_STEP(r, i, a, b, c, d)                                                                      \
+  do {                                                                                                    \
+    for (k = 0; k < vectors; ++k) {                                                                       \
+      g(&v[a][k], &v[b][k], &v[c][k], &v[d][k], load(&m[blake2b_lanes_sigma[r][2 * i] * lanes + 4 * k]), \
+        load(&m[blake2b_lanes_sigma[r][2 * i + 1] * lanes + 4 * k]));                                     \
+    }                                                                                                     \
+  } while (0)
+
+#define LANES_ROUND_AVX2(r)                 \
+  do {                                      \
+    LANES_STEP(r, 0, 0, 4,  8, 12);         \
+    LANES_STEP(r, 1, 1, 5,  9, 13);         \
+    LANES_STEP(r, 2, 2, 6, 10, 14);         \
+    LANES_STEP(r, 3, 3, 7, 11, 15);         \
+    LANES_STEP(r, 4, 0, 5, 10, 15);         \
+    LANES_STEP(r, 5, 1, 6, 11, 12);         \
+    LANES_STEP(r, 6, 2, 7,  8, 13);         \
+    LANES_STEP(r, 7, 3, 4,  9, 14);         \
+  } while (0)
+
+static inline void compress_lanes(const size_t vectors, uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  const size_t lanes = 4 * vectors;
+  __m256i v[16][2];
+  size_t i;
+  size_t k;
+
+  for (k = 0; k < vectors; ++k) {
+    for (i = 0; i < 8; ++i) {
+      v[i][k] = load(&h[i * lanes + 4 * k]);
+      v[i + 8][k] = _mm256_set1_epi64x((int64_t)blake2b_lanes_IV[i]);
+    }
+
+    v[12][k] = _mm256_xor_si256(v[12][k], load(&t[4 * k]));
+    v[14][k] = _mm256_xor_si256(v[14][k], load(&f[4 * k]));
+  }
+
+  LANES_ROUND_AVX2(0);
+  LANES_ROUND_AVX2(1);
+  LANES_ROUND_AVX2(2);
+  LANES_ROUND_AVX2(3);
+  LANES_ROUND_AVX2(4);
+  LANES_ROUND_AVX2(5);
+  LANES_ROUND_AVX2(6);
+  LANES_ROUND_AVX2(7);
+  LANES_ROUND_AVX2(8);
+  LANES_ROUND_AVX2(9);
+  LANES_ROUND_AVX2(10);
+  LANES_ROUND_AVX2(11);
+
+  for (k = 0; k < vectors; ++k) {
+    for (i = 0; i < 8; ++i) {
+      store(&h[i * lanes + 4 * k], _mm256_xor_si256(load(&h[i * lanes + 4 * k]), _mm256_xor_si256(v[i][k], v[i + 8][k])));
+    }
+  }
+}
+
+#undef LANES_STEP
+#undef LANES_ROUND_AVX2
+
+void blake2b_compress_x4_avx2(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  compress_lanes(1, h, m, t, f);
+}
+
+void blake2b_compress_x8_avx2(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  compress_lanes(2, h, m, t, f);
+}
+
+#endif
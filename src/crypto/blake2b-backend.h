@@ -0,0 +1,80 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blake2.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLAKE2B_X86
+// the NEON backend has not been run on an ARM64 CPU yet, it is only built with the BLAKE2B_NEON CMake option
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && defined(BLAKE2B_NEON)
+#define BLAKE2B_ARM64
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// The BLAKE2b compression functions, all of them give the same results. The fastest backend the CPU supports is
+// selected when the program starts and is used by blake2b_x4() and blake2b_x8(). blake2b(), and so cn_fast_hash(),
+// tree_hash() and the proof of work, keeps the reference compression, see detect_blake2b().
+enum blake2b_backend {
+  BLAKE2B_BACKEND_REF,
+  BLAKE2B_BACKEND_SSE41,
+  BLAKE2B_BACKEND_AVX2,
+  BLAKE2B_BACKEND_NEON,
+  BLAKE2B_BACKEND_COUNT
+};
+
+const char *blake2b_backend_name(enum blake2b_backend backend);
+int blake2b_backend_supported(enum blake2b_backend backend);
+enum blake2b_backend blake2b_get_backend(void);
+// for tests and benchmarks, selects the backend for blake2b() too, returns -1 if the CPU does not support the backend,
+// must not be called while other threads are hashing
+int blake2b_set_backend(enum blake2b_backend backend);
+
+// unkeyed BLAKE2b of 4 or 8 independent messages hashed side by side, the digests are written one after the other to
+// out, same results as blake2b() on each message
+// the messages are compressed in lockstep, so a call takes as long as hashing its longest message
+int blake2b_x4(void *out, size_t outlen, const void *const *in, const size_t *inlen);
+int blake2b_x8(void *out, size_t outlen, const void *const *in, const size_t *inlen);
+
+// Implementations of the backends. blake2b_compress_x4_*() and blake2b_compress_x8_*() compress one block of each of
+// 4 or 8 messages, word i of lane l of h and m is at [i * lanes + l], t is the byte count and f the last block flag of
+// each lane.
+
+typedef void (*blake2b_compress_fn)(blake2b_state *S, const uint8_t *block);
+typedef void (*blake2b_compress_lanes_fn)(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+
+extern blake2b_compress_fn blake2b_compress_fp;
+extern blake2b_compress_lanes_fn blake2b_compress_x4_fp;
+extern blake2b_compress_lanes_fn blake2b_compress_x8_fp;
+
+void blake2b_compress_ref(blake2b_state *S, const uint8_t *block);
+void blake2b_compress_x4_ref(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+void blake2b_compress_x8_ref(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+
+#if defined(BLAKE2B_X86)
+void blake2b_compress_sse41(blake2b_state *S, const uint8_t *block);
+void blake2b_compress_x4_sse41(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+void blake2b_compress_x8_sse41(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+
+void blake2b_compress_avx2(blake2b_state *S, const uint8_t *block);
+void blake2b_compress_x4_avx2(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+void blake2b_compress_x8_avx2(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+#endif
+
+#if defined(BLAKE2B_ARM64)
+void blake2b_compress_neon(blake2b_state *S, const uint8_t *block);
+void blake2b_compress_x4_neon(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+void blake2b_compress_x8_neon(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f);
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
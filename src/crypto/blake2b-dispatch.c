@@ -0,0 +1,144 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blake2b-backend.h"
+#include "initializer.h"
+
+#if defined(BLAKE2B_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+struct blake2b_backend_functions {
+  const char *name;
+  blake2b_compress_fn compress;
+  blake2b_compress_lanes_fn compress_x4;
+  blake2b_compress_lanes_fn compress_x8;
+};
+
+static const struct blake2b_backend_functions backends[BLAKE2B_BACKEND_COUNT] = {
+  { "ref", &blake2b_compress_ref, &blake2b_compress_x4_ref, &blake2b_compress_x8_ref },
+#if defined(BLAKE2B_X86)
+  { "sse4.1", &blake2b_compress_sse41, &blake2b_compress_x4_sse41, &blake2b_compress_x8_sse41 },
+  { "avx2", &blake2b_compress_avx2, &blake2b_compress_x4_avx2, &blake2b_compress_x8_avx2 },
+#else
+  { "sse4.1", NULL, NULL, NULL },
+  { "avx2", NULL, NULL, NULL },
+#endif
+#if defined(BLAKE2B_ARM64)
+  { "neon", &blake2b_compress_neon, &blake2b_compress_x4_neon, &blake2b_compress_x8_neon }
+#else
+  { "neon", NULL, NULL, NULL }
+#endif
+};
+
+// the reference functions until detect_blake2b() has run, so hashing from other initializers works
+blake2b_compress_fn blake2b_compress_fp = &blake2b_compress_ref;
+blake2b_compress_lanes_fn blake2b_compress_x4_fp = &blake2b_compress_x4_ref;
+blake2b_compress_lanes_fn blake2b_compress_x8_fp = &blake2b_compress_x8_ref;
+
+static enum blake2b_backend current_backend = BLAKE2B_BACKEND_REF;
+static int supported_backends = 1 << BLAKE2B_BACKEND_REF;
+
+#if defined(BLAKE2B_X86)
+static void cpuid(int leaf, int registers[4]) {
+#if defined(_MSC_VER)
+  __cpuidex(registers, leaf, 0);
+#else
+  __cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// the register state the operating system saves on context switches
+static uint64_t xgetbv0(void) {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax;
+  uint32_t edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static int detect_x86_backends(void) {
+  int registers[4];
+  int supported = 0;
+  int max_leaf;
+
+  cpuid(0, registers);
+  max_leaf = registers[0];
+  if (max_leaf < 1) {
+    return 0;
+  }
+
+  cpuid(1, registers);
+  // SSSE3 is used for the byte shuffles
+  if ((registers[2] & (1 << 9)) && (registers[2] & (1 << 19))) {
+    supported |= 1 << BLAKE2B_BACKEND_SSE41;
+  }
+
+  // AVX2 needs OSXSAVE, AVX and the XMM and YMM registers enabled by the operating system
+  if ((registers[2] & (1 << 27)) && (registers[2] & (1 << 28)) && (xgetbv0() & 6) == 6 && max_leaf >= 7) {
+    cpuid(7, registers);
+    if (registers[1] & (1 << 5)) {
+      supported |= 1 << BLAKE2B_BACKEND_AVX2;
+    }
+  }
+
+  return supported;
+}
+#endif
+
+const char *blake2b_backend_name(enum blake2b_backend backend) {
+  return backend < BLAKE2B_BACKEND_COUNT ? backends[backend].name : "";
+}
+
+int blake2b_backend_supported(enum blake2b_backend backend) {
+  return backend < BLAKE2B_BACKEND_COUNT && (supported_backends & (1 << backend)) != 0;
+}
+
+enum blake2b_backend blake2b_get_backend(void) {
+  return current_backend;
+}
+
+int blake2b_set_backend(enum blake2b_backend backend) {
+  if (!blake2b_backend_supported(backend)) {
+    return -1;
+  }
+
+  blake2b_compress_fp = backends[backend].compress;
+  blake2b_compress_x4_fp = backends[backend].compress_x4;
+  blake2b_compress_x8_fp = backends[backend].compress_x8;
+  current_backend = backend;
+  return 0;
+}
+
+INITIALIZER(detect_blake2b) {
+  int backend;
+
+#if defined(BLAKE2B_X86)
+  supported_backends |= detect_x86_backends();
+#elif defined(BLAKE2B_ARM64)
+  // NEON is part of every ARMv8-A CPU
+  supported_backends |= 1 << BLAKE2B_BACKEND_NEON;
+#endif
+
+  // the later backends are the faster ones
+  for (backend = BLAKE2B_BACKEND_COUNT - 1; backend > BLAKE2B_BACKEND_REF; --backend) {
+    if (blake2b_set_backend((enum blake2b_backend)backend) == 0) {
+      break;
+    }
+  }
+
+  // the steps of one message depend on each other, so the vector compressions of a single message have no more than
+  // the scalar code to work with and hash_benchmark measured them slower than the reference one
+  blake2b_compress_fp = &blake2b_compress_ref;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blake2-impl.h"
+
+// BLAKE2b compression of one block for BLAKE2B_LANES messages side by side, v and m are [16][BLAKE2B_LANES] arrays.
+// The lane loops have no dependencies between lanes so the compiler can turn them into vector code.
+
+#define BLAKE2B_LANES 4
+
+static const uint64_t blake2b_lanes_IV[8] =
+{
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+  0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+  0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t blake2b_lanes_sigma[12][16] =
+{
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 } ,
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 } ,
+  { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 } ,
+  {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 } ,
+  {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 } ,
+  {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 } ,
+  { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 } ,
+  { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 } ,
+  {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 } ,
+  { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 } ,
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 } ,
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+// positions of a, b, c and d in the working vector for the 8 steps of a round
+static const uint8_t blake2b_lanes_steps[8][4] =
+{
+  { 0, 4,  8, 12 },
+  { 1, 5,  9, 13 },
+  { 2, 6, 10, 14 },
+  { 3, 7, 11, 15 },
+  { 0, 5, 10, 15 },
+  { 1, 6, 11, 12 },
+  { 2, 7,  8, 13 },
+  { 3, 4,  9, 14 }
+};
+
+// step i of round r for a single message
+static inline void blake2b_lanes_step(uint64_t *v, const uint64_t *m, size_t r, size_t i)
+{
+  uint64_t *a = &v[blake2b_lanes_steps[i][0]];
+  uint64_t *b = &v[blake2b_lanes_steps[i][1]];
+  uint64_t *c = &v[blake2b_lanes_steps[i][2]];
+  uint64_t *d = &v[blake2b_lanes_steps[i][3]];
+
+  *a = *a + *b + m[blake2b_lanes_sigma[r][2 * i + 0]];
+  *d = rotr64(*d ^ *a, 32);
+  *c = *c + *d;
+  *b = rotr64(*b ^ *c, 24);
+  *a = *a + *b + m[blake2b_lanes_sigma[r][2 * i + 1]];
+  *d = rotr64(*d ^ *a, 16);
+  *c = *c + *d;
+  *b = rotr64(*b ^ *c, 63);
+}
+
+#define LANES_G(r, i, a, b, c, d)                                               \
+  do {                                                                          \
+    const uint64_t *x = m[blake2b_lanes_sigma[r][2 * i + 0]];                      \
+    const uint64_t *y = m[blake2b_lanes_sigma[r][2 * i + 1]];                      \
+    for (size_t l = 0; l < BLAKE2B_LANES; ++l) {                             \
+      v[a][l] = v[a][l] + v[b][l] + x[l];                                       \
+      v[d][l] = rotr64(v[d][l] ^ v[a][l], 32);                                  \
+      v[c][l] = v[c][l] + v[d][l];                                              \
+      v[b][l] = rotr64(v[b][l] ^ v[c][l], 24);                                  \
+      v[a][l] = v[a][l] + v[b][l] + y[l];                                       \
+      v[d][l] = rotr64(v[d][l] ^ v[a][l], 16);                                  \
+      v[c][l] = v[c][l] + v[d][l];                                              \
+      v[b][l] = rotr64(v[b][l] ^ v[c][l], 63);                                  \
+    }                                                                           \
+  } while (0)
+
+#define LANES_ROUND(r)                  \
+  do {                                  \
+    LANES_G(r, 0, 0, 4,  8, 12);        \
+    LANES_G(r, 1, 1, 5,  9, 13);        \
+    LANES_G(r, 2, 2, 6, 10, 14);        \
+    LANES_G(r, 3, 3, 7, 11, 15);        \
+    LANES_G(r, 4, 0, 5, 10, 15);        \
+    LANES_G(r, 5, 1, 6, 11, 12);        \
+    LANES_G(r, 6, 2, 7,  8, 13);        \
+    LANES_G(r, 7, 3, 4,  9, 14);        \
+  } while (0)
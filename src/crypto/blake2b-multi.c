@@ -0,0 +1,197 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hash-ops.h"
+#include "blake2b-backend.h"
+#include "blake2b-lanes.h"
+
+_Static_assert(BLAKE2B_LANES == 4, "the reference x4 compression is the one of blake2b-lanes.h");
+
+void blake2b_compress_x4_ref(uint64_t *h, const uint64_t *m_words, const uint64_t *t, const uint64_t *f)
+{
+  const uint64_t (*m)[BLAKE2B_LANES] = (const uint64_t (*)[BLAKE2B_LANES])m_words;
+  uint64_t v[16][BLAKE2B_LANES];
+  size_t i;
+  size_t l;
+
+  for (l = 0; l < BLAKE2B_LANES; ++l) {
+    for (i = 0; i < 8; ++i) {
+      v[i][l] = h[i * BLAKE2B_LANES + l];
+      v[i + 8][l] = blake2b_lanes_IV[i];
+    }
+
+    v[12][l] ^= t[l];
+    v[14][l] ^= f[l];
+  }
+
+  LANES_ROUND(0);
+  LANES_ROUND(1);
+  LANES_ROUND(2);
+  LANES_ROUND(3);
+  LANES_ROUND(4);
+  LANES_ROUND(5);
+  LANES_ROUND(6);
+  LANES_ROUND(7);
+  LANES_ROUND(8);
+  LANES_ROUND(9);
+  LANES_ROUND(10);
+  LANES_ROUND(11);
+
+  for (i = 0; i < 8; ++i) {
+    for (l = 0; l < BLAKE2B_LANES; ++l) {
+      h[i * BLAKE2B_LANES + l] ^= v[i][l] ^ v[i + 8][l];
+    }
+  }
+}
+
+// two groups of 4 lanes
+void blake2b_compress_x8_ref(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  uint64_t group_h[8 * BLAKE2B_LANES];
+  uint64_t group_m[16 * BLAKE2B_LANES];
+  size_t group;
+  size_t i;
+
+  for (group = 0; group < 2; ++group) {
+    for (i = 0; i < 8; ++i) {
+      memcpy(&group_h[i * BLAKE2B_LANES], &h[i * 8 + group * BLAKE2B_LANES], sizeof(uint64_t) * BLAKE2B_LANES);
+    }
+
+    for (i = 0; i < 16; ++i) {
+      memcpy(&group_m[i * BLAKE2B_LANES], &m[i * 8 + group * BLAKE2B_LANES], sizeof(uint64_t) * BLAKE2B_LANES);
+    }
+
+    blake2b_compress_x4_ref(group_h, group_m, t + group * BLAKE2B_LANES, f + group * BLAKE2B_LANES);
+
+    for (i = 0; i < 8; ++i) {
+      memcpy(&h[i * 8 + group * BLAKE2B_LANES], &group_h[i * BLAKE2B_LANES], sizeof(uint64_t) * BLAKE2B_LANES);
+    }
+  }
+}
+
+// A lane that has compressed its last block writes its digest and is then compressed on zeros until the longest
+// message is done.
+static int blake2b_lanes(size_t lanes, blake2b_compress_lanes_fn compress, void *out, size_t outlen, const void *const *in, const size_t *inlen)
+{
+  uint64_t h[8 * 8];
+  uint64_t m[16 * 8];
+  uint64_t t[8];
+  uint64_t f[8];
+  size_t blocks[8];
+  size_t block_count = 0;
+  size_t block;
+  size_t i;
+  size_t l;
+
+  if (out == NULL || outlen == 0 || outlen > BLAKE2B_OUTBYTES) {
+    return -1;
+  }
+
+  for (l = 0; l < lanes; ++l) {
+    if (in[l] == NULL && inlen[l] > 0) {
+      return -1;
+    }
+
+    // an empty message is one block of zeros
+    blocks[l] = inlen[l] == 0 ? 1 : (inlen[l] + BLAKE2B_BLOCKBYTES - 1) / BLAKE2B_BLOCKBYTES;
+    if (blocks[l] > block_count) {
+      block_count = blocks[l];
+    }
+
+    // digest length outlen, no key, fanout 1, depth 1
+    for (i = 0; i < 8; ++i) {
+      h[i * lanes + l] = blake2b_lanes_IV[i];
+    }
+
+    h[l] ^= 0x01010000ULL ^ outlen;
+  }
+
+  for (block = 0; block < block_count; ++block) {
+    for (l = 0; l < lanes; ++l) {
+      uint8_t buffer[BLAKE2B_BLOCKBYTES];
+      const uint8_t *data = buffer;
+
+      if (block + 1 < blocks[l]) {
+        data = (const uint8_t *)in[l] + block * BLAKE2B_BLOCKBYTES;
+        t[l] = (block + 1) * BLAKE2B_BLOCKBYTES;
+        f[l] = 0;
+      } else {
+        memset(buffer, 0, sizeof(buffer));
+        if (block + 1 == blocks[l]) {
+          if (inlen[l] > 0) {
+            memcpy(buffer, (const uint8_t *)in[l] + block * BLAKE2B_BLOCKBYTES, inlen[l] - block * BLAKE2B_BLOCKBYTES);
+          }
+
+          f[l] = (uint64_t)-1;
+        } else {
+          f[l] = 0;
+        }
+
+        t[l] = inlen[l];
+      }
+
+      for (i = 0; i < 16; ++i) {
+        m[i * lanes + l] = load64(data + i * sizeof(uint64_t));
+      }
+    }
+
+    compress(h, m, t, f);
+
+    for (l = 0; l < lanes; ++l) {
+      if (block + 1 == blocks[l]) {
+        uint8_t digest[BLAKE2B_OUTBYTES];
+        for (i = 0; i < 8; ++i) {
+          store64(digest + i * sizeof(uint64_t), h[i * lanes + l]);
+        }
+
+        memcpy((uint8_t *)out + l * outlen, digest, outlen);
+      }
+    }
+  }
+
+  return 0;
+}
+
+int blake2b_x4(void *out, size_t outlen, const void *const *in, const size_t *inlen)
+{
+  return blake2b_lanes(4, blake2b_compress_x4_fp, out, outlen, in, inlen);
+}
+
+int blake2b_x8(void *out, size_t outlen, const void *const *in, const size_t *inlen)
+{
+  return blake2b_lanes(8, blake2b_compress_x8_fp, out, outlen, in, inlen);
+}
+
+void cn_fast_hash_many(const void *const *data, const size_t *lengths, size_t count, char *hashes)
+{
+  // without vector instructions the lanes are slower than one message at a time
+  if (blake2b_get_backend() == BLAKE2B_BACKEND_REF) {
+    count = 0;
+  }
+
+  while (count >= 8) {
+    blake2b_x8(hashes, HASH_SIZE, data, lengths);
+    data += 8;
+    lengths += 8;
+    hashes += 8 * HASH_SIZE;
+    count -= 8;
+  }
+
+  if (count >= 4) {
+    blake2b_x4(hashes, HASH_SIZE, data, lengths);
+    data += 4;
+    lengths += 4;
+    hashes += 4 * HASH_SIZE;
+    count -= 4;
+  }
+
+  for (; count > 0; --count) {
+    cn_fast_hash(*data++, *lengths++, hashes);
+    hashes += HASH_SIZE;
+  }
+}
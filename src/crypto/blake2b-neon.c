@@ -0,0 +1,193 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blake2b-backend.h"
+
+#if defined(BLAKE2B_ARM64)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <arm_neon.h>
+
+#include "blake2-impl.h"
+#include "blake2b-lanes.h"
+
+// A vector holds two words, either two columns of the state of one message or the same word of two messages.
+
+static inline uint64x2_t vrotr32(uint64x2_t x)
+{
+  return vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(x)));
+}
+
+static inline uint64x2_t vrotr24(uint64x2_t x)
+{
+  return vsriq_n_u64(vshlq_n_u64(x, 40), x, 24);
+}
+
+static inline uint64x2_t vrotr16(uint64x2_t x)
+{
+  return vsriq_n_u64(vshlq_n_u64(x, 48), x, 16);
+}
+
+static inline uint64x2_t vrotr63(uint64x2_t x)
+{
+  return vsriq_n_u64(vshlq_n_u64(x, 1), x, 63);
+}
+
+static inline void g(uint64x2_t *a, uint64x2_t *b, uint64x2_t *c, uint64x2_t *d, uint64x2_t x, uint64x2_t y)
+{
+  *a = vaddq_u64(vaddq_u64(*a, *b), x);
+  *d = vrotr32(veorq_u64(*d, *a));
+  *c = vaddq_u64(*c, *d);
+  *b = vrotr24(veorq_u64(*b, *c));
+  *a = vaddq_u64(vaddq_u64(*a, *b), y);
+  *d = vrotr16(veorq_u64(*d, *a));
+  *c = vaddq_u64(*c, *d);
+  *b = vrotr63(veorq_u64(*b, *c));
+}
+
+// the rows are split in a low half of columns 0 and 1 and a high half of columns 2 and 3, vextq_u64(x, y, 1) is the
+// high word of x followed by the low word of y
+#define MSG(r, i, j) vcombine_u64(vcreate_u64(m[blake2b_lanes_sigma[r][i]]), vcreate_u64(m[blake2b_lanes_sigma[r][j]]))
+
+#define ROUND(r)                                                                 \
+  do {                                                                           \
+    uint64x2_t t0;                                                               \
+    uint64x2_t t1;                                                               \
+    g(&row1l, &row2l, &row3l, &row4l, MSG(r, 0, 2), MSG(r, 1, 3));               \
+    g(&row1h, &row2h, &row3h, &row4h, MSG(r, 4, 6), MSG(r, 5, 7));               \
+    t0 = vextq_u64(row2l, row2h, 1);                                             \
+    t1 = vextq_u64(row2h, row2l, 1);                                             \
+    row2l = t0; row2h = t1;                                                      \
+    t0 = row3l; row3l = row3h; row3h = t0;                                       \
+    t0 = vextq_u64(row4h, row4l, 1);                                             \
+    t1 = vextq_u64(row4l, row4h, 1);                                             \
+    row4l = t0; row4h = t1;                                                      \
+    g(&row1l, &row2l, &row3l, &row4l, MSG(r, 8, 10), MSG(r, 9, 11));             \
+    g(&row1h, &row2h, &row3h, &row4h, MSG(r, 12, 14), MSG(r, 13, 15));           \
+    t0 = vextq_u64(row2h, row2l, 1);                                             \
+    t1 = vextq_u64(row2l, row2h, 1);                                             \
+    row2l = t0; row2h = t1;                                                      \
+    t0 = row3l; row3l = row3h; row3h = t0;                                       \
+    t0 = vextq_u64(row4l, row4h, 1);                                             \
+    t1 = vextq_u64(row4h, row4l, 1);                                             \
+    row4l = t0; row4h = t1;                                                      \
+  } while (0)
+
+void blake2b_compress_neon(blake2b_state *S, const uint8_t *block)
+{
+  uint64_t m[16];
+  uint64x2_t row1l, row1h, row2l, row2h, row3l, row3h, row4l, row4h;
+  size_t i;
+
+  for (i = 0; i < 16; ++i) {
+    m[i] = load64(block + i * sizeof(uint64_t));
+  }
+
+  row1l = vld1q_u64(&S->h[0]);
+  row1h = vld1q_u64(&S->h[2]);
+  row2l = vld1q_u64(&S->h[4]);
+  row2h = vld1q_u64(&S->h[6]);
+  row3l = vld1q_u64(&blake2b_lanes_IV[0]);
+  row3h = vld1q_u64(&blake2b_lanes_IV[2]);
+  row4l = veorq_u64(vld1q_u64(&blake2b_lanes_IV[4]), vld1q_u64(S->t));
+  row4h = veorq_u64(vld1q_u64(&blake2b_lanes_IV[6]), vld1q_u64(S->f));
+
+  ROUND(0);
+  ROUND(1);
+  ROUND(2);
+  ROUND(3);
+  ROUND(4);
+  ROUND(5);
+  ROUND(6);
+  ROUND(7);
+  ROUND(8);
+  ROUND(9);
+  ROUND(10);
+  ROUND(11);
+
+  vst1q_u64(&S->h[0], veorq_u64(vld1q_u64(&S->h[0]), veorq_u64(row1l, row3l)));
+  vst1q_u64(&S->h[2], veorq_u64(vld1q_u64(&S->h[2]), veorq_u64(row1h, row3h)));
+  vst1q_u64(&S->h[4], veorq_u64(vld1q_u64(&S->h[4]), veorq_u64(row2l, row4l)));
+  vst1q_u64(&S->h[6], veorq_u64(vld1q_u64(&S->h[6]), veorq_u64(row2h, row4h)));
+}
+
+#undef MSG
+#undef ROUND
+
+// 4 of the lanes, starting with lane first, as 2 vectors per word
+#define LANES_STEP(r, i, a, b, c, d)                                                                               \
+  do {                                                                                                             \
+    for (k = 0; k < 2; ++k) {                                                                                      \
+      g(&v[a][k], &v[b][k], &v[c][k], &v[d][k], vld1q_u64(&m[blake2b_lanes_sigma[r][2 * i] * lanes + first + 2 * k]), \
+        vld1q_u64(&m[blake2b_lanes_sigma[r][2 * i + 1] * lanes + first + 2 * k]));                                 \
+    }                                                                                                              \
+  } while (0)
+
+#define LANES_ROUND_NEON(r)                 \
+  do {                                      \
+    LANES_STEP(r, 0, 0, 4,  8, 12);         \
+    LANES_STEP(r, 1, 1, 5,  9, 13);         \
+    LANES_STEP(r, 2, 2, 6, 10, 14);         \
+    LANES_STEP(r, 3, 3, 7, 11, 15);         \
+    LANES_STEP(r, 4, 0, 5, 10, 15);         \
+    LANES_STEP(r, 5, 1, 6, 11, 12);         \
+    LANES_STEP(r, 6, 2, 7,  8, 13);         \
+    LANES_STEP(r, 7, 3, 4,  9, 14);         \
+  } while (0)
+
+static inline void compress_lanes(const size_t lanes, const size_t first, uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  uint64x2_t v[16][2];
+  size_t i;
+  size_t k;
+
+  for (k = 0; k < 2; ++k) {
+    for (i = 0; i < 8; ++i) {
+      v[i][k] = vld1q_u64(&h[i * lanes + first + 2 * k]);
+      v[i + 8][k] = vdupq_n_u64(blake2b_lanes_IV[i]);
+    }
+
+    v[12][k] = veorq_u64(v[12][k], vld1q_u64(&t[first + 2 * k]));
+    v[14][k] = veorq_u64(v[14][k], vld1q_u64(&f[first + 2 * k]));
+  }
+
+  LANES_ROUND_NEON(0);
+  LANES_ROUND_NEON(1);
+  LANES_ROUND_NEON(2);
+  LANES_ROUND_NEON(3);
+  LANES_ROUND_NEON(4);
+  LANES_ROUND_NEON(5);
+  LANES_ROUND_NEON(6);
+  LANES_ROUND_NEON(7);
+  LANES_ROUND_NEON(8);
+  LANES_ROUND_NEON(9);
+  LANES_ROUND_NEON(10);
+  LANES_ROUND_NEON(11);
+
+  for (k = 0; k < 2; ++k) {
+    for (i = 0; i < 8; ++i) {
+      uint64_t *word = &h[i * lanes + first + 2 * k];
+      vst1q_u64(word, veorq_u64(vld1q_u64(word), veorq_u64(v[i][k], v[i + 8][k])));
+    }
+  }
+}
+
+#undef LANES_STEP
+#undef LANES_ROUND_NEON
+
+void blake2b_compress_x4_neon(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  compress_lanes(4, 0, h, m, t, f);
+}
+
+// the state of two groups of 4 lanes does not fit in the registers
+void blake2b_compress_x8_neon(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  compress_lanes(8, 0, h, m, t, f);
+  compress_lanes(8, 4, h, m, t, f);
+}
+
+#endif
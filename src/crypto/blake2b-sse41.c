@@ -0,0 +1,224 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blake2b-backend.h"
+
+#if defined(BLAKE2B_X86)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smmintrin.h>
+
+#include "blake2-impl.h"
+#include "blake2b-lanes.h"
+
+// Built with -msse4.1, only called when the CPU has it. A vector holds two words, either two columns of the state of
+// one message or the same word of two messages.
+
+// builds for CPUs with AVX-512 have a rotate instruction
+#if defined(__AVX512VL__)
+#include <immintrin.h>
+
+#define vrotr32(x) _mm_ror_epi64((x), 32)
+#define vrotr24(x) _mm_ror_epi64((x), 24)
+#define vrotr16(x) _mm_ror_epi64((x), 16)
+#define vrotr63(x) _mm_ror_epi64((x), 63)
+#else
+static inline __m128i vrotr32(__m128i x)
+{
+  return _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline __m128i vrotr24(__m128i x)
+{
+  return _mm_shuffle_epi8(x, _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+}
+
+static inline __m128i vrotr16(__m128i x)
+{
+  return _mm_shuffle_epi8(x, _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+}
+
+static inline __m128i vrotr63(__m128i x)
+{
+  return _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x));
+}
+#endif
+
+static inline void g(__m128i *a, __m128i *b, __m128i *c, __m128i *d, __m128i x, __m128i y)
+{
+  *a = _mm_add_epi64(_mm_add_epi64(*a, *b), x);
+  *d = vrotr32(_mm_xor_si128(*d, *a));
+  *c = _mm_add_epi64(*c, *d);
+  *b = vrotr24(_mm_xor_si128(*b, *c));
+  *a = _mm_add_epi64(_mm_add_epi64(*a, *b), y);
+  *d = vrotr16(_mm_xor_si128(*d, *a));
+  *c = _mm_add_epi64(*c, *d);
+  *b = vrotr63(_mm_xor_si128(*b, *c));
+}
+
+static inline __m128i load(const uint64_t *p)
+{
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void store(uint64_t *p, __m128i x)
+{
+  _mm_storeu_si128((__m128i *)p, x);
+}
+
+// words a and b of the message held in pairs in m, the indexes are constants so one instruction is left
+static inline __m128i message_words(const __m128i *m, size_t a, size_t b)
+{
+  if (a % 2 == 0) {
+    return b % 2 == 0 ? _mm_unpacklo_epi64(m[a / 2], m[b / 2]) : _mm_blend_epi16(m[a / 2], m[b / 2], 0xf0);
+  }
+
+  return b % 2 == 0 ? _mm_alignr_epi8(m[b / 2], m[a / 2], 8) : _mm_unpackhi_epi64(m[a / 2], m[b / 2]);
+}
+
+// the rows are split in a low half of columns 0 and 1 and a high half of columns 2 and 3, the diagonal steps move
+// words 1 to 3 of rows 2 to 4 to the columns of their diagonals
+#define MSG(r, i, j) message_words(m, blake2b_lanes_sigma[r][i], blake2b_lanes_sigma[r][j])
+
+#define ROUND(r)                                                                 \
+  do {                                                                           \
+    __m128i t0;                                                                  \
+    __m128i t1;                                                                  \
+    g(&row1l, &row2l, &row3l, &row4l, MSG(r, 0, 2), MSG(r, 1, 3));               \
+    g(&row1h, &row2h, &row3h, &row4h, MSG(r, 4, 6), MSG(r, 5, 7));               \
+    t0 = _mm_alignr_epi8(row2h, row2l, 8);                                       \
+    t1 = _mm_alignr_epi8(row2l, row2h, 8);                                       \
+    row2l = t0; row2h = t1;                                                      \
+    t0 = row3l; row3l = row3h; row3h = t0;                                       \
+    t0 = _mm_alignr_epi8(row4l, row4h, 8);                                       \
+    t1 = _mm_alignr_epi8(row4h, row4l, 8);                                       \
+    row4l = t0; row4h = t1;                                                      \
+    g(&row1l, &row2l, &row3l, &row4l, MSG(r, 8, 10), MSG(r, 9, 11));             \
+    g(&row1h, &row2h, &row3h, &row4h, MSG(r, 12, 14), MSG(r, 13, 15));           \
+    t0 = _mm_alignr_epi8(row2l, row2h, 8);                                       \
+    t1 = _mm_alignr_epi8(row2h, row2l, 8);                                       \
+    row2l = t0; row2h = t1;                                                      \
+    t0 = row3l; row3l = row3h; row3h = t0;                                       \
+    t0 = _mm_alignr_epi8(row4h, row4l, 8);                                       \
+    t1 = _mm_alignr_epi8(row4l, row4h, 8);                                       \
+    row4l = t0; row4h = t1;                                                      \
+  } while (0)
+
+void blake2b_compress_sse41(blake2b_state *S, const uint8_t *block)
+{
+  __m128i m[8];
+  __m128i row1l, row1h, row2l, row2h, row3l, row3h, row4l, row4h;
+  size_t i;
+
+  for (i = 0; i < 8; ++i) {
+    m[i] = _mm_loadu_si128((const __m128i *)(block + i * sizeof(__m128i)));
+  }
+
+  row1l = load(&S->h[0]);
+  row1h = load(&S->h[2]);
+  row2l = load(&S->h[4]);
+  row2h = load(&S->h[6]);
+  row3l = load(&blake2b_lanes_IV[0]);
+  row3h = load(&blake2b_lanes_IV[2]);
+  row4l = _mm_xor_si128(load(&blake2b_lanes_IV[4]), load(S->t));
+  row4h = _mm_xor_si128(load(&blake2b_lanes_IV[6]), load(S->f));
+
+  ROUND(0);
+  ROUND(1);
+  ROUND(2);
+  ROUND(3);
+  ROUND(4);
+  ROUND(5);
+  ROUND(6);
+  ROUND(7);
+  ROUND(8);
+  ROUND(9);
+  ROUND(10);
+  ROUND(11);
+
+  store(&S->h[0], _mm_xor_si128(load(&S->h[0]), _mm_xor_si128(row1l, row3l)));
+  store(&S->h[2], _mm_xor_si128(load(&S->h[2]), _mm_xor_si128(row1h, row3h)));
+  store(&S->h[4], _mm_xor_si128(load(&S->h[4]), _mm_xor_si128(row2l, row4l)));
+  store(&S->h[6], _mm_xor_si128(load(&S->h[6]), _mm_xor_si128(row2h, row4h)));
+}
+
+#undef MSG
+#undef ROUND
+
+// 4 of the lanes, starting with lane first, as 2 vectors per word
+#define LANES_STEP(r, i, a, b, c, d)                                                                             \
+  do {                                                                                                           \
+    for (k = 0; k < 2; ++k) {                                                                                    \
+      g(&v[a][k], &v[b][k], &v[c][k], &v[d][k], load(&m[blake2b_lanes_sigma[r][2 * i] * lanes + first + 2 * k]), \
+        load(&m[blake2b_lanes_sigma[r][2 * i + 1] * lanes + first + 2 * k]));                                    \
+    }                                                                                                            \
+  } while (0)
+
+#define LANES_ROUND_SSE41(r)                \
+  do {                                      \
+    LANES_STEP(r, 0, 0, 4,  8, 12);         \
+    LANES_STEP(r, 1, 1, 5,  9, 13);         \
+    LANES_STEP(r, 2, 2, 6, 10, 14);         \
+    LANES_STEP(r, 3, 3, 7, 11, 15);         \
+    LANES_STEP(r, 4, 0, 5, 10, 15);         \
+    LANES_STEP(r, 5, 1, 6, 11, 12);         \
+    LANES_STEP(r, 6, 2, 7,  8, 13);         \
+    LANES_STEP(r, 7, 3, 4,  9, 14);         \
+  } while (0)
+
+static inline void compress_lanes(const size_t lanes, const size_t first, uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  __m128i v[16][2];
+  size_t i;
+  size_t k;
+
+  for (k = 0; k < 2; ++k) {
+    for (i = 0; i < 8; ++i) {
+      v[i][k] = load(&h[i * lanes + first + 2 * k]);
+      v[i + 8][k] = _mm_set1_epi64x((int64_t)blake2b_lanes_IV[i]);
+    }
+
+    v[12][k] = _mm_xor_si128(v[12][k], load(&t[first + 2 * k]));
+    v[14][k] = _mm_xor_si128(v[14][k], load(&f[first + 2 * k]));
+  }
+
+  LANES_ROUND_SSE41(0);
+  LANES_ROUND_SSE41(1);
+  LANES_ROUND_SSE41(2);
+  LANES_ROUND_SSE41(3);
+  LANES_ROUND_SSE41(4);
+  LANES_ROUND_SSE41(5);
+  LANES_ROUND_SSE41(6);
+  LANES_ROUND_SSE41(7);
+  LANES_ROUND_SSE41(8);
+  LANES_ROUND_SSE41(9);
+  LANES_ROUND_SSE41(10);
+  LANES_ROUND_SSE41(11);
+
+  for (k = 0; k < 2; ++k) {
+    for (i = 0; i < 8; ++i) {
+      uint64_t *word = &h[i * lanes + first + 2 * k];
+      store(word, _mm_xor_si128(load(word), _mm_xor_si128(v[i][k], v[i + 8][k])));
+    }
+  }
+}
+
+#undef LANES_STEP
+#undef LANES_ROUND_SSE41
+
+void blake2b_compress_x4_sse41(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  compress_lanes(4, 0, h, m, t, f);
+}
+
+// there are not enough registers to interleave two groups of 4 lanes
+void blake2b_compress_x8_sse41(uint64_t *h, const uint64_t *m, const uint64_t *t, const uint64_t *f)
+{
+  compress_lanes(8, 0, h, m, t, f);
+  compress_lanes(8, 4, h, m, t, f);
+}
+
+#endif
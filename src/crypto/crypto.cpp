@@ -11,6 +11,7 @@
 #include <cstring>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "Common/Varint.h"
 #include "crypto.h"
@@ -80,6 +81,47 @@ namespace Crypto {
     return true;
   }
 
+  // compresses points[i] into results[positions[i]]
+  template<typename T>
+  static void points_to_bytes(const std::vector<ge_p2> &points, const std::vector<size_t> &positions, T *results) {
+    static_assert(sizeof(T) == sizeof(EllipticCurvePoint), "Result type must be a compressed point");
+    if (points.empty()) {
+      return;
+    }
+
+    std::unique_ptr<fe[]> scratch(new fe[points.size()]);
+    std::vector<EllipticCurvePoint> bytes(points.size());
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(bytes.data()), points.data(), scratch.get(), points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+      memcpy(&results[positions[i]], &bytes[i], sizeof(EllipticCurvePoint));
+    }
+  }
+
+  void crypto_ops::generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &key, KeyDerivation *derivations, bool *valid) {
+    signed char digits[64];
+    std::vector<ge_p2> points;
+    std::vector<size_t> positions;
+    assert(sc_check(reinterpret_cast<const unsigned char*>(&key)) == 0);
+    ge_scalarmult_recode(digits, reinterpret_cast<const unsigned char*>(&key));
+    points.reserve(count);
+    positions.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      ge_p3 point;
+      ge_p2 point2;
+      ge_p1p1 point3;
+      valid[i] = ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&keys[i])) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      ge_scalarmult_recoded(&point2, digits, &point);
+      ge_mul8(&point3, &point2);
+      points.emplace_back();
+      ge_p1p1_to_p2(&points.back(), &point3);
+      positions.push_back(i);
+    }
+    points_to_bytes(points, positions, derivations);
+  }
+
   static void derivation_to_scalar(const KeyDerivation &derivation, size_t output_index, EllipticCurveScalar &res) {
     struct {
       KeyDerivation derivation;
@@ -225,6 +267,33 @@ namespace Crypto {
   }
 
 
+  void crypto_ops::underive_public_keys(const KeyDerivation *derivations, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *valid) {
+    std::vector<ge_p2> points;
+    std::vector<size_t> positions;
+    points.reserve(count);
+    positions.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      EllipticCurveScalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      valid[i] = ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(&derived_keys[i])) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      derivation_to_scalar(derivations[i], output_indexes[i], scalar);
+      ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      points.emplace_back();
+      ge_p1p1_to_p2(&points.back(), &point4);
+      positions.push_back(i);
+    }
+    points_to_bytes(points, positions, bases);
+  }
+
   struct s_comm {
     Hash h;
     EllipticCurvePoint key;
@@ -46,6 +46,8 @@ struct EllipticCurveScalar {
     friend bool secret_key_to_public_key(const SecretKey &, PublicKey &);
     static bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
     friend bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
+    static void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
+    friend void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
     static bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
@@ -64,6 +66,8 @@ struct EllipticCurveScalar {
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
+    static void underive_public_keys(const KeyDerivation *, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
+    friend void underive_public_keys(const KeyDerivation *, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     friend void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     static bool check_signature(const Hash &, const PublicKey &, const Signature &);
@@ -151,6 +155,13 @@ struct EllipticCurveScalar {
     return crypto_ops::generate_key_derivation(key1, key2, derivation);
   }
 
+  /* Same as generate_key_derivation() for count public keys and one secret key, valid[i] is false if keys[i] is not a valid point.
+   * The secret key is recoded once and the derivations are compressed with a single field inversion.
+   */
+  inline void generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &key, KeyDerivation *derivations, bool *valid) {
+    crypto_ops::generate_key_derivations(keys, count, key, derivations, valid);
+  }
+
   inline bool derive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &base, const uint8_t* prefix, size_t prefixLength, PublicKey &derived_key) {
     return crypto_ops::derive_public_key(derivation, output_index, base, prefix, prefixLength, derived_key);
@@ -190,6 +201,14 @@ struct EllipticCurveScalar {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* Same as underive_public_key() for count outputs, valid[i] is false if derived_keys[i] is not a valid point.
+   * The results are compressed with a single field inversion.
+   */
+  inline void underive_public_keys(const KeyDerivation *derivations, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *valid) {
+    crypto_ops::underive_public_keys(derivations, output_indexes, derived_keys, count, bases, valid);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
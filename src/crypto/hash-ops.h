@@ -52,6 +52,8 @@ enum {
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+// cn_fast_hash() of count independent messages, hashed 8 or 4 at a time side by side, see blake2b_x8()
+void cn_fast_hash_many(const void *const *data, const size_t *lengths, size_t count, char *hashes);
 
 void cn_slow_hash_f(void *, const void *, size_t, void *);
 
@@ -60,4 +62,29 @@ void hash_extra_groestl(const void *data, size_t length, char *hash);
 void hash_extra_jh(const void *data, size_t length, char *hash);
 void hash_extra_skein(const void *data, size_t length, char *hash);
 
-void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
\ No newline at end of file
+void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
+
+enum {
+  TREE_HASH_LANES = 4
+};
+
+// continues each of the root_count chains of tree_hash() whose roots are in roots with the same hashes, for example a
+// block template under several coinbase transactions, TREE_HASH_LANES chains are hashed side by side
+void tree_hash_extend(char (*roots)[HASH_SIZE], size_t root_count, const char (*hashes)[HASH_SIZE], size_t hash_count);
+
+enum {
+  NONCE_HASH_LANES = 4,
+  NONCE_HASH_BATCH = 16 // nonces a miner hashes per call, whole groups of 8 for the AVX2 backend
+};
+
+// a blob of up to 128 bytes prepared to be hashed with cn_fast_hash() for many values of the 8 byte nonce in it
+struct nonce_hash_state {
+  uint64_t h[8];
+  uint64_t m[16];
+  uint64_t v[16];
+  uint64_t length;
+  size_t nonce_word;
+};
+
+int nonce_hash_init(struct nonce_hash_state *state, const void *blob, size_t length, size_t nonce_offset);
+void nonce_hash(const struct nonce_hash_state *state, uint64_t first_nonce, uint64_t step, size_t count, char *hashes);
\ No newline at end of file
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <CryptoTypes.h>
 #include "generic-ops.h"
@@ -30,6 +31,10 @@ namespace Crypto {
     return h;
   }
 
+  inline void cn_fast_hash_many(const void *const *data, const size_t *lengths, size_t count, Hash *hashes) {
+    cn_fast_hash_many(data, lengths, count, reinterpret_cast<char *>(hashes));
+  }
+
   class cn_context {
   public:
 
@@ -53,6 +58,14 @@ namespace Crypto {
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
+
+  inline void tree_hash_extend(Hash *roots, size_t root_count, const Hash *hashes, size_t hash_count) {
+    tree_hash_extend(reinterpret_cast<char (*)[HASH_SIZE]>(roots), root_count, reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), hash_count);
+  }
+
+  inline void nonce_hash(const nonce_hash_state &state, uint64_t first_nonce, uint64_t step, size_t count, Hash *hashes) {
+    nonce_hash(&state, first_nonce, step, count, reinterpret_cast<char *>(hashes));
+  }
 }
 
 CRYPTO_MAKE_HASHABLE(Hash)
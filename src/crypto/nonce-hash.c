@@ -0,0 +1,201 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hash-ops.h"
+#include "blake2.h"
+#include "blake2b-backend.h"
+#include "blake2b-lanes.h"
+
+// BLAKE2b-256 of a blob that fits in one block, same result as cn_fast_hash() on the blob with the nonce written in it.
+// Everything that does not depend on the nonce is computed once by nonce_hash_init() and NONCE_HASH_LANES nonces are
+// hashed side by side.
+// A build for CPUs without AVX2 leaves the lanes in scalar or SSE2 code. There, on a CPU with AVX2, 8 nonces are
+// hashed at a time by blake2b_compress_x8_avx2() instead, which does the whole first round again but runs 4 lanes
+// per register. A build for AVX2 CPUs gets vector code for the lanes from the compiler and keeps the skipped steps.
+// The miners hash NONCE_HASH_BATCH nonces per call so that none of them is left to the lanes there.
+
+_Static_assert(NONCE_HASH_LANES == BLAKE2B_LANES, "the nonces are hashed in the lanes of blake2b-lanes.h");
+_Static_assert(NONCE_HASH_BATCH % 8 == 0, "a batch is hashed by nonce_hash_x8() without a rest");
+
+int nonce_hash_init(struct nonce_hash_state *state, const void *blob, size_t length, size_t nonce_offset)
+{
+  uint8_t block[BLAKE2B_BLOCKBYTES];
+  size_t i;
+
+  if (length > BLAKE2B_BLOCKBYTES || nonce_offset % sizeof(uint64_t) != 0 || nonce_offset + sizeof(uint64_t) > length) {
+    return -1;
+  }
+
+  memset(block, 0, sizeof(block));
+  memcpy(block, blob, length);
+
+  for (i = 0; i < 16; ++i) {
+    state->m[i] = load64(block + i * sizeof(uint64_t));
+  }
+
+  // digest length 32, no key, fanout 1, depth 1
+  for (i = 0; i < 8; ++i) {
+    state->h[i] = blake2b_lanes_IV[i];
+  }
+
+  state->h[0] ^= 0x01010000ULL ^ HASH_SIZE;
+  state->length = length;
+  state->nonce_word = nonce_offset / sizeof(uint64_t);
+
+  // the blob is the only and last block
+  for (i = 0; i < 8; ++i) {
+    state->v[i] = state->h[i];
+  }
+
+  state->v[ 8] = blake2b_lanes_IV[0];
+  state->v[ 9] = blake2b_lanes_IV[1];
+  state->v[10] = blake2b_lanes_IV[2];
+  state->v[11] = blake2b_lanes_IV[3];
+  state->v[12] = blake2b_lanes_IV[4] ^ (uint64_t)length;
+  state->v[13] = blake2b_lanes_IV[5];
+  state->v[14] = ~blake2b_lanes_IV[6];
+  state->v[15] = blake2b_lanes_IV[7];
+
+  // the column steps of the first round are independent of each other and only read words 0 to 7 of the blob,
+  // all of them except the one that reads the nonce are done here
+  for (i = 0; i < 4; ++i) {
+    if (i != state->nonce_word / 2) {
+      blake2b_lanes_step(state->v, state->m, 0, i);
+    }
+  }
+
+  return 0;
+}
+
+// the nonce is written in the blob in memory order
+static inline uint64_t nonce_word(uint64_t nonce)
+{
+  uint8_t bytes[sizeof(uint64_t)];
+  memcpy(bytes, &nonce, sizeof(bytes));
+  return load64(bytes);
+}
+
+#if !defined(__AVX2__)
+// hashes count / 8 groups of 8 nonces with blake2b_compress_x8_fp, returns the number of nonces hashed
+static size_t nonce_hash_x8(const struct nonce_hash_state *state, uint64_t *nonce, uint64_t step, size_t count, char *hashes)
+{
+  uint64_t h[8 * 8];
+  uint64_t m[16 * 8];
+  uint64_t t[8];
+  uint64_t f[8];
+  size_t done;
+  size_t i;
+  size_t l;
+
+  for (l = 0; l < 8; ++l) {
+    t[l] = state->length;
+    f[l] = (uint64_t)-1;
+    for (i = 0; i < 16; ++i) {
+      m[i * 8 + l] = state->m[i];
+    }
+  }
+
+  for (done = 0; done + 8 <= count; done += 8) {
+    for (l = 0; l < 8; ++l) {
+      m[state->nonce_word * 8 + l] = nonce_word(*nonce);
+      *nonce += step;
+      for (i = 0; i < 8; ++i) {
+        h[i * 8 + l] = state->h[i];
+      }
+    }
+
+    blake2b_compress_x8_fp(h, m, t, f);
+
+    for (l = 0; l < 8; ++l) {
+      for (i = 0; i < HASH_SIZE / sizeof(uint64_t); ++i) {
+        store64(hashes + i * sizeof(uint64_t), h[i * 8 + l]);
+      }
+
+      hashes += HASH_SIZE;
+    }
+  }
+
+  return done;
+}
+#endif
+
+void nonce_hash(const struct nonce_hash_state *state, uint64_t first_nonce, uint64_t step, size_t count, char *hashes)
+{
+  const size_t nonce_step = state->nonce_word / 2;
+  uint64_t m[16][NONCE_HASH_LANES];
+  uint64_t v[16][NONCE_HASH_LANES];
+  uint64_t nonce = first_nonce;
+  size_t i;
+  size_t l;
+
+#if !defined(__AVX2__)
+  // the SSE4.1 compression is no faster than the lanes below
+  if (blake2b_get_backend() == BLAKE2B_BACKEND_AVX2) {
+    size_t done = nonce_hash_x8(state, &nonce, step, count, hashes);
+    hashes += done * HASH_SIZE;
+    count -= done;
+  }
+#endif
+
+  for (i = 0; i < 16; ++i) {
+    for (l = 0; l < NONCE_HASH_LANES; ++l) {
+      m[i][l] = state->m[i];
+    }
+  }
+
+  while (count > 0) {
+    const size_t lanes = count < NONCE_HASH_LANES ? count : NONCE_HASH_LANES;
+
+    for (l = 0; l < NONCE_HASH_LANES; ++l) {
+      m[state->nonce_word][l] = nonce_word(nonce);
+      nonce += step;
+    }
+
+    for (i = 0; i < 16; ++i) {
+      for (l = 0; l < NONCE_HASH_LANES; ++l) {
+        v[i][l] = state->v[i];
+      }
+    }
+
+    // rest of the first round, starting with the column step that reads the nonce if there is one
+    switch (nonce_step) {
+    case 0: LANES_G(0, 0, 0, 4,  8, 12); break;
+    case 1: LANES_G(0, 1, 1, 5,  9, 13); break;
+    case 2: LANES_G(0, 2, 2, 6, 10, 14); break;
+    case 3: LANES_G(0, 3, 3, 7, 11, 15); break;
+    default: break;
+    }
+
+    LANES_G(0, 4, 0, 5, 10, 15);
+    LANES_G(0, 5, 1, 6, 11, 12);
+    LANES_G(0, 6, 2, 7,  8, 13);
+    LANES_G(0, 7, 3, 4,  9, 14);
+
+    LANES_ROUND(1);
+    LANES_ROUND(2);
+    LANES_ROUND(3);
+    LANES_ROUND(4);
+    LANES_ROUND(5);
+    LANES_ROUND(6);
+    LANES_ROUND(7);
+    LANES_ROUND(8);
+    LANES_ROUND(9);
+    LANES_ROUND(10);
+    LANES_ROUND(11);
+
+    for (l = 0; l < lanes; ++l) {
+      for (i = 0; i < HASH_SIZE / sizeof(uint64_t); ++i) {
+        store64(hashes + i * sizeof(uint64_t), state->h[i] ^ v[i][l] ^ v[i + 8][l]);
+      }
+
+      hashes += HASH_SIZE;
+    }
+
+    count -= lanes;
+  }
+}
@@ -3,12 +3,137 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <alloca.h>
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "hash-ops.h"
+#include "blake2b-lanes.h"
+
+_Static_assert(TREE_HASH_LANES == BLAKE2B_LANES, "the chains are hashed in the lanes of blake2b-lanes.h");
+
+// A node of the chain is byte 1, the transaction hash and the merkle root so far, 65 bytes hashed with cn_fast_hash().
+// It fits in one BLAKE2b block, so a node is a single compression with a working vector that is the same for all nodes.
+
+enum {
+  TREE_HASH_NODE_SIZE = 1 + 2 * HASH_SIZE,
+  TREE_HASH_NODE_WORDS = (TREE_HASH_NODE_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)
+};
+
+static void tree_hash_init_vector(uint64_t *v)
+{
+  size_t i;
+
+  // digest length 32, no key, fanout 1, depth 1
+  for (i = 0; i < 8; ++i) {
+    v[i] = blake2b_lanes_IV[i];
+  }
+
+  v[0] ^= 0x01010000ULL ^ HASH_SIZE;
+
+  // the node is the only and last block
+  v[ 8] = blake2b_lanes_IV[0];
+  v[ 9] = blake2b_lanes_IV[1];
+  v[10] = blake2b_lanes_IV[2];
+  v[11] = blake2b_lanes_IV[3];
+  v[12] = blake2b_lanes_IV[4] ^ (uint64_t)TREE_HASH_NODE_SIZE;
+  v[13] = blake2b_lanes_IV[5];
+  v[14] = ~blake2b_lanes_IV[6];
+  v[15] = blake2b_lanes_IV[7];
+}
+
+static void tree_hash_load_node(uint64_t *m, const char *hash, const char *root)
+{
+  uint8_t node[TREE_HASH_NODE_WORDS * sizeof(uint64_t)];
+  size_t i;
+
+  // prepend byte with value of 1 to follow Siacoin stratum protocol
+  memset(node, 0, sizeof(node));
+  node[0] = 1;
+  memcpy(node + 1, hash, HASH_SIZE);
+  memcpy(node + 1 + HASH_SIZE, root, HASH_SIZE);
+
+  for (i = 0; i < TREE_HASH_NODE_WORDS; ++i) {
+    m[i] = load64(node + i * sizeof(uint64_t));
+  }
+
+  for (; i < 16; ++i) {
+    m[i] = 0;
+  }
+}
+
+static void tree_hash_chain(char *root, const char (*hashes)[HASH_SIZE], size_t hash_count)
+{
+  uint64_t v0[16];
+  uint64_t v[16];
+  uint64_t m[16];
+  size_t h;
+  size_t r;
+  size_t i;
+
+  tree_hash_init_vector(v0);
+
+  for (h = 0; h < hash_count; ++h) {
+    tree_hash_load_node(m, hashes[h], root);
+    memcpy(v, v0, sizeof(v));
+
+    for (r = 0; r < 12; ++r) {
+      for (i = 0; i < 8; ++i) {
+        blake2b_lanes_step(v, m, r, i);
+      }
+    }
+
+    for (i = 0; i < HASH_SIZE / sizeof(uint64_t); ++i) {
+      store64(root + i * sizeof(uint64_t), v0[i] ^ v[i] ^ v[i + 8]);
+    }
+  }
+}
+
+static void tree_hash_chains(char (*roots)[HASH_SIZE], size_t root_count, const char (*hashes)[HASH_SIZE], size_t hash_count)
+{
+  uint64_t v0[16];
+  uint64_t v[16][TREE_HASH_LANES];
+  uint64_t m[16][TREE_HASH_LANES];
+  uint64_t words[16];
+  size_t h;
+  size_t i;
+  size_t l;
+
+  assert(root_count <= TREE_HASH_LANES);
+
+  tree_hash_init_vector(v0);
+
+  // the missing lanes hash the first chain again and are dropped
+  for (h = 0; h < hash_count; ++h) {
+    for (l = 0; l < TREE_HASH_LANES; ++l) {
+      tree_hash_load_node(words, hashes[h], roots[l < root_count ? l : 0]);
+      for (i = 0; i < 16; ++i) {
+        m[i][l] = words[i];
+        v[i][l] = v0[i];
+      }
+    }
+
+    LANES_ROUND(0);
+    LANES_ROUND(1);
+    LANES_ROUND(2);
+    LANES_ROUND(3);
+    LANES_ROUND(4);
+    LANES_ROUND(5);
+    LANES_ROUND(6);
+    LANES_ROUND(7);
+    LANES_ROUND(8);
+    LANES_ROUND(9);
+    LANES_ROUND(10);
+    LANES_ROUND(11);
+
+    for (l = 0; l < root_count; ++l) {
+      for (i = 0; i < HASH_SIZE / sizeof(uint64_t); ++i) {
+        store64(roots[l] + i * sizeof(uint64_t), v0[i] ^ v[i][l] ^ v[i + 8][l]);
+      }
+    }
+  }
+}
 
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash)
 {
@@ -18,20 +143,20 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash)
   // first hash in hashes should be the coinbase transaction hash
   memcpy(root_hash, hashes[0], HASH_SIZE);
 
-  for (size_t h = 1; h < count; h++)
-  {
-    char binaryArray[2 * HASH_SIZE + 1];
+  tree_hash_chain(root_hash, hashes + 1, count - 1);
+}
 
-    // prepend byte with value of 1 to follow Siacoin stratum protocol
-    binaryArray[0] = 1;
-
-    // append transaction hash to binary array
-    memcpy(binaryArray + 1, hashes[h], HASH_SIZE);
-
-    // append merkle root to binary array
-    memcpy(binaryArray + 1 + HASH_SIZE, root_hash, HASH_SIZE);
+void tree_hash_extend(char (*roots)[HASH_SIZE], size_t root_count, const char (*hashes)[HASH_SIZE], size_t hash_count)
+{
+  if (root_count == 1) {
+    tree_hash_chain(roots[0], hashes, hash_count);
+    return;
+  }
 
-    // hash the binary array to get the merkle root
-    cn_fast_hash(binaryArray, 2 * HASH_SIZE + 1, root_hash);
+  while (root_count > 0) {
+    const size_t lanes = root_count < TREE_HASH_LANES ? root_count : TREE_HASH_LANES;
+    tree_hash_chains(roots, lanes, hashes, hash_count);
+    roots += lanes;
+    root_count -= lanes;
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "helperFunctions.h"
+#include "CryptoNoteCore/BinaryBlobReader.h"
+#include "Common/Varint.h"
+#include <iostream>
+
+using namespace CryptoNote;
+
+/*
+
+My Notes
+
+class BinaryBlobReader {
+
+public
+  BinaryBlobReader()
+  getPosition()
+  endOfBlob()
+  range()
+  readVarint()
+  skip()
+  skipVarint()
+  skipTransaction()
+  skipBlock()
+
+}
+
+*/
+
+uint32_t loopCount = 50;
+
+// BinaryBlobReader
+// readVarint()
+// skipVarint()
+// endOfBlob()
+TEST(binaryBlobReader, 1)
+{
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    uint64_t value1 = getRandUint64_t();
+    uint64_t value2 = getRandUint32_t();
+
+    std::string blob = Tools::get_varint_data(value1) + Tools::get_varint_data(value2);
+
+    BinaryBlobReader reader(Common::StringView(blob.data(), blob.size()));
+
+    uint64_t output;
+    ASSERT_TRUE(reader.readVarint(output));
+    ASSERT_EQ(value1, output);
+    ASSERT_FALSE(reader.endOfBlob());
+    ASSERT_TRUE(reader.skipVarint());
+    ASSERT_TRUE(reader.endOfBlob());
+    ASSERT_EQ(blob.size(), reader.getPosition());
+    ASSERT_FALSE(reader.readVarint(output));
+  }
+}
+
+// BinaryBlobReader
+// skipTransaction()
+// range()
+TEST(binaryBlobReader, 2)
+{
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    Transaction transaction1 = getRandTransaction();
+    Transaction transaction2 = getRandTransaction();
+
+    BinaryArray blob1 = toBinaryArray(transaction1);
+    BinaryArray blob2 = toBinaryArray(transaction2);
+
+    BinaryArray blob = blob1;
+    blob.insert(blob.end(), blob2.begin(), blob2.end());
+
+    BinaryBlobReader reader(Common::StringView(reinterpret_cast<const char*>(blob.data()), blob.size()));
+
+    ASSERT_TRUE(reader.skipTransaction());
+    ASSERT_EQ(blob1.size(), reader.getPosition());
+
+    size_t begin = reader.getPosition();
+    ASSERT_TRUE(reader.skipTransaction());
+    ASSERT_TRUE(reader.endOfBlob());
+
+    Common::StringView second = reader.range(begin, reader.getPosition());
+    ASSERT_EQ(blob2.size(), second.getSize());
+    ASSERT_EQ(0, memcmp(blob2.data(), second.getData(), second.getSize()));
+  }
+}
+
+// BinaryBlobReader
+// skipBlock()
+TEST(binaryBlobReader, 3)
+{
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    Block block = getRandBlock();
+    BinaryArray blob = toBinaryArray(block);
+
+    BinaryBlobReader reader(Common::StringView(reinterpret_cast<const char*>(blob.data()), blob.size()));
+
+    ASSERT_TRUE(reader.skipBlock());
+    ASSERT_TRUE(reader.endOfBlob());
+  }
+}
+
+// BinaryBlobReader
+// truncated blobs are rejected
+TEST(binaryBlobReader, 4)
+{
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    Block block = getRandBlock();
+    BinaryArray blob = toBinaryArray(block);
+
+    size_t truncatedSize = getRandUint32_t() % blob.size();
+
+    BinaryBlobReader reader(Common::StringView(reinterpret_cast<const char*>(blob.data()), truncatedSize));
+
+    ASSERT_FALSE(reader.skipBlock());
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
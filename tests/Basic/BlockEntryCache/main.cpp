@@ -0,0 +1,182 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "CryptoNoteCore/BlockEntryCache.h"
+#include <memory>
+#include <string>
+
+using namespace CryptoNote;
+
+/*
+
+My Notes
+
+class BlockEntryCache {
+
+public
+  BlockEntryCache()
+  get()
+  insert()
+  truncate()
+  clear()
+  size()
+  getHits()
+  getMisses()
+
+private
+  erase()
+
+  const size_t m_maxSize;
+  mutable std::mutex m_mutex;
+  std::list<Entry> m_entries;
+  std::unordered_map<uint32_t, std::list<Entry>::iterator> m_heights;
+  size_t m_size;
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+
+}
+
+*/
+
+// Helper functions
+
+uint32_t loopCount = 100;
+
+// returns an entry of size 10 bytes
+block_complete_entry createEntry(uint32_t height)
+{
+  block_complete_entry entry;
+  std::string blob = std::to_string(height);
+  entry.block = blob + std::string(5 - blob.size(), 'b');
+  entry.txs.push_back(std::string(3, 't'));
+  entry.txs.push_back(std::string(2, 't'));
+  return entry;
+}
+
+// constructor
+// insert()
+// get()
+// size()
+// getHits()
+// getMisses()
+TEST(BlockEntryCache, 1)
+{
+  BlockEntryCache cache(10 * loopCount);
+  ASSERT_EQ(0, cache.size());
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    cache.insert(i, std::make_shared<block_complete_entry>(createEntry(i)));
+  }
+
+  ASSERT_EQ(loopCount, cache.size());
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    std::shared_ptr<const block_complete_entry> entry = cache.get(i);
+    ASSERT_TRUE(entry != nullptr);
+    ASSERT_EQ(createEntry(i).block, entry->block);
+    ASSERT_EQ(createEntry(i).txs, entry->txs);
+  }
+
+  ASSERT_TRUE(cache.get(loopCount) == nullptr);
+
+  ASSERT_EQ(loopCount, cache.getHits());
+  ASSERT_EQ(1, cache.getMisses());
+}
+
+// insert()
+// least recently used entries are evicted when the cache is full
+TEST(BlockEntryCache, 2)
+{
+  BlockEntryCache cache(10 * 3);
+
+  cache.insert(1, std::make_shared<block_complete_entry>(createEntry(1)));
+  cache.insert(2, std::make_shared<block_complete_entry>(createEntry(2)));
+  cache.insert(3, std::make_shared<block_complete_entry>(createEntry(3)));
+
+  ASSERT_TRUE(cache.get(1) != nullptr);
+
+  cache.insert(4, std::make_shared<block_complete_entry>(createEntry(4)));
+
+  ASSERT_EQ(3, cache.size());
+  ASSERT_TRUE(cache.get(1) != nullptr);
+  ASSERT_TRUE(cache.get(2) == nullptr);
+  ASSERT_TRUE(cache.get(3) != nullptr);
+  ASSERT_TRUE(cache.get(4) != nullptr);
+
+  // replacing an entry
+  block_complete_entry other = createEntry(5);
+  cache.insert(4, std::make_shared<block_complete_entry>(other));
+  ASSERT_EQ(3, cache.size());
+  ASSERT_TRUE(cache.get(4) != nullptr);
+  ASSERT_EQ(other.block, cache.get(4)->block);
+
+  // entries larger than the cache are not kept
+  std::shared_ptr<block_complete_entry> large = std::make_shared<block_complete_entry>();
+  large->block = std::string(31, 'b');
+  cache.insert(5, large);
+  ASSERT_TRUE(cache.get(5) == nullptr);
+  ASSERT_EQ(3, cache.size());
+}
+
+// truncate()
+// clear()
+TEST(BlockEntryCache, 3)
+{
+  BlockEntryCache cache(10 * loopCount);
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    cache.insert(i, std::make_shared<block_complete_entry>(createEntry(i)));
+  }
+
+  cache.truncate(loopCount / 2);
+  ASSERT_EQ(loopCount / 2, cache.size());
+
+  ASSERT_TRUE(cache.get(loopCount / 2 - 1) != nullptr);
+  ASSERT_TRUE(cache.get(loopCount / 2) == nullptr);
+  ASSERT_TRUE(cache.get(loopCount - 1) == nullptr);
+
+  // space of the removed entries can be used again
+  for (uint32_t i = loopCount / 2; i < loopCount; ++i)
+  {
+    cache.insert(i, std::make_shared<block_complete_entry>(createEntry(i)));
+  }
+
+  ASSERT_EQ(loopCount, cache.size());
+  ASSERT_TRUE(cache.get(0) != nullptr);
+
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+  ASSERT_TRUE(cache.get(0) == nullptr);
+}
+
+// get()
+// a hit returns the cached entry itself, which stays valid after it is evicted
+TEST(BlockEntryCache, 4)
+{
+  BlockEntryCache cache(10 * 2);
+
+  std::shared_ptr<const block_complete_entry> inserted = std::make_shared<block_complete_entry>(createEntry(1));
+  cache.insert(1, inserted);
+
+  std::shared_ptr<const block_complete_entry> entry = cache.get(1);
+  ASSERT_EQ(inserted.get(), entry.get());
+  ASSERT_EQ(inserted.get(), cache.get(1).get());
+
+  cache.insert(2, std::make_shared<block_complete_entry>(createEntry(2)));
+  cache.insert(3, std::make_shared<block_complete_entry>(createEntry(3)));
+  ASSERT_TRUE(cache.get(1) == nullptr);
+
+  ASSERT_EQ(createEntry(1).block, entry->block);
+  ASSERT_EQ(createEntry(1).txs, entry->txs);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
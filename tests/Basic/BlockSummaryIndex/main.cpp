@@ -0,0 +1,224 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "helperFunctions.h"
+#include "CryptoNoteCore/BlockSummaryIndex.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
+#include <iostream>
+
+using namespace CryptoNote;
+
+/*
+
+My Notes
+
+class BlockSummaryIndex {
+
+public
+  push()
+  pop()
+  clear()
+  size()
+  empty()
+  getTimestamp()
+  getCumulativeDifficulty()
+  getBlockCumulativeSize()
+  getAlreadyGeneratedCoins()
+  getTimestamps()
+  getCumulativeDifficulties()
+  getBlockCumulativeSizes()
+  findFirstTimestampNotLess()
+  serialize()
+
+private
+  std::vector<uint64_t> m_timestamps;
+  std::vector<difficulty_type> m_cumulativeDifficulties;
+  std::vector<uint64_t> m_blockCumulativeSizes;
+  std::vector<uint64_t> m_alreadyGeneratedCoins;
+
+}
+
+*/
+
+// Helper functions
+
+uint32_t loopCount = 100;
+
+struct Summary
+{
+  uint64_t timestamp;
+  difficulty_type cumulativeDifficulty;
+  uint64_t blockCumulativeSize;
+  uint64_t alreadyGeneratedCoins;
+};
+
+std::vector<Summary> fillIndex(BlockSummaryIndex& index, uint32_t count)
+{
+  std::vector<Summary> summaries;
+
+  uint64_t timestamp = getRandUint32_t();
+  difficulty_type cumulativeDifficulty = 0;
+  uint64_t alreadyGeneratedCoins = 0;
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    timestamp += getRandUint8_t();
+    cumulativeDifficulty += getRandUint32_t();
+    alreadyGeneratedCoins += getRandUint32_t();
+
+    Summary summary = {timestamp, cumulativeDifficulty, getRandUint32_t(), alreadyGeneratedCoins};
+    summaries.push_back(summary);
+    index.push(summary.timestamp, summary.cumulativeDifficulty, summary.blockCumulativeSize, summary.alreadyGeneratedCoins);
+  }
+
+  return summaries;
+}
+
+// push()
+// size()
+// empty()
+// getTimestamp()
+// getCumulativeDifficulty()
+// getBlockCumulativeSize()
+// getAlreadyGeneratedCoins()
+TEST(BlockSummaryIndex, 1)
+{
+  BlockSummaryIndex index;
+  ASSERT_TRUE(index.empty());
+
+  std::vector<Summary> summaries = fillIndex(index, loopCount);
+
+  ASSERT_FALSE(index.empty());
+  ASSERT_EQ(loopCount, index.size());
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    ASSERT_EQ(summaries[i].timestamp, index.getTimestamp(i));
+    ASSERT_EQ(summaries[i].cumulativeDifficulty, index.getCumulativeDifficulty(i));
+    ASSERT_EQ(summaries[i].blockCumulativeSize, index.getBlockCumulativeSize(i));
+    ASSERT_EQ(summaries[i].alreadyGeneratedCoins, index.getAlreadyGeneratedCoins(i));
+  }
+}
+
+// pop()
+// clear()
+TEST(BlockSummaryIndex, 2)
+{
+  BlockSummaryIndex index;
+
+  std::vector<Summary> summaries = fillIndex(index, loopCount);
+
+  for (uint32_t i = 0; i < loopCount / 2; ++i)
+  {
+    index.pop();
+  }
+
+  ASSERT_EQ(loopCount - loopCount / 2, index.size());
+  ASSERT_EQ(summaries[index.size() - 1].timestamp, index.getTimestamp(index.size() - 1));
+  ASSERT_EQ(summaries[index.size() - 1].alreadyGeneratedCoins, index.getAlreadyGeneratedCoins(index.size() - 1));
+
+  index.clear();
+  ASSERT_TRUE(index.empty());
+  ASSERT_EQ(0, index.size());
+}
+
+// getTimestamps()
+// getCumulativeDifficulties()
+// getBlockCumulativeSizes()
+TEST(BlockSummaryIndex, 3)
+{
+  BlockSummaryIndex index;
+
+  std::vector<Summary> summaries = fillIndex(index, loopCount);
+
+  uint32_t startHeight = 10;
+  uint32_t endHeight = 60;
+
+  std::vector<uint64_t> timestamps = {1, 2};
+  std::vector<difficulty_type> cumulativeDifficulties;
+  std::vector<size_t> blockCumulativeSizes;
+
+  index.getTimestamps(startHeight, endHeight, timestamps);
+  index.getCumulativeDifficulties(startHeight, endHeight, cumulativeDifficulties);
+  index.getBlockCumulativeSizes(startHeight, endHeight, blockCumulativeSizes);
+
+  // values are appended
+  ASSERT_EQ(2 + endHeight - startHeight, timestamps.size());
+  ASSERT_EQ(1, timestamps[0]);
+  ASSERT_EQ(2, timestamps[1]);
+  ASSERT_EQ(endHeight - startHeight, cumulativeDifficulties.size());
+  ASSERT_EQ(endHeight - startHeight, blockCumulativeSizes.size());
+
+  for (uint32_t i = startHeight; i < endHeight; ++i)
+  {
+    ASSERT_EQ(summaries[i].timestamp, timestamps[2 + i - startHeight]);
+    ASSERT_EQ(summaries[i].cumulativeDifficulty, cumulativeDifficulties[i - startHeight]);
+    ASSERT_EQ(summaries[i].blockCumulativeSize, blockCumulativeSizes[i - startHeight]);
+  }
+
+  // empty range
+  timestamps.clear();
+  index.getTimestamps(endHeight, endHeight, timestamps);
+  ASSERT_TRUE(timestamps.empty());
+}
+
+// findFirstTimestampNotLess()
+TEST(BlockSummaryIndex, 4)
+{
+  BlockSummaryIndex index;
+
+  for (uint64_t i = 0; i < loopCount; ++i)
+  {
+    index.push(1000 + i * 10, i, i, i);
+  }
+
+  ASSERT_EQ(0, index.findFirstTimestampNotLess(0, 0));
+  ASSERT_EQ(0, index.findFirstTimestampNotLess(0, 1000));
+  ASSERT_EQ(1, index.findFirstTimestampNotLess(0, 1001));
+  ASSERT_EQ(50, index.findFirstTimestampNotLess(0, 1500));
+  ASSERT_EQ(60, index.findFirstTimestampNotLess(60, 1500));
+  ASSERT_EQ(loopCount, index.findFirstTimestampNotLess(0, 1000 + loopCount * 10));
+}
+
+// serialize()
+TEST(BlockSummaryIndex, 5)
+{
+  BlockSummaryIndex index;
+
+  std::vector<Summary> summaries = fillIndex(index, loopCount);
+
+  std::string blob;
+  {
+    Common::StringOutputStream stream(blob);
+    BinaryOutputStreamSerializer serializer(stream);
+    index.serialize(serializer);
+  }
+
+  BlockSummaryIndex loadedIndex;
+  {
+    Common::MemoryInputStream stream(blob.data(), blob.size());
+    BinaryInputStreamSerializer serializer(stream);
+    loadedIndex.serialize(serializer);
+  }
+
+  ASSERT_EQ(index.size(), loadedIndex.size());
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    ASSERT_EQ(summaries[i].timestamp, loadedIndex.getTimestamp(i));
+    ASSERT_EQ(summaries[i].cumulativeDifficulty, loadedIndex.getCumulativeDifficulty(i));
+    ASSERT_EQ(summaries[i].blockCumulativeSize, loadedIndex.getBlockCumulativeSize(i));
+    ASSERT_EQ(summaries[i].alreadyGeneratedCoins, loadedIndex.getAlreadyGeneratedCoins(i));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
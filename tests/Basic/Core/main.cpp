@@ -24,6 +24,8 @@
 #include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "Rpc/CoreRpcCommands.h"
 #include "CryptoNoteCore/CryptoNoteStatInfo.h"
+#include "CryptoNoteCore/PreparedBlock.h"
+#include "Common/StringTools.h"
 #include <random>
 #include <iostream>
 
@@ -109,6 +111,9 @@ public
   *getPoolChanges()
   *getNextBlockDifficulty()
   *getTotalGeneratedAmount()
+  *prepareBlock()
+  *addPreparedBlock()
+  *getBlockEntryCacheStatistics()
 
 private
   add_new_tx()
@@ -3829,6 +3834,255 @@ TEST(Core, 63)
   }
 }
 
+// prepareBlock()
+// addPreparedBlock()
+TEST(Core, 64)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  CryptonoteProtocol crpytonoteProtocol;
+  Core core(currency, &crpytonoteProtocol, logger);
+  CoreConfig coreConfig;
+  MinerConfig minerConfig;
+  bool loadExisting = false;
+  ASSERT_TRUE(core.init(coreConfig, minerConfig, loadExisting));
+
+  AccountPublicAddress accountPublicAddress;
+  KeyPair viewKeyPair = generateKeyPair();
+  KeyPair spendKeyPair = generateKeyPair();
+  accountPublicAddress.viewPublicKey = viewKeyPair.publicKey;
+  accountPublicAddress.spendPublicKey = spendKeyPair.publicKey;
+
+  BinaryArray extraNonce;
+  Block block;
+  difficulty_type difficulty;
+  uint32_t height;
+  ASSERT_TRUE(core.get_block_template(block, accountPublicAddress, difficulty, height, extraNonce));
+
+  Crypto::Hash proofOfWorkIgnore = NULL_HASH;
+  Crypto::cn_context context;
+  while(!core.currency().checkProofOfWork1(context, block, difficulty, proofOfWorkIgnore))
+  {
+    block.nonce++;
+  }
+
+  // block received from a peer
+  block_complete_entry entry;
+  entry.block = Common::asString(toBinaryArray(block));
+
+  PreparedBlock preparedBlock;
+  ASSERT_TRUE(core.prepareBlock(entry, preparedBlock));
+  ASSERT_TRUE(hashesEqual(get_block_hash(block), preparedBlock.hash));
+  ASSERT_EQ(0, preparedBlock.transactions.size());
+
+  // preparing a block does not add it to the blockchain
+  ASSERT_FALSE(core.have_block(preparedBlock.hash));
+  ASSERT_EQ(1, core.get_current_blockchain_height());
+
+  block_verification_context bvc = boost::value_initialized<block_verification_context>();
+  ASSERT_TRUE(core.addPreparedBlock(preparedBlock, bvc));
+  ASSERT_TRUE(bvc.m_added_to_main_chain);
+  ASSERT_FALSE(bvc.m_verification_failed);
+  ASSERT_TRUE(core.have_block(preparedBlock.hash));
+  ASSERT_EQ(2, core.get_current_blockchain_height());
+
+  // adding the same block again
+  bvc = boost::value_initialized<block_verification_context>();
+  core.addPreparedBlock(preparedBlock, bvc);
+  ASSERT_TRUE(bvc.m_already_exists);
+  ASSERT_EQ(2, core.get_current_blockchain_height());
+
+  // block blob that cannot be parsed
+  block_complete_entry badEntry;
+  badEntry.block = "not a block";
+  ASSERT_FALSE(core.prepareBlock(badEntry, preparedBlock));
+
+  // transaction that is not listed in the block
+  Transaction transaction = block.baseTransaction;
+  badEntry.block = entry.block;
+  badEntry.txs.push_back(Common::asString(toBinaryArray(transaction)));
+  ASSERT_FALSE(core.prepareBlock(badEntry, preparedBlock));
+}
+
+// queryBlocks()
+// getBlockEntryCacheStatistics()
+TEST(Core, 65)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  CryptonoteProtocol crpytonoteProtocol;
+  Core core(currency, &crpytonoteProtocol, logger);
+  CoreConfig coreConfig;
+  MinerConfig minerConfig;
+  bool loadExisting = false;
+  ASSERT_TRUE(core.init(coreConfig, minerConfig, loadExisting));
+
+  Crypto::Hash blockHash;
+  ASSERT_TRUE(addBlock3(core, blockHash));
+
+  uint64_t hits;
+  uint64_t misses;
+  core.getBlockEntryCacheStatistics(hits, misses);
+  ASSERT_EQ(0, hits);
+  ASSERT_EQ(0, misses);
+
+  std::vector<Crypto::Hash> blockHashes;
+  blockHashes.push_back(currency.genesisBlockHash());
+
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  std::vector<BlockFullInfo> entries;
+  uint64_t timestamp = 0;
+  ASSERT_TRUE(core.queryBlocks(blockHashes, timestamp, startHeight, currentHeight, fullOffset, entries));
+  ASSERT_EQ(2, entries.size());
+
+  // the blobs are the same as the serialized blocks
+  for (const BlockFullInfo& entry : entries)
+  {
+    Block block;
+    ASSERT_TRUE(core.getBlockByHash(entry.block_id, block));
+    ASSERT_TRUE(entry.cachedEntry != nullptr);
+    ASSERT_EQ(Common::asString(toBinaryArray(block)), entry.cachedEntry->block);
+    ASSERT_EQ(0, entry.cachedEntry->txs.size());
+  }
+
+  ASSERT_TRUE(hashesEqual(blockHash, entries[1].block_id));
+
+  core.getBlockEntryCacheStatistics(hits, misses);
+  ASSERT_EQ(0, hits);
+  ASSERT_EQ(2, misses);
+
+  // the second query is served from the cache
+  std::vector<BlockFullInfo> cachedEntries;
+  ASSERT_TRUE(core.queryBlocks(blockHashes, timestamp, startHeight, currentHeight, fullOffset, cachedEntries));
+  ASSERT_EQ(2, cachedEntries.size());
+  ASSERT_EQ(entries[1].cachedEntry->block, cachedEntries[1].cachedEntry->block);
+  ASSERT_EQ(entries[1].cachedEntry.get(), cachedEntries[1].cachedEntry.get());
+
+  core.getBlockEntryCacheStatistics(hits, misses);
+  ASSERT_EQ(2, hits);
+  ASSERT_EQ(2, misses);
+}
+
+// queryBlocksLite()
+// global output indexes are sent along with the blocks
+TEST(Core, 66)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  CryptonoteProtocol crpytonoteProtocol;
+  Core core(currency, &crpytonoteProtocol, logger);
+  CoreConfig coreConfig;
+  MinerConfig minerConfig;
+  bool loadExisting = false;
+  ASSERT_TRUE(core.init(coreConfig, minerConfig, loadExisting));
+
+  Crypto::Hash blockHash;
+  ASSERT_TRUE(addBlock3(core, blockHash));
+
+  std::vector<Crypto::Hash> blockHashes;
+  blockHashes.push_back(currency.genesisBlockHash());
+
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  std::vector<BlockShortInfo> entries;
+  uint64_t timestamp = 0;
+  ASSERT_TRUE(core.queryBlocksLite(blockHashes, timestamp, startHeight, currentHeight, fullOffset, entries));
+  ASSERT_EQ(2, entries.size());
+
+  for (const BlockShortInfo& entry : entries)
+  {
+    Block block;
+    ASSERT_TRUE(core.getBlockByHash(entry.blockId, block));
+
+    std::vector<uint32_t> globalIndexes;
+    ASSERT_TRUE(core.get_tx_outputs_gindexes(getObjectHash(block.baseTransaction), globalIndexes));
+    ASSERT_FALSE(globalIndexes.empty());
+    ASSERT_EQ(globalIndexes, entry.baseTransactionGlobalIndexes);
+
+    for (const TransactionPrefixInfo& prefixInfo : entry.txPrefixes)
+    {
+      ASSERT_TRUE(core.get_tx_outputs_gindexes(prefixInfo.txHash, globalIndexes));
+      ASSERT_EQ(globalIndexes, prefixInfo.globalIndexes);
+    }
+  }
+}
+
+// get_block_template()
+// the template cached for the tip is given again with the extra nonce of the request
+TEST(Core, 67)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  CryptonoteProtocol crpytonoteProtocol;
+  Core core(currency, &crpytonoteProtocol, logger);
+  CoreConfig coreConfig;
+  MinerConfig minerConfig;
+  bool loadExisting = false;
+  ASSERT_TRUE(core.init(coreConfig, minerConfig, loadExisting));
+
+  ASSERT_TRUE(addBlock1(core));
+
+  AccountPublicAddress accountPublicAddress;
+  accountPublicAddress.viewPublicKey = generateKeyPair().publicKey;
+  accountPublicAddress.spendPublicKey = generateKeyPair().publicKey;
+
+  BinaryArray extraNonce1 = { 1, 2, 3, 4 };
+  BinaryArray extraNonce2 = { 5, 6, 7, 8 };
+
+  Block block1;
+  Block block2;
+  difficulty_type difficulty1;
+  difficulty_type difficulty2;
+  uint32_t height1;
+  uint32_t height2;
+
+  ASSERT_TRUE(core.get_block_template(block1, accountPublicAddress, difficulty1, height1, extraNonce1));
+  ASSERT_TRUE(core.get_block_template(block2, accountPublicAddress, difficulty2, height2, extraNonce2));
+
+  ASSERT_EQ(block1.previousBlockHash, block2.previousBlockHash);
+  ASSERT_EQ(difficulty1, difficulty2);
+  ASSERT_EQ(height1, height2);
+
+  // the coinbase transactions differ in the extra nonce only
+  BinaryArray extra1 = block1.baseTransaction.extra;
+  BinaryArray extra2 = block2.baseTransaction.extra;
+  ASSERT_EQ(extra1.size(), extra2.size());
+  ASSERT_TRUE(std::equal(extraNonce1.begin(), extraNonce1.end(), extra1.end() - extraNonce1.size()));
+  ASSERT_TRUE(std::equal(extraNonce2.begin(), extraNonce2.end(), extra2.end() - extraNonce2.size()));
+  std::copy(extraNonce1.begin(), extraNonce1.end(), extra2.end() - extraNonce1.size());
+  ASSERT_EQ(extra1, extra2);
+  ASSERT_EQ(boost::get<KeyOutput>(block1.baseTransaction.outputs[0].target).key, boost::get<KeyOutput>(block2.baseTransaction.outputs[0].target).key);
+
+  ASSERT_NE(block1.merkleRoot, block2.merkleRoot);
+  ASSERT_EQ(get_tx_tree_hash(block2), block2.merkleRoot);
+
+  // another extra nonce size gives another coinbase transaction
+  BinaryArray extraNonce3 = { 1, 2, 3 };
+  Block block3;
+  ASSERT_TRUE(core.get_block_template(block3, accountPublicAddress, difficulty2, height2, extraNonce3));
+  ASSERT_NE(boost::get<KeyOutput>(block1.baseTransaction.outputs[0].target).key, boost::get<KeyOutput>(block3.baseTransaction.outputs[0].target).key);
+
+  // the cached template can be mined
+  Crypto::Hash proofOfWorkIgnore = NULL_HASH;
+  Crypto::cn_context context;
+  while(!core.currency().checkProofOfWork1(context, block2, difficulty2, proofOfWorkIgnore))
+  {
+    block2.nonce++;
+  }
+
+  ASSERT_TRUE(core.handle_block_found(block2));
+  ASSERT_EQ(get_block_hash(block2), core.get_tail_id());
+
+  // a new block gives a new template
+  ASSERT_TRUE(core.get_block_template(block1, accountPublicAddress, difficulty1, height1, extraNonce1));
+  ASSERT_EQ(get_block_hash(block2), block1.previousBlockHash);
+  ASSERT_EQ(height2 + 1, height1);
+  ASSERT_NE(boost::get<KeyOutput>(block1.baseTransaction.outputs[0].target).key, boost::get<KeyOutput>(block2.baseTransaction.outputs[0].target).key);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -34,6 +34,7 @@ get_aux_block_header_hash()
 get_block_hash()
 get_block_hash()
 get_block_longhash()
+get_block_longhash_state()
 get_inputs_money_amount()
 get_outs_money_amount()
 check_inputs_types_supported()
@@ -1194,6 +1195,30 @@ TEST(cryptoNoteFormatUtils, 34)
   ASSERT_TRUE(generate_key_image_helper(accountKeys, transactionKeyPair.publicKey, realOutputIndex, ephemeralKeyPair, keyImage));
 }
 
+// get_block_longhash_state()
+TEST(cryptoNoteFormatUtils, 35)
+{
+  Block block = getRandBlock();
+
+  Crypto::nonce_hash_state hashState;
+  ASSERT_TRUE(get_block_longhash_state(block, hashState));
+
+  // hashes of nonces 1000, 1003, 1006, ...
+  const size_t count = 4 * Crypto::NONCE_HASH_LANES + 1;
+  Crypto::Hash hashes[count];
+  Crypto::nonce_hash(hashState, 1000, 3, count, hashes);
+
+  Crypto::cn_context context;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    block.nonce = 1000 + 3 * i;
+    Crypto::Hash blockHash;
+    ASSERT_TRUE(get_block_longhash(context, block, blockHash));
+    ASSERT_EQ(blockHash, hashes[i]);
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
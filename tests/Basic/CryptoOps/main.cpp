@@ -0,0 +1,135 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "crypto/crypto.h"
+#include <memory>
+#include <vector>
+
+using namespace Crypto;
+
+/*
+
+My Notes
+
+class crypto_ops {
+
+public
+  generate_key_derivations()
+  underive_public_keys()
+
+}
+
+*/
+
+// Helper functions
+
+uint32_t loopCount = 100;
+
+// a public key that is not a point of the curve
+PublicKey getInvalidPublicKey()
+{
+  PublicKey key;
+
+  do
+  {
+    key = rand<PublicKey>();
+  } while (check_key(key));
+
+  return key;
+}
+
+// generate_key_derivations()
+TEST(CryptoOps, 1)
+{
+  PublicKey viewPublicKey;
+  SecretKey viewSecretKey;
+  generate_keys(viewPublicKey, viewSecretKey);
+
+  std::vector<PublicKey> keys;
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    PublicKey publicKey;
+    SecretKey secretKey;
+    generate_keys(publicKey, secretKey);
+    keys.push_back(i % 7 == 3 ? getInvalidPublicKey() : publicKey);
+  }
+
+  std::vector<KeyDerivation> derivations(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  generate_key_derivations(keys.data(), keys.size(), viewSecretKey, derivations.data(), valid.get());
+
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    KeyDerivation derivation;
+    ASSERT_EQ(generate_key_derivation(keys[i], viewSecretKey, derivation), valid[i]);
+    ASSERT_EQ(i % 7 != 3, valid[i]);
+
+    if (valid[i])
+    {
+      ASSERT_EQ(0, memcmp(&derivation, &derivations[i], sizeof(derivation)));
+    }
+  }
+
+  // one key and no keys
+  generate_key_derivations(keys.data(), 1, viewSecretKey, derivations.data(), valid.get());
+  ASSERT_TRUE(valid[0]);
+  generate_key_derivations(keys.data(), 0, viewSecretKey, derivations.data(), valid.get());
+}
+
+// underive_public_keys()
+TEST(CryptoOps, 2)
+{
+  PublicKey viewPublicKey;
+  SecretKey viewSecretKey;
+  generate_keys(viewPublicKey, viewSecretKey);
+
+  PublicKey spendPublicKey;
+  SecretKey spendSecretKey;
+  generate_keys(spendPublicKey, spendSecretKey);
+
+  std::vector<KeyDerivation> derivations;
+  std::vector<size_t> outputIndexes;
+  std::vector<PublicKey> keys;
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    PublicKey transactionPublicKey;
+    SecretKey transactionSecretKey;
+    generate_keys(transactionPublicKey, transactionSecretKey);
+
+    KeyDerivation derivation;
+    ASSERT_TRUE(generate_key_derivation(viewPublicKey, transactionSecretKey, derivation));
+
+    size_t outputIndex = i * 37;
+    PublicKey key;
+    ASSERT_TRUE(derive_public_key(derivation, outputIndex, spendPublicKey, key));
+
+    derivations.push_back(derivation);
+    outputIndexes.push_back(outputIndex);
+    keys.push_back(i % 5 == 1 ? getInvalidPublicKey() : key);
+  }
+
+  std::vector<PublicKey> bases(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  underive_public_keys(derivations.data(), outputIndexes.data(), keys.data(), keys.size(), bases.data(), valid.get());
+
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    PublicKey base;
+    ASSERT_EQ(underive_public_key(derivations[i], outputIndexes[i], keys[i], base), valid[i]);
+    ASSERT_EQ(i % 5 != 1, valid[i]);
+
+    if (valid[i])
+    {
+      ASSERT_EQ(base, bases[i]);
+      ASSERT_EQ(spendPublicKey, bases[i]);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
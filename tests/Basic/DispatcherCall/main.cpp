@@ -0,0 +1,118 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "System/Dispatcher.h"
+#include "System/DispatcherCall.h"
+#include "System/Event.h"
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace System;
+
+// Helper functions
+
+// runs a dispatcher in another thread until stop() is called
+class DispatcherThread
+{
+public:
+  DispatcherThread()
+  {
+    std::promise<void> started;
+    std::future<void> startedFuture = started.get_future();
+
+    thread = std::thread([this, &started] {
+      Dispatcher threadDispatcher;
+      Event threadStopEvent(threadDispatcher);
+      dispatcher = &threadDispatcher;
+      stopEvent = &threadStopEvent;
+      started.set_value();
+      threadStopEvent.wait();
+    });
+
+    startedFuture.wait();
+  }
+
+  ~DispatcherThread()
+  {
+    Event* event = stopEvent;
+    dispatcher->remoteSpawn([=] { event->set(); });
+    thread.join();
+  }
+
+  Dispatcher* dispatcher;
+  Event* stopEvent;
+  std::thread thread;
+};
+
+// callInDispatcher()
+TEST(DispatcherCall, 1)
+{
+  // same dispatcher
+  Dispatcher dispatcher;
+  std::thread::id threadId = callInDispatcher<std::thread::id>(dispatcher, dispatcher, [] { return std::this_thread::get_id(); });
+  ASSERT_EQ(std::this_thread::get_id(), threadId);
+}
+
+// callInDispatcher()
+TEST(DispatcherCall, 2)
+{
+  // dispatcher of another thread
+  Dispatcher dispatcher;
+  DispatcherThread owner;
+
+  std::thread::id threadId = callInDispatcher<std::thread::id>(dispatcher, *owner.dispatcher, [] { return std::this_thread::get_id(); });
+  ASSERT_EQ(owner.thread.get_id(), threadId);
+
+  int value = 0;
+  callInDispatcher<void>(dispatcher, *owner.dispatcher, [&value] { value = 5; });
+  ASSERT_EQ(5, value);
+}
+
+// callInDispatcher()
+TEST(DispatcherCall, 3)
+{
+  // exceptions are thrown in the calling context
+  Dispatcher dispatcher;
+  DispatcherThread owner;
+
+  ASSERT_THROW(callInDispatcher<int>(dispatcher, *owner.dispatcher, [] () -> int { throw std::runtime_error("error"); }), std::runtime_error);
+  ASSERT_EQ(7, callInDispatcher<int>(dispatcher, *owner.dispatcher, [] { return 7; }));
+}
+
+// callInDispatcher()
+TEST(DispatcherCall, 4)
+{
+  // many calls from the contexts of several threads
+  DispatcherThread owner;
+  size_t counter = 0;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    threads.emplace_back([&owner, &counter] {
+      Dispatcher dispatcher;
+      for (size_t j = 0; j < 1000; ++j)
+      {
+        callInDispatcher<void>(dispatcher, *owner.dispatcher, [&counter] { ++counter; });
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  // the calls are executed one at a time in the thread of owner
+  ASSERT_EQ(4000, counter);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -3,9 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "gtest/gtest.h"
+#include "crypto/blake2b-backend.h"
 #include "crypto/hash.h"
 #include "Common/StringTools.h"
+#include <cstring>
 #include <string>
+#include <vector>
 
 TEST(Blake2b, 1)
 {
@@ -3527,6 +3530,353 @@ TEST(Blake2b, 320)
   ASSERT_EQ("bd9fd2024cf5bbe5c7669f036061dddf8e8d4ec735ed892d5f565192d2f34257", hashString);
 }
 
+// nonce_hash_init()
+// nonce_hash()
+// with every supported backend, the AVX2 backend hashes groups of 8 nonces and the rest in the 4 lanes
+TEST(NonceHash, 1)
+{
+  const blake2b_backend startBackend = blake2b_get_backend();
+  uint8_t blob[128];
+  for (size_t i = 0; i < sizeof(blob); ++i)
+  {
+    blob[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  for (int backend = BLAKE2B_BACKEND_REF; backend < BLAKE2B_BACKEND_COUNT; ++backend)
+  {
+    if (blake2b_set_backend(static_cast<blake2b_backend>(backend)) != 0)
+    {
+      continue;
+    }
+
+    for (size_t length = 8; length <= sizeof(blob); length += 24)
+    {
+      for (size_t nonceOffset = 0; nonceOffset + 8 <= length; nonceOffset += 8)
+      {
+        Crypto::nonce_hash_state state;
+        ASSERT_EQ(0, Crypto::nonce_hash_init(&state, blob, length, nonceOffset));
+
+        Crypto::Hash hashes[21];
+        Crypto::nonce_hash(state, 0xfffffffffffffffeULL, 5, 21, hashes);
+
+        for (size_t i = 0; i < 21; ++i)
+        {
+          uint8_t data[128];
+          memcpy(data, blob, length);
+          uint64_t nonce = 0xfffffffffffffffeULL + 5 * i;
+          memcpy(data + nonceOffset, &nonce, sizeof(nonce));
+
+          Crypto::Hash hash;
+          Crypto::cn_fast_hash(data, length, hash);
+          ASSERT_EQ(hash, hashes[i]) << blake2b_backend_name(static_cast<blake2b_backend>(backend)) << ", nonce " << i;
+        }
+      }
+    }
+  }
+
+  ASSERT_EQ(0, blake2b_set_backend(startBackend));
+
+  // blobs longer than one block and nonces that are not word aligned are not supported
+  Crypto::nonce_hash_state state;
+  ASSERT_EQ(-1, Crypto::nonce_hash_init(&state, blob, 129, 0));
+  ASSERT_EQ(-1, Crypto::nonce_hash_init(&state, blob, 80, 4));
+  ASSERT_EQ(-1, Crypto::nonce_hash_init(&state, blob, 80, 80));
+}
+
+#if defined(BLAKE2B_X86) && !defined(__AVX2__)
+size_t compressX8Calls = 0;
+
+// blake2b_compress_x8_avx2() that counts its calls
+void countingCompressX8(uint64_t* h, const uint64_t* m, const uint64_t* t, const uint64_t* f)
+{
+  ++compressX8Calls;
+  blake2b_compress_x8_avx2(h, m, t, f);
+}
+#endif
+
+// nonce_hash()
+// the NONCE_HASH_BATCH nonces hashed by the miners, all of them in groups of 8 with the AVX2 backend
+TEST(NonceHash, 2)
+{
+  const blake2b_backend startBackend = blake2b_get_backend();
+  uint8_t blob[76];
+  for (size_t i = 0; i < sizeof(blob); ++i)
+  {
+    blob[i] = static_cast<uint8_t>(i * 13);
+  }
+
+  const size_t nonceOffset = 40;
+  Crypto::nonce_hash_state state;
+  ASSERT_EQ(0, Crypto::nonce_hash_init(&state, blob, sizeof(blob), nonceOffset));
+
+  Crypto::Hash expected[Crypto::NONCE_HASH_BATCH];
+  for (size_t i = 0; i < Crypto::NONCE_HASH_BATCH; ++i)
+  {
+    uint8_t data[sizeof(blob)];
+    memcpy(data, blob, sizeof(blob));
+    uint64_t nonce = 1000 + 3 * i;
+    memcpy(data + nonceOffset, &nonce, sizeof(nonce));
+    Crypto::cn_fast_hash(data, sizeof(data), expected[i]);
+  }
+
+  for (int backend = BLAKE2B_BACKEND_REF; backend < BLAKE2B_BACKEND_COUNT; ++backend)
+  {
+    if (blake2b_set_backend(static_cast<blake2b_backend>(backend)) != 0)
+    {
+      continue;
+    }
+
+    Crypto::Hash hashes[Crypto::NONCE_HASH_BATCH];
+    Crypto::nonce_hash(state, 1000, 3, Crypto::NONCE_HASH_BATCH, hashes);
+
+    for (size_t i = 0; i < Crypto::NONCE_HASH_BATCH; ++i)
+    {
+      ASSERT_EQ(expected[i], hashes[i]) << blake2b_backend_name(static_cast<blake2b_backend>(backend)) << ", nonce " << i;
+    }
+  }
+
+#if defined(BLAKE2B_X86) && !defined(__AVX2__)
+  if (blake2b_set_backend(BLAKE2B_BACKEND_AVX2) == 0)
+  {
+    blake2b_compress_lanes_fn compressX8 = blake2b_compress_x8_fp;
+    blake2b_compress_x8_fp = &countingCompressX8;
+    compressX8Calls = 0;
+
+    Crypto::Hash hashes[Crypto::NONCE_HASH_BATCH];
+    Crypto::nonce_hash(state, 1000, 3, Crypto::NONCE_HASH_BATCH, hashes);
+
+    blake2b_compress_x8_fp = compressX8;
+    ASSERT_EQ(Crypto::NONCE_HASH_BATCH / 8, compressX8Calls);
+    ASSERT_EQ(0, memcmp(expected, hashes, sizeof(hashes)));
+  }
+#endif
+
+  ASSERT_EQ(0, blake2b_set_backend(startBackend));
+}
+
+// the chain of tree_hash() with one cn_fast_hash() per node
+Crypto::Hash treeHashChain(Crypto::Hash root, const Crypto::Hash* hashes, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint8_t node[65];
+    node[0] = 1;
+    memcpy(node + 1, &hashes[i], sizeof(Crypto::Hash));
+    memcpy(node + 33, &root, sizeof(Crypto::Hash));
+    Crypto::cn_fast_hash(node, sizeof(node), root);
+  }
+
+  return root;
+}
+
+// tree_hash()
+TEST(TreeHash, 1)
+{
+  Crypto::Hash hashes[9];
+  for (size_t i = 0; i < 9; ++i)
+  {
+    Crypto::cn_fast_hash(&i, sizeof(i), hashes[i]);
+  }
+
+  for (size_t count = 1; count <= 9; ++count)
+  {
+    Crypto::Hash root;
+    Crypto::tree_hash(hashes, count, root);
+    ASSERT_EQ(treeHashChain(hashes[0], hashes + 1, count - 1), root);
+  }
+}
+
+// tree_hash_extend()
+TEST(TreeHash, 2)
+{
+  Crypto::Hash hashes[5];
+  for (size_t i = 0; i < 5; ++i)
+  {
+    Crypto::cn_fast_hash(&i, sizeof(i), hashes[i]);
+  }
+
+  for (size_t rootCount = 0; rootCount <= 2 * Crypto::TREE_HASH_LANES + 1; ++rootCount)
+  {
+    for (size_t count = 0; count <= 5; ++count)
+    {
+      std::vector<Crypto::Hash> roots(rootCount);
+      for (size_t i = 0; i < rootCount; ++i)
+      {
+        uint64_t seed = 1000 + i;
+        Crypto::cn_fast_hash(&seed, sizeof(seed), roots[i]);
+      }
+
+      std::vector<Crypto::Hash> startRoots = roots;
+      Crypto::tree_hash_extend(roots.data(), rootCount, hashes, count);
+
+      for (size_t i = 0; i < rootCount; ++i)
+      {
+        ASSERT_EQ(treeHashChain(startRoots[i], hashes, count), roots[i]);
+      }
+    }
+  }
+}
+
+// messages of every length around the block boundaries
+std::vector<std::vector<uint8_t>> getBlake2bMessages()
+{
+  std::vector<std::vector<uint8_t>> messages;
+  for (size_t length : { 0, 1, 32, 63, 64, 65, 76, 127, 128, 129, 200, 255, 256, 257, 384, 1000 })
+  {
+    std::vector<uint8_t> message(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+      message[i] = static_cast<uint8_t>(i * 13 + length);
+    }
+
+    messages.push_back(message);
+  }
+
+  return messages;
+}
+
+// blake2b_backend_supported()
+// blake2b_set_backend()
+// blake2b_get_backend()
+// every supported backend gives the hashes of the reference backend
+TEST(Blake2bBackend, 1)
+{
+  const blake2b_backend startBackend = blake2b_get_backend();
+  ASSERT_TRUE(blake2b_backend_supported(startBackend));
+  ASSERT_TRUE(blake2b_backend_supported(BLAKE2B_BACKEND_REF));
+  ASSERT_FALSE(blake2b_backend_supported(BLAKE2B_BACKEND_COUNT));
+
+  std::vector<std::vector<uint8_t>> messages = getBlake2bMessages();
+  uint8_t key[BLAKE2B_KEYBYTES];
+  for (size_t i = 0; i < sizeof(key); ++i)
+  {
+    key[i] = static_cast<uint8_t>(i);
+  }
+
+  // unkeyed 32 and 64 byte digests and keyed 64 byte digests of each message
+  ASSERT_EQ(0, blake2b_set_backend(BLAKE2B_BACKEND_REF));
+  std::vector<std::vector<uint8_t>> expected;
+  for (const std::vector<uint8_t>& message : messages)
+  {
+    std::vector<uint8_t> digests(32 + 64 + 64);
+    ASSERT_EQ(0, blake2b(digests.data(), 32, message.data(), message.size(), nullptr, 0));
+    ASSERT_EQ(0, blake2b(digests.data() + 32, 64, message.data(), message.size(), nullptr, 0));
+    ASSERT_EQ(0, blake2b(digests.data() + 96, 64, message.data(), message.size(), key, sizeof(key)));
+    expected.push_back(digests);
+  }
+
+  for (int backend = BLAKE2B_BACKEND_REF; backend < BLAKE2B_BACKEND_COUNT; ++backend)
+  {
+    if (!blake2b_backend_supported(static_cast<blake2b_backend>(backend)))
+    {
+      ASSERT_EQ(-1, blake2b_set_backend(static_cast<blake2b_backend>(backend)));
+      continue;
+    }
+
+    ASSERT_EQ(0, blake2b_set_backend(static_cast<blake2b_backend>(backend)));
+    ASSERT_EQ(backend, blake2b_get_backend());
+
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+      std::vector<uint8_t> digests(32 + 64 + 64);
+      ASSERT_EQ(0, blake2b(digests.data(), 32, messages[i].data(), messages[i].size(), nullptr, 0));
+      ASSERT_EQ(0, blake2b(digests.data() + 32, 64, messages[i].data(), messages[i].size(), nullptr, 0));
+      ASSERT_EQ(0, blake2b(digests.data() + 96, 64, messages[i].data(), messages[i].size(), key, sizeof(key)));
+      ASSERT_EQ(expected[i], digests) << blake2b_backend_name(static_cast<blake2b_backend>(backend)) << ", length " << messages[i].size();
+    }
+
+    char hash[32];
+    std::string str = "x";
+    Crypto::cn_fast_hash(str.data(), str.size(), hash);
+    ASSERT_EQ("d161d71145abeec5ef15abcf0459cec60a27321e2f0ac0ef7ace5254f5944476", Common::toHex(hash, 32));
+  }
+
+  ASSERT_EQ(0, blake2b_set_backend(startBackend));
+}
+
+// blake2b_x4()
+// blake2b_x8()
+TEST(Blake2bBackend, 2)
+{
+  const blake2b_backend startBackend = blake2b_get_backend();
+  std::vector<std::vector<uint8_t>> messages = getBlake2bMessages();
+
+  for (int backend = BLAKE2B_BACKEND_REF; backend < BLAKE2B_BACKEND_COUNT; ++backend)
+  {
+    if (blake2b_set_backend(static_cast<blake2b_backend>(backend)) != 0)
+    {
+      continue;
+    }
+
+    for (size_t lanes : { 4, 8 })
+    {
+      for (size_t outlen : { 32, 64 })
+      {
+        // the lanes take the messages in turn so each lane gets messages of different lengths
+        for (size_t first = 0; first < messages.size(); ++first)
+        {
+          std::vector<const void*> in(lanes);
+          std::vector<size_t> inlen(lanes);
+          for (size_t l = 0; l < lanes; ++l)
+          {
+            const std::vector<uint8_t>& message = messages[(first + l * 3) % messages.size()];
+            in[l] = message.data();
+            inlen[l] = message.size();
+          }
+
+          std::vector<uint8_t> digests(lanes * outlen);
+          ASSERT_EQ(0, lanes == 4 ? blake2b_x4(digests.data(), outlen, in.data(), inlen.data()) : blake2b_x8(digests.data(), outlen, in.data(), inlen.data()));
+
+          for (size_t l = 0; l < lanes; ++l)
+          {
+            std::vector<uint8_t> digest(outlen);
+            ASSERT_EQ(0, blake2b(digest.data(), outlen, in[l], inlen[l], nullptr, 0));
+            ASSERT_EQ(digest, std::vector<uint8_t>(digests.begin() + l * outlen, digests.begin() + (l + 1) * outlen)) <<
+              blake2b_backend_name(static_cast<blake2b_backend>(backend)) << ", lane " << l << ", length " << inlen[l];
+          }
+        }
+      }
+    }
+  }
+
+  ASSERT_EQ(0, blake2b_set_backend(startBackend));
+
+  std::vector<const void*> in(8, messages[1].data());
+  std::vector<size_t> inlen(8, messages[1].size());
+  uint8_t digests[8 * 64];
+  ASSERT_EQ(-1, blake2b_x4(digests, 0, in.data(), inlen.data()));
+  ASSERT_EQ(-1, blake2b_x8(digests, 65, in.data(), inlen.data()));
+  ASSERT_EQ(-1, blake2b_x4(nullptr, 32, in.data(), inlen.data()));
+  in[3] = nullptr;
+  ASSERT_EQ(-1, blake2b_x4(digests, 32, in.data(), inlen.data()));
+}
+
+// cn_fast_hash_many()
+TEST(Blake2bBackend, 3)
+{
+  std::vector<std::vector<uint8_t>> messages = getBlake2bMessages();
+
+  for (size_t count = 0; count <= 2 * messages.size(); ++count)
+  {
+    std::vector<const void*> data;
+    std::vector<size_t> lengths;
+    for (size_t i = 0; i < count; ++i)
+    {
+      const std::vector<uint8_t>& message = messages[i % messages.size()];
+      data.push_back(message.data());
+      lengths.push_back(message.size());
+    }
+
+    std::vector<Crypto::Hash> hashes(count);
+    Crypto::cn_fast_hash_many(data.data(), lengths.data(), count, hashes.data());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      ASSERT_EQ(Crypto::cn_fast_hash(data[i], lengths[i]), hashes[i]);
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
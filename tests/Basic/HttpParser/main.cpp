@@ -15,11 +15,27 @@ public
   receiveRequest()
   receiveResponse()
   parseResponseStatusFromString()
+  getReceiveBuffer()
+  received()
+  hasReceivedData()
+  parseRequest()
+  parseResponse()
 
 */
 
 using namespace CryptoNote;
 
+// Helper functions
+
+void receive(HttpParser& httpParser, const std::string& data)
+{
+  size_t size;
+  uint8_t* buffer = httpParser.getReceiveBuffer(size);
+  ASSERT_GE(size, data.size());
+  memcpy(buffer, data.data(), data.size());
+  httpParser.received(data.size());
+}
+
 // constructor
 TEST(HttpParser, 1)
 {
@@ -81,6 +97,174 @@ TEST(HttpParser, 4)
   ASSERT_ANY_THROW(httpParser.parseResponseStatusFromString("Hello World"));
 }
 
+// getReceiveBuffer(), received() and hasReceivedData()
+TEST(HttpParser, 5)
+{
+  HttpParser httpParser;
+  ASSERT_FALSE(httpParser.hasReceivedData());
+
+  size_t size;
+  uint8_t* buffer = httpParser.getReceiveBuffer(size);
+  ASSERT_NE(nullptr, buffer);
+  ASSERT_GT(size, 0);
+
+  receive(httpParser, "POST /json_rpc HTTP/1.1\r\n");
+  ASSERT_TRUE(httpParser.hasReceivedData());
+}
+
+// parseRequest()
+TEST(HttpParser, 6)
+{
+  HttpParser httpParser;
+  std::string str = "POST /json_rpc HTTP/1.1\r\nmyHeaderName1:myHeaderValue1\r\nmyHeaderName2: myHeaderValue2\r\nContent-Length: 49\r\n\r\nmyBodyName1=myBodyValue1&myBodyName2=myBodyValue2";
+  HttpRequest httpRequest;
+
+  // incomplete headers and body
+  receive(httpParser, str.substr(0, 30));
+  ASSERT_FALSE(httpParser.parseRequest(httpRequest));
+  receive(httpParser, str.substr(30, 70));
+  ASSERT_FALSE(httpParser.parseRequest(httpRequest));
+  receive(httpParser, str.substr(100));
+  ASSERT_TRUE(httpParser.parseRequest(httpRequest));
+  ASSERT_FALSE(httpParser.hasReceivedData());
+
+  ASSERT_EQ("POST", httpRequest.getMethod());
+  ASSERT_EQ("/json_rpc", httpRequest.getUrl());
+  ASSERT_EQ("myBodyName1=myBodyValue1&myBodyName2=myBodyValue2", httpRequest.getBody());
+
+  HttpRequest::Headers headers = httpRequest.getHeaders();
+  ASSERT_EQ("myHeaderValue1", headers["myheadername1"]);
+  ASSERT_EQ("myHeaderValue2", headers["myheadername2"]);
+  ASSERT_EQ("49", headers["content-length"]);
+}
+
+// parseRequest() with pipelined requests
+TEST(HttpParser, 7)
+{
+  HttpParser httpParser;
+  std::string request1 = "POST /getinfo HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+  std::string request2 = "POST /json_rpc HTTP/1.1\r\nContent-Length: 5\r\n\r\nHello";
+  std::string request3 = "POST /getheight HTTP/1.1\r\n";
+  receive(httpParser, request1 + request2 + request3);
+
+  HttpRequest httpRequest1;
+  ASSERT_TRUE(httpParser.parseRequest(httpRequest1));
+  ASSERT_EQ("/getinfo", httpRequest1.getUrl());
+  ASSERT_EQ("", httpRequest1.getBody());
+
+  HttpRequest httpRequest2;
+  ASSERT_TRUE(httpParser.parseRequest(httpRequest2));
+  ASSERT_EQ("/json_rpc", httpRequest2.getUrl());
+  ASSERT_EQ("Hello", httpRequest2.getBody());
+
+  HttpRequest httpRequest3;
+  ASSERT_FALSE(httpParser.parseRequest(httpRequest3));
+  ASSERT_TRUE(httpParser.hasReceivedData());
+  receive(httpParser, "\r\n");
+  ASSERT_TRUE(httpParser.parseRequest(httpRequest3));
+  ASSERT_EQ("/getheight", httpRequest3.getUrl());
+  ASSERT_FALSE(httpParser.hasReceivedData());
+}
+
+// parseRequest() with a body larger than the receive buffer
+TEST(HttpParser, 8)
+{
+  HttpParser httpParser;
+  std::string body(100000, 'x');
+  std::string str = "POST /sendrawtransaction HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+  HttpRequest httpRequest;
+  size_t offset = 0;
+  while (!httpParser.parseRequest(httpRequest)) {
+    ASSERT_LT(offset, str.size());
+    size_t size;
+    uint8_t* buffer = httpParser.getReceiveBuffer(size);
+    size = std::min(size, str.size() - offset);
+    memcpy(buffer, str.data() + offset, size);
+    httpParser.received(size);
+    offset += size;
+  }
+
+  ASSERT_EQ(str.size(), offset);
+  ASSERT_EQ(body, httpRequest.getBody());
+}
+
+// parseRequest() errors
+TEST(HttpParser, 9)
+{
+  HttpRequest httpRequest;
+
+  HttpParser httpParser1;
+  receive(httpParser1, "POST / HTTP/1.1\r\n: myHeaderValue\r\n\r\n");
+  ASSERT_ANY_THROW(httpParser1.parseRequest(httpRequest));
+
+  HttpParser httpParser2;
+  receive(httpParser2, "POST / HTTP/1.1\r\nmyHeaderName\r\n\r\n");
+  ASSERT_ANY_THROW(httpParser2.parseRequest(httpRequest));
+
+  // headers without an end
+  HttpParser httpParser3;
+  std::string header = "myHeaderName: " + std::string(1000, 'x') + "\r\n";
+  ASSERT_ANY_THROW({
+    for (size_t i = 0; i < 100; ++i) {
+      receive(httpParser3, header);
+      httpParser3.parseRequest(httpRequest);
+    }
+  });
+}
+
+// parseResponse()
+TEST(HttpParser, 10)
+{
+  HttpParser httpParser;
+  std::string str1 = "HTTP/1.1 200 OK\r\nmyHeaderName1:myHeaderValue1\r\nContent-Length:11\r\n\r\nHello World";
+  std::string str2 = "HTTP/1.1 404 Not Found\r\n\r\n";
+
+  HttpResponse httpResponse1;
+  receive(httpParser, str1.substr(0, 20));
+  ASSERT_FALSE(httpParser.parseResponse(httpResponse1));
+  receive(httpParser, str1.substr(20) + str2);
+  ASSERT_TRUE(httpParser.parseResponse(httpResponse1));
+
+  ASSERT_EQ(HttpResponse::HTTP_STATUS::STATUS_200, httpResponse1.getStatus());
+  std::map<std::string, std::string> headers = httpResponse1.getHeaders();
+  ASSERT_EQ("myHeaderValue1", headers["myheadername1"]);
+  ASSERT_EQ("Hello World", httpResponse1.getBody());
+
+  HttpResponse httpResponse2;
+  ASSERT_TRUE(httpParser.parseResponse(httpResponse2));
+  ASSERT_EQ(HttpResponse::HTTP_STATUS::STATUS_404, httpResponse2.getStatus());
+  ASSERT_FALSE(httpParser.hasReceivedData());
+}
+
+// parseRequest() and parseResponse() with a large Content-Length
+TEST(HttpParser, 11)
+{
+  HttpRequest httpRequest;
+  HttpResponse httpResponse;
+
+  HttpParser httpParser1;
+  receive(httpParser1, "POST /json_rpc HTTP/1.1\r\nContent-Length: 8000000000\r\n\r\n");
+  ASSERT_ANY_THROW(httpParser1.parseRequest(httpRequest));
+
+  // wraps around when added to the end of the headers
+  HttpParser httpParser2;
+  receive(httpParser2, "POST /json_rpc HTTP/1.1\r\nContent-Length: 18446744073709551615\r\n\r\n");
+  ASSERT_ANY_THROW(httpParser2.parseRequest(httpRequest));
+
+  HttpParser httpParser3;
+  receive(httpParser3, "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n");
+  ASSERT_ANY_THROW(httpParser3.parseResponse(httpResponse));
+
+  // the buffer is not grown to a declared length before the body arrives
+  HttpParser httpParser4;
+  receive(httpParser4, "POST /json_rpc HTTP/1.1\r\nContent-Length: 90000000\r\n\r\n");
+  ASSERT_FALSE(httpParser4.parseRequest(httpRequest));
+  size_t size;
+  httpParser4.getReceiveBuffer(size);
+  ASSERT_LT(size, 1000000);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -18,6 +18,7 @@ public
   addHeader()
   setBody()
   setUrl()
+  getHeaderString()
 
 */
 
@@ -94,6 +95,26 @@ TEST(HttpRequest, 8)
   ASSERT_EQ("Hello World", httpRequest.getBody());
 }
 
+// getHeaderString()
+TEST(HttpRequest, 9)
+{
+  HttpRequest httpRequest;
+  httpRequest.setUrl("/json_rpc");
+  httpRequest.addHeader("myName", "myValue");
+  httpRequest.setBody("Hello World");
+
+  std::string headerString = httpRequest.getHeaderString();
+  ASSERT_EQ(0, headerString.find("POST /json_rpc HTTP/1.1\r\n"));
+  ASSERT_NE(std::string::npos, headerString.find("\r\nHost: 127.0.0.1\r\n"));
+  ASSERT_NE(std::string::npos, headerString.find("\r\nmyName: myValue\r\n"));
+  ASSERT_NE(std::string::npos, headerString.find("\r\nContent-Length: 11\r\n"));
+  ASSERT_EQ(headerString.size() - 4, headerString.find("\r\n\r\n"));
+
+  std::stringstream ss;
+  ss << httpRequest;
+  ASSERT_EQ(headerString + "Hello World", ss.str());
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -18,6 +18,7 @@ public
   getHeaders()
   getStatus()
   getBody()
+  getHeaderString()
 
 */
 
@@ -97,6 +98,25 @@ TEST(HttpResponse, 7)
   ASSERT_EQ("Hello World", httpResponse.getBody());
 }
 
+// getHeaderString()
+TEST(HttpResponse, 8)
+{
+  HttpResponse httpResponse;
+  httpResponse.setStatus(HttpResponse::HTTP_STATUS::STATUS_200);
+  httpResponse.addHeader("myName", "myValue");
+  httpResponse.setBody("Hello World");
+
+  std::string headerString = httpResponse.getHeaderString();
+  ASSERT_EQ(0, headerString.find("HTTP/1.1 200 OK\r\n"));
+  ASSERT_NE(std::string::npos, headerString.find("\r\nmyName: myValue\r\n"));
+  ASSERT_NE(std::string::npos, headerString.find("\r\nContent-Length: 11\r\n"));
+  ASSERT_EQ(headerString.size() - 4, headerString.find("\r\n\r\n"));
+
+  std::stringstream ss;
+  ss << httpResponse;
+  ASSERT_EQ(headerString + "Hello World", ss.str());
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
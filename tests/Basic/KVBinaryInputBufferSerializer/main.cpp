@@ -0,0 +1,327 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "Common/MemoryInputStream.h"
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+#include "Serialization/KVBinaryCommon.h"
+#include "Serialization/KVBinaryInputBufferSerializer.h"
+#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "Serialization/SerializationOverloads.h"
+#include "Serialization/SerializationTools.h"
+#include <string>
+
+using namespace CryptoNote;
+
+/*
+
+My Notes
+
+class KVBinaryInputBufferSerializer {
+
+public
+  KVBinaryInputBufferSerializer()
+  type()
+  beginObject()
+  endObject()
+  beginArray()
+  endArray()
+  operator()()
+  binary()
+
+private
+  scanObject()
+  skipValue()
+  readVarint()
+  require()
+  getValue()
+  getInteger()
+  getString()
+  getNumber()
+
+  const char* m_end;
+  std::vector<Entry> m_entries;
+  std::vector<Frame> m_frames;
+
+}
+
+*/
+
+// Helper functions
+
+uint32_t loopCount = 100;
+
+struct Inner {
+  uint64_t amount;
+  std::string name;
+  std::vector<uint32_t> values;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(amount)
+    KV_MEMBER(name)
+    KV_MEMBER(values)
+  }
+
+  bool operator==(const Inner& other) const {
+    return amount == other.amount && name == other.name && values == other.values;
+  }
+};
+
+struct Outer {
+  uint8_t u8;
+  int16_t i16;
+  uint16_t u16;
+  int32_t i32;
+  uint32_t u32;
+  int64_t i64;
+  uint64_t u64;
+  bool b;
+  std::string str;
+  Crypto::Hash hash;
+  Inner inner;
+  std::vector<Inner> inners;
+  std::vector<std::string> strings;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(u8)
+    KV_MEMBER(i16)
+    KV_MEMBER(u16)
+    KV_MEMBER(i32)
+    KV_MEMBER(u32)
+    KV_MEMBER(i64)
+    KV_MEMBER(u64)
+    KV_MEMBER(b)
+    KV_MEMBER(str)
+    KV_MEMBER(hash)
+    KV_MEMBER(inner)
+    KV_MEMBER(inners)
+    KV_MEMBER(strings)
+  }
+
+  bool operator==(const Outer& other) const {
+    return u8 == other.u8 && i16 == other.i16 && u16 == other.u16 && i32 == other.i32 && u32 == other.u32 &&
+      i64 == other.i64 && u64 == other.u64 && b == other.b && str == other.str && hash == other.hash &&
+      inner == other.inner && inners == other.inners && strings == other.strings;
+  }
+};
+
+// a struct with a field Outer does not have
+struct Extended {
+  uint64_t u64;
+  uint64_t missing;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(u64)
+    KV_MEMBER(missing)
+  }
+};
+
+struct Real {
+  double d;
+  double i32;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(d)
+    KV_MEMBER(i32)
+  }
+};
+
+Inner createInner(uint32_t i)
+{
+  Inner inner;
+  inner.amount = i * 1000000;
+  inner.name = "inner" + std::to_string(i);
+
+  for (uint32_t j = 0; j < i % 5; ++j)
+  {
+    inner.values.push_back(i + j);
+  }
+
+  return inner;
+}
+
+Outer createOuter()
+{
+  Outer outer;
+  outer.u8 = 200;
+  outer.i16 = -300;
+  outer.u16 = 60000;
+  outer.i32 = -70000;
+  outer.u32 = 4000000000;
+  outer.i64 = -5000000000;
+  outer.u64 = 18000000000000000000ULL;
+  outer.b = true;
+  outer.str = std::string(300, 's');
+
+  for (size_t i = 0; i < sizeof(outer.hash.data); ++i)
+  {
+    outer.hash.data[i] = static_cast<uint8_t>(i);
+  }
+
+  outer.inner = createInner(3);
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    outer.inners.push_back(createInner(i));
+    outer.strings.push_back(std::string(i, 'x'));
+  }
+
+  return outer;
+}
+
+template <typename T>
+void loadWithBuffer(T& value, const std::string& buf)
+{
+  KVBinaryInputBufferSerializer serializer(buf.data(), buf.size());
+  serialize(value, serializer);
+}
+
+template <typename T>
+void loadWithStream(T& value, const std::string& buf)
+{
+  Common::MemoryInputStream stream(buf.data(), buf.size());
+  KVBinaryInputStreamSerializer serializer(stream);
+  serialize(value, serializer);
+}
+
+// constructor
+// type()
+// beginObject()
+// endObject()
+// beginArray()
+// endArray()
+// operator()()
+// binary()
+TEST(KVBinaryInputBufferSerializer, 1)
+{
+  Outer original = createOuter();
+  std::string buf = storeToBinaryKeyValue(original);
+
+  KVBinaryInputBufferSerializer serializer(buf.data(), buf.size());
+  ASSERT_EQ(ISerializer::INPUT, serializer.type());
+
+  Outer loaded;
+  serialize(loaded, serializer);
+  ASSERT_TRUE(original == loaded);
+
+  // same result as the stream serializer
+  Outer streamLoaded;
+  loadWithStream(streamLoaded, buf);
+  ASSERT_TRUE(streamLoaded == loaded);
+}
+
+// missing fields and empty arrays are left alone
+// integers are converted between types
+TEST(KVBinaryInputBufferSerializer, 2)
+{
+  Outer original = createOuter();
+  original.inners.clear();
+  original.strings.clear();
+  std::string buf = storeToBinaryKeyValue(original);
+
+  Outer loaded = createOuter();
+  loadWithBuffer(loaded, buf);
+  ASSERT_TRUE(loaded.inners.empty());
+  ASSERT_TRUE(loaded.strings.empty());
+
+  Extended extended;
+  extended.missing = 12345;
+  loadWithBuffer(extended, buf);
+  ASSERT_EQ(original.u64, extended.u64);
+  ASSERT_EQ(12345, extended.missing);
+
+  // an int16 field read into an int64
+  KVBinaryInputBufferSerializer serializer(buf.data(), buf.size());
+  int64_t value = 0;
+  ASSERT_TRUE(serializer(value, "i16"));
+  ASSERT_EQ(-300, value);
+
+  // a string is not a number
+  ASSERT_ANY_THROW(serializer(value, "str"));
+
+  // binary size mismatch
+  Crypto::PublicKey key;
+  ASSERT_ANY_THROW(serializer.binary(&key, sizeof(key) - 1, "hash"));
+
+  // doubles, an integer field read into a double
+  Real real;
+  real.d = 1.5;
+  real.i32 = 0;
+  std::string realBuf = storeToBinaryKeyValue(real);
+  Real loadedReal;
+  loadWithBuffer(loadedReal, realBuf);
+  ASSERT_EQ(1.5, loadedReal.d);
+  loadWithBuffer(loadedReal, buf);
+  ASSERT_EQ(-70000, loadedReal.i32);
+}
+
+// NOTIFY_RESPONSE_GET_OBJECTS request
+TEST(KVBinaryInputBufferSerializer, 3)
+{
+  NOTIFY_RESPONSE_GET_OBJECTS::request original;
+  original.current_blockchain_height = 1000;
+
+  for (uint32_t i = 0; i < loopCount; ++i)
+  {
+    block_complete_entry entry;
+    entry.block = std::string(200 + i, static_cast<char>(i));
+
+    for (uint32_t j = 0; j < i % 4; ++j)
+    {
+      entry.txs.push_back(std::string(500 + j, static_cast<char>(j)));
+    }
+
+    original.blocks.push_back(entry);
+
+    Crypto::Hash hash = boost::value_initialized<Crypto::Hash>();
+    hash.data[0] = static_cast<uint8_t>(i);
+    original.missed_ids.push_back(hash);
+  }
+
+  std::string buf = storeToBinaryKeyValue(original);
+
+  NOTIFY_RESPONSE_GET_OBJECTS::request loaded;
+  ASSERT_TRUE(loadFromBinaryKeyValue(loaded, buf));
+
+  ASSERT_EQ(original.current_blockchain_height, loaded.current_blockchain_height);
+  ASSERT_EQ(original.missed_ids, loaded.missed_ids);
+  ASSERT_EQ(original.blocks.size(), loaded.blocks.size());
+  ASSERT_TRUE(loaded.txs.empty());
+
+  for (size_t i = 0; i < original.blocks.size(); ++i)
+  {
+    ASSERT_EQ(original.blocks[i].block, loaded.blocks[i].block);
+    ASSERT_EQ(original.blocks[i].txs, loaded.blocks[i].txs);
+  }
+}
+
+// malformed input throws
+TEST(KVBinaryInputBufferSerializer, 4)
+{
+  std::string buf = storeToBinaryKeyValue(createOuter());
+
+  // truncated at every length
+  for (size_t size = 0; size < buf.size(); size += 7)
+  {
+    Outer loaded;
+    ASSERT_ANY_THROW(loadWithBuffer(loaded, buf.substr(0, size)));
+    ASSERT_FALSE(loadFromBinaryKeyValue(loaded, buf.substr(0, size)));
+  }
+
+  // bad signature
+  std::string badSignature = buf;
+  badSignature[0] ^= 1;
+  ASSERT_ANY_THROW(KVBinaryInputBufferSerializer(badSignature.data(), badSignature.size()));
+
+  // bad version
+  std::string badVersion = buf;
+  badVersion[sizeof(KVBinaryStorageBlockHeader) - 1] ^= 1;
+  ASSERT_ANY_THROW(KVBinaryInputBufferSerializer(badVersion.data(), badVersion.size()));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
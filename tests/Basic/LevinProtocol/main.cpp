@@ -25,6 +25,9 @@ public
   readCommand()
   sendMessage()
   sendReply()
+  makeMessageHeader()
+  makeReplyHeader()
+  writeBuffers()
   decode()
   encode()
 
@@ -162,6 +165,58 @@ TEST(LevinProtocol, 7)
   ASSERT_EQ(res1.peer_id, res2.peer_id);
 }
 
+// makeMessageHeader()
+// makeReplyHeader()
+// writeBuffers()
+TEST(LevinProtocol, 8)
+{
+  Dispatcher dispatcher;
+  Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+  uint16_t LISTEN_PORT = 6666;
+  TcpListener listener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT);
+  TcpConnection sender = TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT);
+  TcpConnection receiver = listener.accept();
+
+  // larger than the socket buffers so the write is split
+  BinaryArray notify(4 * 1024 * 1024, 7);
+  BinaryArray reply = {1, 2, 3, 4};
+
+  Context<> context1(dispatcher, [&] {
+    LevinProtocol levinProtocol(sender);
+    uint8_t headers[2 * LevinProtocol::HEADER_SIZE];
+    LevinProtocol::makeMessageHeader(10, notify.size(), false, headers);
+    LevinProtocol::makeReplyHeader(11, reply.size(), 1, headers + LevinProtocol::HEADER_SIZE);
+
+    TcpConnection::Buffer buffers[] = {
+      { headers, LevinProtocol::HEADER_SIZE },
+      { notify.data(), notify.size() },
+      { headers + LevinProtocol::HEADER_SIZE, LevinProtocol::HEADER_SIZE },
+      { reply.data(), reply.size() }
+    };
+
+    levinProtocol.writeBuffers(buffers, 4);
+  });
+
+  Context<> context2(dispatcher, [&] {
+    LevinProtocol levinProtocol(receiver);
+    LevinProtocol::Command command;
+
+    ASSERT_TRUE(levinProtocol.readCommand(command));
+    ASSERT_EQ(10, command.command);
+    ASSERT_TRUE(command.isNotify);
+    ASSERT_FALSE(command.isResponse);
+    ASSERT_EQ(notify, command.buf);
+
+    ASSERT_TRUE(levinProtocol.readCommand(command));
+    ASSERT_EQ(11, command.command);
+    ASSERT_TRUE(command.isResponse);
+    ASSERT_EQ(reply, command.buf);
+  });
+
+  context1.get();
+  context2.get();
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,468 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "helperFunctions.h"
+#include "CryptoNoteCore/MappedVector.h"
+#include "CryptoNoteCore/SwappedVector.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace CryptoNote;
+
+/*
+
+My Notes
+
+class MappedVector {
+
+public
+  MappedVector()
+  open()
+  close()
+  empty()
+  size()
+  begin()
+  end()
+  operator[]()
+  front()
+  back()
+  getRaw()
+  reclaim()
+  clear()
+  pop_back()
+  push_back()
+
+}
+
+class MappedVector::ReadGuard {
+
+public
+  ReadGuard()
+  ~ReadGuard()
+
+}
+
+*/
+
+// Helper functions
+
+const std::string itemsFileName = "mappedVectorItems.dat";
+const std::string indexesFileName = "mappedVectorIndexes.dat";
+
+void removeFiles()
+{
+  std::remove(itemsFileName.c_str());
+  std::remove(indexesFileName.c_str());
+}
+
+uint32_t loopCount = 20;
+
+// counts the items alive, so a test can see how many decoded items a mapped vector keeps
+struct CountedItem
+{
+  static int64_t liveCount;
+
+  uint64_t value;
+
+  CountedItem() : value(0) { ++liveCount; }
+  CountedItem(const CountedItem& other) : value(other.value) { ++liveCount; }
+  ~CountedItem() { --liveCount; }
+  CountedItem& operator=(const CountedItem& other) { value = other.value; return *this; }
+};
+
+int64_t CountedItem::liveCount = 0;
+
+void serialize(CountedItem& item, ISerializer& s)
+{
+  s(item.value, "value");
+}
+
+// MappedVector
+// open()
+// push_back()
+// operator[]()
+TEST(mappedVector, 1)
+{
+  removeFiles();
+
+  std::vector<Block> blocks;
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 4));
+    ASSERT_TRUE(mappedVector.empty());
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      mappedVector.push_back(blocks.back());
+    }
+
+    ASSERT_EQ(loopCount, mappedVector.size());
+
+    // reads past the cache pool size come from the mapping
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[i], mappedVector[i]));
+    }
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// open() on files written by SwappedVector
+TEST(mappedVector, 2)
+{
+  removeFiles();
+
+  std::vector<Block> blocks;
+
+  {
+    SwappedVector<Block> swappedVector;
+    ASSERT_TRUE(swappedVector.open(itemsFileName, indexesFileName, 4));
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      swappedVector.push_back(blocks.back());
+    }
+  }
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 4));
+    ASSERT_EQ(loopCount, mappedVector.size());
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[loopCount - 1 - i], mappedVector[loopCount - 1 - i]));
+    }
+
+    ASSERT_TRUE(blocksEqual(blocks.front(), mappedVector.front()));
+    ASSERT_TRUE(blocksEqual(blocks.back(), mappedVector.back()));
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// getRaw()
+TEST(mappedVector, 3)
+{
+  removeFiles();
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 1));
+
+    std::vector<BinaryArray> blobs;
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      Block block = getRandBlock();
+      blobs.push_back(toBinaryArray(block));
+      mappedVector.push_back(block);
+    }
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      Common::StringView raw = mappedVector.getRaw(i);
+      ASSERT_EQ(blobs[i].size(), raw.getSize());
+      ASSERT_EQ(0, memcmp(blobs[i].data(), raw.getData(), raw.getSize()));
+    }
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// pop_back()
+// push_back()
+// reopen
+TEST(mappedVector, 4)
+{
+  removeFiles();
+
+  std::vector<Block> blocks;
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 2));
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      mappedVector.push_back(blocks.back());
+      // make sure the tail is mapped before it is overwritten below
+      mappedVector.getRaw(i);
+    }
+
+    for (uint32_t i = 0; i < loopCount / 2; ++i)
+    {
+      mappedVector.pop_back();
+      blocks.pop_back();
+    }
+
+    ASSERT_EQ(blocks.size(), mappedVector.size());
+
+    for (uint32_t i = 0; i < loopCount / 4; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      mappedVector.push_back(blocks.back());
+    }
+
+    for (uint32_t i = 0; i < blocks.size(); ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[i], mappedVector[i]));
+    }
+  }
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 2));
+    ASSERT_EQ(blocks.size(), mappedVector.size());
+
+    for (uint32_t i = 0; i < blocks.size(); ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[i], mappedVector[i]));
+      ASSERT_TRUE(blocksEqual(blocks[i], *(mappedVector.begin() + i)));
+    }
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// clear()
+TEST(mappedVector, 5)
+{
+  removeFiles();
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 4));
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      mappedVector.push_back(getRandBlock());
+    }
+
+    mappedVector.clear();
+    ASSERT_TRUE(mappedVector.empty());
+    ASSERT_ANY_THROW(mappedVector[0]);
+
+    Block block = getRandBlock();
+    mappedVector.push_back(block);
+    ASSERT_EQ(1, mappedVector.size());
+    ASSERT_TRUE(blocksEqual(block, mappedVector[0]));
+  }
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 4));
+    ASSERT_EQ(1, mappedVector.size());
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// references stay valid while less than poolSize other items are accessed
+TEST(mappedVector, 6)
+{
+  removeFiles();
+
+  {
+    const size_t poolSize = 8;
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, poolSize));
+
+    std::vector<Block> blocks;
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      mappedVector.push_back(blocks.back());
+    }
+
+    std::vector<const Block*> pointers;
+    for (uint32_t i = 0; i < poolSize; ++i)
+    {
+      pointers.push_back(&mappedVector[(i * 7) % loopCount]);
+    }
+
+    for (uint32_t i = 0; i < poolSize; ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[(i * 7) % loopCount], *pointers[i]));
+    }
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// evicted items stay valid until reclaim()
+TEST(mappedVector, 7)
+{
+  removeFiles();
+
+  {
+    const size_t poolSize = 4;
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, poolSize));
+
+    std::vector<Block> blocks;
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      mappedVector.push_back(blocks.back());
+    }
+
+    // every item is evicted many times over while the first references are held
+    std::vector<const Block*> pointers;
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      pointers.push_back(&mappedVector[i]);
+    }
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[i], *pointers[i]));
+    }
+
+    mappedVector.reclaim();
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[i], mappedVector[i]));
+    }
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// push_back()
+// close()
+// the items file has spare space while it is open and none after close()
+TEST(mappedVector, 8)
+{
+  removeFiles();
+
+  std::vector<Block> blocks;
+  uint64_t itemsSize = 0;
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 4));
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      blocks.push_back(getRandBlock());
+      mappedVector.push_back(blocks.back());
+      itemsSize += mappedVector.getRaw(i).getSize();
+    }
+
+    std::ifstream itemsFile(itemsFileName, std::ios::binary | std::ios::ate);
+    ASSERT_LT(itemsSize, static_cast<uint64_t>(itemsFile.tellg()));
+
+    mappedVector.close();
+  }
+
+  {
+    std::ifstream itemsFile(itemsFileName, std::ios::binary | std::ios::ate);
+    ASSERT_EQ(itemsSize, static_cast<uint64_t>(itemsFile.tellg()));
+  }
+
+  {
+    MappedVector<Block> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, 4));
+    ASSERT_EQ(loopCount, mappedVector.size());
+
+    for (uint32_t i = 0; i < loopCount; ++i)
+    {
+      ASSERT_TRUE(blocksEqual(blocks[i], mappedVector[i]));
+    }
+  }
+
+  removeFiles();
+}
+
+// MappedVector
+// ReadGuard
+// reclaim()
+// walking more items than the pool holds keeps a bounded number of them decoded
+TEST(mappedVector, 9)
+{
+  removeFiles();
+
+  {
+    const size_t poolSize = 4;
+    const uint32_t itemCount = 1000;
+    MappedVector<CountedItem> mappedVector;
+    ASSERT_TRUE(mappedVector.open(itemsFileName, indexesFileName, poolSize));
+
+    for (uint32_t i = 0; i < itemCount; ++i)
+    {
+      CountedItem item;
+      item.value = i;
+      mappedVector.push_back(item);
+    }
+
+    mappedVector.reclaim();
+
+    // the slots, the free items and fewer retired items than slots
+    const int64_t maxLiveCount = 3 * poolSize;
+
+    // one guard per read, the last guard to leave frees the retired items
+    for (uint32_t i = 0; i < itemCount; ++i)
+    {
+      MappedVector<CountedItem>::ReadGuard guard(mappedVector);
+      ASSERT_EQ(i, mappedVector[i].value);
+    }
+
+    ASSERT_LE(CountedItem::liveCount, maxLiveCount);
+
+    // one guard for the whole walk, the owner reclaims between items it no longer uses
+    {
+      MappedVector<CountedItem>::ReadGuard guard(mappedVector);
+      for (uint32_t i = 0; i < itemCount; ++i)
+      {
+        if (i % poolSize == 0)
+        {
+          mappedVector.reclaim();
+        }
+
+        ASSERT_EQ(i, mappedVector[i].value);
+        ASSERT_LE(CountedItem::liveCount, maxLiveCount);
+      }
+    }
+
+    // a guard that is still held keeps the evicted items valid
+    {
+      MappedVector<CountedItem>::ReadGuard outerGuard(mappedVector);
+      const CountedItem& first = mappedVector[0];
+      for (uint32_t i = 1; i < itemCount; ++i)
+      {
+        MappedVector<CountedItem>::ReadGuard guard(mappedVector);
+        ASSERT_EQ(i, mappedVector[i].value);
+      }
+
+      ASSERT_EQ(0, first.value);
+    }
+
+    ASSERT_LE(CountedItem::liveCount, maxLiveCount);
+  }
+
+  ASSERT_EQ(0, CountedItem::liveCount);
+
+  removeFiles();
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,286 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+#include "Common/Metrics.h"
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Common;
+
+/*
+
+My Notes
+
+class MetricCounter
+public
+  MetricCounter()
+  add()
+  get()
+
+class MetricGauge
+public
+  MetricGauge()
+  add()
+  get()
+  set()
+
+class MetricHistogram
+public
+  MetricHistogram()
+  getCount()
+  getQuantile()
+  getSum()
+  record()
+  recordDuration()
+
+class MetricTimer
+public
+  MetricTimer()
+  ~MetricTimer()
+
+class MetricsRegistry
+public
+  instance()
+  label()
+  MetricsRegistry()
+  counter()
+  format()
+  gauge()
+  histogram()
+
+*/
+
+// MetricCounter
+// add()
+// get()
+TEST(Metrics, 1)
+{
+  MetricCounter counter;
+  ASSERT_EQ(0, counter.get());
+
+  counter.add();
+  counter.add(10);
+  ASSERT_EQ(11, counter.get());
+}
+
+// MetricCounter
+// add() from several threads
+TEST(Metrics, 2)
+{
+  MetricCounter counter;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < 100000; ++j)
+      {
+        counter.add();
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_EQ(400000, counter.get());
+}
+
+// MetricGauge
+// add()
+// get()
+// set()
+TEST(Metrics, 3)
+{
+  MetricGauge gauge;
+  ASSERT_EQ(0, gauge.get());
+
+  gauge.set(5);
+  ASSERT_EQ(5, gauge.get());
+
+  gauge.add(-7);
+  ASSERT_EQ(-2, gauge.get());
+}
+
+// MetricHistogram
+// getCount()
+// getQuantile()
+// getSum()
+// record()
+TEST(Metrics, 4)
+{
+  MetricHistogram histogram;
+  ASSERT_EQ(0, histogram.getCount());
+  ASSERT_EQ(0, histogram.getSum());
+  ASSERT_EQ(0, histogram.getQuantile(0.5));
+
+  // values below 8 are exact
+  for (uint64_t value = 1; value <= 7; ++value)
+  {
+    histogram.record(value);
+  }
+
+  ASSERT_EQ(7, histogram.getCount());
+  ASSERT_EQ(28, histogram.getSum());
+  ASSERT_EQ(4, histogram.getQuantile(0.5));
+  ASSERT_EQ(7, histogram.getQuantile(1));
+  ASSERT_EQ(1, histogram.getQuantile(0));
+}
+
+// MetricHistogram
+// getQuantile() is the highest value of a bucket at most 12.5% above the recorded value
+TEST(Metrics, 5)
+{
+  std::vector<uint64_t> values = { 8, 9, 15, 16, 17, 1000, 123456789, uint64_t(1) << 40, std::numeric_limits<uint64_t>::max() / 3 };
+  for (uint64_t value : values)
+  {
+    MetricHistogram histogram;
+    histogram.record(value);
+
+    uint64_t quantile = histogram.getQuantile(0.5);
+    ASSERT_LE(value, quantile);
+    ASSERT_LE(quantile - value, value / 8);
+  }
+
+  MetricHistogram histogram;
+  histogram.record(std::numeric_limits<uint64_t>::max());
+  ASSERT_EQ(std::numeric_limits<uint64_t>::max(), histogram.getQuantile(0.99));
+}
+
+// MetricHistogram
+// getQuantile() over many values
+TEST(Metrics, 6)
+{
+  MetricHistogram histogram;
+  for (uint64_t value = 1; value <= 1000; ++value)
+  {
+    histogram.record(value);
+  }
+
+  uint64_t median = histogram.getQuantile(0.5);
+  ASSERT_LE(500, median);
+  ASSERT_GE(500 + 500 / 8, median);
+
+  uint64_t p99 = histogram.getQuantile(0.99);
+  ASSERT_LE(990, p99);
+  ASSERT_GE(990 + 990 / 8, p99);
+}
+
+// MetricHistogram
+// recordDuration()
+TEST(Metrics, 7)
+{
+  MetricHistogram histogram;
+  histogram.recordDuration(std::chrono::milliseconds(3));
+  histogram.recordDuration(std::chrono::microseconds(-1));
+  ASSERT_EQ(2, histogram.getCount());
+  ASSERT_EQ(3000, histogram.getSum());
+}
+
+// MetricTimer
+// constructor
+// destructor
+TEST(Metrics, 8)
+{
+  MetricHistogram histogram;
+
+  {
+    MetricTimer timer(histogram);
+  }
+
+  ASSERT_EQ(1, histogram.getCount());
+}
+
+// MetricsRegistry
+// label()
+TEST(Metrics, 9)
+{
+  ASSERT_EQ("url=\"/get_height\"", MetricsRegistry::label("url", "/get_height"));
+  ASSERT_EQ("name=\"a\\\"b\\\\c\\n\"", MetricsRegistry::label("name", "a\"b\\c\n"));
+}
+
+// MetricsRegistry
+// counter()
+// gauge()
+// histogram()
+// the same name and labels give the same metric
+TEST(Metrics, 10)
+{
+  MetricsRegistry registry;
+
+  MetricCounter& counter = registry.counter("requests_total", "Requests");
+  ASSERT_EQ(&counter, &registry.counter("requests_total", "Requests"));
+  ASSERT_NE(&counter, &registry.counter("requests_total", "Requests", MetricsRegistry::label("url", "/a")));
+
+  MetricHistogram& histogram = registry.histogram("duration", "Duration", MetricsRegistry::label("url", "/a"));
+  ASSERT_EQ(&histogram, &registry.histogram("duration", "Duration", MetricsRegistry::label("url", "/a")));
+
+  ASSERT_THROW(registry.gauge("requests_total", "Requests"), std::invalid_argument);
+  ASSERT_THROW(registry.counter("duration", "Duration"), std::invalid_argument);
+}
+
+// MetricsRegistry
+// format()
+TEST(Metrics, 11)
+{
+  MetricsRegistry registry;
+  ASSERT_EQ("", registry.format());
+
+  registry.counter("requests_total", "Requests served", MetricsRegistry::label("url", "/a")).add(3);
+  registry.gauge("connections", "Open connections").set(-1);
+  MetricHistogram& histogram = registry.histogram("duration", "Time spent");
+  histogram.record(2);
+  histogram.record(4);
+
+  std::string expected =
+    "# HELP connections Open connections\n"
+    "# TYPE connections gauge\n"
+    "connections -1\n"
+    "# HELP duration Time spent\n"
+    "# TYPE duration summary\n"
+    "duration{quantile=\"0.5\"} 2\n"
+    "duration{quantile=\"0.9\"} 4\n"
+    "duration{quantile=\"0.99\"} 4\n"
+    "duration{quantile=\"0.999\"} 4\n"
+    "duration_sum 6\n"
+    "duration_count 2\n"
+    "# HELP requests_total Requests served\n"
+    "# TYPE requests_total counter\n"
+    "requests_total{url=\"/a\"} 3\n";
+
+  ASSERT_EQ(expected, registry.format());
+}
+
+// MetricsRegistry
+// format() joins the labels of a histogram with the quantile
+TEST(Metrics, 12)
+{
+  MetricsRegistry registry;
+  registry.histogram("duration", "Time spent", MetricsRegistry::label("url", "/a")).record(1);
+
+  std::string text = registry.format();
+  ASSERT_NE(std::string::npos, text.find("duration{url=\"/a\",quantile=\"0.5\"} 1\n"));
+  ASSERT_NE(std::string::npos, text.find("duration_sum{url=\"/a\"} 1\n"));
+  ASSERT_NE(std::string::npos, text.find("duration_count{url=\"/a\"} 1\n"));
+}
+
+// MetricsRegistry
+// instance()
+TEST(Metrics, 13)
+{
+  ASSERT_EQ(&MetricsRegistry::instance(), &MetricsRegistry::instance());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
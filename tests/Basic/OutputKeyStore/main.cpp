@@ -0,0 +1,263 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include "helperFunctions.h"
+#include "CryptoNoteCore/OutputKeyStore.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace CryptoNote;
+
+/*
+
+My Notes
+
+class OutputKeyStore {
+
+public
+  OutputKeyStore()
+  ~OutputKeyStore()
+  open()
+  close()
+  clear()
+  get()
+  getOutputCount()
+  pop()
+  push()
+  size()
+
+}
+
+*/
+
+// Helper functions
+
+const std::string outputKeysFileName = "outputKeys.dat";
+
+void removeFile()
+{
+  std::remove(outputKeysFileName.c_str());
+}
+
+uint32_t loopCount = 100;
+
+std::vector<OutputKeyEntry> fillStore(OutputKeyStore& store, uint32_t count)
+{
+  std::vector<OutputKeyEntry> entries;
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    OutputKeyEntry entry = { getRandUint8_t() % 4 + 1u, getRandPublicKey(), getRandUint32_t(), i };
+    entries.push_back(entry);
+    store.push(entry);
+  }
+
+  return entries;
+}
+
+bool equal(const OutputKeyEntry& a, const OutputKeyEntry& b)
+{
+  return a.amount == b.amount && a.key == b.key && a.unlockTime == b.unlockTime && a.blockIndex == b.blockIndex;
+}
+
+// checks that the outputs of each amount are the entries of the amount in push order
+void checkStore(const OutputKeyStore& store, const std::vector<OutputKeyEntry>& entries)
+{
+  ASSERT_EQ(entries.size(), store.size());
+
+  std::unordered_map<uint64_t, uint32_t> counts;
+  for (const OutputKeyEntry& entry : entries)
+  {
+    uint32_t index = counts[entry.amount]++;
+    ASSERT_TRUE(equal(entry, store.get(entry.amount, index)));
+  }
+
+  for (const auto& count : counts)
+  {
+    ASSERT_EQ(count.second, store.getOutputCount(count.first));
+  }
+}
+
+// OutputKeyStore
+// open()
+// push()
+// get()
+// getOutputCount()
+TEST(outputKeyStore, 1)
+{
+  removeFile();
+
+  OutputKeyStore store;
+  ASSERT_TRUE(store.open(outputKeysFileName));
+  ASSERT_EQ(0, store.size());
+  ASSERT_EQ(0, store.getOutputCount(1));
+  ASSERT_THROW(store.get(1, 0), std::out_of_range);
+
+  std::vector<OutputKeyEntry> entries = fillStore(store, loopCount);
+  checkStore(store, entries);
+
+  ASSERT_EQ(0, store.getOutputCount(5));
+  ASSERT_THROW(store.get(entries[0].amount, store.getOutputCount(entries[0].amount)), std::out_of_range);
+
+  store.close();
+  removeFile();
+}
+
+// OutputKeyStore
+// push() grows the file past the initial capacity
+TEST(outputKeyStore, 2)
+{
+  removeFile();
+
+  OutputKeyStore store;
+  ASSERT_TRUE(store.open(outputKeysFileName));
+
+  // the keys differ only in their first bytes, random keys are slow to generate
+  Crypto::PublicKey key = getRandPublicKey();
+  std::vector<OutputKeyEntry> entries;
+  for (uint32_t i = 0; i < 150000; ++i)
+  {
+    memcpy(&key, &i, sizeof(i));
+    OutputKeyEntry entry = { i % 3 + 1u, key, i, i };
+    entries.push_back(entry);
+    store.push(entry);
+  }
+
+  checkStore(store, entries);
+
+  store.close();
+  removeFile();
+}
+
+// OutputKeyStore
+// pop()
+TEST(outputKeyStore, 3)
+{
+  removeFile();
+
+  OutputKeyStore store;
+  ASSERT_TRUE(store.open(outputKeysFileName));
+  ASSERT_THROW(store.pop(), std::runtime_error);
+
+  std::vector<OutputKeyEntry> entries = fillStore(store, loopCount);
+
+  for (uint32_t i = 0; i < loopCount / 2; ++i)
+  {
+    store.pop();
+    entries.pop_back();
+    checkStore(store, entries);
+  }
+
+  // the popped entries are replaced by new ones
+  std::vector<OutputKeyEntry> newEntries = fillStore(store, loopCount / 2);
+  entries.insert(entries.end(), newEntries.begin(), newEntries.end());
+  checkStore(store, entries);
+
+  while (store.size() != 0)
+  {
+    store.pop();
+  }
+
+  for (uint64_t amount = 1; amount <= 4; ++amount)
+  {
+    ASSERT_EQ(0, store.getOutputCount(amount));
+  }
+
+  store.close();
+  removeFile();
+}
+
+// OutputKeyStore
+// clear()
+TEST(outputKeyStore, 4)
+{
+  removeFile();
+
+  OutputKeyStore store;
+  ASSERT_TRUE(store.open(outputKeysFileName));
+  fillStore(store, loopCount);
+
+  store.clear();
+  ASSERT_EQ(0, store.size());
+  ASSERT_EQ(0, store.getOutputCount(1));
+
+  std::vector<OutputKeyEntry> entries = fillStore(store, 10);
+  checkStore(store, entries);
+
+  store.close();
+  removeFile();
+}
+
+// OutputKeyStore
+// close()
+// open() reads the entries written before
+TEST(outputKeyStore, 5)
+{
+  removeFile();
+
+  std::vector<OutputKeyEntry> entries;
+
+  {
+    OutputKeyStore store;
+    ASSERT_TRUE(store.open(outputKeysFileName));
+    entries = fillStore(store, loopCount);
+    store.pop();
+    entries.pop_back();
+    store.close();
+  }
+
+  // the file is truncated to its entries
+  std::ifstream file(outputKeysFileName, std::ios::binary | std::ios::ate);
+  ASSERT_EQ(sizeof(uint64_t) + entries.size() * sizeof(OutputKeyEntry), static_cast<size_t>(file.tellg()));
+  file.close();
+
+  // destructor closes the store
+  {
+    OutputKeyStore store;
+    ASSERT_TRUE(store.open(outputKeysFileName));
+    checkStore(store, entries);
+
+    std::vector<OutputKeyEntry> newEntries = fillStore(store, 10);
+    entries.insert(entries.end(), newEntries.begin(), newEntries.end());
+  }
+
+  OutputKeyStore store;
+  ASSERT_TRUE(store.open(outputKeysFileName));
+  checkStore(store, entries);
+
+  store.close();
+  removeFile();
+}
+
+// OutputKeyStore
+// open() on a damaged file gives an empty store
+TEST(outputKeyStore, 6)
+{
+  removeFile();
+
+  {
+    std::ofstream file(outputKeysFileName, std::ios::binary);
+    uint64_t size = 1000;
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  }
+
+  OutputKeyStore store;
+  ASSERT_TRUE(store.open(outputKeysFileName));
+  ASSERT_EQ(0, store.size());
+
+  std::vector<OutputKeyEntry> entries = fillStore(store, 10);
+  checkStore(store, entries);
+
+  store.close();
+  removeFile();
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+#include "Common/RecursiveSharedMutex.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace Common;
+
+/*
+
+My Notes
+
+class RecursiveSharedMutex
+public
+  RecursiveSharedMutex()
+  lock()
+  unlock()
+  lock_shared()
+  unlock_shared()
+
+class SharedLockGuard
+public
+  SharedLockGuard()
+  ~SharedLockGuard()
+
+*/
+
+// lock()
+// unlock()
+// the owner can lock again and take shared ownership
+TEST(RecursiveSharedMutex, 1)
+{
+  RecursiveSharedMutex mutex;
+
+  std::lock_guard<RecursiveSharedMutex> lock1(mutex);
+  std::lock_guard<RecursiveSharedMutex> lock2(mutex);
+  SharedLockGuard<RecursiveSharedMutex> lock3(mutex);
+  SharedLockGuard<RecursiveSharedMutex> lock4(mutex);
+}
+
+// lock_shared()
+// unlock_shared()
+// readers do not block each other
+TEST(RecursiveSharedMutex, 2)
+{
+  RecursiveSharedMutex mutex;
+  std::atomic<uint32_t> readersInside(0);
+  std::atomic<uint32_t> maxReadersInside(0);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.emplace_back([&]() {
+      SharedLockGuard<RecursiveSharedMutex> lock(mutex);
+      SharedLockGuard<RecursiveSharedMutex> nestedLock(mutex);
+      uint32_t inside = ++readersInside;
+      while (readersInside < 4 && inside < 4)
+      {
+        std::this_thread::yield();
+      }
+
+      uint32_t max = maxReadersInside;
+      while (inside > max && !maxReadersInside.compare_exchange_weak(max, inside))
+      {
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_EQ(4, maxReadersInside);
+}
+
+// lock()
+// lock_shared()
+// a writer excludes readers and readers exclude a writer
+TEST(RecursiveSharedMutex, 3)
+{
+  RecursiveSharedMutex mutex;
+  uint64_t value = 0;
+  std::atomic<bool> failed(false);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 1000; ++j)
+      {
+        std::lock_guard<RecursiveSharedMutex> lock(mutex);
+        uint64_t before = value;
+        value = before + 1;
+        std::this_thread::yield();
+        if (value != before + 1)
+        {
+          failed = true;
+        }
+
+        value = before + 2;
+      }
+    });
+
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 1000; ++j)
+      {
+        SharedLockGuard<RecursiveSharedMutex> lock(mutex);
+        // writers only leave even values behind
+        if (value % 2 != 0)
+        {
+          failed = true;
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  ASSERT_FALSE(failed);
+  ASSERT_EQ(8000, value);
+}
+
+// lock()
+// lock_shared()
+// a new reader waits for a waiting writer
+TEST(RecursiveSharedMutex, 4)
+{
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> writerInside(false);
+  std::atomic<bool> writerWasInside(false);
+  std::atomic<bool> readerInside(false);
+
+  mutex.lock_shared();
+
+  std::thread writer([&]() {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    writerInside = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    writerInside = false;
+    writerWasInside = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  std::thread reader([&]() {
+    SharedLockGuard<RecursiveSharedMutex> lock(mutex);
+    readerInside = true;
+    if (!writerWasInside || writerInside)
+    {
+      readerInside = false;
+    }
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(readerInside);
+
+  mutex.unlock_shared();
+  writer.join();
+  reader.join();
+
+  ASSERT_TRUE(writerWasInside);
+  ASSERT_TRUE(readerInside);
+}
+
+// lock_shared()
+// a reader that already holds the mutex is not blocked by a waiting writer
+TEST(RecursiveSharedMutex, 5)
+{
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> writerInside(false);
+
+  mutex.lock_shared();
+
+  std::thread writer([&]() {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    writerInside = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  {
+    SharedLockGuard<RecursiveSharedMutex> nestedLock(mutex);
+    ASSERT_FALSE(writerInside);
+  }
+
+  mutex.unlock_shared();
+  writer.join();
+
+  ASSERT_TRUE(writerInside);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
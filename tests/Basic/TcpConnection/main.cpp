@@ -62,6 +62,27 @@ TEST(TcpConnection, 5)
   ASSERT_EQ(6666, addressAndPort.second);
 }
 
+// writeBuffers()
+TEST(TcpConnection, 6)
+{
+  Dispatcher dispatcher;
+  Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+  uint16_t LISTEN_PORT = 6666;
+  TcpListener listener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT);
+  TcpConnection sender = TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT);
+  TcpConnection receiver = listener.accept();
+  uint8_t hello[] = "Hello";
+  uint8_t space[] = " ";
+  uint8_t world[] = "World";
+  TcpConnection::Buffer buffers[] = { { hello, 5 }, { space, 1 }, { world, 5 } };
+  size_t written = sender.writeBuffers(buffers, 3);
+  ASSERT_EQ(11, written);
+  uint8_t dataReceived[1024];
+  size_t size = receiver.read(dataReceived, 1024);
+  ASSERT_EQ(11, size);
+  ASSERT_EQ(0, memcmp(dataReceived, "Hello World", 11));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
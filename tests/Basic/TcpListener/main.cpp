@@ -55,6 +55,18 @@ TEST(TcpListener, 5)
   size_t size = receiver.read(dataReceived, 1024);
 }
 
+// constructor
+TEST(TcpListener, 6)
+{
+  // listeners sharing a port
+  Dispatcher dispatcher;
+  Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+  uint16_t LISTEN_PORT = 6666;
+  TcpListener tcpListener1(dispatcher, LISTEN_ADDRESS, LISTEN_PORT, true);
+  TcpListener tcpListener2(dispatcher, LISTEN_ADDRESS, LISTEN_PORT, true);
+  ASSERT_ANY_THROW(TcpListener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
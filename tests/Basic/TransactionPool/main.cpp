@@ -320,7 +320,7 @@ TEST(TransactionPool, 10)
   uint64_t new_block_height = 10;
   Crypto::Hash top_block_id = getRandHash();
 
-  ASSERT_TRUE(tx_memory_pool.on_blockchain_inc(new_block_height, top_block_id));
+  ASSERT_TRUE(tx_memory_pool.on_blockchain_inc(new_block_height, top_block_id, getRandHash(), std::vector<Transaction>()));
 }
 
 // on_blockchain_dec()
@@ -64,6 +64,7 @@ public:
   virtual uint32_t getLocalBlockCount() const override { return 0; };
   virtual uint32_t getKnownBlockCount() const override { return 0; };
   virtual uint64_t getLastLocalBlockTimestamp() const override { return 0; }
+  virtual uint64_t getMinimalFee() const override { return 0; };
 
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<CryptoNote::block_complete_entry>& newBlocks, uint32_t& height, const Callback& callback) override { callback(std::error_code()); };
 
@@ -91,6 +92,21 @@ public:
   Tools::ObserverManager<CryptoNote::INodeObserver> observerManager;
 };
 
+// counts the requests for global output indexes
+class IndexesNode : public Node
+{
+public:
+  IndexesNode() : requests(0) {}
+
+  virtual void getTransactionOutsGlobalIndexes(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndexes, const Callback& callback) override {
+    ++requests;
+    outsGlobalIndexes.assign(1, 9);
+    callback(std::error_code());
+  };
+
+  size_t requests;
+};
+
 // constructor()
 TEST(TransfersConsumer, 1)
 {
@@ -392,6 +408,165 @@ TEST(TransfersConsumer, 13)
   ASSERT_NO_THROW(transfersConsumer.removeUnconfirmedTransaction(transactionHash));
 }
 
+// onNewBlocks()
+// global output indexes sent along with the block are used without asking the node
+TEST(TransfersConsumer, 14)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  IndexesNode node;
+  KeyPair viewKeyPair = generateKeyPair();
+  Crypto::SecretKey& viewSecretKey = viewKeyPair.secretKey;
+  TransfersConsumer transfersConsumer(currency, node, viewSecretKey);
+
+  AccountSubscription subscription;
+
+  AccountKeys accountKeys;
+  KeyPair spendKeyPair = generateKeyPair();
+  accountKeys.address.viewPublicKey = viewKeyPair.publicKey;
+  accountKeys.address.spendPublicKey = spendKeyPair.publicKey;
+  accountKeys.viewSecretKey = viewKeyPair.secretKey;
+  accountKeys.spendSecretKey = spendKeyPair.secretKey;
+
+  subscription.keys = accountKeys;
+  subscription.syncStart.timestamp = 0;
+  subscription.syncStart.height = 0;
+  subscription.transactionSpendableAge = 0;
+
+  ITransfersSubscription& transfersSubscription = transfersConsumer.addSubscription(subscription);
+
+  CompleteBlock completeBlocks[2];
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    std::unique_ptr<ITransaction> transaction = createTransaction();
+    transaction->addOutput(100 + i, accountKeys.address);
+
+    Block block;
+    block.timestamp = 1;
+
+    completeBlocks[i].blockHash = getRandHash();
+    completeBlocks[i].block = block;
+    Transaction tx;
+    ASSERT_TRUE(fromBinaryArray(tx, transaction->getTransactionData()));
+    completeBlocks[i].transactions.push_back(createTransactionPrefix(tx));
+  }
+
+  // the first block has the indexes, the node is asked for the second one
+  completeBlocks[0].globalIndexes.push_back({7});
+
+  ASSERT_TRUE(transfersConsumer.onNewBlocks(completeBlocks, 1, 2));
+  ASSERT_EQ(1, node.requests);
+
+  std::vector<TransactionOutputInformation> transfers;
+  transfersSubscription.getContainer().getOutputs(transfers, ITransfersContainer::IncludeAll);
+  ASSERT_EQ(2, transfers.size());
+
+  for (const TransactionOutputInformation& transfer : transfers)
+  {
+    ASSERT_EQ(transfer.amount == 100 ? 7 : 9, transfer.globalOutputIndex);
+  }
+}
+
+// onNewBlocks()
+// the transactions are scanned in batches, outputs of every batch are found for the right subscription
+TEST(TransfersConsumer, 15)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  IndexesNode node;
+  KeyPair viewKeyPair = generateKeyPair();
+  TransfersConsumer transfersConsumer(currency, node, viewKeyPair.secretKey);
+
+  // two subscriptions sharing the view key and an address with another view key
+  AccountKeys accountKeys[3];
+  ITransfersSubscription* transfersSubscriptions[2];
+
+  for (size_t i = 0; i < 3; ++i)
+  {
+    KeyPair spendKeyPair = generateKeyPair();
+    accountKeys[i].address.viewPublicKey = i < 2 ? viewKeyPair.publicKey : generateKeyPair().publicKey;
+    accountKeys[i].address.spendPublicKey = spendKeyPair.publicKey;
+    accountKeys[i].viewSecretKey = viewKeyPair.secretKey;
+    accountKeys[i].spendSecretKey = spendKeyPair.secretKey;
+
+    if (i < 2)
+    {
+      AccountSubscription subscription;
+      subscription.keys = accountKeys[i];
+      subscription.syncStart.timestamp = 0;
+      subscription.syncStart.height = 0;
+      subscription.transactionSpendableAge = 0;
+      transfersSubscriptions[i] = &transfersConsumer.addSubscription(subscription);
+    }
+  }
+
+  const size_t blockCount = 100;
+  const size_t transactionsPerBlock = 3;
+  std::vector<CompleteBlock> completeBlocks(blockCount);
+  uint64_t expectedAmounts[2] = { 0, 0 };
+  size_t expectedCounts[2] = { 0, 0 };
+  uint32_t globalIndex = 0;
+
+  for (size_t i = 0; i < blockCount; ++i)
+  {
+    Block block;
+    block.timestamp = 1;
+    completeBlocks[i].blockHash = getRandHash();
+    completeBlocks[i].block = block;
+
+    for (size_t j = 0; j < transactionsPerBlock; ++j)
+    {
+      std::unique_ptr<ITransaction> transaction = createTransaction();
+      std::vector<uint32_t> globalIndexes;
+
+      // some transactions pay nobody of the consumer
+      size_t outputCount = (i + j) % 4;
+      for (size_t k = 0; k < outputCount; ++k)
+      {
+        size_t account = (i + j + k) % 3;
+        uint64_t amount = 1 + i * 1000 + j * 10 + k;
+        transaction->addOutput(amount, accountKeys[account].address);
+        globalIndexes.push_back(globalIndex++);
+
+        if (account < 2)
+        {
+          expectedAmounts[account] += amount;
+          ++expectedCounts[account];
+        }
+      }
+
+      Transaction tx;
+      ASSERT_TRUE(fromBinaryArray(tx, transaction->getTransactionData()));
+      completeBlocks[i].transactions.push_back(createTransactionPrefix(tx));
+      completeBlocks[i].globalIndexes.push_back(globalIndexes);
+    }
+  }
+
+  ASSERT_TRUE(transfersConsumer.onNewBlocks(completeBlocks.data(), 1, blockCount));
+  ASSERT_EQ(0, node.requests);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    std::vector<TransactionOutputInformation> transfers;
+    transfersSubscriptions[i]->getContainer().getOutputs(transfers, ITransfersContainer::IncludeAll);
+    ASSERT_EQ(expectedCounts[i], transfers.size());
+
+    uint64_t amount = 0;
+    for (const TransactionOutputInformation& transfer : transfers)
+    {
+      amount += transfer.amount;
+
+      // the amount tells the block, transaction and output of the transfer
+      uint64_t block = (transfer.amount - 1) / 1000;
+      uint64_t output = (transfer.amount - 1) % 10;
+      ASSERT_EQ(i, (block + (transfer.amount - 1) / 10 % 100 + output) % 3);
+    }
+
+    ASSERT_EQ(expectedAmounts[i], amount);
+  }
+}
+
 
 
 
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "gtest/gtest.h"
+#include "Common/StringTools.h"
 #include "helperFunctions.h"
 #include "IWallet.h"
 #include "Transfers/TransfersContainer.h"
@@ -13,6 +14,9 @@
 #include "CryptoNoteCore/Transaction.cpp"
 #include <random>
 #include <iostream>
+#include <map>
+#include <set>
+#include <tuple>
 
 using namespace CryptoNote;
 
@@ -51,12 +55,132 @@ public
   getTransactionInputs()
   getUnconfirmedTransactions()
   getSpentOutputs()
+  getSpendableAmounts()
+  getSpendableOutput()
+  getSpendableOutputs()
+  spendableOutputsCount()
   save()
   load()
 }
 
 */
 
+// Helper functions
+
+uint64_t getOutputsAmount(const TransfersContainer& container, uint32_t flags)
+{
+  std::vector<TransactionOutputInformation> transfers;
+  container.getOutputs(transfers, flags);
+
+  uint64_t amount = 0;
+  for (const TransactionOutputInformation& transfer : transfers)
+  {
+    amount += transfer.amount;
+  }
+
+  return amount;
+}
+
+// balance() must give the same amounts as adding up getOutputs()
+void checkBalance(const TransfersContainer& container)
+{
+  const uint32_t flags[] = {
+    ITransfersContainer::IncludeAll,
+    ITransfersContainer::IncludeKeyUnlocked,
+    ITransfersContainer::IncludeKeyNotUnlocked,
+    ITransfersContainer::IncludeAllLocked,
+    ITransfersContainer::IncludeAllUnlocked,
+    ITransfersContainer::IncludeTypeKey | ITransfersContainer::IncludeStateLocked,
+    ITransfersContainer::IncludeTypeKey | ITransfersContainer::IncludeStateSoftLocked,
+    ITransfersContainer::IncludeTypeMultisignature | ITransfersContainer::IncludeStateAll,
+    ITransfersContainer::IncludeTypeMultisignature | ITransfersContainer::IncludeStateUnlocked
+  };
+
+  for (uint32_t flag : flags)
+  {
+    EXPECT_EQ(getOutputsAmount(container, flag), container.balance(flag)) << "flags " << flag;
+  }
+
+  // the spendable outputs are the unlocked key outputs ordered by amount
+  std::vector<TransactionOutputInformation> unlockedOutputs;
+  container.getOutputs(unlockedOutputs, ITransfersContainer::IncludeKeyUnlocked);
+  ASSERT_EQ(unlockedOutputs.size(), container.spendableOutputsCount());
+
+  std::map<uint64_t, size_t> outputsCounts;
+  for (const TransactionOutputInformation& output : unlockedOutputs)
+  {
+    outputsCounts[output.amount]++;
+  }
+
+  std::map<uint64_t, size_t> spendableAmounts;
+  container.getSpendableAmounts(spendableAmounts);
+  EXPECT_EQ(outputsCounts, spendableAmounts);
+
+  std::multiset<std::tuple<uint64_t, std::string, uint32_t>> unlockedSet;
+  for (const TransactionOutputInformation& output : unlockedOutputs)
+  {
+    unlockedSet.emplace(output.amount, Common::podToHex(output.transactionHash), output.outputInTransaction);
+  }
+
+  std::multiset<std::tuple<uint64_t, std::string, uint32_t>> spendableSet;
+  uint64_t previousAmount = 0;
+  for (size_t i = 0; i < unlockedOutputs.size(); ++i)
+  {
+    TransactionOutputInformation output;
+    ASSERT_TRUE(container.getSpendableOutput(i, output));
+    EXPECT_LE(previousAmount, output.amount);
+    previousAmount = output.amount;
+    spendableSet.emplace(output.amount, Common::podToHex(output.transactionHash), output.outputInTransaction);
+  }
+
+  TransactionOutputInformation output;
+  EXPECT_FALSE(container.getSpendableOutput(unlockedOutputs.size(), output));
+  EXPECT_EQ(unlockedSet, spendableSet);
+
+  for (const auto& outputsCount : outputsCounts)
+  {
+    std::vector<TransactionOutputInformation> outputs;
+    container.getSpendableOutputs(outputsCount.first, outputs);
+    EXPECT_EQ(outputsCount.second, outputs.size());
+  }
+}
+
+// a transaction with one key output and a random public key so that its hash is unique
+Transaction createTransaction(uint64_t unlockTime)
+{
+  Transaction transaction;
+  transaction.version = CURRENT_TRANSACTION_VERSION;
+  transaction.unlockTime = unlockTime;
+
+  TransactionOutput transactionOutput;
+  transactionOutput.amount = 10;
+
+  KeyOutput keyOutput;
+  keyOutput.key = getRandPublicKey();
+  transactionOutput.target = keyOutput;
+
+  transaction.outputs.push_back(transactionOutput);
+
+  addTransactionPublicKeyToExtra(transaction.extra, getRandPublicKey());
+
+  return transaction;
+}
+
+TransactionOutputInformationIn createTransfer(TransactionTypes::OutputType type, uint64_t amount, uint32_t globalOutputIndex)
+{
+  TransactionOutputInformationIn transfer;
+  transfer.type = type;
+  transfer.amount = amount;
+  transfer.globalOutputIndex = globalOutputIndex;
+  transfer.outputInTransaction = 0;
+  transfer.transactionHash = getRandHash();
+  transfer.transactionPublicKey = getRandPublicKey();
+  transfer.outputKey = getRandPublicKey();
+  transfer.keyImage = getRandKeyImage();
+  transfer.requiredSignatures = 1;
+  return transfer;
+}
+
 // SpentOutputDescriptor()
 TEST(SpentOutputDescriptor, 1)
 {
@@ -740,6 +864,149 @@ TEST(TransfersContainer, 17)
   container.load(ss);
 }
 
+// balance() while transfers are added, spent, confirmed, detached and unlocked
+TEST(TransfersContainer, 18)
+{
+  Logging::ConsoleLogger logger;
+  Currency currency = CurrencyBuilder(logger).currency();
+  size_t transactionSpendableAge = 10;
+  TransfersContainer container(currency, transactionSpendableAge);
+
+  checkBalance(container);
+
+  uint32_t height = 0;
+  std::vector<TransactionOutputInformationIn> keyTransfers;
+
+  for (uint32_t i = 0; i < 30; ++i)
+  {
+    height += 2;
+
+    TransactionBlockInfo block;
+    block.height = height;
+    block.transactionIndex = 0;
+
+    uint64_t unlockTime = 0;
+    if (i % 4 == 1)
+    {
+      // unlocked by height
+      unlockTime = height + i;
+    }
+    else if (i % 4 == 2)
+    {
+      // unlock time in the past
+      unlockTime = time(nullptr) - 1000;
+    }
+    else if (i % 4 == 3)
+    {
+      // unlock time in the future
+      unlockTime = time(nullptr) + 100000;
+    }
+
+    Transaction transaction = createTransaction(unlockTime);
+
+    TransactionOutputInformationIn transfer;
+    if (i % 5 == 4)
+    {
+      transfer = createTransfer(TransactionTypes::OutputType::Multisignature, i + 1, i);
+
+      MultisignatureOutput multisignatureOutput;
+      multisignatureOutput.keys.push_back(getRandPublicKey());
+      multisignatureOutput.requiredSignatureCount = 1;
+      transaction.outputs[0].target = multisignatureOutput;
+    }
+    else
+    {
+      transfer = createTransfer(TransactionTypes::OutputType::Key, i + 1, i);
+
+      // same key image as an earlier output, only the earliest one is visible
+      if (i % 7 == 6)
+      {
+        transfer.keyImage = keyTransfers.front().keyImage;
+      }
+
+      keyTransfers.push_back(transfer);
+    }
+
+    TransactionImpl transactionImpl(transaction);
+
+    ASSERT_TRUE(container.addTransaction(block, transactionImpl, {transfer}));
+    checkBalance(container);
+
+    ASSERT_TRUE(container.advanceHeight(height + 1));
+    checkBalance(container);
+  }
+
+  // spend a key output
+  {
+    height += 2;
+
+    TransactionBlockInfo block;
+    block.height = height;
+    block.transactionIndex = 0;
+
+    Transaction transaction = createTransaction(0);
+
+    KeyInput input;
+    input.amount = keyTransfers[1].amount;
+    input.keyImage = keyTransfers[1].keyImage;
+    input.outputIndexes = {keyTransfers[1].globalOutputIndex};
+    transaction.inputs.push_back(input);
+
+    TransactionImpl transactionImpl(transaction);
+
+    ASSERT_TRUE(container.addTransaction(block, transactionImpl, {}));
+    checkBalance(container);
+  }
+
+  // an unconfirmed transaction that is confirmed later
+  {
+    TransactionBlockInfo block;
+    block.height = WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT;
+    block.transactionIndex = 0;
+
+    Transaction transaction = createTransaction(0);
+
+    TransactionImpl transactionImpl(transaction);
+
+    TransactionOutputInformationIn transfer = createTransfer(TransactionTypes::OutputType::Key, 1000, UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX);
+
+    ASSERT_TRUE(container.addTransaction(block, transactionImpl, {transfer}));
+    checkBalance(container);
+
+    block.height = height + 1;
+    ASSERT_TRUE(container.markTransactionConfirmed(block, transactionImpl.getTransactionHash(), {1000}));
+    checkBalance(container);
+  }
+
+  for (uint32_t i = 0; i < 30; ++i)
+  {
+    ASSERT_TRUE(container.advanceHeight(height + i));
+    checkBalance(container);
+  }
+
+  container.detach(30);
+  checkBalance(container);
+
+  ASSERT_TRUE(container.advanceHeight(35));
+  checkBalance(container);
+
+  container.detach(10);
+  checkBalance(container);
+
+  // the balance is rebuilt on load
+  std::stringstream ss;
+  container.save(ss);
+
+  TransfersContainer loaded(currency, transactionSpendableAge);
+  loaded.load(ss);
+  checkBalance(loaded);
+
+  for (size_t flags : {ITransfersContainer::IncludeAll, ITransfersContainer::IncludeKeyUnlocked})
+  {
+    ASSERT_EQ(container.balance(flags), loaded.balance(flags));
+  }
+}
+
 
 
 
@@ -0,0 +1,126 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+#include "Common/WorkerPool.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Common;
+
+/*
+
+My Notes
+
+class WorkerPool
+public
+  WorkerPool()
+  getThreadCount()
+  parallelFor()
+
+*/
+
+// constructor
+// getThreadCount()
+TEST(WorkerPool, 1)
+{
+  WorkerPool workerPool1(1);
+  ASSERT_EQ(1, workerPool1.getThreadCount());
+
+  WorkerPool workerPool4(4);
+  ASSERT_EQ(4, workerPool4.getThreadCount());
+}
+
+// parallelFor()
+// every index is visited exactly once
+TEST(WorkerPool, 2)
+{
+  WorkerPool workerPool(4);
+
+  for (size_t count : {0, 1, 2, 3, 100, 10000})
+  {
+    std::vector<std::atomic<uint32_t>> visits(count);
+    for (std::atomic<uint32_t>& visit : visits)
+    {
+      visit = 0;
+    }
+
+    workerPool.parallelFor(count, [&visits](size_t i) { ++visits[i]; });
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      ASSERT_EQ(1, visits[i]);
+    }
+  }
+}
+
+// parallelFor()
+// a pool of one thread runs everything on the caller
+TEST(WorkerPool, 3)
+{
+  WorkerPool workerPool(1);
+  std::thread::id caller = std::this_thread::get_id();
+  bool onCaller = true;
+
+  workerPool.parallelFor(100, [&](size_t) {
+    if (std::this_thread::get_id() != caller)
+    {
+      onCaller = false;
+    }
+  });
+
+  ASSERT_TRUE(onCaller);
+}
+
+// parallelFor()
+// jobs run on several threads
+TEST(WorkerPool, 4)
+{
+  WorkerPool workerPool(4);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::atomic<uint32_t> started(0);
+
+  workerPool.parallelFor(4, [&](size_t) {
+    ++started;
+    // keep every job busy until all jobs have started
+    while (started < 4)
+    {
+      std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  });
+
+  ASSERT_EQ(4, threads.size());
+}
+
+// parallelFor()
+// exceptions are passed to the caller and the pool can be used again
+TEST(WorkerPool, 5)
+{
+  WorkerPool workerPool(4);
+
+  ASSERT_THROW(workerPool.parallelFor(100, [](size_t i) {
+    if (i == 50)
+    {
+      throw std::runtime_error("job failed");
+    }
+  }), std::runtime_error);
+
+  std::atomic<uint32_t> calls(0);
+  workerPool.parallelFor(100, [&calls](size_t) { ++calls; });
+  ASSERT_EQ(100, calls);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
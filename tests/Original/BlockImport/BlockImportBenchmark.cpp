@@ -0,0 +1,148 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Block import benchmark.
+// Replays a range of blocks from an existing data directory into a fresh blockchain once for every
+// number of validation threads given and prints the time spent on the range.
+// The blocks before the range are imported as a checkpoint zone, so only the range is fully validated.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/StringTools.h"
+#include "CryptoNoteCore/Checkpoints.h"
+#include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/CoreConfig.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/IBlock.h"
+#include "CryptoNoteCore/MinerConfig.h"
+#include "Logging/ConsoleLogger.h"
+
+using namespace std;
+
+namespace {
+
+const size_t BLOCKS_PER_CHAIN = 100;
+
+bool importBlocks(CryptoNote::Core& source, CryptoNote::Core& target, uint32_t startHeight, uint32_t endHeight, size_t& transactionCount) {
+  for (uint32_t height = startHeight; height < endHeight; ) {
+    uint32_t chainEnd = min(endHeight, height + static_cast<uint32_t>(BLOCKS_PER_CHAIN));
+    vector<unique_ptr<CryptoNote::IBlock>> blocks;
+    vector<const CryptoNote::IBlock*> chain;
+    for (; height < chainEnd; ++height) {
+      blocks.push_back(source.getBlock(source.getBlockIdByHeight(height)));
+      if (!blocks.back()) {
+        cerr << "Can't read block " << height << endl;
+        return false;
+      }
+
+      transactionCount += blocks.back()->getTransactionCount();
+      chain.push_back(blocks.back().get());
+    }
+
+    if (target.addChain(chain) != chain.size()) {
+      cerr << "Failed to import blocks before height " << height << endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool runImport(const CryptoNote::Currency& currency, CryptoNote::Core& source, uint32_t firstHeight, uint32_t endHeight, size_t threadCount, Logging::ILogger& logger) {
+  boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  boost::filesystem::create_directories(folder);
+
+  bool success;
+  {
+    CryptoNote::Core target(currency, nullptr, logger);
+    if (firstHeight > 1) {
+      CryptoNote::Checkpoints checkpoints(logger);
+      checkpoints.add_checkpoint(firstHeight - 1, Common::podToHex(source.getBlockIdByHeight(firstHeight - 1)));
+      target.set_checkpoints(std::move(checkpoints));
+    }
+
+    CryptoNote::CoreConfig coreConfig;
+    coreConfig.configFolder = folder.string();
+    coreConfig.validationThreads = threadCount;
+    CryptoNote::MinerConfig minerConfig;
+    if (!target.init(coreConfig, minerConfig, false)) {
+      cerr << "Failed to initialize the target blockchain in " << folder.string() << endl;
+      boost::filesystem::remove_all(folder);
+      return false;
+    }
+
+    size_t transactionCount = 0;
+    success = importBlocks(source, target, 1, firstHeight, transactionCount);
+
+    transactionCount = 0;
+    auto start = chrono::steady_clock::now();
+    success = success && importBlocks(source, target, firstHeight, endHeight, transactionCount);
+    auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+    if (success) {
+      cout << "validation threads: " << threadCount << ", blocks: " << endHeight - firstHeight << ", transactions: " << transactionCount <<
+        ", time: " << duration << " ms, " << (endHeight - firstHeight) * 1000.0 / max<int64_t>(duration, 1) << " blocks/s" << endl;
+    }
+
+    target.deinit();
+  }
+
+  boost::filesystem::remove_all(folder);
+  return success;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    cerr << "Usage: " << argv[0] << " <data directory> <first height> <last height> [validation threads ...]" << endl;
+    return 1;
+  }
+
+  string dataDirectory = argv[1];
+  uint32_t firstHeight = max<uint32_t>(stoul(argv[2]), 1);
+  uint32_t lastHeight = stoul(argv[3]);
+
+  vector<size_t> threadCounts;
+  for (int i = 4; i < argc; ++i) {
+    threadCounts.push_back(stoul(argv[i]));
+  }
+
+  if (threadCounts.empty()) {
+    threadCounts = { 1, 0 };
+  }
+
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  CryptoNote::Currency currency = CryptoNote::CurrencyBuilder(logger).currency();
+
+  CryptoNote::Core source(currency, nullptr, logger);
+  CryptoNote::CoreConfig sourceConfig;
+  sourceConfig.configFolder = dataDirectory;
+  CryptoNote::MinerConfig minerConfig;
+  if (!source.init(sourceConfig, minerConfig, true)) {
+    cerr << "Failed to load the blockchain from " << dataDirectory << endl;
+    return 1;
+  }
+
+  uint32_t endHeight = min(lastHeight + 1, source.get_current_blockchain_height());
+  bool success = firstHeight < endHeight;
+  if (!success) {
+    cerr << "The blockchain in " << dataDirectory << " has no blocks in the range" << endl;
+  }
+
+  for (size_t i = 0; success && i < threadCounts.size(); ++i) {
+    success = runImport(currency, source, firstHeight, endHeight, threadCounts[i], logger);
+  }
+
+  source.deinit();
+  return success ? 0 : 1;
+}
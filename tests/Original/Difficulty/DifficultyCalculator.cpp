@@ -0,0 +1,178 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Differential test for CryptoNote::DifficultyCalculator.
+// Replays the chain in data.txt block by block, with rollbacks and replacement blocks,
+// and checks that the incremental difficulty always equals Currency::nextDifficulty2.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "CryptoNoteCore/BlockSummaryIndex.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/DifficultyCalculator.h"
+#include "CryptoNoteCore/Difficulty.h"
+#include "Logging/ConsoleLogger.h"
+
+using namespace std;
+
+namespace {
+
+// same window as Blockchain::getDifficultyForNextBlock
+uint64_t referenceDifficulty(const CryptoNote::Currency& currency, const CryptoNote::BlockSummaryIndex& index) {
+  uint32_t height = index.size();
+  uint32_t offset = height - min(height, static_cast<uint32_t>(currency.difficultyBlocksCount()));
+  if (offset == 0) {
+    ++offset;
+  }
+
+  offset = min(offset, height);
+
+  vector<uint64_t> timestamps;
+  vector<uint64_t> cumulativeDifficulties;
+  index.getTimestamps(offset, height, timestamps);
+  index.getCumulativeDifficulties(offset, height, cumulativeDifficulties);
+  return currency.nextDifficulty2(timestamps, cumulativeDifficulties);
+}
+
+bool check(const CryptoNote::Currency& currency, const CryptoNote::BlockSummaryIndex& index, const CryptoNote::DifficultyCalculator& calculator, const char* stage) {
+  uint64_t expected = referenceDifficulty(currency, index);
+  uint64_t found = calculator.getNextDifficulty();
+  if (expected != found) {
+    cerr << "Wrong difficulty after " << stage << " at height " << index.size() << endl
+      << "Expected: " << expected << endl
+      << "Found: " << found << endl;
+    return false;
+  }
+
+  return true;
+}
+
+void push(CryptoNote::BlockSummaryIndex& index, CryptoNote::DifficultyCalculator& calculator, uint64_t timestamp, uint64_t difficulty) {
+  uint64_t cumulativeDifficulty = index.empty() ? difficulty : index.getCumulativeDifficulty(index.size() - 1) + difficulty;
+  index.push(timestamp, cumulativeDifficulty, 0, 0);
+  calculator.update();
+}
+
+void pop(CryptoNote::BlockSummaryIndex& index, CryptoNote::DifficultyCalculator& calculator) {
+  index.pop();
+  calculator.update();
+}
+
+bool replay(const CryptoNote::Currency& currency, const vector<uint64_t>& timestamps, const vector<uint64_t>& difficulties, size_t rollbackInterval, size_t maxRollbackDepth) {
+  CryptoNote::BlockSummaryIndex index;
+  CryptoNote::DifficultyCalculator calculator(currency, index);
+  std::mt19937_64 random(timestamps.size());
+
+  for (size_t n = 0; n < timestamps.size(); ++n) {
+    // nextDifficulty2 needs a positive amount of work in the window
+    push(index, calculator, timestamps[n], max<uint64_t>(difficulties[n], 1));
+    if (!check(currency, index, calculator, "push")) {
+      return false;
+    }
+
+    // every few blocks switch to an alternative chain and back, like switch_to_alternative_blockchain does
+    if (n % rollbackInterval == 0 && index.size() > 1) {
+      size_t depth = 1 + random() % min<size_t>(index.size() - 1, maxRollbackDepth);
+      vector<uint64_t> poppedTimestamps;
+      vector<uint64_t> poppedDifficulties;
+      for (size_t i = 0; i < depth; ++i) {
+        uint32_t top = index.size() - 1;
+        poppedTimestamps.push_back(index.getTimestamp(top));
+        poppedDifficulties.push_back(index.getCumulativeDifficulty(top) - index.getCumulativeDifficulty(top - 1));
+        pop(index, calculator);
+        if (!check(currency, index, calculator, "pop")) {
+          return false;
+        }
+      }
+
+      size_t alternativeLength = 1 + random() % (depth + 2);
+      for (size_t i = 0; i < alternativeLength; ++i) {
+        push(index, calculator, timestamps[n] + random() % 2000, 1 + random() % 100000);
+        if (!check(currency, index, calculator, "alternative push")) {
+          return false;
+        }
+      }
+
+      for (size_t i = 0; i < alternativeLength; ++i) {
+        pop(index, calculator);
+        if (!check(currency, index, calculator, "alternative pop")) {
+          return false;
+        }
+      }
+
+      for (size_t i = depth; i > 0; --i) {
+        push(index, calculator, poppedTimestamps[i - 1], poppedDifficulties[i - 1]);
+        if (!check(currency, index, calculator, "restore")) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    cerr << "Wrong arguments" << endl;
+    return 1;
+  }
+
+  vector<uint64_t> timestamps, difficulties;
+  fstream data(argv[1], fstream::in);
+  data.exceptions(fstream::badbit);
+  data.clear(data.rdstate());
+  uint64_t timestamp, difficulty;
+  while (data >> timestamp >> difficulty) {
+    timestamps.push_back(timestamp);
+    difficulties.push_back(difficulty);
+  }
+
+  if (timestamps.empty()) {
+    cerr << "No blocks in " << argv[1] << endl;
+    return 1;
+  }
+
+  Logging::ConsoleLogger logger;
+
+  // parameters of DifficultyTests, the cut removes most of the window
+  CryptoNote::CurrencyBuilder testCurrencyBuilder(logger);
+  testCurrencyBuilder.difficultyTarget(9);
+  testCurrencyBuilder.difficultyWindow(90);
+  testCurrencyBuilder.difficultyCut(40);
+  testCurrencyBuilder.difficultyLag(15);
+  CryptoNote::Currency testCurrency = testCurrencyBuilder.currency();
+
+  // rollbacks deeper than the whole window
+  if (!replay(testCurrency, timestamps, difficulties, 7, testCurrency.difficultyBlocksCount() + 5)) {
+    return 1;
+  }
+
+  // mainnet parameters
+  CryptoNote::Currency currency = CryptoNote::CurrencyBuilder(logger).currency();
+
+  // make the chain longer than the mainnet difficulty window so that it slides
+  vector<uint64_t> longTimestamps, longDifficulties;
+  while (longTimestamps.size() < 2 * currency.difficultyBlocksCount()) {
+    uint64_t timeOffset = longTimestamps.empty() ? 0 : longTimestamps.back();
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+      longTimestamps.push_back(timeOffset + timestamps[i]);
+      longDifficulties.push_back(difficulties[i]);
+    }
+  }
+
+  if (!replay(currency, longTimestamps, longDifficulties, 97, 30)) {
+    return 1;
+  }
+
+  return 0;
+}
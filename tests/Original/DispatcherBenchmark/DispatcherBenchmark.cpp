@@ -0,0 +1,169 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Dispatcher benchmark.
+// Prints how many context switches per second two contexts passing control to each other with events make,
+// how many connections per second a listener accepts and how many messages per second are echoed back
+// to several clients over loopback, with all contexts running on one dispatcher.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+
+using namespace std;
+using namespace System;
+
+namespace {
+
+const uint16_t PORT = 16181;
+
+template<typename F>
+void printRate(const string& name, const string& unit, size_t count, F run) {
+  auto start = chrono::steady_clock::now();
+  run();
+  auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+  cout << name << ": " << count << " " << unit << ", time: " << duration << " ms, " <<
+    static_cast<uint64_t>(count * 1000.0 / max<int64_t>(duration, 1)) << " " << unit << "/s" << endl;
+}
+
+// each round is two switches, one to each context
+void switchContexts(Dispatcher& dispatcher, size_t rounds) {
+  Event ping(dispatcher);
+  Event pong(dispatcher);
+  ContextGroup contextGroup(dispatcher);
+
+  contextGroup.spawn([&] {
+    for (size_t i = 0; i < rounds; ++i) {
+      ping.wait();
+      ping.clear();
+      pong.set();
+    }
+  });
+
+  contextGroup.spawn([&] {
+    for (size_t i = 0; i < rounds; ++i) {
+      ping.set();
+      pong.wait();
+      pong.clear();
+    }
+  });
+
+  contextGroup.wait();
+}
+
+void acceptConnections(Dispatcher& dispatcher, size_t clientCount, size_t connectionsPerClient) {
+  TcpListener listener(dispatcher, Ipv4Address("127.0.0.1"), PORT);
+  ContextGroup contextGroup(dispatcher);
+
+  contextGroup.spawn([&] {
+    for (size_t i = 0; i < clientCount * connectionsPerClient; ++i) {
+      TcpConnection connection = listener.accept();
+    }
+  });
+
+  for (size_t i = 0; i < clientCount; ++i) {
+    contextGroup.spawn([&] {
+      for (size_t j = 0; j < connectionsPerClient; ++j) {
+        TcpConnection connection = TcpConnector(dispatcher).connect(Ipv4Address("127.0.0.1"), PORT);
+      }
+    });
+  }
+
+  contextGroup.wait();
+}
+
+void echoMessages(Dispatcher& dispatcher, size_t clientCount, size_t messagesPerClient, size_t messageSize) {
+  TcpListener listener(dispatcher, Ipv4Address("127.0.0.1"), PORT);
+  vector<TcpConnection> connections;
+  connections.reserve(clientCount);
+  ContextGroup contextGroup(dispatcher);
+
+  contextGroup.spawn([&] {
+    for (size_t i = 0; i < clientCount; ++i) {
+      connections.emplace_back(listener.accept());
+      TcpConnection& connection = connections.back();
+      contextGroup.spawn([&connection] {
+        vector<uint8_t> buffer(4096);
+        for (;;) {
+          size_t size = connection.read(buffer.data(), buffer.size());
+          if (size == 0) {
+            break;
+          }
+
+          for (size_t offset = 0; offset < size;) {
+            offset += connection.write(buffer.data() + offset, size - offset);
+          }
+        }
+      });
+    }
+  });
+
+  for (size_t i = 0; i < clientCount; ++i) {
+    contextGroup.spawn([&] {
+      TcpConnection connection = TcpConnector(dispatcher).connect(Ipv4Address("127.0.0.1"), PORT);
+      vector<uint8_t> message(messageSize, 'x');
+      vector<uint8_t> reply(messageSize);
+      for (size_t j = 0; j < messagesPerClient; ++j) {
+        for (size_t offset = 0; offset < messageSize;) {
+          offset += connection.write(message.data() + offset, messageSize - offset);
+        }
+
+        for (size_t offset = 0; offset < messageSize;) {
+          size_t size = connection.read(reply.data() + offset, messageSize - offset);
+          if (size == 0) {
+            throw runtime_error("connection closed");
+          }
+
+          offset += size;
+        }
+      }
+    });
+  }
+
+  contextGroup.wait();
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    cerr << "Usage: " << argv[0] << " [switch rounds] [clients] [messages per client] [message size]" << endl;
+    return 1;
+  }
+
+  size_t rounds = argc > 1 ? stoul(argv[1]) : 1000000;
+  size_t clientCount = argc > 2 ? stoul(argv[2]) : 64;
+  size_t messagesPerClient = argc > 3 ? stoul(argv[3]) : 1000;
+  size_t messageSize = argc > 4 ? stoul(argv[4]) : 64;
+
+  Dispatcher dispatcher;
+
+  printRate("context switches", "switches", rounds * 2, [&] {
+    switchContexts(dispatcher, rounds);
+  });
+
+  size_t connectionsPerClient = max<size_t>(messagesPerClient / 10, 1);
+  printRate("accept, " + to_string(clientCount) + " clients", "connections", clientCount * connectionsPerClient, [&] {
+    acceptConnections(dispatcher, clientCount, connectionsPerClient);
+  });
+
+  printRate("echo, " + to_string(clientCount) + " clients, " + to_string(messageSize) + " bytes", "messages", clientCount * messagesPerClient, [&] {
+    echoMessages(dispatcher, clientCount, messagesPerClient, messageSize);
+  });
+
+  return 0;
+}
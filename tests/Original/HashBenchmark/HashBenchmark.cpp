@@ -0,0 +1,115 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// BLAKE2b benchmark.
+// Prints how many messages per second are hashed by every BLAKE2b backend the CPU supports, one message at a time
+// with blake2b() and 4 and 8 messages side by side with blake2b_x4() and blake2b_x8(), for messages of the sizes of
+// tree hash nodes, block hashing blobs, transactions and larger ones.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "crypto/blake2b-backend.h"
+
+using namespace std;
+
+namespace {
+
+const size_t HASH_SIZE = 32;
+
+template<typename F>
+void printRate(const string& name, size_t messageCount, size_t messageSize, F hash) {
+  auto start = chrono::steady_clock::now();
+  hash();
+  auto duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+  duration = max<int64_t>(duration, 1);
+
+  cout << name << ": " << messageCount << " messages, time: " << duration / 1000 << " ms, " <<
+    static_cast<uint64_t>(messageCount * 1000000.0 / duration) << " messages/s, " <<
+    static_cast<uint64_t>(messageCount * messageSize / static_cast<double>(duration)) << " MB/s" << endl;
+}
+
+void benchmarkBackend(blake2b_backend backend, const vector<uint8_t>& data, size_t messageSize, size_t messageCount) {
+  vector<uint8_t> hashes(8 * HASH_SIZE);
+  vector<const void*> in(8);
+  vector<size_t> inlen(8, messageSize);
+  const string name = string(blake2b_backend_name(backend)) + ", " + to_string(messageSize) + " bytes";
+
+  // the messages overlap so all of them fit in the cache
+  auto message = [&](size_t i) {
+    return data.data() + i % (data.size() - messageSize);
+  };
+
+  printRate(name + ", blake2b", messageCount, messageSize, [&] {
+    for (size_t i = 0; i < messageCount; ++i) {
+      blake2b(hashes.data(), HASH_SIZE, message(i), messageSize, nullptr, 0);
+    }
+  });
+
+  printRate(name + ", blake2b_x4", messageCount, messageSize, [&] {
+    for (size_t i = 0; i < messageCount; i += 4) {
+      for (size_t l = 0; l < 4; ++l) {
+        in[l] = message(i + l);
+      }
+
+      blake2b_x4(hashes.data(), HASH_SIZE, in.data(), inlen.data());
+    }
+  });
+
+  printRate(name + ", blake2b_x8", messageCount, messageSize, [&] {
+    for (size_t i = 0; i < messageCount; i += 8) {
+      for (size_t l = 0; l < 8; ++l) {
+        in[l] = message(i + l);
+      }
+
+      blake2b_x8(hashes.data(), HASH_SIZE, in.data(), inlen.data());
+    }
+  });
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    cerr << "Usage: " << argv[0] << " [megabytes per test] [message sizes ...]" << endl;
+    return 1;
+  }
+
+  size_t bytesPerTest = (argc > 1 ? stoul(argv[1]) : 64) * 1000000;
+
+  vector<size_t> messageSizes;
+  for (int i = 2; i < argc; ++i) {
+    messageSizes.push_back(stoul(argv[i]));
+  }
+
+  if (messageSizes.empty()) {
+    messageSizes = { 65, 76, 400, 4096 };
+  }
+
+  vector<uint8_t> data(64 * 1024 + *max_element(messageSizes.begin(), messageSizes.end()));
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  const blake2b_backend selectedBackend = blake2b_get_backend();
+  cout << "selected backend: " << blake2b_backend_name(selectedBackend) << endl;
+
+  for (size_t messageSize : messageSizes) {
+    // a multiple of 8 messages
+    size_t messageCount = max<size_t>(bytesPerTest / max<size_t>(messageSize, 1) / 8, 1) * 8;
+
+    for (int backend = BLAKE2B_BACKEND_REF; backend < BLAKE2B_BACKEND_COUNT; ++backend) {
+      if (blake2b_set_backend(static_cast<blake2b_backend>(backend)) == 0) {
+        benchmarkBackend(static_cast<blake2b_backend>(backend), data, messageSize, messageCount);
+      }
+    }
+  }
+
+  blake2b_set_backend(selectedBackend);
+  return 0;
+}
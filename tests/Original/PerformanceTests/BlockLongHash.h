@@ -0,0 +1,81 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "crypto/hash.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+
+// mining a block template with 100 transactions, every call hashes NONCE_HASH_BATCH nonces
+class test_block_longhash_base
+{
+public:
+  static const size_t loop_count = 100000;
+  static const size_t transaction_count = 100;
+
+  bool init()
+  {
+    CryptoNote::BaseInput input;
+    input.blockIndex = 1000;
+    m_block.baseTransaction.version = 1;
+    m_block.baseTransaction.unlockTime = 1000 + 10;
+    m_block.baseTransaction.inputs.push_back(input);
+    m_block.timestamp = 1500000000;
+
+    for (size_t i = 0; i < transaction_count; ++i)
+    {
+      m_block.transactionHashes.push_back(Crypto::cn_fast_hash(&i, sizeof(i)));
+    }
+
+    return true;
+  }
+
+protected:
+  CryptoNote::Block m_block;
+};
+
+// serializes the block and computes its Merkle root for every nonce
+class test_block_longhash : public test_block_longhash_base
+{
+public:
+  bool test()
+  {
+    Crypto::Hash hash;
+    for (size_t i = 0; i < Crypto::NONCE_HASH_BATCH; ++i)
+    {
+      ++m_block.nonce;
+      if (!CryptoNote::get_block_longhash(m_context, m_block, hash))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  Crypto::cn_context m_context;
+};
+
+// hashing blob built once, only the nonce is changed
+class test_block_nonce_hash : public test_block_longhash_base
+{
+public:
+  bool init()
+  {
+    return test_block_longhash_base::init() && CryptoNote::get_block_longhash_state(m_block, m_state);
+  }
+
+  bool test()
+  {
+    Crypto::Hash hashes[Crypto::NONCE_HASH_BATCH];
+    Crypto::nonce_hash(m_state, m_block.nonce, 1, Crypto::NONCE_HASH_BATCH, hashes);
+    m_block.nonce += Crypto::NONCE_HASH_BATCH;
+    return true;
+  }
+
+private:
+  Crypto::nonce_hash_state m_state;
+};
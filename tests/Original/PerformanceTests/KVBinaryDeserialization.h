@@ -0,0 +1,80 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "Common/MemoryInputStream.h"
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
+#include "Serialization/KVBinaryInputBufferSerializer.h"
+#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "Serialization/SerializationTools.h"
+
+// a NOTIFY_RESPONSE_GET_OBJECTS message as sent during synchronization, each block with a few transactions of about 2 KB
+template<size_t a_block_count>
+class test_kv_binary_deserialization_base
+{
+public:
+  static const size_t loop_count = 100;
+  static const size_t block_count = a_block_count;
+  static const size_t transactions_per_block = 4;
+
+  bool init()
+  {
+    CryptoNote::NOTIFY_RESPONSE_GET_OBJECTS::request request;
+    request.current_blockchain_height = 1000000;
+
+    for (size_t i = 0; i < block_count; ++i)
+    {
+      CryptoNote::block_complete_entry entry;
+      entry.block = std::string(400, static_cast<char>(i));
+
+      for (size_t j = 0; j < transactions_per_block; ++j)
+      {
+        entry.txs.push_back(std::string(2000, static_cast<char>(j)));
+      }
+
+      request.blocks.push_back(entry);
+    }
+
+    m_message = CryptoNote::storeToBinaryKeyValue(request);
+    return true;
+  }
+
+protected:
+  bool check(const CryptoNote::NOTIFY_RESPONSE_GET_OBJECTS::request& request) const
+  {
+    return request.blocks.size() == block_count && request.blocks.back().txs.size() == transactions_per_block;
+  }
+
+  std::string m_message;
+};
+
+// builds a Common::JsonValue tree of the message first
+template<size_t a_block_count>
+class test_kv_binary_stream_deserialization : public test_kv_binary_deserialization_base<a_block_count>
+{
+public:
+  bool test()
+  {
+    CryptoNote::NOTIFY_RESPONSE_GET_OBJECTS::request request;
+    Common::MemoryInputStream stream(this->m_message.data(), this->m_message.size());
+    CryptoNote::KVBinaryInputStreamSerializer serializer(stream);
+    serialize(request, serializer);
+    return this->check(request);
+  }
+};
+
+// reads the message in place
+template<size_t a_block_count>
+class test_kv_binary_buffer_deserialization : public test_kv_binary_deserialization_base<a_block_count>
+{
+public:
+  bool test()
+  {
+    CryptoNote::NOTIFY_RESPONSE_GET_OBJECTS::request request;
+    CryptoNote::KVBinaryInputBufferSerializer serializer(this->m_message.data(), this->m_message.size());
+    serialize(request, serializer);
+    return this->check(request);
+  }
+};
@@ -0,0 +1,82 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "crypto/hash.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+
+// merkle roots of a block template with 1000 transactions for TREE_HASH_LANES coinbase transactions that differ in
+// their extra nonce
+class test_tx_tree_hash_base
+{
+public:
+  static const size_t loop_count = 1000;
+  static const size_t transaction_count = 1000;
+
+  bool init()
+  {
+    CryptoNote::BaseInput input;
+    input.blockIndex = 1000;
+    CryptoNote::Transaction baseTransaction;
+    baseTransaction.version = 1;
+    baseTransaction.unlockTime = 1000 + 10;
+    baseTransaction.inputs.push_back(input);
+    baseTransaction.extra.resize(200);
+
+    for (size_t i = 0; i < Crypto::TREE_HASH_LANES; ++i)
+    {
+      baseTransaction.extra.back() = static_cast<uint8_t>(i);
+      m_baseTransactions.push_back(baseTransaction);
+    }
+
+    for (size_t i = 0; i < transaction_count; ++i)
+    {
+      m_block.transactionHashes.push_back(Crypto::cn_fast_hash(&i, sizeof(i)));
+    }
+
+    return true;
+  }
+
+protected:
+  CryptoNote::Block m_block;
+  std::vector<CryptoNote::Transaction> m_baseTransactions;
+};
+
+// one get_tx_tree_hash() per coinbase transaction
+class test_tx_tree_hash : public test_tx_tree_hash_base
+{
+public:
+  bool test()
+  {
+    for (const CryptoNote::Transaction& baseTransaction : m_baseTransactions)
+    {
+      m_block.baseTransaction = baseTransaction;
+      CryptoNote::get_tx_tree_hash(m_block);
+    }
+
+    return true;
+  }
+};
+
+// the chains of all coinbase transactions hashed side by side
+class test_tx_tree_hash_roots : public test_tx_tree_hash_base
+{
+public:
+  bool test()
+  {
+    std::vector<Crypto::Hash> roots;
+    std::vector<Crypto::Hash> baseTransactionHashes;
+    for (const CryptoNote::Transaction& baseTransaction : m_baseTransactions)
+    {
+      baseTransactionHashes.clear();
+      CryptoNote::get_base_tx_tree_hashes(baseTransaction, baseTransactionHashes);
+      roots.push_back(CryptoNote::get_tx_tree_hash(baseTransactionHashes));
+    }
+
+    Crypto::tree_hash_extend(roots.data(), roots.size(), m_block.transactionHashes.data(), m_block.transactionHashes.size());
+    return roots.size() == m_baseTransactions.size();
+  }
+};
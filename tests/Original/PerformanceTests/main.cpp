@@ -7,6 +7,7 @@
 #include "PerformanceUtils.h"
 
 // tests
+#include "BlockLongHash.h"
 #include "ConstructTransaction.h"
 #include "CheckRingSignature.h"
 #include "CryptoNoteSlowHash.h"
@@ -16,6 +17,8 @@
 #include "GenerateKeyImage.h"
 #include "GenerateKeyImageHelper.h"
 #include "IsOutToAccount.h"
+#include "KVBinaryDeserialization.h"
+#include "TreeHash.h"
 
 int main(int argc, char** argv)
 {
@@ -60,6 +63,17 @@ int main(int argc, char** argv)
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
 
+  TEST_PERFORMANCE0(test_block_longhash);
+  TEST_PERFORMANCE0(test_block_nonce_hash);
+
+  TEST_PERFORMANCE0(test_tx_tree_hash);
+  TEST_PERFORMANCE0(test_tx_tree_hash_roots);
+
+  TEST_PERFORMANCE1(test_kv_binary_stream_deserialization, 10);
+  TEST_PERFORMANCE1(test_kv_binary_buffer_deserialization, 10);
+  TEST_PERFORMANCE1(test_kv_binary_stream_deserialization, 200);
+  TEST_PERFORMANCE1(test_kv_binary_buffer_deserialization, 200);
+
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
   return 0;
@@ -0,0 +1,201 @@
+// Copyright (c) 2018-2019 The Cash2 developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Output scanning benchmark.
+// Creates random transactions and prints how many outputs per second are checked against a view key,
+// once with one key derivation and one underive_public_key() per output as wallets did before and once with
+// the batched functions TransfersConsumer uses, on one thread and on every number of threads given.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/WorkerPool.h"
+#include "crypto/crypto.h"
+
+using namespace std;
+
+namespace {
+
+// same batch size as TransfersConsumer
+const size_t SCAN_BATCH_SIZE = 64;
+
+struct ScanTransaction {
+  Crypto::PublicKey publicKey;
+  vector<Crypto::PublicKey> outputKeys;
+};
+
+vector<ScanTransaction> createTransactions(const Crypto::PublicKey& viewPublicKey, const Crypto::PublicKey& spendPublicKey, size_t transactionCount, size_t outputsPerTransaction) {
+  vector<ScanTransaction> transactions(transactionCount);
+
+  for (size_t i = 0; i < transactionCount; ++i) {
+    Crypto::SecretKey transactionSecretKey;
+    Crypto::generate_keys(transactions[i].publicKey, transactionSecretKey);
+
+    // every fourth output goes to the scanned address
+    Crypto::KeyDerivation derivation;
+    Crypto::generate_key_derivation(viewPublicKey, transactionSecretKey, derivation);
+
+    for (size_t j = 0; j < outputsPerTransaction; ++j) {
+      Crypto::PublicKey key;
+      if ((i + j) % 4 == 0) {
+        Crypto::derive_public_key(derivation, j, spendPublicKey, key);
+      } else {
+        Crypto::SecretKey secretKey;
+        Crypto::generate_keys(key, secretKey);
+      }
+
+      transactions[i].outputKeys.push_back(key);
+    }
+  }
+
+  return transactions;
+}
+
+size_t scanOneByOne(const vector<ScanTransaction>& transactions, const Crypto::SecretKey& viewSecretKey, const Crypto::PublicKey& spendPublicKey) {
+  size_t found = 0;
+
+  for (const ScanTransaction& transaction : transactions) {
+    Crypto::KeyDerivation derivation;
+    if (!Crypto::generate_key_derivation(transaction.publicKey, viewSecretKey, derivation)) {
+      continue;
+    }
+
+    for (size_t j = 0; j < transaction.outputKeys.size(); ++j) {
+      Crypto::PublicKey base;
+      if (Crypto::underive_public_key(derivation, j, transaction.outputKeys[j], base) && base == spendPublicKey) {
+        ++found;
+      }
+    }
+  }
+
+  return found;
+}
+
+size_t scanBatch(const ScanTransaction* transactions, size_t count, const Crypto::SecretKey& viewSecretKey, const Crypto::PublicKey& spendPublicKey) {
+  vector<Crypto::PublicKey> publicKeys;
+  for (size_t i = 0; i < count; ++i) {
+    publicKeys.push_back(transactions[i].publicKey);
+  }
+
+  vector<Crypto::KeyDerivation> derivations(count);
+  unique_ptr<bool[]> derivationsValid(new bool[count]);
+  Crypto::generate_key_derivations(publicKeys.data(), count, viewSecretKey, derivations.data(), derivationsValid.get());
+
+  vector<Crypto::KeyDerivation> keyDerivations;
+  vector<size_t> keyIndexes;
+  vector<Crypto::PublicKey> keys;
+  for (size_t i = 0; i < count; ++i) {
+    if (!derivationsValid[i]) {
+      continue;
+    }
+
+    for (size_t j = 0; j < transactions[i].outputKeys.size(); ++j) {
+      keyDerivations.push_back(derivations[i]);
+      keyIndexes.push_back(j);
+      keys.push_back(transactions[i].outputKeys[j]);
+    }
+  }
+
+  vector<Crypto::PublicKey> bases(keys.size());
+  unique_ptr<bool[]> basesValid(new bool[keys.size()]);
+  Crypto::underive_public_keys(keyDerivations.data(), keyIndexes.data(), keys.data(), keys.size(), bases.data(), basesValid.get());
+
+  size_t found = 0;
+  for (size_t k = 0; k < keys.size(); ++k) {
+    if (basesValid[k] && bases[k] == spendPublicKey) {
+      ++found;
+    }
+  }
+
+  return found;
+}
+
+size_t scanBatches(const vector<ScanTransaction>& transactions, const Crypto::SecretKey& viewSecretKey, const Crypto::PublicKey& spendPublicKey, Common::WorkerPool& pool) {
+  size_t batchCount = (transactions.size() + SCAN_BATCH_SIZE - 1) / SCAN_BATCH_SIZE;
+  vector<size_t> found(batchCount);
+
+  pool.parallelFor(batchCount, [&](size_t batch) {
+    size_t begin = batch * SCAN_BATCH_SIZE;
+    size_t count = min(SCAN_BATCH_SIZE, transactions.size() - begin);
+    found[batch] = scanBatch(transactions.data() + begin, count, viewSecretKey, spendPublicKey);
+  });
+
+  size_t total = 0;
+  for (size_t count : found) {
+    total += count;
+  }
+
+  return total;
+}
+
+template<typename F>
+void printRate(const string& name, size_t outputCount, size_t expected, F scan) {
+  auto start = chrono::steady_clock::now();
+  size_t found = scan();
+  auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+  cout << name << ": " << outputCount << " outputs, time: " << duration << " ms, " <<
+    static_cast<uint64_t>(outputCount * 1000.0 / max<int64_t>(duration, 1)) << " outputs/s";
+  if (found != expected) {
+    cout << ", found " << found << " outputs instead of " << expected;
+  }
+
+  cout << endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    cerr << "Usage: " << argv[0] << " [transactions] [outputs per transaction] [threads ...]" << endl;
+    return 1;
+  }
+
+  size_t transactionCount = argc > 1 ? stoul(argv[1]) : 10000;
+  size_t outputsPerTransaction = argc > 2 ? stoul(argv[2]) : 4;
+
+  vector<size_t> threadCounts;
+  for (int i = 3; i < argc; ++i) {
+    threadCounts.push_back(stoul(argv[i]));
+  }
+
+  if (threadCounts.empty()) {
+    threadCounts = { max<size_t>(thread::hardware_concurrency(), 2) };
+  }
+
+  Crypto::PublicKey viewPublicKey;
+  Crypto::SecretKey viewSecretKey;
+  Crypto::generate_keys(viewPublicKey, viewSecretKey);
+  Crypto::PublicKey spendPublicKey;
+  Crypto::SecretKey spendSecretKey;
+  Crypto::generate_keys(spendPublicKey, spendSecretKey);
+
+  vector<ScanTransaction> transactions = createTransactions(viewPublicKey, spendPublicKey, transactionCount, outputsPerTransaction);
+  size_t outputCount = transactionCount * outputsPerTransaction;
+  size_t expected = scanOneByOne(transactions, viewSecretKey, spendPublicKey);
+
+  printRate("one by one, 1 thread", outputCount, expected, [&] {
+    return scanOneByOne(transactions, viewSecretKey, spendPublicKey);
+  });
+
+  Common::WorkerPool singleThread(1);
+  printRate("batched, 1 thread", outputCount, expected, [&] {
+    return scanBatches(transactions, viewSecretKey, spendPublicKey, singleThread);
+  });
+
+  for (size_t threadCount : threadCounts) {
+    Common::WorkerPool pool(threadCount);
+    printRate("batched, " + to_string(pool.getThreadCount()) + " threads", outputCount, expected, [&] {
+      return scanBatches(transactions, viewSecretKey, spendPublicKey, pool);
+    });
+  }
+
+  return 0;
+}
@@ -48,6 +48,8 @@ public:
   virtual bool on_idle() override { return false; }
   virtual void pause_mining() override {}
   virtual void update_block_template_and_resume_mining() override {}
+  virtual bool prepareBlock(const CryptoNote::block_complete_entry& entry, CryptoNote::PreparedBlock& block) override { return false; }
+  virtual bool addPreparedBlock(const CryptoNote::PreparedBlock& block, CryptoNote::block_verification_context& bvc) override { return false; }
   virtual bool handle_incoming_block_blob(const CryptoNote::BinaryArray& block_blob, CryptoNote::block_verification_context& bvc, bool control_miner, bool relay_block) override { return false; }
   virtual bool handle_get_objects(CryptoNote::NOTIFY_REQUEST_GET_OBJECTS::request& arg, CryptoNote::NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) override { return false; }
   virtual void on_synchronized() override {}
@@ -7,6 +7,7 @@
 #include "gtest/gtest.h"
 
 #include <algorithm>
+#include <unordered_set>
 
 #include <boost/filesystem/operations.hpp>
 
@@ -47,6 +48,42 @@ class TransactionValidator : public CryptoNote::ITransactionValidator {
   }
 };
 
+// counts the checks made by the pool before adding a transaction to a block template
+class CountingTransactionValidator : public CryptoNote::ITransactionValidator {
+public:
+  CountingTransactionValidator() : readyChecks(0) {}
+
+  virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock) override {
+    return true;
+  }
+
+  virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
+    ++readyChecks;
+    return true;
+  }
+
+  virtual bool haveSpentKeyImages(const CryptoNote::Transaction& tx) override {
+    for (const auto& input : tx.inputs) {
+      if (input.type() == typeid(KeyInput) && spentKeyImages.count(boost::get<KeyInput>(input).keyImage) > 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  virtual bool checkTransactionSize(size_t blobSize) override {
+    return true;
+  }
+
+  virtual bool checkTransactionExtraSize(size_t txExtraSize) override {
+    return true;
+  }
+
+  size_t readyChecks;
+  std::unordered_set<Crypto::KeyImage> spentKeyImages;
+};
+
 class FakeTimeProvider : public ITimeProvider {
 public:
   FakeTimeProvider(time_t currentTime = time(nullptr))
@@ -669,6 +706,97 @@ TEST_F(tx_pool, RecentlyDeletedTxInfoIsSerializedAndDeserialized) {
   ASSERT_EQ(1, pool->get_transactions_count());
 }
 
+TEST_F(tx_pool, fill_block_template2_checks_transactions_once_per_tip) {
+  TestPool<CountingTransactionValidator, RealTimeProvider> pool(currency, logger);
+
+  for (int i = 0; i < 3; ++i) {
+    Transaction tx;
+    GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    ASSERT_TRUE(pool.add_tx(tx, tvc, false, 0));
+  }
+
+  Block bl;
+  InitBlock(bl);
+
+  size_t totalSize = 0;
+  uint64_t txFee = 0;
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(3, bl.transactionHashes.size());
+  ASSERT_EQ(3, pool.validator.readyChecks);
+
+  // the same tip, nothing is checked again
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(3, bl.transactionHashes.size());
+  ASSERT_EQ(3, pool.validator.readyChecks);
+
+  // a tip the pool was not told about, everything is checked again
+  Crypto::Hash otherTip = NULL_HASH;
+  otherTip.data[0] = 1;
+  bl.previousBlockHash = otherTip;
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(3, bl.transactionHashes.size());
+  ASSERT_EQ(6, pool.validator.readyChecks);
+
+  ASSERT_TRUE(pool.on_blockchain_dec(0, NULL_HASH));
+  bl.previousBlockHash = NULL_HASH;
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(3, bl.transactionHashes.size());
+  ASSERT_EQ(9, pool.validator.readyChecks);
+}
+
+TEST_F(tx_pool, fill_block_template2_checks_transactions_spending_block_inputs_again) {
+  TestPool<CountingTransactionValidator, RealTimeProvider> pool(currency, logger);
+
+  Transaction spentTx;
+  Transaction tx;
+  GenerateTransaction(currency, spentTx, currency.minimumFee(), 1);
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(spentTx, tvc, false, 0));
+  ASSERT_TRUE(pool.add_tx(tx, tvc, false, 0));
+
+  Block bl;
+  InitBlock(bl);
+
+  size_t totalSize = 0;
+  uint64_t txFee = 0;
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(2, bl.transactionHashes.size());
+  ASSERT_EQ(2, pool.validator.readyChecks);
+
+  // a block spends the key image of spentTx
+  Crypto::Hash topBlockId = getObjectHash(tx);
+  pool.validator.spentKeyImages.insert(boost::get<KeyInput>(spentTx.inputs[0]).keyImage);
+  ASSERT_TRUE(pool.on_blockchain_inc(1, topBlockId, NULL_HASH, { spentTx }));
+
+  bl.previousBlockHash = topBlockId;
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(1, bl.transactionHashes.size());
+  ASSERT_EQ(getObjectHash(tx), bl.transactionHashes[0]);
+  ASSERT_EQ(3, pool.validator.readyChecks);
+
+  // the transactions that were not ready are checked again with the next block
+  Crypto::Hash nextBlockId = getObjectHash(spentTx);
+  ASSERT_TRUE(pool.on_blockchain_inc(2, nextBlockId, topBlockId, std::vector<Transaction>()));
+
+  bl.previousBlockHash = nextBlockId;
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(1, bl.transactionHashes.size());
+  ASSERT_EQ(4, pool.validator.readyChecks);
+
+  // taken transactions leave the ready set
+  Transaction txOut;
+  size_t blobSize;
+  uint64_t fee;
+  ASSERT_TRUE(pool.take_tx(getObjectHash(tx), txOut, blobSize, fee));
+  ASSERT_TRUE(pool.fill_block_template2(bl, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_TRUE(bl.transactionHashes.empty());
+  ASSERT_EQ(4, pool.validator.readyChecks);
+}
+
 TEST_F(tx_pool, TxPoolAcceptsValidFusionTransaction) {
   TransactionValidator validator;
   FakeTimeProvider timeProvider;